@@ -0,0 +1,785 @@
+#include "stdafx.h"
+#include "LaneCorpus.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// DEFUALT_BOUNDARY_W of RoadLaneManager.cpp
+#define LANE_CORPUS_BOUNDARY_W 5
+
+static uint64_t AlignOffset(uint64_t offset)
+{
+	return (offset + 7) & ~(uint64_t)7;
+}
+
+void LaneCorpus::Reset()
+{
+	frames_.clear();
+	lines_.clear();
+	boundarys_.clear();
+	polygons_.clear();
+	points_x_.clear();
+	points_y_.clear();
+	points_r_.clear();
+	occlusions_.clear();
+	polygon_points_.clear();
+	strings_.clear();
+}
+
+uint32_t LaneCorpus::AddString(const string &str)
+{
+	uint32_t offset = strings_.size();
+	strings_.insert(strings_.end(), str.begin(), str.end());
+	strings_.push_back('\0');
+	return offset;
+}
+
+void LaneCorpus::AddCurve(vector<LaneCorpusCurve> &curves, const int32_t type[6],
+	const vector<double> &x, const vector<double> &y, const vector<double> &r,
+	const std::vector<std::pair<float, float>> &occ)
+{
+	LaneCorpusCurve curve;
+	memcpy(curve.type, type, sizeof(curve.type));
+	curve.point_count = x.size();
+	curve.occlusion_count = occ.size();
+	curve.first_point = points_x_.size();
+	curve.first_occlusion = occlusions_.size() / 2;
+	points_x_.insert(points_x_.end(), x.begin(), x.end());
+	points_y_.insert(points_y_.end(), y.begin(), y.end());
+	points_r_.insert(points_r_.end(), r.begin(), r.end());
+	for (int k = 0; k < occ.size(); k++) {
+		occlusions_.push_back(occ[k].first);
+		occlusions_.push_back(occ[k].second);
+	}
+	curves.push_back(curve);
+}
+
+int LaneCorpus::Append(const RoadLaneManager &road, const char *name)
+{
+	LaneCorpusFrame frame;
+	memset(&frame, 0, sizeof(frame));
+	frame.name_offset = AddString(name ? name : "");
+	frame.tool_version_offset = AddString(road.tool_version());
+	frame.image_width = road.GetImageW();
+	frame.image_height = road.GetImageH();
+	frame.vp_y_ratio = road.vp_y_ratio();
+	frame.vp_x_ratio = road.vp_x_ratio();
+	frame.has_vp = road.has_vp();
+
+	frame.first_line = lines_.size();
+	frame.line_count = road.GetSizeLaneLine();
+	for (int i = 0; i < road.GetSizeLaneLine(); i++) {
+		const LaneLine &line = *road.line_ptr(i);
+		int32_t type[6] = { line.info.type1, line.info.type2, line.info.type3,
+			line.info.type4, line.info.type5, line.info.type6 };
+		AddCurve(lines_, type, line.spline_x_, line.spline_y_, line.line_r_, line.info.occlusions_top_bottom_);
+	}
+
+	frame.first_boundary = boundarys_.size();
+	frame.boundary_count = road.GetSizeBoundary();
+	for (int i = 0; i < road.GetSizeBoundary(); i++) {
+		const BoundaryLine &line = *road.boundary_ptr(i);
+		int32_t type[6] = { line.info.type3, line.info.BoundaryType, line.info.Situation, 0, 0, 0 };
+		AddCurve(boundarys_, type, line.spline_x_, line.spline_y_, line.line_r_, line.info.occlusions_top_bottom_);
+	}
+
+	frame.first_polygon = polygons_.size();
+	frame.polygon_count = road.GetSizeRoadMarking();
+	for (int i = 0; i < road.GetSizeRoadMarking(); i++) {
+		const RoadMarkingPolygon &polygon = *road.roadmarking_ptr(i);
+		LaneCorpusPolygon record;
+		record.type = polygon.GetRoadMarkerInfo().GetType();
+		record.point_count = polygon.GetPolygonPointNum();
+		record.first_point = polygon_points_.size() / 2;
+		for (int j = 0; j < polygon.GetPolygonPointNum(); j++) {
+			PPOINTF point = polygon.GetPoint(j);
+			polygon_points_.push_back(point.x);
+			polygon_points_.push_back(point.y);
+		}
+		polygons_.push_back(record);
+	}
+
+	frames_.push_back(frame);
+	return frames_.size() - 1;
+}
+
+void LaneCorpus::GetCounts(LaneCorpusHeader &counts) const
+{
+	memset(&counts, 0, sizeof(counts));
+	counts.frame_count = frames_.size();
+	counts.line_count = lines_.size();
+	counts.boundary_count = boundarys_.size();
+	counts.polygon_count = polygons_.size();
+	counts.point_count = points_x_.size();
+	counts.occlusion_count = occlusions_.size() / 2;
+	counts.polygon_point_count = polygon_points_.size() / 2;
+	counts.string_bytes = strings_.size();
+}
+
+void LaneCorpus::Truncate(const LaneCorpusHeader &counts)
+{
+	frames_.resize(counts.frame_count);
+	lines_.resize(counts.line_count);
+	boundarys_.resize(counts.boundary_count);
+	polygons_.resize(counts.polygon_count);
+	points_x_.resize(counts.point_count);
+	points_y_.resize(counts.point_count);
+	points_r_.resize(counts.point_count);
+	occlusions_.resize(counts.occlusion_count * 2);
+	polygon_points_.resize(counts.polygon_point_count * 2);
+	strings_.resize(counts.string_bytes);
+}
+
+bool LaneCorpus::AppendXml(const char *szpath, const char *name)
+{
+	// reused across calls on the same thread
+	static thread_local vector<char> buffer;
+	if (!ReadLaneFileToBuffer(szpath, buffer))
+		return false;
+	return AppendXmlBuffer(&buffer[0], buffer.size() - 1, name);
+}
+
+// Point / Occlusion children of a Spline or Boundary element.
+bool LaneCorpus::ParseCurve(LaneXmlPullParser &parser, vector<LaneCorpusCurve> &curves,
+	const int32_t type[6], int point_num, int occ_num)
+{
+	LaneCorpusCurve curve;
+	memcpy(curve.type, type, sizeof(curve.type));
+	curve.point_count = 0;
+	curve.occlusion_count = 0;
+	curve.first_point = points_x_.size();
+	curve.first_occlusion = occlusions_.size() / 2;
+
+	for (;;) {
+		LaneXmlPullParser::Token token = parser.Next();
+		if (token == LaneXmlPullParser::TOKEN_END)
+			break;
+		if (token != LaneXmlPullParser::TOKEN_START)
+			return false;
+
+		if (parser.IsElement("Point") && (int)curve.point_count < point_num) {
+			double px = 0, py = 0, pr = 0;
+			parser.QueryDoubleAttribute("x", &px);
+			parser.QueryDoubleAttribute("y", &py);
+			parser.QueryDoubleAttribute("r", &pr);
+			points_x_.push_back(px);
+			points_y_.push_back(py);
+			points_r_.push_back(pr);
+			curve.point_count++;
+		}
+		else if (parser.IsElement("Occlusion") && (int)curve.occlusion_count < occ_num) {
+			float top_y = 0, bottom_y = 0;
+			parser.QueryFloatAttribute("top", &top_y);
+			parser.QueryFloatAttribute("bottom", &bottom_y);
+			occlusions_.push_back(top_y);
+			occlusions_.push_back(bottom_y);
+			curve.occlusion_count++;
+		}
+		if (!parser.SkipElement())
+			return false;
+	}
+	curves.push_back(curve);
+	return true;
+}
+
+bool LaneCorpus::AppendXmlBuffer(const char *data, size_t size, const char *name)
+{
+	LaneCorpusHeader counts;
+	GetCounts(counts);
+
+	LaneXmlPullParser parser(data, data + size);
+	LaneXmlPullParser::Token token = parser.Next();
+	if (token != LaneXmlPullParser::TOKEN_START)
+		return false;
+
+	// defaults of RoadLaneManager
+	LaneCorpusFrame frame;
+	memset(&frame, 0, sizeof(frame));
+	frame.vp_y_ratio = 0.5;
+	frame.vp_x_ratio = 0.5;
+	string tool_version;
+	parser.QueryStringAttribute("toolVersion", &tool_version);
+	parser.QueryIntAttribute("imageWidth", &frame.image_width);
+	parser.QueryIntAttribute("imageHeight", &frame.image_height);
+	frame.first_line = lines_.size();
+	frame.first_boundary = boundarys_.size();
+	frame.first_polygon = polygons_.size();
+
+	bool succ = true;
+	while (succ) {
+		token = parser.Next();
+		if (token == LaneXmlPullParser::TOKEN_END)
+			break;
+		if (token != LaneXmlPullParser::TOKEN_START) {
+			succ = false;
+			break;
+		}
+
+		if (parser.IsElement("VP")) {
+			bool has_vp = false;
+			parser.QueryBoolAttribute("hasVP", &has_vp);
+			parser.QueryDoubleAttribute("y_ratio", &frame.vp_y_ratio);
+			parser.QueryDoubleAttribute("x_ratio", &frame.vp_x_ratio);
+			frame.has_vp = has_vp;
+			succ = parser.SkipElement();
+		}
+		else if (parser.IsElement("Splines")) {
+			int spline_num = 0;
+			parser.QueryIntAttribute("splineNum", &spline_num);
+			while (succ && (token = parser.Next()) == LaneXmlPullParser::TOKEN_START) {
+				if (!parser.IsElement("Spline") || (int)frame.line_count >= spline_num) {
+					succ = parser.SkipElement();
+					continue;
+				}
+				int32_t type[6] = { 0, };
+				int point_num = 0, occ_num = 0;
+				parser.QueryIntAttribute("type1", &type[0]);
+				parser.QueryIntAttribute("type2", &type[1]);
+				parser.QueryIntAttribute("type3", &type[2]);
+				parser.QueryIntAttribute("type4", &type[3]);
+				parser.QueryIntAttribute("type5", &type[4]);
+				parser.QueryIntAttribute("type6", &type[5]);
+				parser.QueryIntAttribute("pointNum", &point_num);
+				parser.QueryIntAttribute("occNum", &occ_num);
+				succ = ParseCurve(parser, lines_, type, point_num, occ_num);
+				frame.line_count++;
+			}
+			succ = succ && token == LaneXmlPullParser::TOKEN_END;
+		}
+		else if (parser.IsElement("Polygons")) {
+			int polygon_num = 0;
+			parser.QueryIntAttribute("polygonNum", &polygon_num);
+			while (succ && (token = parser.Next()) == LaneXmlPullParser::TOKEN_START) {
+				if (!parser.IsElement("Polygon") || (int)frame.polygon_count >= polygon_num) {
+					succ = parser.SkipElement();
+					continue;
+				}
+				LaneCorpusPolygon polygon;
+				int point_num = 0;
+				polygon.type = 0;
+				polygon.point_count = 0;
+				polygon.first_point = polygon_points_.size() / 2;
+				parser.QueryIntAttribute("pointNum", &point_num);
+				parser.QueryIntAttribute("type", &polygon.type);
+				// RoadLaneManager maps unknown types to hard negative
+				if (polygon.type < RoadMarkerInfo::ROAD_MARKER_TYPE_HARD_NEGATIVE ||
+					polygon.type > RoadMarkerInfo::ROAD_MARKER_TYPE_SPEED_BUMP)
+					polygon.type = RoadMarkerInfo::ROAD_MARKER_TYPE_HARD_NEGATIVE;
+				while (succ && (token = parser.Next()) == LaneXmlPullParser::TOKEN_START) {
+					if (parser.IsElement("Point") && (int)polygon.point_count < point_num) {
+						float px = 0, py = 0;
+						parser.QueryFloatAttribute("x", &px);
+						parser.QueryFloatAttribute("y", &py);
+						polygon_points_.push_back(px);
+						polygon_points_.push_back(py);
+						polygon.point_count++;
+					}
+					succ = parser.SkipElement();
+				}
+				succ = succ && token == LaneXmlPullParser::TOKEN_END;
+				// RoadMarkingPolygon::SetPoints drops polygons with less than 3 points
+				if (polygon.point_count < 3) {
+					polygon_points_.resize(polygon.first_point * 2);
+					polygon.point_count = 0;
+				}
+				polygons_.push_back(polygon);
+				frame.polygon_count++;
+			}
+			succ = succ && token == LaneXmlPullParser::TOKEN_END;
+		}
+		else if (parser.IsElement("Boundarys")) {
+			int boundary_num = 0;
+			parser.QueryIntAttribute("boundaryNum", &boundary_num);
+			while (succ && (token = parser.Next()) == LaneXmlPullParser::TOKEN_START) {
+				if (!parser.IsElement("Boundary") || (int)frame.boundary_count >= boundary_num) {
+					succ = parser.SkipElement();
+					continue;
+				}
+				int32_t type[6] = { 0, };
+				int point_num = 0, occ_num = 0;
+				parser.QueryIntAttribute("type3", &type[0]);
+				parser.QueryIntAttribute("boundary", &type[1]);
+				parser.QueryIntAttribute("pointNum", &point_num);
+				parser.QueryIntAttribute("occNum", &occ_num);
+				succ = ParseCurve(parser, boundarys_, type, point_num, occ_num);
+				frame.boundary_count++;
+				if (!succ) break;
+
+				LaneCorpusCurve &curve = boundarys_.back();
+				std::fill(points_r_.begin() + curve.first_point, points_r_.end(), (double)LANE_CORPUS_BOUNDARY_W);
+
+				// same side inference as RoadLaneManager::ReadFile
+				int position = curve.type[0] % (1 << 8);
+				if (position == BoundaryInfo::LEFT || position == BoundaryInfo::RIGHT) {
+					bool clamped = false;   // id clamped as BoundaryInfo::SetFileType3 does
+					curve.type[0] = char(position) + (LaneTypeFieldValue(curve.type[0] >> 8, 8, clamped) << 8);
+				}
+				else {
+					int boundary_unknown_id = 8;
+					double average_x = 0;
+					if (curve.point_count)
+						average_x = (points_x_[curve.first_point] + points_x_[curve.first_point + curve.point_count - 1]) / 2;
+					position = average_x < frame.image_width / 2 ? BoundaryInfo::LEFT : BoundaryInfo::RIGHT;
+					curve.type[0] = char(position) + (boundary_unknown_id << 8);
+				}
+			}
+			succ = succ && token == LaneXmlPullParser::TOKEN_END;
+		}
+		else {
+			succ = parser.SkipElement();
+		}
+	}
+	if (!succ) {
+		Truncate(counts);
+		return false;
+	}
+
+	frame.name_offset = AddString(name ? name : "");
+	frame.tool_version_offset = AddString(tool_version);
+	frames_.push_back(frame);
+	return true;
+}
+
+void LaneCorpus::Merge(const LaneCorpus &other)
+{
+	LaneCorpusHeader base;
+	GetCounts(base);
+
+	frames_.insert(frames_.end(), other.frames_.begin(), other.frames_.end());
+	for (size_t i = base.frame_count; i < frames_.size(); i++) {
+		LaneCorpusFrame &frame = frames_[i];
+		frame.name_offset += base.string_bytes;
+		frame.tool_version_offset += base.string_bytes;
+		frame.first_line += base.line_count;
+		frame.first_boundary += base.boundary_count;
+		frame.first_polygon += base.polygon_count;
+	}
+	lines_.insert(lines_.end(), other.lines_.begin(), other.lines_.end());
+	for (size_t i = base.line_count; i < lines_.size(); i++) {
+		lines_[i].first_point += base.point_count;
+		lines_[i].first_occlusion += base.occlusion_count;
+	}
+	boundarys_.insert(boundarys_.end(), other.boundarys_.begin(), other.boundarys_.end());
+	for (size_t i = base.boundary_count; i < boundarys_.size(); i++) {
+		boundarys_[i].first_point += base.point_count;
+		boundarys_[i].first_occlusion += base.occlusion_count;
+	}
+	polygons_.insert(polygons_.end(), other.polygons_.begin(), other.polygons_.end());
+	for (size_t i = base.polygon_count; i < polygons_.size(); i++)
+		polygons_[i].first_point += base.polygon_point_count;
+
+	points_x_.insert(points_x_.end(), other.points_x_.begin(), other.points_x_.end());
+	points_y_.insert(points_y_.end(), other.points_y_.begin(), other.points_y_.end());
+	points_r_.insert(points_r_.end(), other.points_r_.begin(), other.points_r_.end());
+	occlusions_.insert(occlusions_.end(), other.occlusions_.begin(), other.occlusions_.end());
+	polygon_points_.insert(polygon_points_.end(), other.polygon_points_.begin(), other.polygon_points_.end());
+	strings_.insert(strings_.end(), other.strings_.begin(), other.strings_.end());
+}
+
+template <typename T>
+static bool WriteSection(FILE *fp, uint64_t &written, uint64_t offset, const vector<T> &data)
+{
+	static const char zeros[8] = { 0, };
+	if (offset - written > sizeof(zeros)) return false;
+	if (fwrite(zeros, 1, (size_t)(offset - written), fp) != offset - written) return false;
+	written = offset;
+	if (data.empty()) return true;
+	if (fwrite(&data[0], sizeof(T), data.size(), fp) != data.size()) return false;
+	written += data.size() * sizeof(T);
+	return true;
+}
+
+bool LaneCorpus::Save(const char *szpath) const
+{
+	LaneCorpusHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, LANE_CORPUS_MAGIC, sizeof(header.magic));
+	header.version = LANE_CORPUS_VERSION;
+	header.frame_count = frames_.size();
+	header.line_count = lines_.size();
+	header.boundary_count = boundarys_.size();
+	header.polygon_count = polygons_.size();
+	header.point_count = points_x_.size();
+	header.occlusion_count = occlusions_.size() / 2;
+	header.polygon_point_count = polygon_points_.size() / 2;
+	header.string_bytes = strings_.size();
+	if (header.string_bytes > UINT32_MAX) {
+		printf("lane corpus strings exceed 4 GiB - \"%s\".\n", szpath);
+		return false;
+	}
+
+	vector<uint32_t> name_index(frames_.size());
+	for (int i = 0; i < name_index.size(); i++) name_index[i] = i;
+	const char *strings = strings_.empty() ? "" : &strings_[0];
+	const LaneCorpusFrame *frames = frames_.empty() ? NULL : &frames_[0];
+	std::stable_sort(name_index.begin(), name_index.end(), [strings, frames](uint32_t a, uint32_t b) {
+		return strcmp(strings + frames[a].name_offset, strings + frames[b].name_offset) < 0;
+	});
+
+	uint64_t offset = sizeof(LaneCorpusHeader);
+	header.frames_offset = offset = AlignOffset(offset);
+	offset += frames_.size() * sizeof(LaneCorpusFrame);
+	header.name_index_offset = offset = AlignOffset(offset);
+	offset += name_index.size() * sizeof(uint32_t);
+	header.lines_offset = offset = AlignOffset(offset);
+	offset += lines_.size() * sizeof(LaneCorpusCurve);
+	header.boundarys_offset = offset = AlignOffset(offset);
+	offset += boundarys_.size() * sizeof(LaneCorpusCurve);
+	header.polygons_offset = offset = AlignOffset(offset);
+	offset += polygons_.size() * sizeof(LaneCorpusPolygon);
+	header.points_offset = offset = AlignOffset(offset);
+	offset += points_x_.size() * sizeof(double) * 3;
+	header.occlusions_offset = offset = AlignOffset(offset);
+	offset += occlusions_.size() * sizeof(float);
+	header.polygon_points_offset = offset = AlignOffset(offset);
+	offset += polygon_points_.size() * sizeof(float);
+	header.strings_offset = offset = AlignOffset(offset);
+
+	FILE *fp = fopen(szpath, "wb");
+	if (fp == NULL) {
+		printf("failed to open lane corpus - \"%s\".\n", szpath);
+		return false;
+	}
+	uint64_t points_bytes = points_x_.size() * sizeof(double);
+	uint64_t written = sizeof(header);
+	bool succ = fwrite(&header, sizeof(header), 1, fp) == 1
+		&& WriteSection(fp, written, header.frames_offset, frames_)
+		&& WriteSection(fp, written, header.name_index_offset, name_index)
+		&& WriteSection(fp, written, header.lines_offset, lines_)
+		&& WriteSection(fp, written, header.boundarys_offset, boundarys_)
+		&& WriteSection(fp, written, header.polygons_offset, polygons_)
+		&& WriteSection(fp, written, header.points_offset, points_x_)
+		&& WriteSection(fp, written, header.points_offset + points_bytes, points_y_)
+		&& WriteSection(fp, written, header.points_offset + points_bytes * 2, points_r_)
+		&& WriteSection(fp, written, header.occlusions_offset, occlusions_)
+		&& WriteSection(fp, written, header.polygon_points_offset, polygon_points_)
+		&& WriteSection(fp, written, header.strings_offset, strings_);
+	fclose(fp);
+	return succ;
+}
+
+LaneCorpusView::LaneCorpusView()
+{
+	base_ = NULL;
+	size_ = 0;
+#ifdef _WIN32
+	file_handle_ = NULL;
+	map_handle_ = NULL;
+#endif
+	header_ = NULL;
+}
+
+LaneCorpusView::~LaneCorpusView()
+{
+	Close();
+}
+
+bool LaneCorpusView::Open(const char *szpath)
+{
+	Close();
+#ifdef _WIN32
+	HANDLE file = CreateFileA(szpath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		printf("failed to open lane corpus - \"%s\".\n", szpath);
+		return false;
+	}
+	LARGE_INTEGER file_size;
+	GetFileSizeEx(file, &file_size);
+	HANDLE mapping = file_size.QuadPart ? CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+	void *base = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+	if (base == NULL) {
+		if (mapping) CloseHandle(mapping);
+		CloseHandle(file);
+		printf("failed to map lane corpus - \"%s\".\n", szpath);
+		return false;
+	}
+	file_handle_ = file;
+	map_handle_ = mapping;
+	size_ = (size_t)file_size.QuadPart;
+#else
+	int fd = open(szpath, O_RDONLY);
+	if (fd < 0) {
+		printf("failed to open lane corpus - \"%s\".\n", szpath);
+		return false;
+	}
+	struct stat st;
+	void *base = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && st.st_size > 0)
+		base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED) {
+		printf("failed to map lane corpus - \"%s\".\n", szpath);
+		return false;
+	}
+	size_ = st.st_size;
+#endif
+	base_ = base;
+
+	const char *bytes = (const char *)base_;
+	header_ = (const LaneCorpusHeader *)bytes;
+	if (size_ < sizeof(LaneCorpusHeader) ||
+		memcmp(header_->magic, LANE_CORPUS_MAGIC, sizeof(header_->magic)) != 0 ||
+		header_->version != LANE_CORPUS_VERSION) {
+		printf("invalid lane corpus - \"%s\".\n", szpath);
+		Close();
+		return false;
+	}
+	frames_ = (const LaneCorpusFrame *)(bytes + header_->frames_offset);
+	name_index_ = (const uint32_t *)(bytes + header_->name_index_offset);
+	lines_ = (const LaneCorpusCurve *)(bytes + header_->lines_offset);
+	boundarys_ = (const LaneCorpusCurve *)(bytes + header_->boundarys_offset);
+	polygons_ = (const LaneCorpusPolygon *)(bytes + header_->polygons_offset);
+	points_x_ = (const double *)(bytes + header_->points_offset);
+	points_y_ = points_x_ + header_->point_count;
+	points_r_ = points_y_ + header_->point_count;
+	occlusions_ = (const float *)(bytes + header_->occlusions_offset);
+	polygon_points_ = (const float *)(bytes + header_->polygon_points_offset);
+	strings_ = bytes + header_->strings_offset;
+	if (!Validate()) {
+		printf("invalid lane corpus - \"%s\".\n", szpath);
+		Close();
+		return false;
+	}
+	return true;
+}
+
+// [offset, offset + count * elem_size) inside a file of file_size bytes,
+// without overflowing
+static bool SectionInFile(uint64_t offset, uint64_t count, uint64_t elem_size, uint64_t file_size)
+{
+	if ((offset & 7) != 0 || offset > file_size) return false;
+	return count <= (file_size - offset) / elem_size;
+}
+
+static bool RangeInSection(uint64_t first, uint64_t count, uint64_t section_count)
+{
+	return first <= section_count && count <= section_count - first;
+}
+
+bool LaneCorpusView::Validate() const
+{
+	const LaneCorpusHeader &h = *header_;
+	if (!SectionInFile(h.frames_offset, h.frame_count, sizeof(LaneCorpusFrame), size_) ||
+		!SectionInFile(h.name_index_offset, h.frame_count, sizeof(uint32_t), size_) ||
+		!SectionInFile(h.lines_offset, h.line_count, sizeof(LaneCorpusCurve), size_) ||
+		!SectionInFile(h.boundarys_offset, h.boundary_count, sizeof(LaneCorpusCurve), size_) ||
+		!SectionInFile(h.polygons_offset, h.polygon_count, sizeof(LaneCorpusPolygon), size_) ||
+		h.point_count > UINT64_MAX / 3 ||
+		!SectionInFile(h.points_offset, h.point_count * 3, sizeof(double), size_) ||
+		h.occlusion_count > UINT64_MAX / 2 ||
+		!SectionInFile(h.occlusions_offset, h.occlusion_count * 2, sizeof(float), size_) ||
+		h.polygon_point_count > UINT64_MAX / 2 ||
+		!SectionInFile(h.polygon_points_offset, h.polygon_point_count * 2, sizeof(float), size_) ||
+		h.strings_offset > size_ || h.string_bytes > size_ - h.strings_offset ||
+		h.string_bytes > UINT32_MAX)
+		return false;
+	// every string ends inside the table
+	if (h.frame_count && (h.string_bytes == 0 || strings_[h.string_bytes - 1] != '\0'))
+		return false;
+
+	for (uint32_t i = 0; i < h.frame_count; i++) {
+		const LaneCorpusFrame &f = frames_[i];
+		if (name_index_[i] >= h.frame_count ||
+			f.name_offset >= h.string_bytes || f.tool_version_offset >= h.string_bytes ||
+			!RangeInSection(f.first_line, f.line_count, h.line_count) ||
+			!RangeInSection(f.first_boundary, f.boundary_count, h.boundary_count) ||
+			!RangeInSection(f.first_polygon, f.polygon_count, h.polygon_count))
+			return false;
+	}
+	for (uint32_t i = 0; i < h.line_count; i++) {
+		if (!RangeInSection(lines_[i].first_point, lines_[i].point_count, h.point_count) ||
+			!RangeInSection(lines_[i].first_occlusion, lines_[i].occlusion_count, h.occlusion_count))
+			return false;
+	}
+	for (uint32_t i = 0; i < h.boundary_count; i++) {
+		if (!RangeInSection(boundarys_[i].first_point, boundarys_[i].point_count, h.point_count) ||
+			!RangeInSection(boundarys_[i].first_occlusion, boundarys_[i].occlusion_count, h.occlusion_count))
+			return false;
+	}
+	for (uint32_t i = 0; i < h.polygon_count; i++) {
+		if (!RangeInSection(polygons_[i].first_point, polygons_[i].point_count, h.polygon_point_count))
+			return false;
+	}
+	return true;
+}
+
+void LaneCorpusView::Close()
+{
+	if (base_) {
+#ifdef _WIN32
+		UnmapViewOfFile(base_);
+		CloseHandle((HANDLE)map_handle_);
+		CloseHandle((HANDLE)file_handle_);
+		map_handle_ = NULL;
+		file_handle_ = NULL;
+#else
+		munmap(base_, size_);
+#endif
+	}
+	base_ = NULL;
+	size_ = 0;
+	header_ = NULL;
+}
+
+int LaneCorpusView::FindFrame(const char *name) const
+{
+	int lo = 0, hi = GetSizeFrame();
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		int cmp = strcmp(frame_name(name_index_[mid]), name);
+		if (cmp == 0) return name_index_[mid];
+		if (cmp < 0) lo = mid + 1;
+		else hi = mid;
+	}
+	return -1;
+}
+
+LaneCorpusCurveView LaneCorpusView::MakeCurveView(const LaneCorpusCurve &curve) const
+{
+	LaneCorpusCurveView view;
+	view.curve = &curve;
+	view.x = points_x_ + curve.first_point;
+	view.y = points_y_ + curve.first_point;
+	view.r = points_r_ + curve.first_point;
+	view.occlusions = occlusions_ + curve.first_occlusion * 2;
+	return view;
+}
+
+LaneCorpusCurveView LaneCorpusView::line(int frame_idx, int idx) const
+{
+	return MakeCurveView(lines_[frames_[frame_idx].first_line + idx]);
+}
+
+LaneCorpusCurveView LaneCorpusView::boundary(int frame_idx, int idx) const
+{
+	return MakeCurveView(boundarys_[frames_[frame_idx].first_boundary + idx]);
+}
+
+LaneCorpusPolygonView LaneCorpusView::roadmarking(int frame_idx, int idx) const
+{
+	LaneCorpusPolygonView view;
+	view.polygon = &polygons_[frames_[frame_idx].first_polygon + idx];
+	view.points = polygon_points_ + view.polygon->first_point * 2;
+	return view;
+}
+
+template <typename LINE>
+static void FillLine(const LaneCorpusCurveView &view, LINE &line)
+{
+	line.spline_x_.assign(view.x, view.x + view.point_count());
+	line.spline_y_.assign(view.y, view.y + view.point_count());
+	line.line_r_.assign(view.r, view.r + view.point_count());
+	line.info.occlusions_top_bottom_.resize(view.occlusion_count());
+	for (int k = 0; k < view.occlusion_count(); k++)
+		line.info.occlusions_top_bottom_[k] = std::make_pair(view.occlusion_top(k), view.occlusion_bottom(k));
+	line.GenerateModels();
+}
+
+bool LaneCorpusView::ToRoadLane(int frame_idx, RoadLaneManager &road) const
+{
+	if (frame_idx < 0 || frame_idx >= GetSizeFrame()) return false;
+	const LaneCorpusFrame &f = frames_[frame_idx];
+
+	road.Reset(f.image_width, f.image_height);
+	road.SetToolVersion(tool_version(frame_idx));
+	road.SetVPYRatio(f.vp_y_ratio);
+	road.SetVPXRatio(f.vp_x_ratio);
+	road.set_has_vp(f.has_vp != 0);
+
+	road.ReserveLine(f.line_count);
+	road.ReserveBoundary(f.boundary_count);
+	road.ReservePolygon(f.polygon_count);
+	for (int i = 0; i < f.line_count; i++) {
+		LaneCorpusCurveView view = line(frame_idx, i);
+		LaneLine &lane = road.EmplaceLine();
+		// types appended from xml are stored as read, clamped here like ReadFile does
+		lane.info.SetFileTypes(view.curve->type);
+		FillLine(view, lane);
+	}
+	for (int i = 0; i < f.boundary_count; i++) {
+		LaneCorpusCurveView view = boundary(frame_idx, i);
+		BoundaryLine &line = road.EmplaceBoundary();
+		line.info.SetFileTypes(view.curve->type[0], view.curve->type[1], view.curve->type[2]);
+		FillLine(view, line);
+	}
+	for (int i = 0; i < f.polygon_count; i++) {
+		LaneCorpusPolygonView view = roadmarking(frame_idx, i);
+		vector<PPOINTF> points(view.point_count());
+		for (int j = 0; j < view.point_count(); j++) points[j] = view.point(j);
+		RoadMarkingPolygon &polygon = road.EmplacePolygon();
+		polygon.SetRoadMarkType((RoadMarkerInfo::RoadMakerType)view.polygon->type);
+		polygon.SetPoints(std::move(points));
+	}
+	return true;
+}
+
+int LoadLaneCorpusParallel(const vector<string> &xml_paths, const vector<string> &names,
+	LaneCorpus &corpus, int num_threads)
+{
+	if (xml_paths.size() != names.size()) return 0;
+	int file_num = xml_paths.size();
+	if (num_threads <= 0) num_threads = std::thread::hardware_concurrency();
+	if (num_threads <= 0) num_threads = 1;
+	if (num_threads > file_num) num_threads = file_num > 0 ? file_num : 1;
+
+	// files are claimed in small chunks from a shared cursor, so a worker stuck
+	// on large files never holds back the others
+	const int chunk = 16;
+	std::atomic<int> cursor(0);
+	vector<LaneCorpus> partial(num_threads);
+	vector<vector<int>> sources(num_threads);
+	auto worker = [&](int tid) {
+		LaneCorpus &local = partial[tid];
+		for (;;) {
+			int begin = cursor.fetch_add(chunk);
+			if (begin >= file_num) break;
+			int end = std::min(begin + chunk, file_num);
+			for (int i = begin; i < end; i++) {
+				if (local.AppendXml(xml_paths[i].c_str(), names[i].c_str()))
+					sources[tid].push_back(i);
+				else
+					printf("skip lane xml - \"%s\".\n", xml_paths[i].c_str());
+			}
+		}
+	};
+	vector<std::thread> threads;
+	for (int t = 1; t < num_threads; t++) threads.push_back(std::thread(worker, t));
+	worker(0);
+	for (int t = 0; t < threads.size(); t++) threads[t].join();
+
+	// merge the arenas, then put the frame records back in input order
+	int first_frame = corpus.GetSizeFrame();
+	size_t total = 0;
+	for (int t = 0; t < num_threads; t++) total += partial[t].frames_.size();
+	vector<int> slot(file_num, -1);
+	for (int t = 0; t < num_threads; t++) {
+		int base = corpus.GetSizeFrame();
+		corpus.Merge(partial[t]);
+		for (int k = 0; k < sources[t].size(); k++) slot[sources[t][k]] = base + k;
+		partial[t] = LaneCorpus();
+	}
+	vector<LaneCorpusFrame> ordered;
+	ordered.reserve(total);
+	for (int i = 0; i < file_num; i++) {
+		if (slot[i] >= 0) ordered.push_back(corpus.frames_[slot[i]]);
+	}
+	std::copy(ordered.begin(), ordered.end(), corpus.frames_.begin() + first_frame);
+	return ordered.size();
+}
+
+bool ConvertLaneXmlToCorpus(const vector<string> &xml_paths, const vector<string> &names, const char *out_path)
+{
+	if (xml_paths.size() != names.size()) return false;
+	LaneCorpus corpus;
+	LoadLaneCorpusParallel(xml_paths, names, corpus);
+	return corpus.Save(out_path);
+}
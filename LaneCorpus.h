@@ -0,0 +1,209 @@
+#ifndef _LANE_CORPUS_H_
+#define _LANE_CORPUS_H_
+#include "RoadLaneManager.h"
+#include "RoadLaneXmlStream.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Packed binary container for many RoadLaneManager frames.
+//
+// File layout (little endian, every section 8 byte aligned):
+//   LaneCorpusHeader
+//   LaneCorpusFrame    [frame_count]
+//   uint32_t           [frame_count]      frame indices sorted by name
+//   LaneCorpusCurve    [line_count]       splines of all frames
+//   LaneCorpusCurve    [boundary_count]   boundaries of all frames
+//   LaneCorpusPolygon  [polygon_count]
+//   double             [point_count]      x, then y, then r (structure of arrays)
+//   float              [occlusion_count * 2]  (top, bottom) pairs
+//   float              [polygon_point_count * 2]  (x, y) pairs
+//   char               [string_bytes]     NUL terminated frame names / tool versions
+//
+// The reader maps the file and hands out pointers into it, so loading a frame
+// costs page faults instead of XML parsing. Open checks every section and
+// every frame / curve / polygon range against the file first. String offsets
+// are 32 bit, so the string table is limited to 4 GiB.
+
+#define LANE_CORPUS_MAGIC "LNCORP01"
+#define LANE_CORPUS_VERSION 1
+
+#pragma pack(push, 8)
+struct LaneCorpusHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t frame_count;
+	uint32_t line_count;
+	uint32_t boundary_count;
+	uint32_t polygon_count;
+	uint32_t reserved;
+	uint64_t point_count;
+	uint64_t occlusion_count;
+	uint64_t polygon_point_count;
+	uint64_t string_bytes;
+	uint64_t frames_offset;
+	uint64_t name_index_offset;
+	uint64_t lines_offset;
+	uint64_t boundarys_offset;
+	uint64_t polygons_offset;
+	uint64_t points_offset;
+	uint64_t occlusions_offset;
+	uint64_t polygon_points_offset;
+	uint64_t strings_offset;
+};
+
+struct LaneCorpusFrame {
+	uint32_t name_offset;
+	uint32_t tool_version_offset;
+	int32_t image_width;
+	int32_t image_height;
+	double vp_y_ratio;
+	double vp_x_ratio;
+	uint32_t has_vp;
+	uint32_t first_line;
+	uint32_t line_count;
+	uint32_t first_boundary;
+	uint32_t boundary_count;
+	uint32_t first_polygon;
+	uint32_t polygon_count;
+	uint32_t reserved;
+};
+
+// Shared by splines and boundaries.
+// spline   : type = { type1, type2, type3, type4, type5, type6 }
+// boundary : type = { type3, BoundaryType, Situation, 0, 0, 0 }
+struct LaneCorpusCurve {
+	int32_t type[6];
+	uint32_t point_count;
+	uint32_t occlusion_count;
+	uint64_t first_point;
+	uint64_t first_occlusion;
+};
+
+struct LaneCorpusPolygon {
+	int32_t type;
+	uint32_t point_count;
+	uint64_t first_point;
+};
+#pragma pack(pop)
+
+// In-memory corpus. Every point, radius and occlusion lives in a handful of
+// contiguous arenas; frames and curves only keep offsets into them.
+class LaneCorpus
+{
+public:
+	LaneCorpus() {}
+	~LaneCorpus() {}
+
+	void Reset();
+	int GetSizeFrame() const { return frames_.size(); }
+
+	// appends one frame; returns the frame index
+	int Append(const RoadLaneManager &road, const char *name);
+	// parses a lane xml straight into the arenas (no LaneLine / spline objects);
+	// same semantics as RoadLaneManager::ReadFileStream
+	bool AppendXml(const char *szpath, const char *name);
+	bool AppendXmlBuffer(const char *data, size_t size, const char *name);
+	// appends every frame of other, rebasing its offsets
+	void Merge(const LaneCorpus &other);
+	bool Save(const char *szpath) const;
+
+	vector<LaneCorpusFrame> frames_;
+	vector<LaneCorpusCurve> lines_;
+	vector<LaneCorpusCurve> boundarys_;
+	vector<LaneCorpusPolygon> polygons_;
+	vector<double> points_x_, points_y_, points_r_;
+	vector<float> occlusions_;
+	vector<float> polygon_points_;
+	vector<char> strings_;
+
+protected:
+	uint32_t AddString(const string &str);
+	void AddCurve(vector<LaneCorpusCurve> &curves, const int32_t type[6],
+		const vector<double> &x, const vector<double> &y, const vector<double> &r,
+		const std::vector<std::pair<float, float>> &occ);
+	// arena sizes are kept in a header so a failed parse can be rolled back
+	void GetCounts(LaneCorpusHeader &counts) const;
+	void Truncate(const LaneCorpusHeader &counts);
+	bool ParseCurve(LaneXmlPullParser &parser, vector<LaneCorpusCurve> &curves,
+		const int32_t type[6], int point_num, int occ_num);
+};
+
+// Zero-copy view of one spline or boundary inside a mapped corpus.
+struct LaneCorpusCurveView {
+	const LaneCorpusCurve *curve;
+	const double *x, *y, *r;
+	const float *occlusions;   // occlusion_count (top, bottom) pairs
+
+	int point_count() const { return curve->point_count; }
+	int occlusion_count() const { return curve->occlusion_count; }
+	float occlusion_top(int idx) const { return occlusions[idx * 2]; }
+	float occlusion_bottom(int idx) const { return occlusions[idx * 2 + 1]; }
+};
+
+struct LaneCorpusPolygonView {
+	const LaneCorpusPolygon *polygon;
+	const float *points;       // point_count (x, y) pairs
+
+	int point_count() const { return polygon->point_count; }
+	PPOINTF point(int idx) const { return PPOINTF(points[idx * 2], points[idx * 2 + 1]); }
+};
+
+// Read-only memory mapped corpus.
+class LaneCorpusView
+{
+public:
+	LaneCorpusView();
+	~LaneCorpusView();
+
+	bool Open(const char *szpath);
+	void Close();
+	bool is_open() const { return base_ != NULL; }
+
+	int GetSizeFrame() const { return header_ ? header_->frame_count : 0; }
+	const LaneCorpusFrame &frame(int idx) const { return frames_[idx]; }
+	const char *frame_name(int idx) const { return strings_ + frames_[idx].name_offset; }
+	const char *tool_version(int idx) const { return strings_ + frames_[idx].tool_version_offset; }
+	// binary search over the name index; -1 when the frame is not in the corpus
+	int FindFrame(const char *name) const;
+
+	LaneCorpusCurveView line(int frame_idx, int idx) const;
+	LaneCorpusCurveView boundary(int frame_idx, int idx) const;
+	LaneCorpusPolygonView roadmarking(int frame_idx, int idx) const;
+
+	// rebuilds a RoadLaneManager; WriteFile on it reproduces the source xml
+	bool ToRoadLane(int frame_idx, RoadLaneManager &road) const;
+
+private:
+	LaneCorpusCurveView MakeCurveView(const LaneCorpusCurve &curve) const;
+	// sections inside the file, ranges inside their sections
+	bool Validate() const;
+
+	void *base_;
+	size_t size_;
+#ifdef _WIN32
+	void *file_handle_;
+	void *map_handle_;
+#endif
+	const LaneCorpusHeader *header_;
+	const LaneCorpusFrame *frames_;
+	const uint32_t *name_index_;
+	const LaneCorpusCurve *lines_;
+	const LaneCorpusCurve *boundarys_;
+	const LaneCorpusPolygon *polygons_;
+	const double *points_x_, *points_y_, *points_r_;
+	const float *occlusions_;
+	const float *polygon_points_;
+	const char *strings_;
+};
+
+// Loads lane xmls into corpus with num_threads workers (0 = all cores).
+// Each worker parses into its own corpus, the results are merged once and
+// frames keep the order of xml_paths. Unreadable files are skipped.
+// Returns the number of frames appended.
+int LoadLaneCorpusParallel(const vector<string> &xml_paths, const vector<string> &names,
+	LaneCorpus &corpus, int num_threads = 0);
+
+// Converts a list of lane xmls (named by frame id) into one corpus file.
+bool ConvertLaneXmlToCorpus(const vector<string> &xml_paths, const vector<string> &names, const char *out_path);
+#endif
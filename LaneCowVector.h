@@ -0,0 +1,80 @@
+#ifndef _LANE_COW_VECTOR_H_
+#define _LANE_COW_VECTOR_H_
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+// Vector of copy-on-write elements. The element list and every element are
+// held through shared_ptr, so copying the vector is O(1) and copies share
+// all elements until one side writes. Reads go through the const
+// operator[]; writes go through mutable_at / set / push_back ..., which
+// detach the list and clone the touched element only while it is shared.
+//
+// A copy may be read from another thread while the original keeps being
+// edited, as long as the copy itself is made on the editing thread.
+template<typename T>
+class LaneCowVector
+{
+public:
+	LaneCowVector() : items_(std::make_shared<List>()) {}
+
+	int size() const { return (int)items_->size(); }
+	bool empty() const { return items_->empty(); }
+
+	const T &operator[](int idx) const { return *(*items_)[idx]; }
+	const T &back() const { return *items_->back(); }
+
+	// true when this vector and other share every element
+	bool same(const LaneCowVector &other) const { return items_ == other.items_; }
+
+	void clear() { items_ = std::make_shared<List>(); }
+	void reserve(int size) { Detach(); items_->reserve(size); }
+	// new elements are default constructed, kept elements stay shared
+	void resize(int size) {
+		Detach();
+		int old_size = items_->size();
+		items_->resize(size);
+		for (int i = old_size; i < size; i++)
+			(*items_)[i] = std::make_shared<T>();
+	}
+
+	T &mutable_at(int idx) {
+		Detach();
+		std::shared_ptr<T> &item = (*items_)[idx];
+		if (item.use_count() > 1)
+			item = std::make_shared<T>(*item);
+		return *item;
+	}
+	T &mutable_back() { return mutable_at(size() - 1); }
+
+	void set(int idx, const T &value) { Detach(); (*items_)[idx] = std::make_shared<T>(value); }
+	void set(int idx, T &&value) { Detach(); (*items_)[idx] = std::make_shared<T>(std::move(value)); }
+	void push_back(const T &value) { Detach(); items_->push_back(std::make_shared<T>(value)); }
+	void push_back(T &&value) { Detach(); items_->push_back(std::make_shared<T>(std::move(value))); }
+	// the reference is valid until the element is replaced or erased
+	T &emplace_back() {
+		Detach();
+		items_->push_back(std::make_shared<T>());
+		return *items_->back();
+	}
+	void erase(int idx) { Detach(); items_->erase(items_->begin() + idx); }
+
+	// reorders the element handles only, elements stay shared
+	template<typename Compare>
+	void sort(Compare comp) {
+		Detach();
+		std::sort(items_->begin(), items_->end(),
+			[&comp](const std::shared_ptr<T> &a, const std::shared_ptr<T> &b) { return comp(*a, *b); });
+	}
+
+private:
+	typedef std::vector<std::shared_ptr<T> > List;
+
+	void Detach() {
+		if (items_.use_count() > 1)
+			items_ = std::make_shared<List>(*items_);
+	}
+
+	std::shared_ptr<List> items_;
+};
+#endif
@@ -0,0 +1,110 @@
+#include "LaneImageProbe.h"
+#include <stdio.h>
+#include <string.h>
+
+static int BigEndian16(const unsigned char *p)
+{
+	return (p[0] << 8) | p[1];
+}
+
+static unsigned int BigEndian32(const unsigned char *p)
+{
+	return ((unsigned int)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static bool IsPngHeader(const unsigned char *data, size_t size)
+{
+	static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	return size >= 8 && memcmp(data, signature, 8) == 0;
+}
+
+static bool ProbePng(const unsigned char *data, size_t size, int &width, int &height)
+{
+	// signature, IHDR length and type, width, height
+	if (size < 24 || memcmp(data + 12, "IHDR", 4) != 0) return false;
+	unsigned int w = BigEndian32(data + 16), h = BigEndian32(data + 20);
+	if (w == 0 || h == 0 || w > 0x7fffffff || h > 0x7fffffff) return false;
+	width = w;
+	height = h;
+	return true;
+}
+
+// SOF0..SOF15 without DHT (c4), JPG (c8) and DAC (cc)
+static bool IsJpegFrameMarker(int marker)
+{
+	return marker >= 0xc0 && marker <= 0xcf && marker != 0xc4 && marker != 0xc8 && marker != 0xcc;
+}
+
+// Walks the marker segments through read(offset, bytes, count), which
+// returns the bytes available at offset (up to count).
+template <typename READ>
+static bool ProbeJpeg(READ read, int &width, int &height)
+{
+	unsigned char buf[9];
+	if (read(0, buf, 2) < 2 || buf[0] != 0xff || buf[1] != 0xd8) return false;
+	long offset = 2;
+	for (;;) {
+		if (read(offset, buf, 2) < 2 || buf[0] != 0xff) return false;
+		int marker = buf[1];
+		if (marker == 0xff) {
+			// fill byte before the marker
+			offset++;
+			continue;
+		}
+		offset += 2;
+		// markers without a length
+		if (marker == 0x01 || (marker >= 0xd0 && marker <= 0xd7)) continue;
+		if (marker == 0xd9 || marker == 0xda) return false;     // EOI / SOS before a frame
+		if (read(offset, buf, 2) < 2) return false;
+		int length = BigEndian16(buf);
+		if (length < 2) return false;
+		if (IsJpegFrameMarker(marker)) {
+			// length, precision, height, width
+			if (length < 7 || read(offset, buf, 7) < 7) return false;
+			int h = BigEndian16(buf + 3), w = BigEndian16(buf + 5);
+			// height 0 is defined later by DNL, which a probe cannot see
+			if (w == 0 || h == 0) return false;
+			width = w;
+			height = h;
+			return true;
+		}
+		offset += length;
+	}
+}
+
+bool ProbeLaneImageSize(const unsigned char *data, size_t size, int &width, int &height)
+{
+	if (IsPngHeader(data, size)) return ProbePng(data, size, width, height);
+	return ProbeJpeg([=](long offset, unsigned char *bytes, int count) {
+		if (offset < 0 || (size_t)offset >= size) return 0;
+		int n = (int)(size - offset < (size_t)count ? size - offset : count);
+		memcpy(bytes, data + offset, n);
+		return n;
+	}, width, height);
+}
+
+bool ProbeLaneImageSize(const char *szpath, int &width, int &height)
+{
+	FILE *fp = fopen(szpath, "rb");
+	if (fp == NULL) return false;
+	// one read covers png and most jpeg headers; larger APP segments
+	// (exif thumbnails) are stepped over with seeks
+	unsigned char head[4096];
+	size_t size = fread(head, 1, sizeof(head), fp);
+	bool ok;
+	if (IsPngHeader(head, size)) {
+		ok = ProbePng(head, size, width, height);
+	}
+	else {
+		ok = ProbeJpeg([&](long offset, unsigned char *bytes, int count) {
+			if (offset + count <= (long)size) {
+				memcpy(bytes, head + offset, count);
+				return count;
+			}
+			if (fseek(fp, offset, SEEK_SET) != 0) return 0;
+			return (int)fread(bytes, 1, count, fp);
+		}, width, height);
+	}
+	fclose(fp);
+	return ok;
+}
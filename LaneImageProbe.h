@@ -0,0 +1,14 @@
+#ifndef _LANE_IMAGE_PROBE_H_
+#define _LANE_IMAGE_PROBE_H_
+#include <stddef.h>
+
+// Size of a source image from its header alone, so the batch paths never
+// decode the image just for GetWidth() / GetHeight().
+//   png   IHDR, which must be the first chunk
+//   jpeg  the first SOF marker; other segments are skipped by their length
+// Sizes are as stored, like GDI+ reports them (no EXIF orientation).
+// Returns false for other formats and truncated or broken headers.
+bool ProbeLaneImageSize(const char *szpath, int &width, int &height);
+// same on a header already in memory
+bool ProbeLaneImageSize(const unsigned char *data, size_t size, int &width, int &height);
+#endif
@@ -0,0 +1,597 @@
+#include "LaneMaskExport.h"
+#include "LaneImageProbe.h"
+#include "lane_label_rle.hpp"
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+// ---------------------------------------------------------------- png
+
+static const int kLaneDeflateLengthBase[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const int kLaneDeflateLengthExtra[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const int kLaneDeflateDistBase[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+	1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const int kLaneDeflateDistExtra[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+#define LANE_DEFLATE_MAX_MATCH 258
+#define LANE_DEFLATE_MAX_DIST 32768
+
+// deflate bit order: values LSB first, huffman codes MSB first
+class LaneBitWriter
+{
+public:
+	explicit LaneBitWriter(vector<unsigned char> &out) : out_(out), bits_(0), count_(0) {}
+	void Put(uint32_t value, int n) {
+		bits_ |= (uint64_t)value << count_;
+		count_ += n;
+		while (count_ >= 8) {
+			out_.push_back((unsigned char)bits_);
+			bits_ >>= 8;
+			count_ -= 8;
+		}
+	}
+	void Flush() {
+		if (count_) out_.push_back((unsigned char)bits_);
+		bits_ = 0;
+		count_ = 0;
+	}
+private:
+	vector<unsigned char> &out_;
+	uint64_t bits_;
+	int count_;
+};
+
+// fixed huffman codes, bit reversed for LaneBitWriter::Put
+struct LaneFixedCodes {
+	LaneFixedCodes() {
+		for (int symbol = 0; symbol < 288; symbol++) {
+			if (symbol < 144) Set(literal[symbol], 0x30 + symbol, 8);
+			else if (symbol < 256) Set(literal[symbol], 0x190 + symbol - 144, 9);
+			else if (symbol < 280) Set(literal[symbol], symbol - 256, 7);
+			else Set(literal[symbol], 0xC0 + symbol - 280, 8);
+		}
+		for (int code = 0; code < 30; code++) Set(dist[code], code, 5);
+		for (int code = 0; code < 29; code++) {
+			int last = code == 28 ? LANE_DEFLATE_MAX_MATCH : kLaneDeflateLengthBase[code + 1] - 1;
+			for (int len = kLaneDeflateLengthBase[code]; len <= last; len++) length_code[len] = code;
+		}
+	}
+	static void Set(uint32_t (&entry)[2], uint32_t code, int n) {
+		uint32_t reversed = 0;
+		for (int i = 0; i < n; i++) reversed |= ((code >> i) & 1) << (n - 1 - i);
+		entry[0] = reversed;
+		entry[1] = n;
+	}
+	uint32_t literal[288][2];
+	uint32_t dist[30][2];
+	unsigned char length_code[LANE_DEFLATE_MAX_MATCH + 1];
+};
+static const LaneFixedCodes g_lane_fixed_codes;
+
+static void PutFixedSymbol(LaneBitWriter &writer, int symbol)
+{
+	writer.Put(g_lane_fixed_codes.literal[symbol][0], g_lane_fixed_codes.literal[symbol][1]);
+}
+
+static void PutMatch(LaneBitWriter &writer, int length, int dist)
+{
+	int code = g_lane_fixed_codes.length_code[length];
+	PutFixedSymbol(writer, 257 + code);
+	if (kLaneDeflateLengthExtra[code]) writer.Put(length - kLaneDeflateLengthBase[code], kLaneDeflateLengthExtra[code]);
+	code = 29;
+	while (kLaneDeflateDistBase[code] > dist) code--;
+	writer.Put(g_lane_fixed_codes.dist[code][0], g_lane_fixed_codes.dist[code][1]);
+	if (kLaneDeflateDistExtra[code]) writer.Put(dist - kLaneDeflateDistBase[code], kLaneDeflateDistExtra[code]);
+}
+
+// zlib stream of one fixed huffman block
+static void LaneDeflate(const unsigned char *data, size_t size, int row_dist, vector<unsigned char> &out)
+{
+	out.push_back(0x78);
+	out.push_back(0x01);
+	LaneBitWriter writer(out);
+	writer.Put(1, 1);      // final block
+	writer.Put(1, 2);      // fixed codes
+	int dists[2] = { 3, row_dist };
+	size_t i = 0;
+	while (i < size) {
+		int best_len = 0, best_dist = 0;
+		for (int k = 0; k < 2 && best_len < LANE_DEFLATE_MAX_MATCH; k++) {
+			int dist = dists[k];
+			if (dist > LANE_DEFLATE_MAX_DIST || (size_t)dist > i) continue;
+			size_t max_len = std::min((size_t)LANE_DEFLATE_MAX_MATCH, size - i);
+			const unsigned char *a = data + i, *b = data + i - dist;
+			size_t len = 0;
+			while (len < max_len && a[len] == b[len]) len++;
+			if ((int)len > best_len) {
+				best_len = len;
+				best_dist = dist;
+			}
+		}
+		if (best_len >= 3) {
+			PutMatch(writer, best_len, best_dist);
+			i += best_len;
+		}
+		else {
+			PutFixedSymbol(writer, data[i]);
+			i++;
+		}
+	}
+	PutFixedSymbol(writer, 256);
+	writer.Flush();
+
+	uint32_t s1 = 1, s2 = 0;
+	for (size_t k = 0; k < size;) {
+		// 5552 bytes keep the sums below 2^32
+		size_t end = std::min(size, k + 5552);
+		for (; k < end; k++) {
+			s1 += data[k];
+			s2 += s1;
+		}
+		s1 %= 65521;
+		s2 %= 65521;
+	}
+	uint32_t adler = (s2 << 16) | s1;
+	for (int shift = 24; shift >= 0; shift -= 8) out.push_back((unsigned char)(adler >> shift));
+}
+
+static uint32_t LaneCrc32(const unsigned char *data, size_t size, uint32_t crc = 0)
+{
+	struct Table {
+		uint32_t value[256];
+		Table() {
+			for (uint32_t n = 0; n < 256; n++) {
+				uint32_t c = n;
+				for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				value[n] = c;
+			}
+		}
+	};
+	static const Table table;
+	crc = ~crc;
+	for (size_t i = 0; i < size; i++) crc = table.value[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	return ~crc;
+}
+
+static void PutBigEndian(vector<unsigned char> &out, uint32_t value)
+{
+	for (int shift = 24; shift >= 0; shift -= 8) out.push_back((unsigned char)(value >> shift));
+}
+
+// chunk of type / data, data starting at out[begin]; length and crc are filled in
+static void CloseChunk(vector<unsigned char> &out, size_t begin)
+{
+	uint32_t length = out.size() - begin - 8;
+	for (int k = 0; k < 4; k++) out[begin + k] = (unsigned char)(length >> (24 - 8 * k));
+	PutBigEndian(out, LaneCrc32(&out[begin + 4], length + 4));
+}
+
+static size_t OpenChunk(vector<unsigned char> &out, const char *type)
+{
+	size_t begin = out.size();
+	PutBigEndian(out, 0);
+	out.insert(out.end(), type, type + 4);
+	return begin;
+}
+
+void EncodeLaneMaskPng(const LaneMaskBuffer &mask, vector<unsigned char> &png)
+{
+	static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	// filtered scanlines (filter 0) and the deflate output are reused per thread
+	static thread_local vector<unsigned char> raw, idat;
+	size_t row_bytes = (size_t)mask.width * 3 + 1;
+	raw.resize(row_bytes * mask.height);
+	for (int y = 0; y < mask.height; y++) {
+		unsigned char *dst = &raw[row_bytes * y];
+		const unsigned char *src = mask.row(y);
+		*dst++ = 0;
+		for (int x = 0; x < mask.width; x++, src += 3, dst += 3) {
+			dst[0] = src[mask.r];
+			dst[1] = src[mask.g];
+			dst[2] = src[mask.b];
+		}
+	}
+	idat.clear();
+	LaneDeflate(raw.empty() ? NULL : &raw[0], raw.size(), (int)std::min(row_bytes, (size_t)LANE_DEFLATE_MAX_DIST + 1), idat);
+
+	// signature, IHDR, IDAT and IEND
+	png.reserve(sizeof(signature) + 25 + 12 + idat.size() + 12);
+	png.assign(signature, signature + sizeof(signature));
+	size_t chunk = OpenChunk(png, "IHDR");
+	PutBigEndian(png, mask.width);
+	PutBigEndian(png, mask.height);
+	png.push_back(8);      // bit depth
+	png.push_back(2);      // truecolor
+	png.push_back(0);      // deflate
+	png.push_back(0);      // adaptive filters
+	png.push_back(0);      // no interlace
+	CloseChunk(png, chunk);
+	chunk = OpenChunk(png, "IDAT");
+	png.insert(png.end(), idat.begin(), idat.end());
+	CloseChunk(png, chunk);
+	chunk = OpenChunk(png, "IEND");
+	CloseChunk(png, chunk);
+}
+
+void WriteLaneMaskTypes(const LaneMaskLayout &layout, int width, int height, LaneXmlWriter &writer)
+{
+	writer.Clear();
+	writer.OpenElement("LaneBoundaryTypes");
+	writer.PushAttribute("imageWidth", width);
+	writer.PushAttribute("imageHeight", height);
+
+	writer.OpenElement("LaneLines");
+	writer.PushAttribute("LaneLineNum", (int)layout.line_types.size());
+	for (int i = 0; i < layout.line_types.size(); i++) {
+		const LineTypes &line_type = layout.line_types[i];
+		writer.OpenElement("LaneLine");
+		writer.PushAttribute("id", line_type.id);
+		writer.PushAttribute("typeShape", line_type.typeShape);
+		writer.PushAttribute("typeSD", line_type.typeSD);
+		writer.PushAttribute("typePos", line_type.typePos);
+		writer.PushAttribute("typeColor", line_type.typeColor);
+		writer.PushAttribute("typeBicycle", line_type.typeBicycle);
+		writer.CloseElement();
+	}
+	writer.CloseElement();
+
+	writer.OpenElement("BoundaryLines");
+	writer.PushAttribute("BoundaryLineNum", (int)layout.boundary_types.size());
+	for (int i = 0; i < layout.boundary_types.size(); i++) {
+		const BoundaryTypes &boundary_type = layout.boundary_types[i];
+		writer.OpenElement("BoundaryLine");
+		writer.PushAttribute("id", boundary_type.id);
+		writer.PushAttribute("typeShape", boundary_type.typeShape);
+		writer.PushAttribute("typePos", boundary_type.typePos);
+		writer.CloseElement();
+	}
+	writer.CloseElement();
+
+	writer.CloseElement();
+}
+
+void GetLaneMaskTypeFrame(const LaneMaskLayout &layout, int width, int height, LaneTypeManifestFrame &frame)
+{
+	frame.width = width;
+	frame.height = height;
+	frame.lanes.clear();
+	for (int i = 0; i < layout.line_types.size(); i++) {
+		const LineTypes &line_type = layout.line_types[i];
+		int fields[LANE_TYPE_MANIFEST_LANE_FIELDS] = { line_type.id, line_type.typeShape, line_type.typeSD,
+			line_type.typePos, line_type.typeColor, line_type.typeBicycle };
+		frame.lanes.insert(frame.lanes.end(), fields, fields + LANE_TYPE_MANIFEST_LANE_FIELDS);
+	}
+	frame.boundaries.clear();
+	for (int i = 0; i < layout.boundary_types.size(); i++) {
+		const BoundaryTypes &boundary_type = layout.boundary_types[i];
+		int fields[LANE_TYPE_MANIFEST_BOUNDARY_FIELDS] = { boundary_type.id, boundary_type.typeShape, boundary_type.typePos };
+		frame.boundaries.insert(frame.boundaries.end(), fields, fields + LANE_TYPE_MANIFEST_BOUNDARY_FIELDS);
+	}
+}
+
+// ---------------------------------------------------------------- pipeline
+
+LaneMaskExportStats::LaneMaskExportStats()
+{
+	for (int s = 0; s < LANE_EXPORT_STAGE_NUM; s++) {
+		items[s] = 0;
+		seconds[s] = 0;
+	}
+	exported = skipped = failed = 0;
+	wall_seconds = 0;
+}
+
+void LaneMaskExportStats::Print() const
+{
+	static const char *names[LANE_EXPORT_STAGE_NUM] = { "read", "parse", "rasterize", "encode", "write" };
+	for (int s = 0; s < LANE_EXPORT_STAGE_NUM; s++) {
+		printf("%-10s %8d items %9.2f s %10.1f items/s\n", names[s], items[s], seconds[s],
+			seconds[s] > 0 ? items[s] / seconds[s] : 0.0);
+	}
+	printf("exported %d, skipped %d, failed %d in %.2f s\n", exported, skipped, failed, wall_seconds);
+}
+
+namespace {
+
+struct LaneExportJob {
+	int item;
+	bool ok;
+	int width, height;               // mask size, 0 = from the xml
+	vector<char> xml;
+	vector<unsigned char> mask;      // encoded
+	LaneXmlWriter types;
+	vector<unsigned char> type_record;
+};
+
+// queue between stages; its length is bounded by the job pool
+class LaneExportQueue
+{
+public:
+	LaneExportQueue() : closed_(false) {}
+	void Push(LaneExportJob *job) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		jobs_.push_back(job);
+		cv_.notify_one();
+	}
+	// false once closed and drained
+	bool Pop(LaneExportJob *&job) {
+		std::unique_lock<std::mutex> lock(mutex_);
+		cv_.wait(lock, [this] { return !jobs_.empty() || closed_; });
+		if (jobs_.empty()) return false;
+		job = jobs_.front();
+		jobs_.pop_front();
+		return true;
+	}
+	void Close() {
+		std::lock_guard<std::mutex> lock(mutex_);
+		closed_ = true;
+		cv_.notify_all();
+	}
+private:
+	std::mutex mutex_;
+	std::condition_variable cv_;
+	std::deque<LaneExportJob *> jobs_;
+	bool closed_;
+};
+
+class LaneStageTimer
+{
+public:
+	LaneStageTimer() : start_(std::chrono::steady_clock::now()) {}
+	double Lap() {
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		double seconds = std::chrono::duration<double>(now - start_).count();
+		start_ = now;
+		return seconds;
+	}
+private:
+	std::chrono::steady_clock::time_point start_;
+};
+
+}
+
+// path exists and was modified after source, so it was exported from the
+// current source; same second counts as older
+static bool LaneFileNewer(const string &path, const string &source)
+{
+	struct stat st, source_st;
+	if (stat(path.c_str(), &st) != 0) return false;
+	return stat(source.c_str(), &source_st) != 0 || st.st_mtime > source_st.st_mtime;
+}
+
+// written under a temporary name and renamed, so a file that exists is complete
+static bool WriteLaneFileAtomic(const string &path, const void *data, size_t size)
+{
+	string tmp_path = path + ".tmp";
+	FILE *fp = fopen(tmp_path.c_str(), "wb");
+	if (fp == NULL) {
+		printf("cannot write - \"%s\".\n", path.c_str());
+		return false;
+	}
+	bool ok = fwrite(data, 1, size, fp) == size;
+	ok = fclose(fp) == 0 && ok;
+	remove(path.c_str());
+	if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+		printf("cannot write - \"%s\".\n", path.c_str());
+		remove(tmp_path.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool ExportLaneMasks(const vector<LaneMaskExportItem> &items, const LaneMaskExportOptions &options,
+	LaneMaskExportStats &stats)
+{
+	stats = LaneMaskExportStats();
+	LaneStageTimer wall;
+	int num_threads = options.num_threads;
+	if (num_threads <= 0) num_threads = std::thread::hardware_concurrency();
+	if (num_threads <= 0) num_threads = 1;
+	int queue_size = options.queue_size > 0 ? options.queue_size : 4 * num_threads;
+
+	// Manifest rewritten with the frames it already holds, which drops
+	// duplicates and a record cut off by an interrupted export; appended to
+	// from then on; a frame exported again appends a record that replaces
+	// its old one. Frames of items come first, in item order, then the
+	// others sorted by name, so the same input gives the same file.
+	FILE *manifest = NULL;
+	std::unordered_map<string, LaneTypeManifestFrame> manifest_frames;
+	if (!options.type_manifest_path.empty()) {
+		vector<char> old_manifest;
+		if (ReadLaneFileToBuffer(options.type_manifest_path.c_str(), old_manifest) &&
+			!DecodeLaneTypeManifest(&old_manifest[0], old_manifest.size() - 1, manifest_frames))
+			printf("damaged records dropped - \"%s\".\n", options.type_manifest_path.c_str());
+		vector<unsigned char> content;
+		EncodeLaneTypeManifestHeader(content);
+		std::unordered_set<string> written;
+		for (int i = 0; i < items.size(); i++) {
+			auto it = manifest_frames.find(items[i].type_key);
+			if (it != manifest_frames.end() && written.insert(it->first).second)
+				EncodeLaneTypeManifestFrame(it->first, it->second, content);
+		}
+		vector<string> others;
+		for (auto it = manifest_frames.begin(); it != manifest_frames.end(); ++it)
+			if (!written.count(it->first)) others.push_back(it->first);
+		std::sort(others.begin(), others.end());
+		for (int i = 0; i < others.size(); i++)
+			EncodeLaneTypeManifestFrame(others[i], manifest_frames[others[i]], content);
+		if (WriteLaneFileAtomic(options.type_manifest_path, &content[0], content.size()))
+			manifest = fopen(options.type_manifest_path.c_str(), "ab");
+		if (manifest == NULL) {
+			printf("cannot write - \"%s\".\n", options.type_manifest_path.c_str());
+			return false;
+		}
+	}
+
+	vector<LaneExportJob> jobs(queue_size);
+	LaneExportQueue free_jobs, parse_jobs, write_jobs;
+	for (int i = 0; i < jobs.size(); i++) free_jobs.Push(&jobs[i]);
+	std::mutex stats_mutex;
+
+	auto worker = [&]() {
+		// per thread state, reused for every frame
+		RoadLaneManager road;
+		vector<unsigned char> pixels;
+		LaneMaskLayout layout;
+		LaneTypeManifestFrame type_frame;
+		double seconds[LANE_EXPORT_STAGE_NUM] = { 0 };
+		int count = 0;
+		LaneExportJob *job;
+		while (parse_jobs.Pop(job)) {
+			const LaneMaskExportItem &item = items[job->item];
+			LaneStageTimer timer;
+			job->ok = road.ReadBufferStream(&job->xml[0], job->xml.size() - 1, item.xml_path.c_str());
+			seconds[LANE_EXPORT_PARSE] += timer.Lap();
+			int w = job->width > 0 ? job->width : road.GetImageW();
+			int h = job->height > 0 ? job->height : road.GetImageH();
+			if (job->ok && (w <= 0 || h <= 0)) {
+				printf("no image size - \"%s\".\n", item.xml_path.c_str());
+				job->ok = false;
+			}
+			if (job->ok) {
+				// GDI+ wants rows of a multiple of 4 bytes
+				int stride = (w * 3 + 3) & ~3;
+				pixels.resize((size_t)stride * h);
+				LaneMaskBuffer mask(&pixels[0], w, h, stride);
+				if (options.draw_road_marking) {
+					mask.Clear();
+					job->ok = options.draw_road_marking(road, mask, options.user);
+					RasterizeLaneMask(road, mask, layout, false);
+				}
+				else {
+					RasterizeLaneMask(road, mask, layout);
+				}
+				if (options.draw_boundary) {
+					for (int i = 0; job->ok && i < layout.boundary_index.size(); i++) {
+						job->ok = options.draw_boundary(road.boundary(layout.boundary_index[i]), layout.boundary_types[i].id,
+							layout.boundary_width, mask, options.user);
+					}
+				}
+				seconds[LANE_EXPORT_RASTERIZE] += timer.Lap();
+				if (!job->ok) {
+					printf("cannot draw mask - \"%s\".\n", item.xml_path.c_str());
+				}
+				else if (options.format == LANE_MASK_RLE) {
+					if (!EncodeLaneLabelRle(mask.data, w, h, mask.stride, mask.r, mask.g, mask.b, job->mask)) {
+						printf("mask too large for rle - \"%s\".\n", item.xml_path.c_str());
+						job->ok = false;
+					}
+				}
+				else if (options.encode_png) {
+					job->ok = options.encode_png(mask, job->mask, options.user);
+					if (!job->ok) printf("cannot encode png - \"%s\".\n", item.xml_path.c_str());
+				}
+				else {
+					EncodeLaneMaskPng(mask, job->mask);
+				}
+				if (!item.type_path.empty()) WriteLaneMaskTypes(layout, w, h, job->types);
+				if (manifest) {
+					GetLaneMaskTypeFrame(layout, w, h, type_frame);
+					job->type_record.clear();
+					EncodeLaneTypeManifestFrame(item.type_key, type_frame, job->type_record);
+				}
+				seconds[LANE_EXPORT_ENCODE] += timer.Lap();
+				count++;
+			}
+			write_jobs.Push(job);
+		}
+		std::lock_guard<std::mutex> lock(stats_mutex);
+		stats.items[LANE_EXPORT_PARSE] += count;
+		stats.items[LANE_EXPORT_RASTERIZE] += count;
+		stats.items[LANE_EXPORT_ENCODE] += count;
+		for (int s = LANE_EXPORT_PARSE; s <= LANE_EXPORT_ENCODE; s++) stats.seconds[s] += seconds[s];
+	};
+
+	auto writer = [&]() {
+		LaneExportJob *job;
+		while (write_jobs.Pop(job)) {
+			const LaneMaskExportItem &item = items[job->item];
+			if (job->ok) {
+				LaneStageTimer timer;
+				// mask last: its presence marks the item as done
+				bool ok = item.type_path.empty() ||
+					WriteLaneFileAtomic(item.type_path, job->types.data(), job->types.size());
+				if (ok && manifest) {
+					ok = fwrite(&job->type_record[0], 1, job->type_record.size(), manifest) == job->type_record.size() &&
+						fflush(manifest) == 0;
+					if (!ok) printf("cannot write - \"%s\".\n", options.type_manifest_path.c_str());
+				}
+				ok = ok && WriteLaneFileAtomic(item.mask_path, &job->mask[0], job->mask.size());
+				stats.seconds[LANE_EXPORT_WRITE] += timer.Lap();
+				if (ok) {
+					stats.items[LANE_EXPORT_WRITE]++;
+					stats.exported++;
+				}
+				else {
+					stats.failed++;
+				}
+			}
+			else {
+				stats.failed++;
+			}
+			free_jobs.Push(job);
+		}
+	};
+
+	vector<std::thread> workers;
+	for (int t = 0; t < num_threads; t++) workers.push_back(std::thread(worker));
+	std::thread writer_thread(writer);
+
+	// reader on the calling thread
+	for (int i = 0; i < items.size(); i++) {
+		const LaneMaskExportItem &item = items[i];
+		if (options.resume && LaneFileNewer(item.mask_path, item.xml_path) &&
+			(item.type_path.empty() || LaneFileNewer(item.type_path, item.xml_path)) &&
+			(manifest == NULL || manifest_frames.count(item.type_key))) {
+			stats.skipped++;
+			continue;
+		}
+		// free_jobs is never closed; every job comes back to it
+		LaneExportJob *job = NULL;
+		if (!free_jobs.Pop(job)) break;
+		job->item = i;
+		LaneStageTimer timer;
+		job->ok = ReadLaneFileToBuffer(item.xml_path.c_str(), job->xml);
+		job->width = item.width;
+		job->height = item.height;
+		if ((job->width <= 0 || job->height <= 0) && !item.image_path.empty() &&
+			!ProbeLaneImageSize(item.image_path.c_str(), job->width, job->height))
+			job->width = job->height = 0;
+		stats.seconds[LANE_EXPORT_READ] += timer.Lap();
+		if (job->ok) {
+			stats.items[LANE_EXPORT_READ]++;
+			parse_jobs.Push(job);
+		}
+		else {
+			printf("cannot read - \"%s\".\n", item.xml_path.c_str());
+			write_jobs.Push(job);
+		}
+	}
+	parse_jobs.Close();
+	for (int t = 0; t < workers.size(); t++) workers[t].join();
+	write_jobs.Close();
+	writer_thread.join();
+	if (manifest && fclose(manifest) != 0) {
+		printf("cannot write - \"%s\".\n", options.type_manifest_path.c_str());
+		stats.failed++;
+	}
+
+	stats.wall_seconds = wall.Lap();
+	return stats.failed == 0;
+}
@@ -0,0 +1,100 @@
+#ifndef _LANE_MASK_EXPORT_H_
+#define _LANE_MASK_EXPORT_H_
+#include "LaneMaskRasterizer.h"
+#include "RoadLaneXmlStream.h"
+#include "lane_type_manifest.hpp"
+#include <string>
+#include <vector>
+
+// Batch export of lane masks (the LaneData mask and the TypeData xml or type
+// manifest of
+// SaveSplineMaskImageAll) as a pipeline:
+//   reader thread   read      lane xml into a job buffer, image size
+//                             from the image header (LaneImageProbe.h)
+//   worker threads  parse     ReadBufferStream
+//                   rasterize RasterizeLaneMask into the worker's mask, rows
+//                             padded to 4 bytes so the callbacks below can
+//                             wrap it in a GDI+ Bitmap
+//                   encode    png or rle mask and type xml / record into the job
+//   writer thread   write     to a temporary name, then renamed; type
+//                             records are appended to the manifest
+// Jobs are recycled through a fixed pool, so at most queue_size frames are
+// in flight and their buffers are reused. The mask is renamed last, so with
+// resume on an interrupted export continues by skipping items whose mask
+// already exists and is newer than their xml.
+
+struct LaneMaskExportItem {
+	string xml_path;                 // lane annotation
+	string mask_path;                // mask to write, in LaneMaskExportOptions::format
+	string type_path;                // type xml to write, empty for none
+	string type_key;                 // frame name in the type manifest
+	string image_path;               // source image, only its header is read
+	int width, height;               // mask size, 0 = the size of image_path,
+	                                 // else the image size of the xml
+
+	LaneMaskExportItem() : width(0), height(0) {}
+};
+
+// Callbacks run on the worker threads, each on its own mask; false fails the item.
+// road markings into the cleared mask, before the other layers
+typedef bool (*LaneMaskRoadMarkingFunc)(const RoadLaneManager &road, LaneMaskBuffer &mask, void *user);
+// one boundary segment, after the other layers
+typedef bool (*LaneMaskBoundaryFunc)(const BoundaryLine &boundary, int id, float width,
+	LaneMaskBuffer &mask, void *user);
+// png of the finished mask
+typedef bool (*LaneMaskEncodeFunc)(const LaneMaskBuffer &mask, vector<unsigned char> &png, void *user);
+
+enum LaneMaskFormat {
+	LANE_MASK_PNG = 0,               // 8 bit RGB png
+	LANE_MASK_RLE                    // run length labels of lane_label_rle.hpp
+};
+
+struct LaneMaskExportOptions {
+	LaneMaskExportOptions() : num_threads(0), queue_size(0), resume(false), format(LANE_MASK_PNG),
+		draw_road_marking(NULL), draw_boundary(NULL), encode_png(NULL), user(NULL) {}
+	int num_threads;                 // workers, 0 = all cores
+	int queue_size;                  // frames in flight, 0 = 4 per worker
+	bool resume;                     // skip items whose mask and types exist and are
+	                                 // newer than the xml; off = overwrite all
+	LaneMaskFormat format;
+	string type_manifest_path;       // type records of all items, empty for none
+	LaneMaskRoadMarkingFunc draw_road_marking;  // NULL = LaneMaskDrawRoadMarking
+	LaneMaskBoundaryFunc draw_boundary;  // boundary segments, none when NULL
+	LaneMaskEncodeFunc encode_png;   // NULL = EncodeLaneMaskPng
+	void *user;                      // passed to the callbacks
+};
+
+enum LaneMaskExportStage {
+	LANE_EXPORT_READ = 0,
+	LANE_EXPORT_PARSE,
+	LANE_EXPORT_RASTERIZE,
+	LANE_EXPORT_ENCODE,
+	LANE_EXPORT_WRITE,
+	LANE_EXPORT_STAGE_NUM
+};
+
+struct LaneMaskExportStats {
+	LaneMaskExportStats();
+	// one line per stage: items, busy seconds summed over its threads and
+	// items per busy second
+	void Print() const;
+
+	int items[LANE_EXPORT_STAGE_NUM];
+	double seconds[LANE_EXPORT_STAGE_NUM];
+	int exported, skipped, failed;
+	double wall_seconds;
+};
+
+// Exports every item; false when any item failed.
+bool ExportLaneMasks(const vector<LaneMaskExportItem> &items, const LaneMaskExportOptions &options,
+	LaneMaskExportStats &stats);
+
+// 8 bit RGB png of the mask, channels reordered from the buffer layout.
+// Deflate with fixed codes and matches against the previous pixel and the
+// pixel above, which is most of what a label mask has to offer.
+void EncodeLaneMaskPng(const LaneMaskBuffer &mask, vector<unsigned char> &png);
+// type xml of WriteTypeFile
+void WriteLaneMaskTypes(const LaneMaskLayout &layout, int width, int height, LaneXmlWriter &writer);
+// the same types as a manifest record
+void GetLaneMaskTypeFrame(const LaneMaskLayout &layout, int width, int height, LaneTypeManifestFrame &frame);
+#endif
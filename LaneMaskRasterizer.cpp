@@ -0,0 +1,544 @@
+#include "LaneMaskRasterizer.h"
+#include "LaneTypeMap.h"
+#include <algorithm>
+#include <limits.h>
+#include <math.h>
+#include <string.h>
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LANE_MASK_SSE2
+#endif
+
+void LaneMaskBuffer::Clear()
+{
+	for (int y = 0; y < height; y++) memset(row(y), 0, width * 3);
+}
+
+LaneMaskSpanFill::LaneMaskSpanFill()
+{
+	for (int c = 0; c < 3; c++) SetChannel(c, 0xff, 0, 0, [](int v) { return v; });
+}
+
+void LaneMaskSpanFill::SetChannel(int offset, unsigned char value)
+{
+	memset(table_[offset], value, 256);
+	SetMasks(offset, 0, 0, value);
+}
+
+void LaneMaskSpanFill::SetMasks(int offset, unsigned char keep, unsigned char hi, unsigned char set)
+{
+	hi &= keep;
+	masked_[offset] = true;
+	for (int v = 0; v < 256; v++) {
+		if (table_[offset][v] != (unsigned char)((v & keep & ~((v & hi) >> 1)) | set)) {
+			masked_[offset] = false;
+			break;
+		}
+	}
+	for (int i = offset; i < 48; i += 3) {
+		keep_[i] = keep;
+		hi_[i] = hi >> 1;
+		set_[i] = set;
+	}
+}
+
+bool LaneMaskSpanFill::idempotent() const
+{
+	for (int c = 0; c < 3; c++) {
+		for (int v = 0; v < 256; v++) {
+			if (table_[c][table_[c][v]] != table_[c][v]) return false;
+		}
+	}
+	return true;
+}
+
+void LaneMaskSpanFill::Fill(unsigned char *row, int first, int last, int width) const
+{
+	first = std::max(first, 0);
+	last = std::min(last, width - 1);
+	if (first > last) return;
+	unsigned char *px = row + first * 3;
+	unsigned char *end = row + (last + 1) * 3;
+#ifdef LANE_MASK_SSE2
+	if (masked_[0] && masked_[1] && masked_[2]) {
+		// 16 pixels are 3 vectors with the same channel layout every time;
+		// the 16 bit shift leaks into bit 7 only, which hi >> 1 never has.
+		// The patterns are loaded once: stores through px may alias them.
+		__m128i keep[3], hi[3], set[3];
+		for (int k = 0; k < 3; k++) {
+			keep[k] = _mm_loadu_si128((const __m128i *)(keep_ + 16 * k));
+			hi[k] = _mm_loadu_si128((const __m128i *)(hi_ + 16 * k));
+			set[k] = _mm_loadu_si128((const __m128i *)(set_ + 16 * k));
+		}
+		for (; end - px >= 48; px += 48) {
+			for (int k = 0; k < 3; k++) {
+				__m128i v = _mm_and_si128(_mm_loadu_si128((const __m128i *)(px + 16 * k)), keep[k]);
+				__m128i clear = _mm_and_si128(_mm_srli_epi16(v, 1), hi[k]);
+				v = _mm_or_si128(_mm_andnot_si128(clear, v), set[k]);
+				_mm_storeu_si128((__m128i *)(px + 16 * k), v);
+			}
+		}
+	}
+#endif
+	for (; px < end; px += 3) {
+		px[0] = table_[0][px[0]];
+		px[1] = table_[1][px[1]];
+		px[2] = table_[2][px[2]];
+	}
+}
+
+LineTypes GetLineTypes(const LaneInfo &info, int id) {
+	LineTypes line_type;
+	line_type.id = id;
+	line_type.typeShape = LaneTypeShape(info);
+	line_type.typeSD = LaneTypeSD(info);
+	line_type.typePos = LaneTypePos(info);
+	line_type.typeColor = LaneTypeColor(info);
+	line_type.typeBicycle = LaneTypeBicycle(info);
+
+	return line_type;
+}
+
+BoundaryTypes GetBoundaryTypes(const BoundaryInfo &info, int id, int max_level) {
+	BoundaryTypes boundary_type;
+	boundary_type.id = id;
+	boundary_type.typeShape = BoundaryTypeShape(info);
+	boundary_type.typePos = BoundaryTypePos(info, max_level);
+	return boundary_type;
+}
+
+// road marking pixels of row y under one polygon
+static void FillRoadMarkingRow(const LanePolygonEdgeTable &table, int y, const LaneMaskSpanFill &fill,
+	LaneMaskBuffer &mask)
+{
+	static thread_local vector<std::pair<int, int>> spans;
+	table.RowSpans((float)y, mask.width, spans);
+	unsigned char *row = mask.row(y);
+	for (int i = 0; i < spans.size(); i++)
+		fill.Fill(row, spans[i].first, spans[i].second, mask.width);
+}
+
+static void SetRoadMarkingFill(LaneMaskSpanFill &fill, const LaneMaskBuffer &mask)
+{
+	fill.SetChannel(mask.r, 0);
+	fill.SetChannel(mask.g, 128);
+	fill.SetChannel(mask.b, 0);
+}
+
+void LaneMaskDrawRoadMarking(const RoadLaneManager &road, LaneMaskBuffer &mask)
+{
+	LaneMaskSpanFill fill;
+	SetRoadMarkingFill(fill, mask);
+	for (int i = 0; i < road.GetSizeRoadMarking(); i++) {
+		const RoadMarkingPolygon &polygon = road.roadmarking(i);
+		if (!polygon.GetPolygonPointNum()) continue;
+		LanePolygonEdgeTable table(polygon.points());
+		int first = std::max((int)ceil(table.top()), 0);
+		int last = std::min((int)floor(table.bottom()), mask.height - 1);
+		for (int y = first; y <= last; y++)
+			FillRoadMarkingRow(table, y, fill, mask);
+	}
+}
+
+// B value and box of LaneMaskDrawVP
+static int LaneMaskVPBox(const RoadLaneManager &road, int w, int h, int &rt_x, int &rt_y, int &rt_width, int &rt_height)
+{
+	if (!road.has_vp()) {
+		rt_x = 0; rt_y = 0;
+		rt_width = w; rt_height = h;
+		return 64;
+	}
+	rt_width = w / 5;
+	rt_height = h / 8;
+	// RoadLaneManager::IsZF
+	if ((float)road.GetImageH() / road.GetImageW() > 0.7) {
+		rt_width = w / 8;
+		rt_height = h / 24;
+	}
+
+	int vpx = (int)std::round(road.vp_x_ratio() * w);
+	int vpy = (int)std::round(road.vp_y_ratio() * h);
+	rt_x = vpx - rt_width / 2;
+	rt_y = vpy - rt_height / 2;
+	return 128;
+}
+
+void LaneMaskDrawVP(const RoadLaneManager &road, LaneMaskBuffer &mask)
+{
+	int w = mask.width, h = mask.height;
+	int rt_x, rt_y, rt_width, rt_height;
+	int b = LaneMaskVPBox(road, w, h, rt_x, rt_y, rt_width, rt_height);
+
+	LaneMaskSpanFill fill;
+	fill.SetChannel(mask.b, b);
+	for (int y = std::max(0, rt_y); y < rt_y + rt_height && y < h; y++)
+		fill.Fill(mask.row(y), rt_x, rt_x + rt_width - 1, w);
+}
+
+// Row walk of the view's lane drawers. Every row from round(top_y_) to end_y
+// covers [round(x - r), round(x + r)], with x taken through PointF (float) as
+// before. A row whose span does not overlap the previous one is bridged from
+// the previous lx to rx; the overlap test keeps its original form
+// (min(prev_lx, rx) - max(prev_lx, lx)). Both end at rx, so when filling
+// twice changes nothing they are one span from min(lx, prev_lx).
+// span(y, first, last, occluded, extended) gets the unclipped pixels
+// [first, last] of row y, rows ascending.
+template <typename SPAN>
+static void DrawLineRows(const LaneLine &line, bool extend, bool merge, int h, SPAN span)
+{
+	int top_y = std::max((int)std::round(line.top_y_), 0);
+	int bottom_y = std::min((int)std::round(line.bottom_y_), h - 1);
+	int end_y = extend ? (h - 1) : bottom_y;
+	if (top_y > end_y) return;
+
+	std::shared_ptr<const LaneRowRaster> raster = line.RowRaster(h);
+	int prev_lx = 0, prev_rx = 0;
+	for (int y = top_y; y <= end_y; y++) {
+		bool occluded = raster->row_occluded(y);
+		bool extended = y > bottom_y;
+		float x = (float)raster->row_x(y);
+		double r = raster->row_r(y);
+		int lx = std::round(x - r);
+		int rx = std::round(x + r);
+		bool bridge = false;
+		if (y > top_y) {
+			double overlap_ratio = (std::min(prev_lx, rx) - std::max(prev_lx, lx)) /
+				(double)(std::max(prev_rx, rx) - std::min(prev_lx, lx));
+			bridge = overlap_ratio <= 0;
+		}
+		if (bridge && merge) {
+			span(y, std::min(lx, prev_lx), rx, occluded, extended);
+		}
+		else {
+			span(y, lx, rx, occluded, extended);
+			if (bridge) span(y, prev_lx, rx, occluded, extended);
+		}
+		prev_lx = lx;
+		prev_rx = rx;
+	}
+}
+
+namespace {
+
+// one lane drawer's clipped spans in drawing order; id is the R value of
+// the span (+128 occluded, +64 extended), -1 to leave R alone
+struct LaneMaskSpan {
+	int y, first, last, id;
+};
+
+struct LaneMaskLineLayer {
+	LaneMaskSpanFill fill;
+	vector<LaneMaskSpan> spans;
+	int next;                        // first span not drawn yet
+	int current_id;                  // R value fill is set to
+};
+
+}
+
+static void BuildLineLayer(const LaneLine &line, int id, bool extend, const LaneMaskBuffer &mask, LaneMaskLineLayer &layer)
+{
+	int w = mask.width;
+	layer.spans.clear();
+	layer.next = 0;
+	layer.current_id = -1;
+	DrawLineRows(line, extend, layer.fill.idempotent(), mask.height, [&](int y, int first, int last, bool occluded, bool extended) {
+		first = std::max(first, 0);
+		last = std::min(last, w - 1);
+		if (first > last) return;
+		int id_ = id;
+		if (id >= 0) {
+			if (occluded) id_ += 128;
+			if (extended) id_ += 64;
+		}
+		LaneMaskSpan span = { y, first, last, id_ };
+		layer.spans.push_back(span);
+	});
+}
+
+// spans of the layer above row end_y
+static void DrawLineLayer(LaneMaskLineLayer &layer, int end_y, LaneMaskBuffer &mask)
+{
+	for (; layer.next < layer.spans.size() && layer.spans[layer.next].y < end_y; layer.next++) {
+		const LaneMaskSpan &span = layer.spans[layer.next];
+		if (span.id >= 0 && span.id != layer.current_id) {
+			layer.fill.SetChannel(mask.r, (unsigned char)span.id);
+			layer.current_id = span.id;
+		}
+		layer.fill.Fill(mask.row(span.y), span.first, span.last, mask.width);
+	}
+}
+
+static void BuildRoadMarkerLayer(const LaneLine &line, const LaneMaskBuffer &mask, LaneMaskLineLayer &layer)
+{
+	layer.fill = LaneMaskSpanFill();
+	layer.fill.SetChannel(mask.g, 0xff, 0, 128, [](int v) { return v < 128 ? v + 128 : v; });
+	BuildLineLayer(line, -1, false, mask, layer);
+}
+
+static void BuildLaneLayer(const LaneLine &line, int id, const LaneMaskBuffer &mask, LaneMaskLineLayer &layer)
+{
+	const LaneInfo &info = line.info;
+	int typePos = LaneTypePos(info);
+	int typeShape = LaneTypeShape(info);
+	int green = (typeShape << 5) + typePos;
+	int blue = LaneTypeColor(info);
+	bool b_ext = (4 <= typePos && typePos <= 7);
+
+	// G keeps its road marker bit, B its VP level (128 over 64)
+	layer.fill = LaneMaskSpanFill();
+	layer.fill.SetChannel(mask.g, 0x80, 0, (unsigned char)green, [=](int v) {
+		return 128 <= v ? green + 128 : green;
+	});
+	layer.fill.SetChannel(mask.b, 0xc0, 0x80, (unsigned char)blue, [=](int v) {
+		if (128 <= v) return blue + 128;
+		else if (64 <= v) return blue + 64;
+		return blue;
+	});
+	BuildLineLayer(line, id, b_ext, mask, layer);
+}
+
+static void BuildLaneSegLayer(const LaneLine &line, int id, const LaneMaskBuffer &mask, LaneMaskLineLayer &layer)
+{
+	// the left and right lines 0 and 1, as in BuildLaneLayer
+	int typePos = LaneTypePos(line.info);
+	bool b_ext = (4 <= typePos && typePos <= 7);
+
+	layer.fill = LaneMaskSpanFill();
+	BuildLineLayer(line, id, b_ext, mask, layer);
+}
+
+void LaneMaskDrawLineAsRoadMarker(const LaneLine &line, LaneMaskBuffer &mask)
+{
+	static thread_local LaneMaskLineLayer layer;
+	BuildRoadMarkerLayer(line, mask, layer);
+	DrawLineLayer(layer, mask.height, mask);
+}
+
+void LaneMaskDrawLine(const LaneLine &line, int id, LaneMaskBuffer &mask)
+{
+	static thread_local LaneMaskLineLayer layer;
+	BuildLaneLayer(line, id, mask, layer);
+	DrawLineLayer(layer, mask.height, mask);
+}
+
+void LaneMaskDrawLineSeg(const LaneLine &line, int id, LaneMaskBuffer &mask)
+{
+	static thread_local LaneMaskLineLayer layer;
+	BuildLaneSegLayer(line, id, mask, layer);
+	DrawLineLayer(layer, mask.height, mask);
+}
+
+// drawing order of DrawLaneToMask: true when lane 0 goes first
+static bool LaneMaskDrawsBefore(const LaneInfo &info0, const LaneInfo &info1)
+{
+	if (info0.GetType3() == info1.GetType3() && info0.GetType4() == info1.GetType4() && info0.GetType3_ID() == info1.GetType3_ID())
+		return info0.GetType2() == LaneInfo::DOUBLE;
+
+	if (info0.GetType3() == LaneInfo::UNCERTAIN) return true;
+	else if (info1.GetType3() == LaneInfo::UNCERTAIN) return false;
+
+	if (info0.GetType4() == LaneInfo::OPPOSITE_SIDE) return true;
+	else if (info1.GetType4() == LaneInfo::OPPOSITE_SIDE) return false;
+
+	if (info0.GetType4() == LaneInfo::BRANCH || info0.GetType4() == LaneInfo::MERGED) return true;
+	else if (info1.GetType4() == LaneInfo::BRANCH || info1.GetType4() == LaneInfo::MERGED) return false;
+
+	return true;
+}
+
+void LaneMaskDrawLanes(const RoadLaneManager &road, LaneMaskBuffer &mask)
+{
+	vector<int> lines;
+	for (int i = 0; i < road.GetSizeLaneLine(); i++) {
+		const LaneInfo &info = road.line(i).info;
+		if (LaneInfo::SOLID <= info.GetType1() && info.GetType1() <= LaneInfo::CATS_EYE
+			&& LaneInfo::SINGLE <= info.GetType2() && info.GetType2() <= LaneInfo::ACCESSORIE
+			&& LaneInfo::LEFT <= info.GetType3() && info.GetType3() <= LaneInfo::UNCERTAIN
+			&& LaneInfo::C4_NONE <= info.GetType4() && info.GetType4() <= LaneInfo::OPPOSITE_SIDE) {
+			if (info.GetType4() != LaneInfo::UNABLE) lines.push_back(i);
+		}
+	}
+
+	// selection sort as before, on indices
+	for (int i = 0; i < lines.size(); i++) {
+		int select_idx = i;
+		for (int j = i + 1; j < lines.size(); j++) {
+			if (LaneMaskDrawsBefore(road.line(lines[j]).info, road.line(lines[select_idx]).info))
+				select_idx = j;
+		}
+		std::swap(lines[i], lines[select_idx]);
+	}
+
+	int sl_count = 0, dl_count = 0;
+	for (int i = 0; i < lines.size(); i++) {
+		const LaneLine &line = road.line(lines[i]);
+		int id;
+		if (line.info.GetType2() == LaneInfo::SINGLE)
+			id = 1 + 2 * sl_count++;
+		else
+			id = 2 * (1 + dl_count++);
+		LaneMaskDrawLine(line, id, mask);
+	}
+}
+
+static bool IsMaskBoundaryType(const BoundaryInfo &info)
+{
+	return (BoundaryInfo::WALLS <= info.GetBoundaryType() && info.GetBoundaryType() <= BoundaryInfo::ROAD_EDGE) ||
+		(BoundaryInfo::BOUNDARY_STRUCTURE_ETCS <= info.GetBoundaryType() && info.GetBoundaryType() <= BoundaryInfo::BOUNDARY_ETCS);
+}
+
+// lines of DrawLaneBoundaryToMask: accessory lines drawn as road marker
+// and lane segments with ids 1, 2, ...; fills layout
+static void CollectLaneBoundary(const RoadLaneManager &road, LaneMaskLayout &layout,
+	bool use_acc, vector<int> &acc_lines, vector<int> &lines)
+{
+	layout.line_types.clear();
+	layout.boundary_types.clear();
+	layout.boundary_index.clear();
+
+	// lane
+	acc_lines.clear();
+	lines.clear();
+	for (int i = 0; i < road.GetSizeLaneLine(); i++) {
+		const LaneInfo &info = road.line(i).info;
+		if (LaneInfo::SOLID <= info.GetType1() && info.GetType1() <= LaneInfo::CATS_EYE
+			&& LaneInfo::SINGLE <= info.GetType2() && info.GetType2() <= LaneInfo::ACCESSORIE
+			&& LaneInfo::LEFT <= info.GetType3() && info.GetType3() <= LaneInfo::UNCERTAIN
+			&& LaneInfo::C4_NONE <= info.GetType4() && info.GetType4() <= LaneInfo::OPPOSITE_SIDE
+			&& LaneInfo::WHITE <= info.GetType5() && info.GetType5() <= LaneInfo::ETC) {
+			if (info.GetType4() != LaneInfo::UNABLE) {
+				if (!use_acc && info.GetType2() == LaneInfo::ACCESSORIE)
+					acc_lines.push_back(i);
+				else
+					lines.push_back(i);
+			}
+		}
+	}
+
+	// boundary
+	float boundary_width_ratio = 128.0;
+	layout.boundary_width = road.GetImageW() / (float)boundary_width_ratio;
+	int boundary_max_level = 1;
+
+	// get left_id, right_id
+	int left_id = INT_MAX, right_id = INT_MAX;
+	for (int i = 0; i < road.GetSizeBoundary(); i++) {
+		const BoundaryInfo &boundary_info = road.boundary(i).info;
+		if (!IsMaskBoundaryType(boundary_info)) continue;
+		int type3_id = boundary_info.GetType3_ID();
+		if (type3_id >= 0 && type3_id <= boundary_max_level) {
+			if (boundary_info.GetType3() == BoundaryInfo::LEFT && type3_id < left_id)
+				left_id = type3_id;
+			else if (boundary_info.GetType3() == BoundaryInfo::RIGHT && type3_id < right_id)
+				right_id = type3_id;
+		}
+	}
+	vector<int> boundaries;
+	for (int i = 0; i < road.GetSizeBoundary(); i++) {
+		const BoundaryInfo &boundary_info = road.boundary(i).info;
+		if (IsMaskBoundaryType(boundary_info)) {
+			if ((boundary_info.GetType3() == BoundaryInfo::LEFT && boundary_info.GetType3_ID() == left_id) ||
+				(boundary_info.GetType3() == BoundaryInfo::RIGHT && boundary_info.GetType3_ID() == right_id))
+				boundaries.push_back(i);
+		}
+		else {
+			printf("this image has boundary type problem\n");
+		}
+	}
+
+	for (int i = 0; i < lines.size(); i++)
+		layout.line_types.push_back(GetLineTypes(road.line(lines[i]).info, i + 1));
+
+	// boundary ids: left odd, right even
+	int left_count = 0, right_count = 0;
+	for (int i = 0; i < boundaries.size(); i++) {
+		const BoundaryInfo &boundary_info = road.boundary(boundaries[i]).info;
+		int boundary_id;
+		if (boundary_info.GetType3() == BoundaryInfo::LEFT)
+			boundary_id = (2 * left_count++) + 1;
+		else
+			boundary_id = 2 * (1 + right_count++);
+		layout.boundary_types.push_back(GetBoundaryTypes(boundary_info, boundary_id, boundary_max_level));
+		layout.boundary_index.push_back(boundaries[i]);
+	}
+}
+
+void LaneMaskDrawLaneBoundary(const RoadLaneManager &road, LaneMaskBuffer &mask,
+	LaneMaskLayout &layout, bool use_acc)
+{
+	vector<int> acc_lines, lines;
+	CollectLaneBoundary(road, layout, use_acc, acc_lines, lines);
+
+	// acc lines as road marker (none with use_acc)
+	for (int i = 0; i < acc_lines.size(); i++)
+		LaneMaskDrawLineAsRoadMarker(road.line(acc_lines[i]), mask);
+
+	// line seg mask in R channel
+	for (int i = 0; i < lines.size(); i++)
+		LaneMaskDrawLineSeg(road.line(lines[i]), i + 1, mask);
+}
+
+// Rows are independent under every layer, so drawing all layers band by
+// band gives the layer by layer result. Lines are reduced to spans and the
+// polygons to edge tables first; each band is then cleared and drawn while
+// it stays in cache (16 rows of 1920 pixels are 90 KB).
+#define LANE_MASK_BAND_ROWS 16
+
+bool RasterizeLaneMask(const RoadLaneManager &road, LaneMaskBuffer &mask, LaneMaskLayout &layout,
+	bool road_marking)
+{
+	if (!mask.data || mask.width <= 0 || mask.height <= 0 || mask.stride < mask.width * 3) return false;
+	// the export sorts a copy; lines are shared until the sort detaches the list
+	RoadLaneManager road_lane = road;
+	road_lane.SortingLength();
+
+	// primitives of the frame, scratch reused per thread
+	static thread_local vector<LanePolygonEdgeTable> tables;
+	static thread_local vector<std::pair<int, int>> table_rows;
+	static thread_local vector<LaneMaskLineLayer> layers;
+	static thread_local vector<int> acc_lines, lines;
+	int w = mask.width, h = mask.height;
+
+	int table_num = 0;
+	for (int i = 0; road_marking && i < road_lane.GetSizeRoadMarking(); i++) {
+		const RoadMarkingPolygon &polygon = road_lane.roadmarking(i);
+		if (!polygon.GetPolygonPointNum()) continue;
+		if (tables.size() <= table_num) {
+			tables.resize(table_num + 1);
+			table_rows.resize(table_num + 1);
+		}
+		tables[table_num].Build(polygon.points());
+		table_rows[table_num] = std::make_pair(std::max((int)ceil(tables[table_num].top()), 0),
+			std::min((int)floor(tables[table_num].bottom()), h - 1));
+		table_num++;
+	}
+	LaneMaskSpanFill marking_fill;
+	SetRoadMarkingFill(marking_fill, mask);
+
+	int rt_x, rt_y, rt_width, rt_height;
+	LaneMaskSpanFill vp_fill;
+	vp_fill.SetChannel(mask.b, LaneMaskVPBox(road_lane, w, h, rt_x, rt_y, rt_width, rt_height));
+
+	CollectLaneBoundary(road_lane, layout, false, acc_lines, lines);
+	int layer_num = acc_lines.size() + lines.size();
+	if (layers.size() < layer_num) layers.resize(layer_num);
+	for (int i = 0; i < acc_lines.size(); i++)
+		BuildRoadMarkerLayer(road_lane.line(acc_lines[i]), mask, layers[i]);
+	for (int i = 0; i < lines.size(); i++)
+		BuildLaneSegLayer(road_lane.line(lines[i]), i + 1, mask, layers[acc_lines.size() + i]);
+
+	for (int band = 0; band < h; band += LANE_MASK_BAND_ROWS) {
+		int band_end = std::min(band + LANE_MASK_BAND_ROWS, h);
+		for (int y = band; road_marking && y < band_end; y++) memset(mask.row(y), 0, w * 3);
+		for (int i = 0; i < table_num; i++) {
+			int last = std::min(table_rows[i].second, band_end - 1);
+			for (int y = std::max(table_rows[i].first, band); y <= last; y++)
+				FillRoadMarkingRow(tables[i], y, marking_fill, mask);
+		}
+		for (int y = std::max(band, rt_y); y < rt_y + rt_height && y < band_end; y++)
+			vp_fill.Fill(mask.row(y), rt_x, rt_x + rt_width - 1, w);
+		for (int i = 0; i < layer_num; i++)
+			DrawLineLayer(layers[i], band_end, mask);
+	}
+	return true;
+}
@@ -0,0 +1,112 @@
+#ifndef _LANE_MASK_RASTERIZER_H_
+#define _LANE_MASK_RASTERIZER_H_
+#include "RoadLaneManager.h"
+#include <stddef.h>
+#include <vector>
+
+// Lane mask export of the tool (SaveSplineMaskImage) without MFC / GDI+.
+// Draws a RoadLaneManager into a caller owned 8 bit, 3 channel buffer with
+// the same per row arithmetic as the view's Draw*ToMask, so masks can be made
+// wherever the data is.
+//
+// Lane Mask Format
+// Draw order: Roadmarker -> VP -> Lane
+// R: occ(1bit), ext(1bit), LaneID(6bit)
+// G: Roadmarker(1bit), Shape(2bit), Pos(5bit)
+// B: Color(2bit) + VP(0,64,128)(x,?,O)
+//
+// Pixels are stored B, G, R by default, like GDI+ 24 bpp bitmaps and OpenCV
+// images; SetRGB() switches to R, G, B.
+
+struct LaneMaskBuffer {
+	LaneMaskBuffer(unsigned char *data_, int width_, int height_, int stride_ = 0)
+		: data(data_), width(width_), height(height_), stride(stride_ ? stride_ : width_ * 3), r(2), g(1), b(0) {}
+	void SetRGB() { r = 0; b = 2; }
+	// all channels 0, the blank bitmap the export starts from
+	void Clear();
+	unsigned char *row(int y) const { return data + (ptrdiff_t)y * stride; }
+
+	unsigned char *data;
+	int width, height;
+	int stride;                      // bytes per row
+	int r, g, b;                     // byte offset of each channel in a pixel
+};
+
+// Update of a run of pixels: byte v at offset c of every pixel becomes
+// table(c)[v]. Tables of the form (v & keep & ~((v & hi) >> 1)) | set, which
+// covers the id writes and flag merges of the lane mask, are applied to 16
+// pixels at a time with SSE2; others go through the tables.
+class LaneMaskSpanFill
+{
+public:
+	LaneMaskSpanFill();          // leaves every byte unchanged
+
+	// offset c: v -> rule(v); (keep, hi, set) is the bit mask form of rule,
+	// used only if it gives the same table
+	template <typename RULE>
+	void SetChannel(int offset, unsigned char keep, unsigned char hi, unsigned char set, RULE rule) {
+		for (int v = 0; v < 256; v++) table_[offset][v] = (unsigned char)rule(v);
+		SetMasks(offset, keep, hi, set);
+	}
+	// offset c: v -> value
+	void SetChannel(int offset, unsigned char value);
+
+	// pixels [first, last] of row, clipped to [0, width)
+	void Fill(unsigned char *row, int first, int last, int width) const;
+	// filling a pixel twice equals filling it once
+	bool idempotent() const;
+
+private:
+	void SetMasks(int offset, unsigned char keep, unsigned char hi, unsigned char set);
+
+	unsigned char table_[3][256];
+	// keep / hi >> 1 / set repeated over 16 pixels
+	unsigned char keep_[48], hi_[48], set_[48];
+	bool masked_[3];
+};
+
+// Type file content of DrawLaneBoundaryToMask and the boundaries to draw.
+// Boundary segments go to the caller (boundary_index[i] is the
+// road.boundary() of boundary_types[i], drawn boundary_width wide).
+struct LaneMaskLayout {
+	vector<LineTypes> line_types;
+	vector<BoundaryTypes> boundary_types;
+	vector<int> boundary_index;
+	float boundary_width;
+};
+
+LineTypes GetLineTypes(const LaneInfo &info, int id);
+BoundaryTypes GetBoundaryTypes(const BoundaryInfo &info, int id, int max_level);
+
+// road marking polygons filled with (R, G, B) = (0, 128, 0), even-odd rule
+// with pixel centers on integer coordinates. Meant to match GDI+ FillPolygon,
+// but unlike the other layers it has no golden comparison yet (the goldens of
+// test/LaneMaskGoldenTest.cpp come from the pixel loops of the old view), so
+// the tool still fills road markings through GDI+.
+void LaneMaskDrawRoadMarking(const RoadLaneManager &road, LaneMaskBuffer &mask);
+// B = 128 in the box around the vanishing point, 64 everywhere without one
+void LaneMaskDrawVP(const RoadLaneManager &road, LaneMaskBuffer &mask);
+// G += 128 under an accessory line
+void LaneMaskDrawLineAsRoadMarker(const LaneLine &line, LaneMaskBuffer &mask);
+// id in R, with the shape / pos of the lane in G and its color in B;
+// extended to the bottom row for ego and neighbour positions
+void LaneMaskDrawLine(const LaneLine &line, int id, LaneMaskBuffer &mask);
+// id in R only; extended to the bottom row for the first two left / right lanes
+void LaneMaskDrawLineSeg(const LaneLine &line, int id, LaneMaskBuffer &mask);
+
+// DrawLaneToMask: single lanes get odd ids, double lanes even ids
+void LaneMaskDrawLanes(const RoadLaneManager &road, LaneMaskBuffer &mask);
+// DrawLaneBoundaryToMask without the boundary segments and the type file
+void LaneMaskDrawLaneBoundary(const RoadLaneManager &road, LaneMaskBuffer &mask,
+	LaneMaskLayout &layout, bool use_acc = false);
+
+// The whole export of one frame into a cleared mask: road markings, VP, then
+// the lanes in SortingLength() order. road itself is not reordered.
+// Single pass: all layers are drawn 16 rows at a time, so each band of the
+// mask is written while in cache; the result equals the layer functions above.
+// Without road_marking the mask is neither cleared nor given road markings:
+// the caller has drawn them into a cleared mask.
+// Returns false for an empty or too narrow buffer.
+bool RasterizeLaneMask(const RoadLaneManager &road, LaneMaskBuffer &mask, LaneMaskLayout &layout,
+	bool road_marking = true);
+#endif
@@ -0,0 +1,93 @@
+#ifndef _LANE_OCCLUSION_H_
+#define _LANE_OCCLUSION_H_
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <math.h>
+
+// Occlusions of one curve as a sorted set of disjoint intervals. Built from
+// info.occlusions_top_bottom_, which keeps the annotated order (the tool
+// edits occlusions by index): overlapping or touching intervals are merged,
+// reversed ones (top > bottom) are dropped since they never contained a row.
+// y is occluded when top <= y <= bottom, as in the per row loops it replaces.
+class LaneOcclusionSet
+{
+public:
+	typedef std::pair<float, float> Interval;
+
+	LaneOcclusionSet() {}
+	explicit LaneOcclusionSet(const std::vector<Interval> &occlusions) { Build(occlusions); }
+
+	void Build(const std::vector<Interval> &occlusions) {
+		source_ = occlusions;
+		intervals_.clear();
+		for (int i = 0; i < occlusions.size(); i++) {
+			if (occlusions[i].first <= occlusions[i].second) intervals_.push_back(occlusions[i]);
+		}
+		std::sort(intervals_.begin(), intervals_.end());
+		int count = 0;
+		for (int i = 0; i < intervals_.size(); i++) {
+			if (count && intervals_[i].first <= intervals_[count - 1].second)
+				intervals_[count - 1].second = std::max(intervals_[count - 1].second, intervals_[i].second);
+			else
+				intervals_[count++] = intervals_[i];
+		}
+		intervals_.resize(count);
+	}
+
+	// occlusions the set was built from
+	const std::vector<Interval> &source() const { return source_; }
+	int size() const { return intervals_.size(); }
+	bool empty() const { return intervals_.empty(); }
+	const Interval &operator[](int idx) const { return intervals_[idx]; }
+
+	// index of the first interval with top > y, O(log k)
+	int UpperBound(double y) const {
+		int lo = 0, hi = intervals_.size();
+		while (lo < hi) {
+			int mid = (lo + hi) / 2;
+			if (intervals_[mid].first <= y) lo = mid + 1;
+			else hi = mid;
+		}
+		return lo;
+	}
+	bool IsOccluded(double y) const {
+		int idx = UpperBound(y) - 1;
+		return idx >= 0 && y <= intervals_[idx].second;
+	}
+
+	// rows of [first_row, last_row] that are not occluded, as inclusive
+	// (first, last) row spans in ascending order; returns the span count
+	int VisibleSpans(int first_row, int last_row, std::vector<std::pair<int, int>> &spans) const {
+		spans.clear();
+		int row = first_row;
+		for (int i = std::max(UpperBound(first_row) - 1, 0); i < intervals_.size() && row <= last_row; i++) {
+			int occ_first = (int)ceil(intervals_[i].first);
+			int occ_last = (int)floor(intervals_[i].second);
+			if (occ_last < row || occ_first > occ_last) continue;
+			if (occ_first > row) spans.push_back(std::make_pair(row, std::min(occ_first - 1, last_row)));
+			row = occ_last + 1;
+		}
+		if (row <= last_row) spans.push_back(std::make_pair(row, last_row));
+		return spans.size();
+	}
+
+	// IsOccluded for ascending y, O(1) amortized per call
+	class Cursor
+	{
+	public:
+		explicit Cursor(const LaneOcclusionSet &set) : set_(set), idx_(0) {}
+		bool IsOccluded(double y) {
+			while (idx_ < set_.size() && set_[idx_].second < y) idx_++;
+			return idx_ < set_.size() && set_[idx_].first <= y;
+		}
+	private:
+		const LaneOcclusionSet &set_;
+		int idx_;
+	};
+
+private:
+	std::vector<Interval> source_;
+	std::vector<Interval> intervals_;
+};
+#endif
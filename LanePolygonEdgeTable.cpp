@@ -0,0 +1,154 @@
+#include "LanePolygonEdgeTable.h"
+#include <algorithm>
+#include <math.h>
+
+void LanePolygonEdgeTable::Build(const std::vector<PPOINTF> &polygon)
+{
+	edges_.clear();
+	top_ = bottom_ = 0;
+	int nvert = polygon.size();
+	for (int i = 0, j = nvert - 1; i < nvert; j = i++) {
+		// horizontal edges never straddle a row
+		if (polygon[i].y == polygon[j].y) continue;
+		Edge edge;
+		edge.xi = polygon[i].x;
+		edge.yi = polygon[i].y;
+		edge.dx = polygon[j].x - polygon[i].x;
+		edge.dy = polygon[j].y - polygon[i].y;
+		edge.y_min = std::min(polygon[i].y, polygon[j].y);
+		edge.y_max = std::max(polygon[i].y, polygon[j].y);
+		edges_.push_back(edge);
+	}
+	std::stable_sort(edges_.begin(), edges_.end(), [](const Edge &a, const Edge &b) {
+		return a.y_min < b.y_min;
+	});
+	for (int k = 0; k < edges_.size(); k++) {
+		if (k == 0 || edges_[k].y_min < top_) top_ = edges_[k].y_min;
+		if (k == 0 || edges_[k].y_max > bottom_) bottom_ = edges_[k].y_max;
+	}
+}
+
+bool LanePolygonEdgeTable::Contains(PPOINTF point) const
+{
+	bool c = false;
+	for (int k = 0; k < edges_.size() && edges_[k].y_min < point.y; k++) {
+		const Edge &edge = edges_[k];
+		if (point.y <= edge.y_max && point.x <= Crossing(edge, point.y))
+			c = !c;
+	}
+	return c;
+}
+
+void LanePolygonEdgeTable::RowCrossings(float y, std::vector<float> &xs) const
+{
+	xs.clear();
+	for (int k = 0; k < edges_.size() && edges_[k].y_min < y; k++) {
+		if (y <= edges_[k].y_max)
+			xs.push_back(Crossing(edges_[k], y));
+	}
+	std::sort(xs.begin(), xs.end());
+}
+
+// a point is inside when an odd number of crossings lie at or right of it
+void LanePolygonEdgeTable::ClassifySortedRow(const std::vector<float> &xs, float x0, float step, int count, unsigned char *inside)
+{
+	int n = xs.size();
+	if (n == 0) {
+		std::fill(inside, inside + count, 0);
+		return;
+	}
+	int k = 0;
+	for (int i = 0; i < count; i++) {
+		float x = x0 + i * step;
+		if (step > 0) {
+			while (k < n && xs[k] < x) k++;
+		}
+		else {
+			k = std::lower_bound(xs.begin(), xs.end(), x) - xs.begin();
+		}
+		inside[i] = (n - k) & 1;
+	}
+}
+
+void LanePolygonEdgeTable::ClassifyRow(float y, float x0, float step, int count, unsigned char *inside) const
+{
+	static thread_local std::vector<float> xs;
+	RowCrossings(y, xs);
+	ClassifySortedRow(xs, x0, step, count, inside);
+}
+
+int LanePolygonEdgeTable::RowSpans(float y, int count, std::vector<std::pair<int, int>> &spans) const
+{
+	static thread_local std::vector<float> xs;
+	RowCrossings(y, xs);
+	spans.clear();
+	// pixel x has the crossings below it, (x > xs[k]), counted; that count
+	// steps up at floor(xs[k]) + 1, so the parity is constant in between
+	int n = xs.size();
+	int first = 0;
+	for (int k = 0; k <= n && first < count; k++) {
+		int end = count;
+		if (k < n) {
+			float x = xs[k];
+			end = x < 0 ? 0 : (x >= count ? count : std::min((int)floor(x) + 1, count));
+		}
+		if (((n - k) & 1) && first < end) {
+			if (!spans.empty() && spans.back().second == first - 1) spans.back().second = end - 1;
+			else spans.push_back(std::make_pair(first, end - 1));
+		}
+		first = std::max(first, end);
+	}
+	return spans.size();
+}
+
+void LanePolygonEdgeTable::ClassifyGrid(float x0, float y0, float step_x, float step_y, int cols, int rows,
+	unsigned char *inside, int stride) const
+{
+	static thread_local std::vector<int> active;
+	static thread_local std::vector<float> xs;
+	active.clear();
+	int next = 0;
+	for (int r = 0; r < rows; r++) {
+		float y = y0 + r * step_y;
+		// rows only move down, so an edge that ended stays ended
+		while (next < edges_.size() && edges_[next].y_min < y)
+			active.push_back(next++);
+		int kept = 0;
+		xs.clear();
+		for (int a = 0; a < active.size(); a++) {
+			const Edge &edge = edges_[active[a]];
+			if (y > edge.y_max) continue;
+			active[kept++] = active[a];
+			xs.push_back(Crossing(edge, y));
+		}
+		active.resize(kept);
+		std::sort(xs.begin(), xs.end());
+		ClassifySortedRow(xs, x0, step_x, cols, inside + (size_t)r * stride);
+	}
+}
+
+void LanePolygonEdgeTable::ClassifyPoints(const PPOINTF *points, int count, unsigned char *inside) const
+{
+	static thread_local std::vector<int> order;
+	static thread_local std::vector<float> xs;
+	order.resize(count);
+	for (int i = 0; i < count; i++) order[i] = i;
+	std::sort(order.begin(), order.end(), [points](int a, int b) { return points[a].y < points[b].y; });
+	for (int s = 0; s < count;) {
+		float y = points[order[s]].y;
+		int e = s + 1;
+		while (e < count && points[order[e]].y == y) e++;
+		if (e - s == 1) {
+			inside[order[s]] = Contains(points[order[s]]);
+		}
+		else {
+			RowCrossings(y, xs);
+			for (int k = s; k < e; k++) {
+				int n = xs.size();
+				int idx = std::lower_bound(xs.begin(), xs.end(), points[order[k]].x) - xs.begin();
+				inside[order[k]] = (n - idx) & 1;
+			}
+		}
+		s = e;
+	}
+}
@@ -0,0 +1,56 @@
+#ifndef _LANE_POLYGON_EDGE_TABLE_H_
+#define _LANE_POLYGON_EDGE_TABLE_H_
+#include "regressor.h"
+#include <vector>
+#include <utility>
+
+// Edge table of a road marking polygon for classifying many points at once.
+//
+// A point is inside under exactly the even-odd rule of
+// RoadMarkingPolygon::PtInPolygon: edge (i, j) counts when it straddles the
+// point's y ((yi >= y) != (yj >= y)) and x <= dx * (y - yi) / dy + xi. The
+// crossing is evaluated with the same float operations, so the batch results
+// equal PtInPolygon bit for bit, but only once per edge and row instead of
+// once per edge and point. Edges are sorted by their lower y so a top to
+// bottom sweep only visits the edges active on the current row.
+class LanePolygonEdgeTable
+{
+public:
+	LanePolygonEdgeTable() { top_ = bottom_ = 0; }
+	explicit LanePolygonEdgeTable(const std::vector<PPOINTF> &polygon) { Build(polygon); }
+
+	void Build(const std::vector<PPOINTF> &polygon);
+	int edge_size() const { return edges_.size(); }
+	// rows outside [top, bottom] have no crossings
+	float top() const { return top_; }
+	float bottom() const { return bottom_; }
+
+	bool Contains(PPOINTF point) const;
+	// x of every edge crossing row y, ascending
+	void RowCrossings(float y, std::vector<float> &xs) const;
+
+	// inside[i] = Contains(x0 + i * step, y)
+	void ClassifyRow(float y, float x0, float step, int count, unsigned char *inside) const;
+	// runs of ClassifyRow(y, 0, 1, count) that are inside, as inclusive
+	// (first, last) pixel spans in ascending order; returns the span count
+	int RowSpans(float y, int count, std::vector<std::pair<int, int>> &spans) const;
+	// inside[r * stride + c] = Contains(x0 + c * step_x, y0 + r * step_y); step_y > 0
+	void ClassifyGrid(float x0, float y0, float step_x, float step_y, int cols, int rows,
+		unsigned char *inside, int stride) const;
+	// arbitrary points; points sharing a y share one crossing list
+	void ClassifyPoints(const PPOINTF *points, int count, unsigned char *inside) const;
+
+private:
+	struct Edge {
+		float y_min, y_max;   // active for y_min < y <= y_max
+		float xi, yi, dx, dy; // PtInPolygon's polygon_[i] and polygon_[j] - polygon_[i]
+	};
+	float Crossing(const Edge &edge, float y) const {
+		return edge.dx * (y - edge.yi) / edge.dy + edge.xi;
+	}
+	static void ClassifySortedRow(const std::vector<float> &xs, float x0, float step, int count, unsigned char *inside);
+
+	std::vector<Edge> edges_;    // sorted by y_min
+	float top_, bottom_;
+};
+#endif
@@ -0,0 +1,207 @@
+#include "stdafx.h"
+#include "LaneQa.h"
+#include <algorithm>
+#include <atomic>
+#include <math.h>
+#include <thread>
+
+// boundary_unknown_id of RoadLaneManager::ReadFile: side was inferred, not annotated
+#define LANE_QA_BOUNDARY_UNKNOWN_ID 8
+// occlusions are stored as float, curve ends as double
+#define LANE_QA_OCCLUSION_EPS 0.5
+
+const char *LaneQaCheckName(LaneQaCheck check)
+{
+	static const char *names[LANE_QA_CHECK_NUM] = {
+		"model_failed", "occlusion_range", "lanes_crossing",
+		"boundary_side", "polygon_points", "unreadable"
+	};
+	return (check >= 0 && check < LANE_QA_CHECK_NUM) ? names[check] : "unknown";
+}
+
+static void AddIssue(vector<LaneQaIssue> &issues, int frame, LaneQaCheck check,
+	LaneQaObject object_kind, int object, int other = -1, float y = -1)
+{
+	LaneQaIssue issue;
+	issue.frame = frame;
+	issue.check = check;
+	issue.object_kind = object_kind;
+	issue.object = object;
+	issue.other = other;
+	issue.y = y;
+	issues.push_back(issue);
+}
+
+static bool HasModel(double top_y, double bottom_y)
+{
+	// GenerateModels leaves 0, 0 when it fails
+	return top_y < bottom_y;
+}
+
+template <typename LINE>
+static void CheckCurve(const LINE &line, int frame, LaneQaObject kind, int idx, vector<LaneQaIssue> &issues)
+{
+	if (!HasModel(line.top_y_, line.bottom_y_)) {
+		AddIssue(issues, frame, LANE_QA_MODEL_FAILED, kind, idx);
+		return;
+	}
+	const vector<std::pair<float, float>> &occ = line.info.occlusions_top_bottom_;
+	for (int k = 0; k < occ.size(); k++) {
+		if (occ[k].first > occ[k].second
+			|| occ[k].first < line.top_y_ - LANE_QA_OCCLUSION_EPS
+			|| occ[k].second > line.bottom_y_ + LANE_QA_OCCLUSION_EPS) {
+			AddIssue(issues, frame, LANE_QA_OCCLUSION_RANGE, kind, idx, -1, occ[k].first);
+		}
+	}
+}
+
+void LaneQaScanner::CheckFrame(const RoadLaneManager &road, int frame, vector<LaneQaIssue> &issues) const
+{
+	for (int i = 0; i < road.GetSizeLaneLine(); i++)
+		CheckCurve(road.line(i), frame, LANE_QA_LINE, i, issues);
+	for (int i = 0; i < road.GetSizeBoundary(); i++)
+		CheckCurve(road.boundary(i), frame, LANE_QA_BOUNDARY, i, issues);
+
+	// crossing lanes: every lane sampled once on a shared row grid
+	// (rows k * row_step), then pairs compared over their common rows
+	struct Samples { int line, first_row, count; size_t offset; };
+	static thread_local vector<Samples> samples;
+	static thread_local vector<double> xs, rs;
+	samples.clear();
+	int step = std::max(options_.row_step, 1);
+	size_t total = 0;
+	for (int i = 0; i < road.GetSizeLaneLine(); i++) {
+		const LaneLine &line = road.line(i);
+		int type4 = line.info.GetType4();
+		if (type4 != LaneInfo::C4_NONE && type4 != LaneInfo::OPPOSITE_SIDE) continue;
+		if (!HasModel(line.top_y_, line.bottom_y_)) continue;
+		int first_row = (int)ceil(line.top_y_ / step);
+		int last_row = (int)floor(line.bottom_y_ / step);
+		if (last_row < first_row) continue;
+		Samples s = { i, first_row, last_row - first_row + 1, total };
+		samples.push_back(s);
+		total += s.count;
+	}
+	if (xs.size() < total) {
+		xs.resize(total);
+		rs.resize(total);
+	}
+	for (int k = 0; k < samples.size(); k++) {
+		const Samples &s = samples[k];
+		road.line(s.line).EvaluateRows((double)s.first_row * step, (double)(s.first_row + s.count - 1) * step, step,
+			&xs[s.offset], &rs[s.offset]);
+	}
+	for (int a = 0; a < samples.size(); a++) {
+		for (int b = a + 1; b < samples.size(); b++) {
+			const Samples &sa = samples[a], &sb = samples[b];
+			int first = std::max(sa.first_row, sb.first_row);
+			int last = std::min(sa.first_row + sa.count, sb.first_row + sb.count) - 1;
+			const double *xa = &xs[sa.offset] - sa.first_row;
+			const double *xb = &xs[sb.offset] - sb.first_row;
+			int side = 0;
+			for (int row = first; row <= last; row++) {
+				double d = xa[row] - xb[row];
+				int s = d > options_.crossing_gap ? 1 : (d < -options_.crossing_gap ? -1 : 0);
+				if (!s) continue;
+				if (side && s != side) {
+					AddIssue(issues, frame, LANE_QA_LANES_CROSSING, LANE_QA_LINE, sa.line, sb.line, (float)row * step);
+					break;
+				}
+				side = s;
+			}
+		}
+	}
+
+	// boundary sides, inferred the way ReadFile does for unknown ones
+	for (int i = 0; i < road.GetSizeBoundary(); i++) {
+		const BoundaryLine &line = road.boundary(i);
+		if (line.spline_x_.empty() || line.info.GetType3_ID() == LANE_QA_BOUNDARY_UNKNOWN_ID) continue;
+		int side = line.info.GetType3();
+		if (side != BoundaryInfo::CATEGORY3::LEFT && side != BoundaryInfo::CATEGORY3::RIGHT) continue;
+		double average_x = (line.spline_x_[0] + line.spline_x_[line.spline_x_.size() - 1]) / 2;
+		int inferred = average_x < road.GetImageW() / 2 ?
+			BoundaryInfo::CATEGORY3::LEFT : BoundaryInfo::CATEGORY3::RIGHT;
+		if (side != inferred)
+			AddIssue(issues, frame, LANE_QA_BOUNDARY_SIDE, LANE_QA_BOUNDARY, i);
+	}
+
+	for (int i = 0; i < road.GetSizeRoadMarking(); i++) {
+		if (road.roadmarking(i).GetPolygonPointNum() < 3)
+			AddIssue(issues, frame, LANE_QA_POLYGON_POINTS, LANE_QA_POLYGON, i);
+	}
+}
+
+template <typename LOAD>
+void LaneQaScanner::Scan(int frame_num, LOAD load, vector<LaneQaIssue> &issues) const
+{
+	int num_threads = options_.num_threads;
+	if (num_threads <= 0) num_threads = std::thread::hardware_concurrency();
+	if (num_threads <= 0) num_threads = 1;
+	if (num_threads > frame_num) num_threads = frame_num > 0 ? frame_num : 1;
+
+	const int chunk = 64;
+	std::atomic<int> cursor(0);
+	vector<vector<LaneQaIssue>> partial(num_threads);
+	auto worker = [&](int tid) {
+		RoadLaneManager road;
+		for (;;) {
+			int begin = cursor.fetch_add(chunk);
+			if (begin >= frame_num) break;
+			int end = std::min(begin + chunk, frame_num);
+			for (int i = begin; i < end; i++) {
+				if (load(i, road))
+					CheckFrame(road, i, partial[tid]);
+				else
+					AddIssue(partial[tid], i, LANE_QA_UNREADABLE, LANE_QA_FRAME, -1);
+			}
+		}
+	};
+	vector<std::thread> threads;
+	for (int t = 1; t < num_threads; t++) threads.push_back(std::thread(worker, t));
+	worker(0);
+	for (int t = 0; t < threads.size(); t++) threads[t].join();
+
+	size_t begin = issues.size();
+	for (int t = 0; t < num_threads; t++)
+		issues.insert(issues.end(), partial[t].begin(), partial[t].end());
+	std::stable_sort(issues.begin() + begin, issues.end(),
+		[](const LaneQaIssue &a, const LaneQaIssue &b) { return a.frame < b.frame; });
+}
+
+void LaneQaScanner::ScanXml(const vector<string> &xml_paths, vector<LaneQaIssue> &issues) const
+{
+	Scan(xml_paths.size(), [&](int i, RoadLaneManager &road) {
+		return road.ReadFileStream(xml_paths[i].c_str());
+	}, issues);
+}
+
+void LaneQaScanner::ScanCorpus(const LaneCorpusView &corpus, vector<LaneQaIssue> &issues) const
+{
+	Scan(corpus.GetSizeFrame(), [&](int i, RoadLaneManager &road) {
+		return corpus.ToRoadLane(i, road);
+	}, issues);
+}
+
+bool LaneQaScanner::WriteReport(const char *szpath, const vector<LaneQaIssue> &issues, const vector<string> &frame_ids)
+{
+	static const char *kinds[] = { "frame", "line", "boundary", "polygon" };
+	FILE *fp = fopen(szpath, "w");
+	if (fp == NULL) {
+		printf("cannot write qa report - \"%s\".\n", szpath);
+		return false;
+	}
+	int counts[LANE_QA_CHECK_NUM] = { 0 };
+	for (int i = 0; i < issues.size(); i++) {
+		const LaneQaIssue &issue = issues[i];
+		if (issue.frame >= 0 && issue.frame < frame_ids.size())
+			fprintf(fp, "%s", frame_ids[issue.frame].c_str());
+		else
+			fprintf(fp, "%d", issue.frame);
+		fprintf(fp, "\t%s\t%s\t%d\t%d\t%g\n", LaneQaCheckName(issue.check), kinds[issue.object_kind],
+			issue.object, issue.other, issue.y);
+		if (issue.check >= 0 && issue.check < LANE_QA_CHECK_NUM) counts[issue.check]++;
+	}
+	for (int c = 0; c < LANE_QA_CHECK_NUM; c++)
+		fprintf(fp, "# %s\t%d\n", LaneQaCheckName((LaneQaCheck)c), counts[c]);
+	return fclose(fp) == 0;
+}
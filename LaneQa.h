@@ -0,0 +1,70 @@
+#ifndef _LANE_QA_H_
+#define _LANE_QA_H_
+#include "RoadLaneManager.h"
+#include "LaneCorpus.h"
+#include <string>
+#include <vector>
+
+// Annotation checks over whole datasets. Frames are loaded through
+// RoadLaneManager (ReadFileStream or LaneCorpusView::ToRoadLane), checked on
+// worker threads and reported with their frame ids.
+
+enum LaneQaCheck {
+	LANE_QA_MODEL_FAILED = 0,        // curve with fewer than 3 distinct y, GenerateModels failed
+	LANE_QA_OCCLUSION_RANGE,         // occlusion reversed or outside [top_y_, bottom_y_]
+	LANE_QA_LANES_CROSSING,          // two lanes swap sides (branch / merged / unable lanes excluded)
+	LANE_QA_BOUNDARY_SIDE,           // type3 side disagrees with the side inferred from x
+	LANE_QA_POLYGON_POINTS,          // road marking with fewer than 3 points (SetPoints rejected it)
+	LANE_QA_UNREADABLE,              // xml could not be parsed
+	LANE_QA_CHECK_NUM
+};
+
+enum LaneQaObject {
+	LANE_QA_FRAME = 0,
+	LANE_QA_LINE,
+	LANE_QA_BOUNDARY,
+	LANE_QA_POLYGON
+};
+
+const char *LaneQaCheckName(LaneQaCheck check);
+
+struct LaneQaIssue {
+	int frame;                       // index in the scanned list
+	LaneQaCheck check;
+	LaneQaObject object_kind;
+	int object;                      // index of the line / boundary / polygon, -1 for the frame
+	int other;                       // second line of a crossing, -1 otherwise
+	float y;                         // image row of the problem, -1 when not tied to a row
+};
+
+struct LaneQaOptions {
+	LaneQaOptions() : row_step(4), crossing_gap(1.f), num_threads(0) {}
+	int row_step;                    // rows between samples of the crossing check
+	float crossing_gap;              // |x_a - x_b| up to this counts as touching, not crossing
+	int num_threads;                 // 0 = all cores
+};
+
+class LaneQaScanner
+{
+public:
+	explicit LaneQaScanner(const LaneQaOptions &options = LaneQaOptions()) : options_(options) {}
+
+	// appends the issues of one frame
+	void CheckFrame(const RoadLaneManager &road, int frame, vector<LaneQaIssue> &issues) const;
+
+	// issues are sorted by frame
+	void ScanXml(const vector<string> &xml_paths, vector<LaneQaIssue> &issues) const;
+	void ScanCorpus(const LaneCorpusView &corpus, vector<LaneQaIssue> &issues) const;
+
+	// one tab separated line per issue: frame id, check, object kind, object, other, y;
+	// counts per check at the end
+	static bool WriteReport(const char *szpath, const vector<LaneQaIssue> &issues, const vector<string> &frame_ids);
+
+private:
+	// runs load(frame, road) and CheckFrame for every frame on the worker threads
+	template <typename LOAD>
+	void Scan(int frame_num, LOAD load, vector<LaneQaIssue> &issues) const;
+
+	LaneQaOptions options_;
+};
+#endif
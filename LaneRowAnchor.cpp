@@ -0,0 +1,159 @@
+#include "stdafx.h"
+#include "LaneRowAnchor.h"
+#include "LaneTypeMap.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+LaneRowAnchorSpec::LaneRowAnchorSpec()
+{
+	out_width = 800;
+	out_height = 288;
+	max_lines = 8;
+	max_boundarys = 4;
+	boundary_max_level = 1;
+	SetUniformRows(72, 0, out_height - 1);
+}
+
+void LaneRowAnchorSpec::SetUniformRows(int row_count, float first_row, float last_row)
+{
+	rows.resize(std::max(row_count, 0));
+	for (int k = 0; k < rows.size(); k++)
+		rows[k] = row_count > 1 ? first_row + (last_row - first_row) * k / (row_count - 1) : first_row;
+}
+
+void LaneRowAnchorBatch::Resize(int frames, const LaneRowAnchorSpec &spec)
+{
+	frame_count = frames;
+	slot_count = spec.slot_count();
+	row_count = spec.rows.size();
+	size_t values = (size_t)frame_count * slot_count * row_count;
+	x.assign(values, -1.f);
+	half_width.assign(values, -1.f);
+	visible.assign(values, 0);
+	labels.assign((size_t)frame_count * slot_count * LANE_ANCHOR_LABEL_NUM, -1);
+	object_count.assign(frame_count, 0);
+	dropped_count.assign(frame_count, 0);
+}
+
+void LaneRowAnchorBatch::ClearFrame(int frame)
+{
+	size_t values = (size_t)slot_count * row_count;
+	if (values) {
+		std::fill(x_ptr(frame, 0), x_ptr(frame, 0) + values, -1.f);
+		std::fill(half_width_ptr(frame, 0), half_width_ptr(frame, 0) + values, -1.f);
+		std::fill(visible_ptr(frame, 0), visible_ptr(frame, 0) + values, 0);
+	}
+	if (slot_count)
+		std::fill(labels_ptr(frame, 0), labels_ptr(frame, 0) + slot_count * LANE_ANCHOR_LABEL_NUM, -1);
+	object_count[frame] = 0;
+	dropped_count[frame] = 0;
+}
+
+static int8_t AnchorLabel(int value)
+{
+	return (value >= -1 && value <= 127) ? (int8_t)value : -1;
+}
+
+// Rows inside [top_y_, bottom_y_] get the spline values, evaluated with the
+// same segment walk as EstimatePoint. scale maps image to output space.
+template <typename LINE>
+static void SampleCurve(const LINE &line, const LaneRowAnchorSpec &spec, double scale_x, double scale_y,
+	float *x, float *half_width, unsigned char *visible)
+{
+	std::shared_ptr<const LaneOcclusionSet> occlusions = line.Occlusions();
+	LaneOcclusionSet::Cursor occ(*occlusions);
+	int idx_x = 0, idx_r = 0;
+	for (int k = 0; k < spec.rows.size(); k++) {
+		double y = spec.rows[k] / scale_y;
+		if (y < line.top_y_) continue;
+		if (y > line.bottom_y_) break;
+		idx_x = line.spline_xy_model_.Segment(y, idx_x);
+		idx_r = line.spline_ry_model_.Segment(y, idx_r);
+		double out_x = line.spline_xy_model_.Evaluate(y, idx_x) * scale_x;
+		x[k] = (float)out_x;
+		half_width[k] = (float)(line.spline_ry_model_.Evaluate(y, idx_r) * scale_x);
+		visible[k] = !occ.IsOccluded(y) && out_x >= 0 && out_x < spec.out_width;
+	}
+}
+
+int SampleRowAnchors(const RoadLaneManager &road, const LaneRowAnchorSpec &spec,
+	LaneRowAnchorBatch &batch, int frame)
+{
+	batch.ClearFrame(frame);
+	if (road.GetImageW() <= 0 || road.GetImageH() <= 0) return 0;
+	double scale_x = (double)spec.out_width / road.GetImageW();
+	double scale_y = (double)spec.out_height / road.GetImageH();
+
+	int slot = 0, dropped = 0;
+	for (int i = 0; i < road.GetSizeLaneLine(); i++) {
+		const LaneLine &line = road.line(i);
+		// GenerateModels failed (fewer than 3 distinct rows)
+		if (line.top_y_ >= line.bottom_y_) continue;
+		if (slot >= spec.max_lines) {
+			dropped++;
+			continue;
+		}
+		SampleCurve(line, spec, scale_x, scale_y,
+			batch.x_ptr(frame, slot), batch.half_width_ptr(frame, slot), batch.visible_ptr(frame, slot));
+		int8_t *labels = batch.labels_ptr(frame, slot);
+		labels[LANE_ANCHOR_LABEL_KIND] = 0;
+		labels[LANE_ANCHOR_LABEL_POS] = AnchorLabel(LaneTypePos(line.info));
+		labels[LANE_ANCHOR_LABEL_SHAPE] = AnchorLabel(LaneTypeShape(line.info));
+		labels[LANE_ANCHOR_LABEL_SD] = AnchorLabel(LaneTypeSD(line.info));
+		labels[LANE_ANCHOR_LABEL_COLOR] = AnchorLabel(LaneTypeColor(line.info));
+		labels[LANE_ANCHOR_LABEL_BICYCLE] = AnchorLabel(LaneTypeBicycle(line.info));
+		slot++;
+	}
+	int used = slot;
+
+	slot = spec.max_lines;
+	for (int i = 0; i < road.GetSizeBoundary(); i++) {
+		const BoundaryLine &line = road.boundary(i);
+		if (line.top_y_ >= line.bottom_y_) continue;
+		if (slot >= spec.slot_count()) {
+			dropped++;
+			continue;
+		}
+		SampleCurve(line, spec, scale_x, scale_y,
+			batch.x_ptr(frame, slot), batch.half_width_ptr(frame, slot), batch.visible_ptr(frame, slot));
+		int8_t *labels = batch.labels_ptr(frame, slot);
+		labels[LANE_ANCHOR_LABEL_KIND] = 1;
+		labels[LANE_ANCHOR_LABEL_POS] = AnchorLabel(BoundaryTypePos(line.info, spec.boundary_max_level));
+		labels[LANE_ANCHOR_LABEL_SHAPE] = AnchorLabel(BoundaryTypeShape(line.info));
+		slot++;
+	}
+	used += slot - spec.max_lines;
+
+	batch.object_count[frame] = used;
+	batch.dropped_count[frame] = dropped;
+	return used;
+}
+
+void SampleRowAnchorsBatch(const vector<const RoadLaneManager *> &frames, const LaneRowAnchorSpec &spec,
+	LaneRowAnchorBatch &batch, int num_threads)
+{
+	int frame_num = frames.size();
+	batch.Resize(frame_num, spec);
+	if (num_threads <= 0) num_threads = std::thread::hardware_concurrency();
+	if (num_threads <= 0) num_threads = 1;
+	if (num_threads > frame_num) num_threads = frame_num > 0 ? frame_num : 1;
+
+	// frames write disjoint parts of the batch
+	const int chunk = 64;
+	std::atomic<int> cursor(0);
+	auto worker = [&]() {
+		for (;;) {
+			int begin = cursor.fetch_add(chunk);
+			if (begin >= frame_num) break;
+			int end = std::min(begin + chunk, frame_num);
+			for (int i = begin; i < end; i++) {
+				if (frames[i]) SampleRowAnchors(*frames[i], spec, batch, i);
+			}
+		}
+	};
+	vector<std::thread> threads;
+	for (int t = 1; t < num_threads; t++) threads.push_back(std::thread(worker));
+	worker();
+	for (int t = 0; t < threads.size(); t++) threads[t].join();
+}
@@ -0,0 +1,72 @@
+#ifndef _LANE_ROW_ANCHOR_H_
+#define _LANE_ROW_ANCHOR_H_
+#include "RoadLaneManager.h"
+#include <stdint.h>
+#include <vector>
+
+// Row anchor targets sampled straight from the splines, for heads that
+// regress x per row instead of segmenting the lane mask.
+//
+// Every frame has slot_count slots: lines fill [0, max_lines), boundaries
+// [max_lines, slot_count), in RoadLaneManager order. Per slot and row anchor:
+//   x           center x in output space, -1 outside [top_y_, bottom_y_]
+//   half_width  spline_ry_model_ in output space, -1 outside the curve
+//   visible     1 inside the curve and the output width, and not in
+//               occlusions_top_bottom_
+// and per slot the labels of LaneTypeMap.h (LANE_ANCHOR_LABEL_*), -1 for none.
+
+enum LaneAnchorLabel {
+	LANE_ANCHOR_LABEL_KIND = 0,      // 0 lane, 1 boundary
+	LANE_ANCHOR_LABEL_POS,           // typePos
+	LANE_ANCHOR_LABEL_SHAPE,         // typeShape
+	LANE_ANCHOR_LABEL_SD,            // typeSD (lanes)
+	LANE_ANCHOR_LABEL_COLOR,         // typeColor (lanes)
+	LANE_ANCHOR_LABEL_BICYCLE,       // typeBicycle (lanes)
+	LANE_ANCHOR_LABEL_NUM
+};
+
+struct LaneRowAnchorSpec {
+	LaneRowAnchorSpec();
+	// row_count anchors evenly spaced from first_row to last_row
+	void SetUniformRows(int row_count, float first_row, float last_row);
+
+	int out_width, out_height;       // output space; image rows / columns are scaled to it
+	vector<float> rows;              // row anchors in output space, ascending
+	int max_lines;
+	int max_boundarys;
+	int boundary_max_level;          // max_level of BoundaryTypePos, as in the mask export
+
+	int slot_count() const { return max_lines + max_boundarys; }
+};
+
+// Dense targets of many frames; arrays are [frame][slot][row] and
+// [frame][slot][label], ready to be handed to the training blobs.
+struct LaneRowAnchorBatch {
+	void Resize(int frame_count, const LaneRowAnchorSpec &spec);
+	// clears one frame to "no object"
+	void ClearFrame(int frame);
+
+	int frame_count, slot_count, row_count;
+	vector<float> x;
+	vector<float> half_width;
+	vector<unsigned char> visible;
+	vector<int8_t> labels;
+	vector<int> object_count;        // slots used per frame
+	vector<int> dropped_count;       // objects that did not fit the slots
+
+	float *x_ptr(int frame, int slot) { return &x[((size_t)frame * slot_count + slot) * row_count]; }
+	float *half_width_ptr(int frame, int slot) { return &half_width[((size_t)frame * slot_count + slot) * row_count]; }
+	unsigned char *visible_ptr(int frame, int slot) { return &visible[((size_t)frame * slot_count + slot) * row_count]; }
+	int8_t *labels_ptr(int frame, int slot) { return &labels[((size_t)frame * slot_count + slot) * LANE_ANCHOR_LABEL_NUM]; }
+};
+
+// Samples one frame into batch slot arrays of the given frame.
+// Returns the number of slots written.
+int SampleRowAnchors(const RoadLaneManager &road, const LaneRowAnchorSpec &spec,
+	LaneRowAnchorBatch &batch, int frame);
+
+// Samples every frame into a batch resized to frames.size(), with
+// num_threads workers (0 = all cores).
+void SampleRowAnchorsBatch(const vector<const RoadLaneManager *> &frames, const LaneRowAnchorSpec &spec,
+	LaneRowAnchorBatch &batch, int num_threads = 0);
+#endif
@@ -0,0 +1,847 @@
+#include "stdafx.h"
+#include "LaneSequence.h"
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+// low two bits of the leading varint of a value
+enum { VALUE_FIXED = 0, VALUE_FLOAT_BITS = 1, VALUE_RAW = 2 };
+// curve / polygon flags
+enum { SAME_TYPE = 0x1, SAME_POINTS = 0x2, SAME_OCCLUSIONS = 0x4 };
+// frame flags
+enum { SAME_TOOL_VERSION = 0x1, SAME_IMAGE_SIZE = 0x2, SAME_VP = 0x4 };
+
+static void PutVarint(vector<unsigned char> &out, uint64_t v)
+{
+	while (v >= 0x80) {
+		out.push_back((unsigned char)(v | 0x80));
+		v >>= 7;
+	}
+	out.push_back((unsigned char)v);
+}
+
+static void PutRaw(vector<unsigned char> &out, const void *src, size_t size)
+{
+	const unsigned char *p = (const unsigned char *)src;
+	out.insert(out.end(), p, p + size);
+}
+
+static uint64_t ZigZag(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+static int64_t UnZigZag(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+// Bounds checked cursor over one frame record; ok drops to false on overrun.
+struct LaneSequenceInput {
+	const unsigned char *p, *end;
+	bool ok;
+
+	uint64_t Varint() {
+		uint64_t v = 0;
+		for (int shift = 0; shift < 64 && p < end; shift += 7) {
+			unsigned char c = *p++;
+			v |= (uint64_t)(c & 0x7f) << shift;
+			if (!(c & 0x80)) return v;
+		}
+		ok = false;
+		return 0;
+	}
+	void Raw(void *dst, size_t size) {
+		if ((size_t)(end - p) < size) {
+			ok = false;
+			memset(dst, 0, size);
+			return;
+		}
+		memcpy(dst, p, size);
+		p += size;
+	}
+	// element counts are bounded by the bytes left (every element takes one at least)
+	bool Count(int &n) {
+		uint64_t v = Varint();
+		if (!ok || v > (uint64_t)(end - p)) return ok = false;
+		n = (int)v;
+		return true;
+	}
+};
+
+// Floats as integers in value order, so near values have small differences.
+static int64_t FloatOrder(float f)
+{
+	int32_t i;
+	memcpy(&i, &f, sizeof(i));
+	return i < 0 ? (int64_t)(i ^ 0x7fffffff) : i;
+}
+
+static bool FloatFromOrder(int64_t order, float &f)
+{
+	if (order < INT32_MIN || order > INT32_MAX) return false;
+	int32_t i = (int32_t)order;
+	if (i < 0) i ^= 0x7fffffff;
+	memcpy(&f, &i, sizeof(f));
+	return true;
+}
+
+static float PredictFloat(double pred)
+{
+	return fabs(pred) <= FLT_MAX ? (float)pred : 0.f;
+}
+
+// Value coding shared by writer and reader. Every value is coded against a
+// prediction the reader already has:
+//   VALUE_FIXED      (q - q_pred) in units of 1 / scale
+//   VALUE_FLOAT_BITS difference of the float bit patterns (values that are floats)
+//   VALUE_RAW        the 8 byte double
+class LaneValueCodec
+{
+public:
+	LaneValueCodec(int64_t scale, bool lossless) : scale_((double)scale), lossless_(lossless) {}
+
+	// returns v as the reader will decode it
+	double Put(vector<unsigned char> &out, double v, double pred) const {
+		int64_t q;
+		if (Quantize(v, q)) {
+			double back = q / scale_;
+			if (!lossless_ || back == v) {
+				PutVarint(out, ZigZag(q - QuantizePred(pred)) << 2 | VALUE_FIXED);
+				return back;
+			}
+		}
+		if (fabs(v) <= FLT_MAX && (double)(float)v == v) {
+			PutVarint(out, ZigZag(FloatOrder((float)v) - FloatOrder(PredictFloat(pred))) << 2 | VALUE_FLOAT_BITS);
+			return v;
+		}
+		PutVarint(out, VALUE_RAW);
+		PutRaw(out, &v, sizeof(v));
+		return v;
+	}
+	float PutFloat(vector<unsigned char> &out, float v, float pred) const {
+		int64_t q;
+		if (Quantize(v, q)) {
+			float back = (float)(q / scale_);
+			if (!lossless_ || back == v) {
+				PutVarint(out, ZigZag(q - QuantizePred(pred)) << 2 | VALUE_FIXED);
+				return back;
+			}
+		}
+		PutVarint(out, ZigZag(FloatOrder(v) - FloatOrder(pred)) << 2 | VALUE_FLOAT_BITS);
+		return v;
+	}
+
+	// v as the reader would decode it, without writing anything
+	double Round(double v) const {
+		int64_t q;
+		return Quantize(v, q) && !lossless_ ? q / scale_ : v;
+	}
+	float Round(float v) const {
+		int64_t q;
+		return Quantize(v, q) && !lossless_ ? (float)(q / scale_) : v;
+	}
+
+	double Get(LaneSequenceInput &in, double pred) const {
+		uint64_t u = in.Varint();
+		switch (u & 3) {
+		case VALUE_FIXED:
+			return (UnZigZag(u >> 2) + QuantizePred(pred)) / scale_;
+		case VALUE_FLOAT_BITS: {
+			float f = 0;
+			if (!FloatFromOrder(FloatOrder(PredictFloat(pred)) + UnZigZag(u >> 2), f)) in.ok = false;
+			return f;
+		}
+		case VALUE_RAW: {
+			double v;
+			in.Raw(&v, sizeof(v));
+			return v;
+		}
+		}
+		in.ok = false;
+		return 0;
+	}
+	float GetFloat(LaneSequenceInput &in, float pred) const {
+		uint64_t u = in.Varint();
+		switch (u & 3) {
+		case VALUE_FIXED:
+			return (float)((UnZigZag(u >> 2) + QuantizePred(pred)) / scale_);
+		case VALUE_FLOAT_BITS: {
+			float f = 0;
+			if (!FloatFromOrder(FloatOrder(pred) + UnZigZag(u >> 2), f)) in.ok = false;
+			return f;
+		}
+		}
+		in.ok = false;
+		return 0;
+	}
+
+private:
+	// |q| < 2^52, so q / scale is exact to compute and deltas cannot overflow
+	bool Quantize(double v, int64_t &q) const {
+		double scaled = v * scale_;
+		if (!(fabs(scaled) < 4e15)) return false;
+		q = llround(scaled);
+		return true;
+	}
+	int64_t QuantizePred(double pred) const {
+		int64_t q;
+		return Quantize(pred, q) ? q : 0;
+	}
+
+	double scale_;
+	bool lossless_;
+};
+
+// j-th value predicted from the matching value of the reference object,
+// or from the value `back` positions earlier in the object itself
+template <typename T>
+static T PredictValue(const vector<T> *ref, const vector<T> &cur, int j, int back)
+{
+	if (ref && j < ref->size()) return (*ref)[j];
+	return j >= back ? cur[j - back] : 0;
+}
+
+template <typename T>
+static double IntraCost(const vector<T> &v, int back)
+{
+	double cost = 0;
+	for (int j = 0; j < v.size(); j++) cost += fabs(v[j] - (j >= back ? v[j - back] : 0));
+	return cost;
+}
+
+template <typename T>
+static double DeltaCost(const vector<T> &v, const vector<T> &ref, int back)
+{
+	double cost = 0;
+	for (int j = 0; j < v.size(); j++) cost += fabs(v[j] - (j < ref.size() ? ref[j] : j >= back ? v[j - back] : 0));
+	return cost;
+}
+
+// true when every value of v decodes to the value of ref
+template <typename T>
+static bool SameValues(const LaneValueCodec &codec, const vector<T> &v, const vector<T> &ref)
+{
+	if (v.size() != ref.size()) return false;
+	for (int j = 0; j < v.size(); j++) {
+		if (codec.Round(v[j]) != ref[j]) return false;
+	}
+	return true;
+}
+
+// object of the previous frame that predicts curve best, -1 for none
+static int ChooseReference(const LaneSequenceCurve &curve, const vector<LaneSequenceCurve> &prev)
+{
+	double best = IntraCost(curve.x, 1) + IntraCost(curve.y, 1) + IntraCost(curve.r, 1);
+	int best_ref = -1;
+	for (int k = 0; k < prev.size(); k++) {
+		double cost = DeltaCost(curve.x, prev[k].x, 1) + DeltaCost(curve.y, prev[k].y, 1) + DeltaCost(curve.r, prev[k].r, 1);
+		if (memcmp(curve.type, prev[k].type, sizeof(curve.type))) cost += 1;
+		if (cost < best) {
+			best = cost;
+			best_ref = k;
+		}
+	}
+	return best_ref;
+}
+
+static int ChooseReference(const LaneSequencePolygon &polygon, const vector<LaneSequencePolygon> &prev)
+{
+	double best = IntraCost(polygon.points, 2);
+	int best_ref = -1;
+	for (int k = 0; k < prev.size(); k++) {
+		double cost = DeltaCost(polygon.points, prev[k].points, 2);
+		if (polygon.type != prev[k].type) cost += 1;
+		if (cost < best) {
+			best = cost;
+			best_ref = k;
+		}
+	}
+	return best_ref;
+}
+
+static void PutCurve(vector<unsigned char> &out, const LaneValueCodec &codec,
+	const LaneSequenceCurve &curve, const vector<LaneSequenceCurve> &prev, LaneSequenceCurve &back)
+{
+	int ref = ChooseReference(curve, prev);
+	const LaneSequenceCurve *pred = ref >= 0 ? &prev[ref] : NULL;
+	int flags = 0;
+	if (pred) {
+		if (!memcmp(curve.type, pred->type, sizeof(curve.type))) flags |= SAME_TYPE;
+		if (SameValues(codec, curve.x, pred->x) && SameValues(codec, curve.y, pred->y) && SameValues(codec, curve.r, pred->r))
+			flags |= SAME_POINTS;
+		if (SameValues(codec, curve.occlusions, pred->occlusions)) flags |= SAME_OCCLUSIONS;
+	}
+	PutVarint(out, ref + 1);
+	PutVarint(out, flags);
+
+	memcpy(back.type, curve.type, sizeof(back.type));
+	if (!(flags & SAME_TYPE)) {
+		for (int k = 0; k < 6; k++) PutVarint(out, ZigZag(curve.type[k]));
+	}
+
+	if (flags & SAME_POINTS) {
+		back.x = pred->x;
+		back.y = pred->y;
+		back.r = pred->r;
+	}
+	else {
+		int n = curve.x.size();
+		PutVarint(out, n);
+		back.x.resize(n);
+		back.y.resize(n);
+		back.r.resize(n);
+		for (int j = 0; j < n; j++) {
+			back.x[j] = codec.Put(out, curve.x[j], PredictValue(pred ? &pred->x : NULL, back.x, j, 1));
+			back.y[j] = codec.Put(out, curve.y[j], PredictValue(pred ? &pred->y : NULL, back.y, j, 1));
+			back.r[j] = codec.Put(out, curve.r[j], PredictValue(pred ? &pred->r : NULL, back.r, j, 1));
+		}
+	}
+
+	if (flags & SAME_OCCLUSIONS) {
+		back.occlusions = pred->occlusions;
+	}
+	else {
+		int n = curve.occlusions.size();
+		PutVarint(out, n);
+		back.occlusions.resize(n);
+		for (int j = 0; j < n; j++)
+			back.occlusions[j] = codec.PutFloat(out, curve.occlusions[j], PredictValue(pred ? &pred->occlusions : NULL, back.occlusions, j, 1));
+	}
+}
+
+static bool GetCurve(LaneSequenceInput &in, const LaneValueCodec &codec,
+	const vector<LaneSequenceCurve> &prev, LaneSequenceCurve &curve)
+{
+	int ref = (int)in.Varint() - 1;
+	int flags = (int)in.Varint();
+	if (!in.ok || ref < -1 || ref >= (int)prev.size()) return false;
+	const LaneSequenceCurve *pred = ref >= 0 ? &prev[ref] : NULL;
+	if (!pred && (flags & (SAME_TYPE | SAME_POINTS | SAME_OCCLUSIONS))) return false;
+
+	if (flags & SAME_TYPE) {
+		memcpy(curve.type, pred->type, sizeof(curve.type));
+	}
+	else {
+		for (int k = 0; k < 6; k++) curve.type[k] = (int32_t)UnZigZag(in.Varint());
+	}
+
+	if (flags & SAME_POINTS) {
+		curve.x = pred->x;
+		curve.y = pred->y;
+		curve.r = pred->r;
+	}
+	else {
+		int n;
+		if (!in.Count(n)) return false;
+		curve.x.resize(n);
+		curve.y.resize(n);
+		curve.r.resize(n);
+		for (int j = 0; j < n; j++) {
+			curve.x[j] = codec.Get(in, PredictValue(pred ? &pred->x : NULL, curve.x, j, 1));
+			curve.y[j] = codec.Get(in, PredictValue(pred ? &pred->y : NULL, curve.y, j, 1));
+			curve.r[j] = codec.Get(in, PredictValue(pred ? &pred->r : NULL, curve.r, j, 1));
+		}
+	}
+
+	if (flags & SAME_OCCLUSIONS) {
+		curve.occlusions = pred->occlusions;
+	}
+	else {
+		int n;
+		if (!in.Count(n)) return false;
+		curve.occlusions.resize(n);
+		for (int j = 0; j < n; j++)
+			curve.occlusions[j] = codec.GetFloat(in, PredictValue(pred ? &pred->occlusions : NULL, curve.occlusions, j, 1));
+	}
+	return in.ok;
+}
+
+static void PutPolygon(vector<unsigned char> &out, const LaneValueCodec &codec,
+	const LaneSequencePolygon &polygon, const vector<LaneSequencePolygon> &prev, LaneSequencePolygon &back)
+{
+	int ref = ChooseReference(polygon, prev);
+	const LaneSequencePolygon *pred = ref >= 0 ? &prev[ref] : NULL;
+	int flags = 0;
+	if (pred) {
+		if (polygon.type == pred->type) flags |= SAME_TYPE;
+		if (SameValues(codec, polygon.points, pred->points)) flags |= SAME_POINTS;
+	}
+	PutVarint(out, ref + 1);
+	PutVarint(out, flags);
+
+	back.type = polygon.type;
+	if (!(flags & SAME_TYPE)) PutVarint(out, ZigZag(polygon.type));
+
+	if (flags & SAME_POINTS) {
+		back.points = pred->points;
+	}
+	else {
+		// (x, y) pairs: a point without reference is predicted from the previous point
+		int n = polygon.points.size();
+		PutVarint(out, n);
+		back.points.resize(n);
+		for (int j = 0; j < n; j++)
+			back.points[j] = codec.PutFloat(out, polygon.points[j], PredictValue(pred ? &pred->points : NULL, back.points, j, 2));
+	}
+}
+
+static bool GetPolygon(LaneSequenceInput &in, const LaneValueCodec &codec,
+	const vector<LaneSequencePolygon> &prev, LaneSequencePolygon &polygon)
+{
+	int ref = (int)in.Varint() - 1;
+	int flags = (int)in.Varint();
+	if (!in.ok || ref < -1 || ref >= (int)prev.size()) return false;
+	const LaneSequencePolygon *pred = ref >= 0 ? &prev[ref] : NULL;
+	if (!pred && (flags & (SAME_TYPE | SAME_POINTS))) return false;
+
+	polygon.type = (flags & SAME_TYPE) ? pred->type : (int32_t)UnZigZag(in.Varint());
+
+	if (flags & SAME_POINTS) {
+		polygon.points = pred->points;
+	}
+	else {
+		int n;
+		if (!in.Count(n)) return false;
+		polygon.points.resize(n);
+		for (int j = 0; j < n; j++)
+			polygon.points[j] = codec.GetFloat(in, PredictValue(pred ? &pred->points : NULL, polygon.points, j, 2));
+	}
+	return in.ok;
+}
+
+static void PutFrame(vector<unsigned char> &out, const LaneValueCodec &codec,
+	const LaneSequenceFrameData &frame, const LaneSequenceFrameData &prev, LaneSequenceFrameData &back)
+{
+	int flags = 0;
+	if (frame.tool_version == prev.tool_version) flags |= SAME_TOOL_VERSION;
+	if (frame.image_width == prev.image_width && frame.image_height == prev.image_height) flags |= SAME_IMAGE_SIZE;
+	if (frame.has_vp == prev.has_vp && codec.Round(frame.vp_y_ratio) == prev.vp_y_ratio && codec.Round(frame.vp_x_ratio) == prev.vp_x_ratio)
+		flags |= SAME_VP;
+	PutVarint(out, flags);
+
+	back.tool_version = frame.tool_version;
+	if (!(flags & SAME_TOOL_VERSION)) {
+		PutVarint(out, frame.tool_version.size());
+		PutRaw(out, frame.tool_version.data(), frame.tool_version.size());
+	}
+	back.image_width = frame.image_width;
+	back.image_height = frame.image_height;
+	if (!(flags & SAME_IMAGE_SIZE)) {
+		PutVarint(out, ZigZag(frame.image_width));
+		PutVarint(out, ZigZag(frame.image_height));
+	}
+	back.has_vp = frame.has_vp;
+	if (flags & SAME_VP) {
+		back.vp_y_ratio = prev.vp_y_ratio;
+		back.vp_x_ratio = prev.vp_x_ratio;
+	}
+	else {
+		out.push_back(frame.has_vp ? 1 : 0);
+		back.vp_y_ratio = codec.Put(out, frame.vp_y_ratio, prev.vp_y_ratio);
+		back.vp_x_ratio = codec.Put(out, frame.vp_x_ratio, prev.vp_x_ratio);
+	}
+
+	PutVarint(out, frame.lines.size());
+	back.lines.resize(frame.lines.size());
+	for (int i = 0; i < frame.lines.size(); i++)
+		PutCurve(out, codec, frame.lines[i], prev.lines, back.lines[i]);
+
+	PutVarint(out, frame.boundarys.size());
+	back.boundarys.resize(frame.boundarys.size());
+	for (int i = 0; i < frame.boundarys.size(); i++)
+		PutCurve(out, codec, frame.boundarys[i], prev.boundarys, back.boundarys[i]);
+
+	PutVarint(out, frame.polygons.size());
+	back.polygons.resize(frame.polygons.size());
+	for (int i = 0; i < frame.polygons.size(); i++)
+		PutPolygon(out, codec, frame.polygons[i], prev.polygons, back.polygons[i]);
+}
+
+static bool GetFrame(LaneSequenceInput &in, const LaneValueCodec &codec,
+	const LaneSequenceFrameData &prev, LaneSequenceFrameData &frame)
+{
+	int flags = (int)in.Varint();
+
+	if (flags & SAME_TOOL_VERSION) {
+		frame.tool_version = prev.tool_version;
+	}
+	else {
+		int n;
+		if (!in.Count(n)) return false;
+		frame.tool_version.assign((const char *)in.p, n);
+		in.p += n;
+	}
+	if (flags & SAME_IMAGE_SIZE) {
+		frame.image_width = prev.image_width;
+		frame.image_height = prev.image_height;
+	}
+	else {
+		frame.image_width = (int32_t)UnZigZag(in.Varint());
+		frame.image_height = (int32_t)UnZigZag(in.Varint());
+	}
+	if (flags & SAME_VP) {
+		frame.has_vp = prev.has_vp;
+		frame.vp_y_ratio = prev.vp_y_ratio;
+		frame.vp_x_ratio = prev.vp_x_ratio;
+	}
+	else {
+		unsigned char has_vp;
+		in.Raw(&has_vp, 1);
+		frame.has_vp = has_vp != 0;
+		frame.vp_y_ratio = codec.Get(in, prev.vp_y_ratio);
+		frame.vp_x_ratio = codec.Get(in, prev.vp_x_ratio);
+	}
+
+	int n;
+	if (!in.Count(n)) return false;
+	frame.lines.resize(n);
+	for (int i = 0; i < n; i++)
+		if (!GetCurve(in, codec, prev.lines, frame.lines[i])) return false;
+
+	if (!in.Count(n)) return false;
+	frame.boundarys.resize(n);
+	for (int i = 0; i < n; i++)
+		if (!GetCurve(in, codec, prev.boundarys, frame.boundarys[i])) return false;
+
+	if (!in.Count(n)) return false;
+	frame.polygons.resize(n);
+	for (int i = 0; i < n; i++)
+		if (!GetPolygon(in, codec, prev.polygons, frame.polygons[i])) return false;
+	return in.ok;
+}
+
+void LaneSequenceFrameData::Reset()
+{
+	tool_version.clear();
+	image_width = 0;
+	image_height = 0;
+	vp_y_ratio = 0;
+	vp_x_ratio = 0;
+	has_vp = false;
+	lines.clear();
+	boundarys.clear();
+	polygons.clear();
+}
+
+template <typename LINE>
+static void FromLine(const LINE &line, LaneSequenceCurve &curve)
+{
+	curve.x = line.spline_x_;
+	curve.y = line.spline_y_;
+	curve.r = line.line_r_;
+	curve.occlusions.resize(line.info.occlusions_top_bottom_.size() * 2);
+	for (int k = 0; k < line.info.occlusions_top_bottom_.size(); k++) {
+		curve.occlusions[k * 2] = line.info.occlusions_top_bottom_[k].first;
+		curve.occlusions[k * 2 + 1] = line.info.occlusions_top_bottom_[k].second;
+	}
+}
+
+void LaneSequenceFrameData::FromRoadLane(const RoadLaneManager &road)
+{
+	tool_version = road.tool_version();
+	image_width = road.GetImageW();
+	image_height = road.GetImageH();
+	vp_y_ratio = road.vp_y_ratio();
+	vp_x_ratio = road.vp_x_ratio();
+	has_vp = road.has_vp();
+
+	lines.resize(road.GetSizeLaneLine());
+	for (int i = 0; i < lines.size(); i++) {
+		const LaneLine &line = road.line(i);
+		int32_t type[6] = { line.info.type1, line.info.type2, line.info.type3,
+			line.info.type4, line.info.type5, line.info.type6 };
+		memcpy(lines[i].type, type, sizeof(type));
+		FromLine(line, lines[i]);
+	}
+	boundarys.resize(road.GetSizeBoundary());
+	for (int i = 0; i < boundarys.size(); i++) {
+		const BoundaryLine &line = road.boundary(i);
+		int32_t type[6] = { line.info.type3, line.info.BoundaryType, line.info.Situation, 0, 0, 0 };
+		memcpy(boundarys[i].type, type, sizeof(type));
+		FromLine(line, boundarys[i]);
+	}
+	polygons.resize(road.GetSizeRoadMarking());
+	for (int i = 0; i < polygons.size(); i++) {
+		const RoadMarkingPolygon &polygon = road.roadmarking(i);
+		polygons[i].type = polygon.GetRoadMarkerInfo().GetType();
+		polygons[i].points.resize(polygon.GetPolygonPointNum() * 2);
+		for (int j = 0; j < polygon.GetPolygonPointNum(); j++) {
+			PPOINTF point = polygon.GetPoint(j);
+			polygons[i].points[j * 2] = point.x;
+			polygons[i].points[j * 2 + 1] = point.y;
+		}
+	}
+}
+
+template <typename LINE>
+static void FillLine(const LaneSequenceCurve &curve, LINE &line)
+{
+	line.spline_x_ = curve.x;
+	line.spline_y_ = curve.y;
+	line.line_r_ = curve.r;
+	line.info.occlusions_top_bottom_.resize(curve.occlusions.size() / 2);
+	for (int k = 0; k < line.info.occlusions_top_bottom_.size(); k++)
+		line.info.occlusions_top_bottom_[k] = std::make_pair(curve.occlusions[k * 2], curve.occlusions[k * 2 + 1]);
+	line.GenerateModels();
+}
+
+void LaneSequenceFrameData::ToRoadLane(RoadLaneManager &road) const
+{
+	road.Reset(image_width, image_height);
+	road.SetToolVersion(tool_version);
+	road.SetVPYRatio(vp_y_ratio);
+	road.SetVPXRatio(vp_x_ratio);
+	road.set_has_vp(has_vp);
+
+	road.ReserveLine(lines.size());
+	road.ReserveBoundary(boundarys.size());
+	road.ReservePolygon(polygons.size());
+	for (int i = 0; i < lines.size(); i++) {
+		LaneLine &lane = road.EmplaceLine();
+		lane.info.SetFileTypes(lines[i].type);
+		FillLine(lines[i], lane);
+	}
+	for (int i = 0; i < boundarys.size(); i++) {
+		BoundaryLine &line = road.EmplaceBoundary();
+		line.info.SetFileTypes(boundarys[i].type[0], boundarys[i].type[1], boundarys[i].type[2]);
+		FillLine(boundarys[i], line);
+	}
+	for (int i = 0; i < polygons.size(); i++) {
+		int n = polygons[i].points.size() / 2;
+		vector<PPOINTF> points(n);
+		for (int j = 0; j < n; j++) points[j] = PPOINTF(polygons[i].points[j * 2], polygons[i].points[j * 2 + 1]);
+		RoadMarkingPolygon &polygon = road.EmplacePolygon();
+		polygon.SetRoadMarkType((RoadMarkerInfo::RoadMakerType)polygons[i].type);
+		polygon.SetPoints(std::move(points));
+	}
+}
+
+LaneSequenceWriter::LaneSequenceWriter(int keyframe_interval, int64_t scale, bool lossless)
+{
+	keyframe_interval_ = std::max(keyframe_interval, 1);
+	scale_ = std::max(scale, (int64_t)1);
+	lossless_ = lossless;
+}
+
+void LaneSequenceWriter::Reset()
+{
+	frames_.clear();
+	data_.clear();
+	strings_.clear();
+	prev_.Reset();
+}
+
+int LaneSequenceWriter::Append(const RoadLaneManager &road, const char *name, bool keyframe)
+{
+	LaneSequenceFrameData frame;
+	frame.FromRoadLane(road);
+
+	int frame_idx = frames_.size();
+	if (frame_idx == 0 || frame_idx - (int)frames_.back().keyframe >= keyframe_interval_)
+		keyframe = true;
+
+	LaneSequenceFrame record;
+	memset(&record, 0, sizeof(record));
+	record.offset = data_.size();
+	record.keyframe = keyframe ? frame_idx : frames_.back().keyframe;
+	record.name_offset = strings_.size();
+	string str_name = name ? name : "";
+	strings_.insert(strings_.end(), str_name.begin(), str_name.end());
+	strings_.push_back('\0');
+
+	// the next frame is predicted from what the reader will decode, not from the input
+	const LaneSequenceFrameData none;
+	LaneSequenceFrameData back;
+	PutFrame(data_, LaneValueCodec(scale_, lossless_), frame, keyframe ? none : prev_, back);
+	record.size = data_.size() - record.offset;
+	prev_ = std::move(back);
+
+	frames_.push_back(record);
+	return frame_idx;
+}
+
+bool LaneSequenceWriter::AppendXml(const char *szpath, const char *name, bool keyframe)
+{
+	RoadLaneManager road;
+	if (!road.ReadFileStream(szpath))
+		return false;
+	Append(road, name, keyframe);
+	return true;
+}
+
+void LaneSequenceWriter::SaveBuffer(vector<unsigned char> &out) const
+{
+	LaneSequenceHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, LANE_SEQUENCE_MAGIC, sizeof(header.magic));
+	header.version = LANE_SEQUENCE_VERSION;
+	header.frame_count = frames_.size();
+	header.keyframe_interval = keyframe_interval_;
+	header.flags = lossless_ ? LANE_SEQUENCE_LOSSLESS : 0;
+	header.scale = scale_;
+	header.frames_offset = sizeof(header);
+	header.data_offset = header.frames_offset + frames_.size() * sizeof(LaneSequenceFrame);
+	header.data_bytes = data_.size();
+	header.strings_offset = header.data_offset + data_.size();
+	header.string_bytes = strings_.size();
+
+	out.clear();
+	out.reserve(header.strings_offset + header.string_bytes);
+	PutRaw(out, &header, sizeof(header));
+	if (!frames_.empty()) PutRaw(out, &frames_[0], frames_.size() * sizeof(LaneSequenceFrame));
+	out.insert(out.end(), data_.begin(), data_.end());
+	out.insert(out.end(), strings_.begin(), strings_.end());
+}
+
+bool LaneSequenceWriter::Save(const char *szpath) const
+{
+	vector<unsigned char> out;
+	SaveBuffer(out);
+	FILE *fp = fopen(szpath, "wb");
+	if (fp == NULL) {
+		printf("cannot write lane sequence - \"%s\".\n", szpath);
+		return false;
+	}
+	bool succ = fwrite(&out[0], 1, out.size(), fp) == out.size();
+	succ = (fclose(fp) == 0) && succ;
+	return succ;
+}
+
+LaneSequenceReader::LaneSequenceReader()
+{
+	Close();
+}
+
+void LaneSequenceReader::Close()
+{
+	buffer_.clear();
+	memset(&header_, 0, sizeof(header_));
+	frame_count_ = 0;
+	frames_ = NULL;
+	data_ = NULL;
+	strings_ = NULL;
+	cached_idx_ = -1;
+	cached_.Reset();
+}
+
+bool LaneSequenceReader::Open(const char *szpath)
+{
+	Close();
+	FILE *fp = fopen(szpath, "rb");
+	if (fp == NULL) return false;
+	fseek(fp, 0, SEEK_END);
+	long size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	bool succ = size > 0;
+	if (succ) {
+		buffer_.resize(size);
+		succ = fread(&buffer_[0], 1, size, fp) == (size_t)size;
+	}
+	fclose(fp);
+	if (!succ || !Validate()) {
+		printf("invalid lane sequence - \"%s\".\n", szpath);
+		Close();
+		return false;
+	}
+	return true;
+}
+
+bool LaneSequenceReader::OpenBuffer(const void *data, size_t size)
+{
+	Close();
+	const unsigned char *p = (const unsigned char *)data;
+	buffer_.assign(p, p + size);
+	if (!Validate()) {
+		Close();
+		return false;
+	}
+	return true;
+}
+
+bool LaneSequenceReader::Validate()
+{
+	if (buffer_.size() < sizeof(header_)) return false;
+	memcpy(&header_, &buffer_[0], sizeof(header_));
+	if (memcmp(header_.magic, LANE_SEQUENCE_MAGIC, sizeof(header_.magic)) || header_.version != LANE_SEQUENCE_VERSION)
+		return false;
+	if (header_.scale <= 0) return false;
+	uint64_t size = buffer_.size();
+	if (header_.frames_offset > size || header_.frame_count > (size - header_.frames_offset) / sizeof(LaneSequenceFrame)
+		|| header_.data_offset > size || header_.data_bytes > size - header_.data_offset
+		|| header_.strings_offset > size || header_.string_bytes > size - header_.strings_offset)
+		return false;
+	if (header_.frames_offset % 8) return false;
+	if (header_.frame_count && (header_.string_bytes == 0 || buffer_[header_.strings_offset + header_.string_bytes - 1] != '\0'))
+		return false;
+
+	frames_ = (const LaneSequenceFrame *)&buffer_[header_.frames_offset];
+	data_ = &buffer_[0] + header_.data_offset;
+	strings_ = (const char *)&buffer_[0] + header_.strings_offset;
+	for (uint32_t i = 0; i < header_.frame_count; i++) {
+		const LaneSequenceFrame &f = frames_[i];
+		if (f.offset > header_.data_bytes || f.size > header_.data_bytes - f.offset) return false;
+		if (f.keyframe > i || frames_[f.keyframe].keyframe != f.keyframe) return false;
+		if (f.name_offset >= header_.string_bytes) return false;
+	}
+	frame_count_ = header_.frame_count;
+	return true;
+}
+
+int LaneSequenceReader::FindFrame(const char *name) const
+{
+	for (int i = 0; i < frame_count_; i++) {
+		if (!strcmp(frame_name(i), name)) return i;
+	}
+	return -1;
+}
+
+bool LaneSequenceReader::DecodeNext(int frame_idx)
+{
+	const LaneSequenceFrame &f = frames_[frame_idx];
+	LaneSequenceInput in = { data_ + f.offset, data_ + f.offset + f.size, true };
+	const LaneSequenceFrameData none;
+	LaneSequenceFrameData frame;
+	LaneValueCodec codec(header_.scale, (header_.flags & LANE_SEQUENCE_LOSSLESS) != 0);
+	if (!GetFrame(in, codec, f.keyframe == frame_idx ? none : cached_, frame)) {
+		printf("broken lane sequence frame - %d.\n", frame_idx);
+		cached_idx_ = -1;
+		return false;
+	}
+	cached_ = std::move(frame);
+	cached_idx_ = frame_idx;
+	return true;
+}
+
+bool LaneSequenceReader::Seek(int frame_idx)
+{
+	if (frame_idx < 0 || frame_idx >= frame_count_) return false;
+	if (cached_idx_ == frame_idx) return true;
+	// continue from the cached frame when it lies between the keyframe and the target
+	int first = frames_[frame_idx].keyframe;
+	if (cached_idx_ >= first && cached_idx_ < frame_idx) first = cached_idx_ + 1;
+	for (int i = first; i <= frame_idx; i++) {
+		if (!DecodeNext(i)) return false;
+	}
+	return true;
+}
+
+bool LaneSequenceReader::Decode(int frame_idx, LaneSequenceFrameData &frame)
+{
+	if (!Seek(frame_idx)) return false;
+	frame = cached_;
+	return true;
+}
+
+bool LaneSequenceReader::ToRoadLane(int frame_idx, RoadLaneManager &road)
+{
+	if (!Seek(frame_idx)) return false;
+	cached_.ToRoadLane(road);
+	return true;
+}
+
+bool ConvertLaneXmlToSequence(const vector<string> &xml_paths, const vector<string> &names,
+	const char *out_path, int keyframe_interval)
+{
+	if (xml_paths.size() != names.size()) return false;
+	LaneSequenceWriter writer(keyframe_interval);
+	for (int i = 0; i < xml_paths.size(); i++) {
+		if (!writer.AppendXml(xml_paths[i].c_str(), names[i].c_str()))
+			printf("skip lane xml - \"%s\".\n", xml_paths[i].c_str());
+	}
+	return writer.Save(out_path);
+}
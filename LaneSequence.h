@@ -0,0 +1,159 @@
+#ifndef _LANE_SEQUENCE_H_
+#define _LANE_SEQUENCE_H_
+#include "RoadLaneManager.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Delta coded container for a sequence of RoadLaneManager frames (one UDB
+// next_key / seq_len chain). Consecutive frames of a sequence differ in a
+// few control points, so every frame except the keyframes is coded against
+// the previous one:
+//   - each spline / boundary / polygon names the object of the previous frame
+//     it is predicted from (chosen by the writer), and flags whatever is
+//     unchanged (types, points, occlusions)
+//   - remaining values are coded as zigzag varint deltas against the
+//     prediction, in fixed point units of 1 / scale pixel
+//
+// Value coding is lossless by default: values that are not a multiple of
+// 1 / scale (decimals with more digits, float coordinates from the tool) fall
+// back to a float bit delta or to the raw double. With lossless off every
+// value is rounded to 1 / scale.
+//
+// File layout (little endian):
+//   LaneSequenceHeader
+//   LaneSequenceFrame  [frame_count]
+//   unsigned char      [data_bytes]     frame records
+//   char               [string_bytes]   NUL terminated frame names
+//
+// A frame is decoded from its keyframe forward, so random access costs at
+// most keyframe_interval frame decodes and sequential access one.
+
+#define LANE_SEQUENCE_MAGIC "LNSEQ001"
+#define LANE_SEQUENCE_VERSION 1
+#define LANE_SEQUENCE_LOSSLESS 0x1
+
+#pragma pack(push, 8)
+struct LaneSequenceHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t frame_count;
+	uint32_t keyframe_interval;
+	uint32_t flags;
+	int64_t scale;
+	uint64_t frames_offset;
+	uint64_t data_offset;
+	uint64_t data_bytes;
+	uint64_t strings_offset;
+	uint64_t string_bytes;
+};
+
+struct LaneSequenceFrame {
+	uint64_t offset;          // from data_offset
+	uint32_t size;
+	uint32_t keyframe;        // index of the keyframe this frame is decoded from
+	uint32_t name_offset;
+	uint32_t reserved;
+};
+#pragma pack(pop)
+
+// Frame content as coded. Curves use the LaneCorpusCurve type layout:
+// spline   : type = { type1, type2, type3, type4, type5, type6 }
+// boundary : type = { type3, BoundaryType, Situation, 0, 0, 0 }
+struct LaneSequenceCurve {
+	int32_t type[6];
+	vector<double> x, y, r;
+	vector<float> occlusions;     // (top, bottom) pairs
+};
+
+struct LaneSequencePolygon {
+	int32_t type;
+	vector<float> points;         // (x, y) pairs
+};
+
+struct LaneSequenceFrameData {
+	LaneSequenceFrameData() { Reset(); }
+	void Reset();
+	void FromRoadLane(const RoadLaneManager &road);
+	void ToRoadLane(RoadLaneManager &road) const;
+
+	string tool_version;
+	int32_t image_width, image_height;
+	double vp_y_ratio, vp_x_ratio;
+	bool has_vp;
+	vector<LaneSequenceCurve> lines;
+	vector<LaneSequenceCurve> boundarys;
+	vector<LaneSequencePolygon> polygons;
+};
+
+// Builds a sequence file. Frames must be appended in sequence order.
+class LaneSequenceWriter
+{
+public:
+	explicit LaneSequenceWriter(int keyframe_interval = 32, int64_t scale = 1000, bool lossless = true);
+
+	void Reset();
+	int GetSizeFrame() const { return frames_.size(); }
+	size_t data_bytes() const { return data_.size(); }
+
+	// appends one frame; keyframe forces a keyframe (start of a new sequence).
+	// Returns the frame index.
+	int Append(const RoadLaneManager &road, const char *name, bool keyframe = false);
+	bool AppendXml(const char *szpath, const char *name, bool keyframe = false);
+	bool Save(const char *szpath) const;
+	void SaveBuffer(vector<unsigned char> &out) const;
+
+private:
+	int keyframe_interval_;
+	int64_t scale_;
+	bool lossless_;
+	vector<LaneSequenceFrame> frames_;
+	vector<unsigned char> data_;
+	vector<char> strings_;
+	LaneSequenceFrameData prev_;   // last frame as the reader reconstructs it
+};
+
+// Reads a sequence file into memory. Keeps the last decoded frame, so it is
+// not thread safe; use one reader per thread.
+class LaneSequenceReader
+{
+public:
+	LaneSequenceReader();
+
+	bool Open(const char *szpath);
+	bool OpenBuffer(const void *data, size_t size);
+	void Close();
+
+	int GetSizeFrame() const { return frame_count_; }
+	const char *frame_name(int idx) const { return strings_ + frames_[idx].name_offset; }
+	bool is_keyframe(int idx) const { return frames_[idx].keyframe == idx; }
+	// -1 when the frame is not in the sequence
+	int FindFrame(const char *name) const;
+
+	bool Decode(int frame_idx, LaneSequenceFrameData &frame);
+	// rebuilds a RoadLaneManager; WriteFile on it reproduces the source xml
+	// when the sequence was written lossless
+	bool ToRoadLane(int frame_idx, RoadLaneManager &road);
+
+private:
+	bool Validate();
+	// leaves frame_idx in cached_
+	bool Seek(int frame_idx);
+	// decodes frame_idx on top of cached_ (its previous frame, or nothing for a keyframe)
+	bool DecodeNext(int frame_idx);
+
+	vector<unsigned char> buffer_;
+	LaneSequenceHeader header_;
+	int frame_count_;
+	const LaneSequenceFrame *frames_;
+	const unsigned char *data_;
+	const char *strings_;
+	int cached_idx_;
+	LaneSequenceFrameData cached_;
+};
+
+// Converts the lane xmls of one sequence, in order, into a sequence file.
+// Unreadable files are skipped.
+bool ConvertLaneXmlToSequence(const vector<string> &xml_paths, const vector<string> &names,
+	const char *out_path, int keyframe_interval = 32);
+#endif
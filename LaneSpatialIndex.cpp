@@ -0,0 +1,303 @@
+#include "LaneSpatialIndex.h"
+#include "RoadLaneManager.h"
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+
+void LaneIntervalIndex::Add(int id, double top, double bottom, double left, double right)
+{
+	Item item;
+	item.top = top;
+	item.bottom = bottom;
+	item.left = left;
+	item.right = right;
+	item.id = id;
+	items_.push_back(item);
+}
+
+void LaneIntervalIndex::Finish()
+{
+	std::sort(items_.begin(), items_.end(), [](const Item &a, const Item &b) {
+		return a.top < b.top || (a.top == b.top && a.id < b.id);
+	});
+	max_bottom_.resize(items_.size());
+	BuildMax(0, items_.size());
+}
+
+// node of range [lo, hi) is its middle item
+double LaneIntervalIndex::BuildMax(int lo, int hi)
+{
+	if (lo >= hi) return -DBL_MAX;
+	int mid = (lo + hi) / 2;
+	double m = items_[mid].bottom;
+	m = std::max(m, BuildMax(lo, mid));
+	m = std::max(m, BuildMax(mid + 1, hi));
+	max_bottom_[mid] = m;
+	return m;
+}
+
+void LaneIntervalIndex::Query(double y0, double y1, double x0, double x1, std::vector<int> &ids) const
+{
+	ids.clear();
+	Query(0, items_.size(), y0, y1, x0, x1, ids);
+	std::sort(ids.begin(), ids.end());
+}
+
+void LaneIntervalIndex::Query(int lo, int hi, double y0, double y1, double x0, double x1, std::vector<int> &ids) const
+{
+	if (lo >= hi) return;
+	int mid = (lo + hi) / 2;
+	if (max_bottom_[mid] < y0) return;
+	Query(lo, mid, y0, y1, x0, x1, ids);
+	// everything right of mid starts at or below items_[mid].top
+	if (items_[mid].top > y1) return;
+	const Item &item = items_[mid];
+	if (item.bottom >= y0 && item.right >= x0 && item.left <= x1)
+		ids.push_back(item.id);
+	Query(mid + 1, hi, y0, y1, x0, x1, ids);
+}
+
+void LanePolygonGrid::Clear()
+{
+	left_ = top_ = 0;
+	cell_w_ = cell_h_ = 1;
+	cols_ = rows_ = 0;
+	top_left_.clear();
+	bottom_right_.clear();
+	cell_start_.clear();
+	cell_ids_.clear();
+}
+
+// clamped in float first; query points may lie far outside the grid
+int LanePolygonGrid::CellX(float x) const
+{
+	float cx = floor((x - left_) / cell_w_);
+	return (int)std::min(std::max(cx, 0.f), (float)(cols_ - 1));
+}
+
+int LanePolygonGrid::CellY(float y) const
+{
+	float cy = floor((y - top_) / cell_h_);
+	return (int)std::min(std::max(cy, 0.f), (float)(rows_ - 1));
+}
+
+void LanePolygonGrid::Build(const std::vector<PPOINTF> &top_left, const std::vector<PPOINTF> &bottom_right)
+{
+	Clear();
+	top_left_ = top_left;
+	bottom_right_ = bottom_right;
+	int n = top_left_.size();
+
+	// an inverted box marks a polygon without points; it is never stored
+	float right = -FLT_MAX, bottom = -FLT_MAX;
+	left_ = FLT_MAX;
+	top_ = FLT_MAX;
+	for (int i = 0; i < n; i++) {
+		if (top_left_[i].x > bottom_right_[i].x) continue;
+		left_ = std::min(left_, top_left_[i].x);
+		top_ = std::min(top_, top_left_[i].y);
+		right = std::max(right, bottom_right_[i].x);
+		bottom = std::max(bottom, bottom_right_[i].y);
+	}
+	if (left_ > right) {
+		left_ = top_ = 0;
+		return;
+	}
+	// about one polygon per cell
+	int side = std::min(std::max((int)ceil(sqrt((double)n)), 1), 256);
+	cols_ = rows_ = side;
+	cell_w_ = std::max((right - left_) / cols_, 1.f);
+	cell_h_ = std::max((bottom - top_) / rows_, 1.f);
+
+	cell_start_.assign(cols_ * rows_ + 1, 0);
+	for (int pass = 0; pass < 2; pass++) {
+		std::vector<int> fill;
+		if (pass) {
+			for (int c = 0; c < cols_ * rows_; c++) cell_start_[c + 1] += cell_start_[c];
+			cell_ids_.resize(cell_start_[cols_ * rows_]);
+			fill.assign(cell_start_.begin(), cell_start_.end() - 1);
+		}
+		for (int i = 0; i < n; i++) {
+			if (top_left_[i].x > bottom_right_[i].x) continue;
+			int cx0 = CellX(top_left_[i].x), cx1 = CellX(bottom_right_[i].x);
+			int cy0 = CellY(top_left_[i].y), cy1 = CellY(bottom_right_[i].y);
+			for (int cy = cy0; cy <= cy1; cy++) {
+				for (int cx = cx0; cx <= cx1; cx++) {
+					int c = cy * cols_ + cx;
+					if (pass) cell_ids_[fill[c]++] = i;
+					else cell_start_[c + 1]++;
+				}
+			}
+		}
+	}
+}
+
+void LanePolygonGrid::Query(float x0, float y0, float x1, float y1, std::vector<int> &ids) const
+{
+	ids.clear();
+	if (cols_ == 0) return;
+	int cx0 = CellX(x0), cx1 = CellX(x1);
+	int cy0 = CellY(y0), cy1 = CellY(y1);
+	for (int cy = cy0; cy <= cy1; cy++) {
+		for (int cx = cx0; cx <= cx1; cx++) {
+			int c = cy * cols_ + cx;
+			for (int k = cell_start_[c]; k < cell_start_[c + 1]; k++) {
+				int i = cell_ids_[k];
+				if (top_left_[i].x <= x1 && bottom_right_[i].x >= x0 &&
+					top_left_[i].y <= y1 && bottom_right_[i].y >= y0)
+					ids.push_back(i);
+			}
+		}
+	}
+	// a polygon spanning several cells is found once per cell
+	std::sort(ids.begin(), ids.end());
+	ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+}
+
+// x extent of a curve, including its half width and the 1 pixel hit margin
+template <typename LINE>
+static void MeasureCurve(const LINE &line, LaneSpatialIndex::CurveBox &box)
+{
+	static thread_local std::vector<double> xs, rs;
+	int count = LaneSplineRowCount(line.top_y_, line.bottom_y_, 1);
+	xs.resize(count + 1);
+	rs.resize(count + 1);
+	line.EvaluateRows(line.top_y_, line.bottom_y_, 1, &xs[0], &rs[0]);
+	// the last row is rarely on an integer step from top_y_
+	line.EvaluateRows(line.bottom_y_, line.bottom_y_, 1, &xs[count], &rs[count]);
+	double left = DBL_MAX, right = -DBL_MAX;
+	for (int i = 0; i <= count; i++) {
+		left = std::min(left, xs[i] - fabs(rs[i]) - 1);
+		right = std::max(right, xs[i] + fabs(rs[i]) + 1);
+	}
+	box.top = line.top_y_;
+	box.bottom = line.bottom_y_;
+	box.left = left;
+	box.right = right;
+}
+
+static void MeasurePolygon(const RoadMarkingPolygon &polygon, PPOINTF &top_left, PPOINTF &bottom_right)
+{
+	if (polygon.GetPolygonPointNum() == 0) {
+		// inverted box, skipped by the grid
+		top_left = PPOINTF(FLT_MAX, FLT_MAX);
+		bottom_right = PPOINTF(-FLT_MAX, -FLT_MAX);
+		return;
+	}
+	top_left = bottom_right = polygon.GetPoint(0);
+	for (int j = 1; j < polygon.GetPolygonPointNum(); j++) {
+		PPOINTF pt = polygon.GetPoint(j);
+		top_left.x = std::min(top_left.x, pt.x);
+		top_left.y = std::min(top_left.y, pt.y);
+		bottom_right.x = std::max(bottom_right.x, pt.x);
+		bottom_right.y = std::max(bottom_right.y, pt.y);
+	}
+}
+
+static void AllIds(int count, std::vector<int> &ids)
+{
+	ids.resize(count);
+	for (int i = 0; i < count; i++)
+		ids[i] = i;
+}
+
+void LaneSpatialIndex::Build(const RoadLaneManager &road)
+{
+	static thread_local std::vector<int> lines, boundarys, polygons;
+	AllIds(road.GetSizeLaneLine(), lines);
+	AllIds(road.GetSizeBoundary(), boundarys);
+	AllIds(road.GetSizeRoadMarking(), polygons);
+	line_boxes_.resize(lines.size());
+	boundary_boxes_.resize(boundarys.size());
+	polygon_top_left_.resize(polygons.size());
+	polygon_bottom_right_.resize(polygons.size());
+	Measure(road, lines, boundarys, polygons);
+	Finish();
+}
+
+void LaneSpatialIndex::Update(const LaneSpatialIndex &old, const RoadLaneManager &road,
+	const std::vector<int> &lines, const std::vector<int> &boundarys, const std::vector<int> &polygons)
+{
+	if (old.line_boxes_.size() != road.GetSizeLaneLine() || old.boundary_boxes_.size() != road.GetSizeBoundary() ||
+		old.polygon_top_left_.size() != road.GetSizeRoadMarking()) {
+		Build(road);
+		return;
+	}
+	line_boxes_ = old.line_boxes_;
+	boundary_boxes_ = old.boundary_boxes_;
+	polygon_top_left_ = old.polygon_top_left_;
+	polygon_bottom_right_ = old.polygon_bottom_right_;
+	Measure(road, lines, boundarys, polygons);
+	Finish();
+}
+
+void LaneSpatialIndex::Measure(const RoadLaneManager &road, const std::vector<int> &lines,
+	const std::vector<int> &boundarys, const std::vector<int> &polygons)
+{
+	for (int k = 0; k < lines.size(); k++)
+		MeasureCurve(*road.line_ptr(lines[k]), line_boxes_[lines[k]]);
+	for (int k = 0; k < boundarys.size(); k++)
+		MeasureCurve(*road.boundary_ptr(boundarys[k]), boundary_boxes_[boundarys[k]]);
+	for (int k = 0; k < polygons.size(); k++)
+		MeasurePolygon(*road.roadmarking_ptr(polygons[k]), polygon_top_left_[polygons[k]], polygon_bottom_right_[polygons[k]]);
+}
+
+void LaneSpatialIndex::Finish()
+{
+	lines_.Clear();
+	for (int i = 0; i < line_boxes_.size(); i++)
+		lines_.Add(i, line_boxes_[i].top, line_boxes_[i].bottom, line_boxes_[i].left, line_boxes_[i].right);
+	lines_.Finish();
+
+	boundarys_.Clear();
+	for (int i = 0; i < boundary_boxes_.size(); i++)
+		boundarys_.Add(i, boundary_boxes_[i].top, boundary_boxes_[i].bottom, boundary_boxes_[i].left, boundary_boxes_[i].right);
+	boundarys_.Finish();
+
+	polygons_.Build(polygon_top_left_, polygon_bottom_right_);
+}
+
+int LaneSpatialIndex::FindLine(const RoadLaneManager &road, PPOINTF pt) const
+{
+	static thread_local std::vector<int> ids;
+	// the x extents are sampled a row apart; a pixel of slack covers the
+	// curve between two rows
+	lines_.Query(pt.y, pt.y, pt.x - 1, pt.x + 1, ids);
+	for (int k = 0; k < ids.size(); k++) {
+		PPOINT3F point3 = road.line_ptr(ids[k])->EstimatePoint(pt.y);
+		if (fabs(point3.x - pt.x) < (point3.r + 1))
+			return ids[k];
+	}
+	return -1;
+}
+
+int LaneSpatialIndex::FindBoundary(const RoadLaneManager &road, PPOINTF pt) const
+{
+	static thread_local std::vector<int> ids;
+	boundarys_.Query(pt.y, pt.y, pt.x - 1, pt.x + 1, ids);
+	for (int k = 0; k < ids.size(); k++) {
+		PPOINT3F point3 = road.boundary_ptr(ids[k])->EstimatePoint(pt.y);
+		if (fabs(point3.x - pt.x) < (point3.r + 1))
+			return ids[k];
+	}
+	return -1;
+}
+
+int LaneSpatialIndex::FindRoadMarking(const RoadLaneManager &road, PPOINTF pt) const
+{
+	static thread_local std::vector<int> ids;
+	polygons_.Query(pt.x, pt.y, pt.x, pt.y, ids);
+	for (int k = 0; k < ids.size(); k++) {
+		if (road.roadmarking_ptr(ids[k])->PtInPolygon(pt))
+			return ids[k];
+	}
+	return -1;
+}
+
+void LaneSpatialIndex::FindInRect(float left, float top, float right, float bottom,
+	std::vector<int> &lines, std::vector<int> &boundarys, std::vector<int> &polygons) const
+{
+	lines_.Query(top, bottom, left, right, lines);
+	boundarys_.Query(top, bottom, left, right, boundarys);
+	polygons_.Query(left, top, right, bottom, polygons);
+}
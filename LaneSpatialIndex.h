@@ -0,0 +1,103 @@
+#ifndef _LANE_SPATIAL_INDEX_H_
+#define _LANE_SPATIAL_INDEX_H_
+#include "regressor.h"
+#include <vector>
+
+class RoadLaneManager;
+
+// Interval tree over the y ranges of curves. Intervals are kept sorted by
+// top and every implicit subtree stores its largest bottom, so a stabbing or
+// range query costs O(log n + k log n).
+class LaneIntervalIndex
+{
+public:
+	void Clear() { items_.clear(); max_bottom_.clear(); }
+	void Add(int id, double top, double bottom, double left, double right);
+	// call after the last Add
+	void Finish();
+	int size() const { return items_.size(); }
+
+	// ids with [top, bottom] overlapping [y0, y1] and [left, right] overlapping [x0, x1]
+	void Query(double y0, double y1, double x0, double x1, std::vector<int> &ids) const;
+
+private:
+	struct Item {
+		double top, bottom;
+		double left, right;
+		int id;
+	};
+	double BuildMax(int lo, int hi);
+	void Query(int lo, int hi, double y0, double y1, double x0, double x1, std::vector<int> &ids) const;
+
+	std::vector<Item> items_;
+	std::vector<double> max_bottom_;
+};
+
+// Uniform grid over the bounding boxes of the road marking polygons.
+class LanePolygonGrid
+{
+public:
+	LanePolygonGrid() { Clear(); }
+	void Clear();
+	// top_left[i] / bottom_right[i] is the bounding box of polygon i
+	void Build(const std::vector<PPOINTF> &top_left, const std::vector<PPOINTF> &bottom_right);
+
+	// polygons whose box contains the point / overlaps the rectangle, ascending
+	void Query(float x0, float y0, float x1, float y1, std::vector<int> &ids) const;
+
+private:
+	int CellX(float x) const;
+	int CellY(float y) const;
+
+	float left_, top_, cell_w_, cell_h_;
+	int cols_, rows_;
+	std::vector<PPOINTF> top_left_, bottom_right_;
+	std::vector<int> cell_start_;   // CSR: cell i owns cell_ids_[cell_start_[i], cell_start_[i + 1])
+	std::vector<int> cell_ids_;
+};
+
+// Hit testing index over a RoadLaneManager. Built from the manager and
+// answered against it, so the manager must not change in between; the
+// manager rebuilds it lazily after its mutators, and only measures again
+// the objects written through its *_ptr accessors.
+class LaneSpatialIndex
+{
+public:
+	// y range and x extent of a curve, half width and hit margin included
+	struct CurveBox {
+		double top, bottom, left, right;
+	};
+
+	void Build(const RoadLaneManager &road);
+	// Build when only the listed objects changed since old was built and none
+	// was added, removed or reordered. The boxes of the others are copied
+	// from old, so an edit costs a sort of the boxes instead of evaluating
+	// every curve again.
+	void Update(const LaneSpatialIndex &old, const RoadLaneManager &road,
+		const std::vector<int> &lines, const std::vector<int> &boundarys, const std::vector<int> &polygons);
+
+	// lowest index under the image point, -1 when none. Curves hit when
+	// |x(y) - pt.x| < r(y) + 1, the rule MousePointOnSpline used.
+	int FindLine(const RoadLaneManager &road, PPOINTF pt) const;
+	int FindBoundary(const RoadLaneManager &road, PPOINTF pt) const;
+	int FindRoadMarking(const RoadLaneManager &road, PPOINTF pt) const;
+
+	// objects whose bounding box overlaps the rectangle, ascending
+	void FindInRect(float left, float top, float right, float bottom,
+		std::vector<int> &lines, std::vector<int> &boundarys, std::vector<int> &polygons) const;
+
+private:
+	void Measure(const RoadLaneManager &road, const std::vector<int> &lines,
+		const std::vector<int> &boundarys, const std::vector<int> &polygons);
+	void Finish();
+
+	std::vector<CurveBox> line_boxes_;
+	std::vector<CurveBox> boundary_boxes_;
+	std::vector<PPOINTF> polygon_top_left_;
+	std::vector<PPOINTF> polygon_bottom_right_;
+
+	LaneIntervalIndex lines_;
+	LaneIntervalIndex boundarys_;
+	LanePolygonGrid polygons_;
+};
+#endif
@@ -0,0 +1,186 @@
+#ifndef _LANE_SPLINE_H_
+#define _LANE_SPLINE_H_
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LANE_SPLINE_SSE2
+#endif
+
+// Cubic / linear spline with the same interface and arithmetic as
+// svld::tk::spline (natural boundary, band LU solve, linear extrapolation),
+// but with the coefficients kept accessible so rows can be evaluated in
+// batches instead of one binary search per call.
+//   f(x) = ((a[i] * h + b[i]) * h + c[i]) * h + y[i],  h = x - x[i]
+class LaneSpline
+{
+public:
+	LaneSpline() { m_b0 = 0; m_c0 = 0; }
+
+	void set_points(const std::vector<double> &x, const std::vector<double> &y, bool cubic_spline = true) {
+		int n = x.size();
+		m_x = x;
+		m_y = y;
+		m_a.assign(n, 0.0);
+		m_b.assign(n, 0.0);
+		m_c.assign(n, 0.0);
+		if (n < 2) {
+			m_b0 = 0; m_c0 = 0;
+			return;
+		}
+		if (cubic_spline) {
+			// tridiagonal system, solved with the same operation order as
+			// tk::band_matrix::lu_solve so the models match bit for bit
+			// scratch is kept per thread; interactive refits call this on every edit
+			static thread_local std::vector<double> lower, diag, upper, saved, rhs;
+			lower.assign(n, 0.0); diag.assign(n, 0.0); upper.assign(n, 0.0);
+			saved.assign(n, 0.0); rhs.assign(n, 0.0);
+			for (int i = 1; i < n - 1; i++) {
+				lower[i] = 1.0 / 3.0 * (x[i] - x[i - 1]);
+				diag[i] = 2.0 / 3.0 * (x[i + 1] - x[i - 1]);
+				upper[i] = 1.0 / 3.0 * (x[i + 1] - x[i]);
+				rhs[i] = (y[i + 1] - y[i]) / (x[i + 1] - x[i]) - (y[i] - y[i - 1]) / (x[i] - x[i - 1]);
+			}
+			diag[0] = 2.0; upper[0] = 0.0; rhs[0] = 0;
+			diag[n - 1] = 2.0; lower[n - 1] = 0.0; rhs[n - 1] = 0;
+
+			for (int i = 0; i < n; i++) {
+				saved[i] = 1.0 / diag[i];
+				if (i > 0) lower[i] *= saved[i];
+				if (i < n - 1) upper[i] *= saved[i];
+				diag[i] = 1.0;
+			}
+			for (int k = 0; k < n - 1; k++) {
+				double f = -lower[k + 1] / diag[k];
+				lower[k + 1] = -f;
+				diag[k + 1] = diag[k + 1] + f * upper[k];
+			}
+			std::vector<double> &b = m_b;
+			for (int i = 0; i < n; i++)
+				b[i] = rhs[i] * saved[i] - (i > 0 ? lower[i] * b[i - 1] : 0.0);
+			for (int i = n - 1; i >= 0; i--)
+				b[i] = (b[i] - (i < n - 1 ? upper[i] * b[i + 1] : 0.0)) / diag[i];
+
+			for (int i = 0; i < n - 1; i++) {
+				m_a[i] = 1.0 / 3.0 * (m_b[i + 1] - m_b[i]) / (x[i + 1] - x[i]);
+				m_c[i] = (y[i + 1] - y[i]) / (x[i + 1] - x[i]) - 1.0 / 3.0 * (2.0 * m_b[i] + m_b[i + 1]) * (x[i + 1] - x[i]);
+			}
+		}
+		else {
+			for (int i = 0; i < n - 1; i++)
+				m_c[i] = (m_y[i + 1] - m_y[i]) / (m_x[i + 1] - m_x[i]);
+		}
+		m_b0 = m_b[0];
+		m_c0 = m_c[0];
+		double h = x[n - 1] - x[n - 2];
+		m_a[n - 1] = 0.0;
+		m_c[n - 1] = 3.0 * m_a[n - 2] * h * h + 2.0 * m_b[n - 2] * h + m_c[n - 2];
+	}
+
+	double operator() (double x) const {
+		int n = m_x.size();
+		if (n == 0) return 0;
+		int idx = std::max(int(std::lower_bound(m_x.begin(), m_x.end(), x) - m_x.begin()) - 1, 0);
+		return Evaluate(x, idx);
+	}
+
+	int size() const { return m_x.size(); }
+	const std::vector<double> &knots() const { return m_x; }
+
+	// segment used by operator() for x, starting the search at idx
+	// (idx must not be past that segment); lets callers walk rows monotonically
+	int Segment(double x, int idx) const {
+		int n = m_x.size();
+		while (idx + 1 < n && m_x[idx + 1] < x) idx++;
+		return idx;
+	}
+
+	double Evaluate(double x, int idx) const {
+		int n = m_x.size();
+		double h = x - m_x[idx];
+		if (x < m_x[0]) return (m_b0 * h + m_c0) * h + m_y[0];
+		if (x > m_x[n - 1]) return (m_b[n - 1] * h + m_c[n - 1]) * h + m_y[n - 1];
+		return ((m_a[idx] * h + m_b[idx]) * h + m_c[idx]) * h + m_y[idx];
+	}
+
+	// out[i] = f(x0 + i * step)
+	void EvaluateRows(double x0, double step, int count, double *out) const {
+		if (count <= 0) return;
+		if (m_x.empty()) {
+			std::fill(out, out + count, 0.0);
+			return;
+		}
+		int idx = std::max(int(std::lower_bound(m_x.begin(), m_x.end(), x0) - m_x.begin()) - 1, 0);
+		for (int i = 0; i < count; i++) {
+			double x = x0 + i * step;
+			idx = step > 0 ? Segment(x, idx) : std::max(int(std::lower_bound(m_x.begin(), m_x.end(), x) - m_x.begin()) - 1, 0);
+			out[i] = Evaluate(x, idx);
+		}
+	}
+
+	friend void EvaluateSplinePair(const LaneSpline &s0, const LaneSpline &s1,
+		double x0, double step, int count, double *out0, double *out1);
+
+private:
+	std::vector<double> m_x, m_y, m_a, m_b, m_c;
+	double m_b0, m_c0;
+};
+
+// Number of rows y0, y0 + step, ... not past y1.
+inline int LaneSplineRowCount(double y0, double y1, double step)
+{
+	if (step <= 0 || y1 < y0) return 0;
+	return (int)floor((y1 - y0) / step) + 1;
+}
+
+// Evaluates two splines built on the same knots (x/y and r/y of a lane)
+// at x0 + i * step. One segment walk serves both, and with SSE2 both cubic
+// polynomials are evaluated in one register. The operations are the same
+// as LaneSpline::operator(), so results are identical to the scalar path.
+inline void EvaluateSplinePair(const LaneSpline &s0, const LaneSpline &s1,
+	double x0, double step, int count, double *out0, double *out1)
+{
+	if (count <= 0) return;
+	if (s0.m_x.empty() || step <= 0 || s0.m_x != s1.m_x) {
+		s0.EvaluateRows(x0, step, count, out0);
+		s1.EvaluateRows(x0, step, count, out1);
+		return;
+	}
+	const std::vector<double> &kx = s0.m_x;
+	int n = kx.size();
+	int idx = std::max(int(std::lower_bound(kx.begin(), kx.end(), x0) - kx.begin()) - 1, 0);
+	for (int i = 0; i < count; i++) {
+		double x = x0 + i * step;
+		idx = s0.Segment(x, idx);
+		double h = x - kx[idx];
+		// extrapolation is the same polynomial with a = 0
+		int k = idx;
+		double a0, a1, b0, b1, c0, c1;
+		if (x < kx[0]) {
+			k = 0;
+			a0 = 0; a1 = 0;
+			b0 = s0.m_b0; b1 = s1.m_b0;
+			c0 = s0.m_c0; c1 = s1.m_c0;
+		}
+		else {
+			if (x > kx[n - 1]) k = n - 1;
+			a0 = s0.m_a[k]; a1 = s1.m_a[k];
+			b0 = s0.m_b[k]; b1 = s1.m_b[k];
+			c0 = s0.m_c[k]; c1 = s1.m_c[k];
+		}
+#ifdef LANE_SPLINE_SSE2
+		__m128d vh = _mm_set1_pd(h);
+		__m128d v = _mm_set_pd(a1, a0);
+		v = _mm_add_pd(_mm_mul_pd(v, vh), _mm_set_pd(b1, b0));
+		v = _mm_add_pd(_mm_mul_pd(v, vh), _mm_set_pd(c1, c0));
+		v = _mm_add_pd(_mm_mul_pd(v, vh), _mm_set_pd(s1.m_y[k], s0.m_y[k]));
+		_mm_storel_pd(out0 + i, v);
+		_mm_storeh_pd(out1 + i, v);
+#else
+		out0[i] = ((a0 * h + b0) * h + c0) * h + s0.m_y[k];
+		out1[i] = ((a1 * h + b1) * h + c1) * h + s1.m_y[k];
+#endif
+	}
+}
+#endif
@@ -0,0 +1,159 @@
+#ifndef _LANE_TYPE_MAP_H_
+#define _LANE_TYPE_MAP_H_
+#include "RoadLaneManager.h"
+
+// Compile time tables for the type labels of the lane mask and TypeData xml
+// (typePos / typeShape / typeSD / typeColor / typeBicycle).
+//
+// Every table is generated by running a constexpr copy of the original
+// if / else chain over a few bins per field. A chain only compares a field
+// against a handful of values, so all other values share one bin whose
+// representative matches none of them; a lookup therefore equals the chain
+// for every int, and the chains themselves stay here as the reference.
+// test/LaneTypeMapTest.cpp checks every lookup over the whole bit-field
+// domain against the chains as they were in the view.
+
+// lane typePos: type4 x side (char of type3) x id (type3 >> 8)
+//   0 opposite left, 1 branch, 2..5 left 3..0, 6..9 right 0..3,
+//   10 merged, 11 opposite right, 12 uncertain
+constexpr int LaneTypePosChain(int type4, int side, int id)
+{
+	if (type4 == LaneInfo::OPPOSITE_SIDE && side == LaneInfo::LEFT) return 0;
+	if (type4 == LaneInfo::BRANCH) return 1;
+	if (type4 == LaneInfo::C4_NONE && side == LaneInfo::LEFT && id == 3) return 2;
+	if (type4 == LaneInfo::C4_NONE && side == LaneInfo::LEFT && id == 2) return 3;
+	if (type4 == LaneInfo::C4_NONE && side == LaneInfo::LEFT && id == 1) return 4;
+	if (type4 == LaneInfo::C4_NONE && side == LaneInfo::LEFT && id == 0) return 5;
+	if (type4 == LaneInfo::C4_NONE && side == LaneInfo::RIGHT && id == 0) return 6;
+	if (type4 == LaneInfo::C4_NONE && side == LaneInfo::RIGHT && id == 1) return 7;
+	if (type4 == LaneInfo::C4_NONE && side == LaneInfo::RIGHT && id == 2) return 8;
+	if (type4 == LaneInfo::C4_NONE && side == LaneInfo::RIGHT && id == 3) return 9;
+	if (type4 == LaneInfo::MERGED) return 10;
+	if (type4 == LaneInfo::OPPOSITE_SIDE && side == LaneInfo::RIGHT) return 11;
+	return 12; //uncertain
+}
+
+// boundary typePos: side x id x max_level (number of ids used on a side - 1)
+constexpr int BoundaryTypePosChain(int side, int id, int max_level)
+{
+	const int L = BoundaryInfo::LEFT, R = BoundaryInfo::RIGHT;
+	if (max_level == 0) {
+		if (side == L && id == 0) return 0;
+		if (side == R && id == 0) return 1;
+		return 2;
+	}
+	if (max_level == 1) {
+		if (side == L && id == 1) return 0;
+		if (side == L && id == 0) return 1;
+		if (side == R && id == 0) return 2;
+		if (side == R && id == 1) return 3;
+		return 4;
+	}
+	if (max_level == 2) {
+		if (side == L && id == 2) return 0;
+		if (side == L && id == 1) return 1;
+		if (side == L && id == 0) return 2;
+		if (side == R && id == 0) return 3;
+		if (side == R && id == 1) return 4;
+		if (side == R && id == 2) return 5;
+		return 6;
+	}
+	if (side == L && id > 2) return 0;
+	if (side == L && id == 2) return 1;
+	if (side == L && id == 1) return 2;
+	if (side == L && id == 0) return 3;
+	if (side == R && id == 0) return 4;
+	if (side == R && id == 1) return 5;
+	if (side == R && id == 2) return 6;
+	if (side == R && id > 2) return 7;
+	return 8;
+}
+
+// boundary typeShape: 0 walls, 1 parked vehicles, 2 guardrail, 3 curbs,
+// 4 lane separators, 5 plastic wall / drum / beacons / cone, 6 road edge, 7 etc
+constexpr int BoundaryTypeShapeChain(int boundary_type)
+{
+	if (boundary_type == BoundaryInfo::WALLS) return 0;
+	if (boundary_type == BoundaryInfo::STATIONARY_VEHICLES) return 1;
+	if (boundary_type == BoundaryInfo::GUARDRAIL) return 2;
+	if (boundary_type == BoundaryInfo::CURBS) return 3;
+	if (boundary_type == BoundaryInfo::STATIC_LANE_SEPARATOR ||
+		boundary_type == BoundaryInfo::LANE_SEPARATOR) return 4;
+	if (boundary_type == BoundaryInfo::PLASTIC_WALL ||
+		boundary_type == BoundaryInfo::DRUM ||
+		boundary_type == BoundaryInfo::BEACONS ||
+		boundary_type == BoundaryInfo::CONE) return 5;
+	if (boundary_type == BoundaryInfo::ROAD_EDGE) return 6;
+	return 7;
+}
+
+// bins: values the chains compare against keep their own bin, the rest
+// share the last one (represented by a value no chain compares against)
+constexpr int LaneType4Bin(int type4) { return (type4 >= 0 && type4 <= LaneInfo::OPPOSITE_SIDE) ? type4 : 5; }
+constexpr int LaneSideBin(int side) { return (side >= 0 && side <= LaneInfo::RIGHT) ? side : 3; }
+constexpr int LaneIdBin(int id) { return (id >= 0 && id <= 3) ? id : 4; }
+constexpr int BoundaryIdBin(int id) { return id < 0 ? 4 : (id > 2 ? 3 : id); }
+constexpr int BoundaryIdOfBin(int bin) { return bin == 4 ? -1 : bin; }
+constexpr int BoundaryLevelBin(int max_level) { return (max_level >= 0 && max_level <= 2) ? max_level : 3; }
+constexpr int BoundaryTypeBin(int boundary_type) { return (boundary_type >= 0 && boundary_type <= BoundaryInfo::BOUNDARY_ETCS) ? boundary_type : 16; }
+
+struct LaneTypeTables {
+	signed char lane_pos[6][4][5];
+	signed char boundary_pos[4][5][4];
+	signed char boundary_shape[17];
+
+	constexpr LaneTypeTables() : lane_pos(), boundary_pos(), boundary_shape() {
+		for (int t4 = 0; t4 < 6; t4++)
+			for (int side = 0; side < 4; side++)
+				for (int id = 0; id < 5; id++)
+					lane_pos[t4][side][id] = LaneTypePosChain(t4, side, id);
+		for (int side = 0; side < 4; side++)
+			for (int id = 0; id < 5; id++)
+				for (int level = 0; level < 4; level++)
+					boundary_pos[side][id][level] = BoundaryTypePosChain(side, BoundaryIdOfBin(id), level);
+		for (int type = 0; type < 17; type++)
+			boundary_shape[type] = BoundaryTypeShapeChain(type);
+	}
+};
+
+static constexpr LaneTypeTables kLaneTypeTables;
+
+inline int LaneTypePos(const LaneInfo &info)
+{
+	return kLaneTypeTables.lane_pos[LaneType4Bin(info.GetType4())][LaneSideBin(info.GetType3())][LaneIdBin(info.GetType3_ID())];
+}
+
+inline int BoundaryTypePos(const BoundaryInfo &info, int max_level)
+{
+	return kLaneTypeTables.boundary_pos[LaneSideBin(info.GetType3())][BoundaryIdBin(info.GetType3_ID())][BoundaryLevelBin(max_level)];
+}
+
+inline int BoundaryTypeShape(const BoundaryInfo &info)
+{
+	return kLaneTypeTables.boundary_shape[BoundaryTypeBin(info.GetBoundaryType())];
+}
+
+// the remaining lane labels are the category minus one (-1 for none)
+inline int LaneTypeShape(const LaneInfo &info) { return info.GetType1() - 1; }
+inline int LaneTypeSD(const LaneInfo &info) { return info.GetType2() - 1; }
+inline int LaneTypeColor(const LaneInfo &info) { return info.GetType5() - 1; }
+inline int LaneTypeBicycle(const LaneInfo &info) { return info.GetType6() - 1; }
+
+static_assert(kLaneTypeTables.lane_pos[LaneInfo::C4_NONE][LaneInfo::LEFT][0] == 5, "ego left");
+static_assert(kLaneTypeTables.lane_pos[LaneInfo::C4_NONE][LaneInfo::RIGHT][0] == 6, "ego right");
+static_assert(kLaneTypeTables.lane_pos[LaneInfo::OPPOSITE_SIDE][LaneInfo::RIGHT][4] == 11, "opposite right");
+static_assert(kLaneTypeTables.lane_pos[5][LaneInfo::LEFT][0] == 12, "unknown type4");
+static_assert(kLaneTypeTables.boundary_pos[BoundaryInfo::LEFT][BoundaryIdBin(7)][3] == 0, "far left");
+static_assert(kLaneTypeTables.boundary_pos[BoundaryInfo::RIGHT][BoundaryIdBin(-1)][3] == 8, "negative id");
+static_assert(kLaneTypeTables.boundary_shape[BoundaryInfo::CONE] == 5, "cone");
+static_assert(kLaneTypeTables.boundary_shape[16] == 7, "unknown boundary");
+
+// every value of the 8 bit BoundaryType field
+constexpr bool BoundaryTypeShapeTableMatches()
+{
+	for (int type = -128; type <= 127; type++)
+		if (kLaneTypeTables.boundary_shape[BoundaryTypeBin(type)] != BoundaryTypeShapeChain(type)) return false;
+	return true;
+}
+static_assert(BoundaryTypeShapeTableMatches(), "boundary typeShape table");
+#endif
@@ -0,0 +1,58 @@
+#include "stdafx.h"
+#include "RoadLaneJournal.h"
+
+RoadLaneJournal::RoadLaneJournal(int max_entries)
+{
+	max_entries_ = std::max(max_entries, 2);
+	current_ = -1;
+}
+
+void RoadLaneJournal::Clear()
+{
+	entries_.clear();
+	current_ = -1;
+}
+
+void RoadLaneJournal::Record(const RoadLaneManager &road, const char *what)
+{
+	entries_.erase(entries_.begin() + (current_ + 1), entries_.end());
+	Entry entry;
+	entry.road = road;
+	entry.what = what ? what : "";
+	entries_.push_back(std::move(entry));
+	if ((int)entries_.size() > max_entries_)
+		entries_.pop_front();
+	current_ = entries_.size() - 1;
+}
+
+bool RoadLaneJournal::Undo(RoadLaneManager &road)
+{
+	if (!CanUndo()) return false;
+	current_--;
+	road = entries_[current_].road;
+	return true;
+}
+
+bool RoadLaneJournal::Redo(RoadLaneManager &road)
+{
+	if (!CanRedo()) return false;
+	current_++;
+	road = entries_[current_].road;
+	return true;
+}
+
+const char *RoadLaneJournal::undo_label() const
+{
+	return CanUndo() ? entries_[current_].what.c_str() : "";
+}
+
+const char *RoadLaneJournal::redo_label() const
+{
+	return CanRedo() ? entries_[current_ + 1].what.c_str() : "";
+}
+
+const RoadLaneManager &RoadLaneJournal::current() const
+{
+	static const RoadLaneManager empty;
+	return current_ >= 0 ? entries_[current_].road : empty;
+}
@@ -0,0 +1,40 @@
+#ifndef _ROAD_LANE_JOURNAL_H_
+#define _ROAD_LANE_JOURNAL_H_
+#include "RoadLaneManager.h"
+#include <deque>
+
+// Undo / redo history of a RoadLaneManager. Every entry is a copy on write
+// snapshot, so recording is O(1) and an entry only owns the objects edited
+// after it was taken.
+class RoadLaneJournal
+{
+public:
+	explicit RoadLaneJournal(int max_entries = 100);
+
+	void Clear();
+	// call after loading and after every edit; drops the redo entries
+	void Record(const RoadLaneManager &road, const char *what);
+
+	bool CanUndo() const { return current_ > 0; }
+	bool CanRedo() const { return current_ + 1 < (int)entries_.size(); }
+	// restore the previous / next recorded state into road, false when there is none
+	bool Undo(RoadLaneManager &road);
+	bool Redo(RoadLaneManager &road);
+	// label of the edit Undo / Redo would revert / reapply
+	const char *undo_label() const;
+	const char *redo_label() const;
+
+	// last recorded state; take it on the editing thread, read it on any
+	const RoadLaneManager &current() const;
+	int size() const { return entries_.size(); }
+
+private:
+	struct Entry {
+		RoadLaneManager road;
+		string what;
+	};
+	std::deque<Entry> entries_;
+	int current_;
+	int max_entries_;
+};
+#endif
@@ -1,5 +1,8 @@
-#include "stdafx.h"
 #include "RoadLaneManager.h"
+#include "RoadLaneXmlStream.h"
+#include "tinyxml2.h"
+
+using namespace tinyxml2;
 
 #define DEFUALT_VP_Y 0.5
 #define DEFUALT_VP_X 0.5
@@ -12,6 +15,7 @@ RoadLaneManager::RoadLaneManager()
 	vp_y_ratio_ = DEFUALT_VP_Y;
 	vp_x_ratio_ = DEFUALT_VP_X;
 	has_vp_ = false;
+	index_dirty_ = true;
 }
 RoadLaneManager::RoadLaneManager(const char *szpath)
 {
@@ -20,6 +24,7 @@ RoadLaneManager::RoadLaneManager(const char *szpath)
 	vp_y_ratio_ = DEFUALT_VP_Y;
 	vp_x_ratio_ = DEFUALT_VP_X;
 	has_vp_ = false;
+	index_dirty_ = true;
 	ReadFile(szpath);
 }
 RoadLaneManager::~RoadLaneManager()
@@ -29,6 +34,7 @@ RoadLaneManager::~RoadLaneManager()
 
 bool RoadLaneManager::ReadFile(const char *szpath)
 {
+	index_dirty_ = true;
 	tinyxml2::XMLDocument xmlDoc;
 	// 
 	XMLError eResult = xmlDoc.LoadFile(szpath);
@@ -62,33 +68,37 @@ bool RoadLaneManager::ReadFile(const char *szpath)
 	eResult = pElement->QueryIntAttribute("splineNum", &Spline_num);
 
 	XMLElement * pSplineElement = pElement->FirstChildElement("Spline");
+	bool types_in_range = true;
 	lines_.resize(Spline_num);
 	for (int i = 0; i < Spline_num; i++) {
 		if (pSplineElement == nullptr) 
 			return XML_ERROR_PARSING_ELEMENT;
 		
+		LaneLine &line = lines_.mutable_at(i);
 		int point_num;
-		eResult = pSplineElement->QueryIntAttribute("type1", &lines_[i].info.type1);
-		eResult = pSplineElement->QueryIntAttribute("type2", &lines_[i].info.type2);
-		eResult = pSplineElement->QueryIntAttribute("type3", &lines_[i].info.type3);
-		eResult = pSplineElement->QueryIntAttribute("type4", &lines_[i].info.type4);
-		eResult = pSplineElement->QueryIntAttribute("type5", &lines_[i].info.type5);
-		eResult = pSplineElement->QueryIntAttribute("type6", &lines_[i].info.type6);
+		int type[6] = { 0 };   // info types are bit-fields
+		eResult = pSplineElement->QueryIntAttribute("type1", &type[0]);
+		eResult = pSplineElement->QueryIntAttribute("type2", &type[1]);
+		eResult = pSplineElement->QueryIntAttribute("type3", &type[2]);
+		eResult = pSplineElement->QueryIntAttribute("type4", &type[3]);
+		eResult = pSplineElement->QueryIntAttribute("type5", &type[4]);
+		eResult = pSplineElement->QueryIntAttribute("type6", &type[5]);
+		types_in_range &= line.info.SetFileTypes(type);
 		eResult = pSplineElement->QueryIntAttribute("pointNum", &point_num);
 		eResult = pSplineElement->QueryIntAttribute("occNum", &Spline_count);
 
 		XMLElement * pPointElement = pSplineElement->FirstChildElement("Point");
-		lines_[i].spline_x_.resize(point_num);
-		lines_[i].spline_y_.resize(point_num);
-		lines_[i].line_r_.resize(point_num);
+		line.spline_x_.resize(point_num);
+		line.spline_y_.resize(point_num);
+		line.line_r_.resize(point_num);
 		for (int j = 0; j < point_num; j++) {	
-			eResult = pPointElement->QueryDoubleAttribute("x", &lines_[i].spline_x_[j]);
-			eResult = pPointElement->QueryDoubleAttribute("y", &lines_[i].spline_y_[j]);
-			eResult = pPointElement->QueryDoubleAttribute("r", &lines_[i].line_r_[j]);	
+			eResult = pPointElement->QueryDoubleAttribute("x", &line.spline_x_[j]);
+			eResult = pPointElement->QueryDoubleAttribute("y", &line.spline_y_[j]);
+			eResult = pPointElement->QueryDoubleAttribute("r", &line.line_r_[j]);	
 			pPointElement = pPointElement->NextSiblingElement("Point");
 		}
 				
-		lines_[i].info.occlusions_top_bottom_.resize(Spline_count);
+		line.info.occlusions_top_bottom_.resize(Spline_count);
 		XMLElement * pOccElement = pSplineElement->FirstChildElement("Occlusion");   // 
 		for(int k = 0; k < Spline_count; k++){
 			float top_y, bottom_y;
@@ -96,11 +106,11 @@ bool RoadLaneManager::ReadFile(const char *szpath)
 			eResult = pOccElement->QueryFloatAttribute("top", &top_y);
 			eResult = pOccElement->QueryFloatAttribute("bottom", &bottom_y);
 			
-			lines_[i].info.occlusions_top_bottom_[k] = std::make_pair(top_y, bottom_y);
+			line.info.occlusions_top_bottom_[k] = std::make_pair(top_y, bottom_y);
 			pOccElement = pOccElement->NextSiblingElement("Occlusion");
 		}
 
-		lines_[i].GenerateModels();
+		line.GenerateModels();
 		pSplineElement = pSplineElement->NextSiblingElement("Spline");
 	}
 
@@ -114,6 +124,7 @@ bool RoadLaneManager::ReadFile(const char *szpath)
 	for (int i = 0; i < polygon_num; i++) {
 		if (pPolygonElement == nullptr)
 			return XML_ERROR_PARSING_ELEMENT;
+		RoadMarkingPolygon &polygon = polygons_.mutable_at(i);
 		int point_num;
 		eResult = pPolygonElement->QueryIntAttribute("pointNum", &point_num);
 		XMLElement * pPointElement = pPolygonElement->FirstChildElement("Point");		
@@ -129,25 +140,25 @@ bool RoadLaneManager::ReadFile(const char *szpath)
 		switch (road_marker_type)
 		{
 		case 0:
-			polygons_[i].SetRoadMarkType(RoadMarkerInfo::ROAD_MARKER_TYPE_HARD_NEGATIVE);
+			polygon.SetRoadMarkType(RoadMarkerInfo::ROAD_MARKER_TYPE_HARD_NEGATIVE);
 			break;
 		case 1:
-			polygons_[i].SetRoadMarkType(RoadMarkerInfo::ROAD_MARKER_TYPE_STOP_LINE);
+			polygon.SetRoadMarkType(RoadMarkerInfo::ROAD_MARKER_TYPE_STOP_LINE);
 			break;
 		case 2:
-			polygons_[i].SetRoadMarkType(RoadMarkerInfo::ROAD_MARKER_TYPE_CROSSWALK);
+			polygon.SetRoadMarkType(RoadMarkerInfo::ROAD_MARKER_TYPE_CROSSWALK);
 			break;
 		case 3:
-			polygons_[i].SetRoadMarkType(RoadMarkerInfo::ROAD_MARKER_TYPE_ARROW);
+			polygon.SetRoadMarkType(RoadMarkerInfo::ROAD_MARKER_TYPE_ARROW);
 			break;
 		case 4:
-			polygons_[i].SetRoadMarkType(RoadMarkerInfo::ROAD_MARKER_TYPE_SPEED_BUMP);
+			polygon.SetRoadMarkType(RoadMarkerInfo::ROAD_MARKER_TYPE_SPEED_BUMP);
 			break;
 		default:
-			polygons_[i].SetRoadMarkType(RoadMarkerInfo::ROAD_MARKER_TYPE_HARD_NEGATIVE);
+			polygon.SetRoadMarkType(RoadMarkerInfo::ROAD_MARKER_TYPE_HARD_NEGATIVE);
 			break;
 		}
-		polygons_[i].SetPoints(points);
+		polygon.SetPoints(points);
 		pPolygonElement = pPolygonElement->NextSiblingElement("Polygon");
 	}
 
@@ -163,30 +174,32 @@ bool RoadLaneManager::ReadFile(const char *szpath)
 		if (pBoundaryElement == nullptr)
 			return XML_ERROR_PARSING_ELEMENT;
 
+		BoundaryLine &boundary = boundarys_.mutable_at(i);
 		int point_num;
-		int type3, boundary_id;
+		int type3, boundary_id, boundary_type = 0;
 		int boundary_unknown_id = 8;
 		BoundaryInfo::CATEGORY3 position = BoundaryInfo::CATEGORY3::C3_NONE;
 		double sum_x = 0.F, average_x = 0.F;
 
 		eResult = pBoundaryElement->QueryIntAttribute("type3", &type3);
-		eResult = pBoundaryElement->QueryIntAttribute("boundary", &boundarys_[i].info.BoundaryType);
+		eResult = pBoundaryElement->QueryIntAttribute("boundary", &boundary_type);
+		types_in_range &= boundary.info.SetFileBoundaryType(boundary_type);
 		eResult = pBoundaryElement->QueryIntAttribute("pointNum", &point_num);
 		eResult = pBoundaryElement->QueryIntAttribute("occNum", &boundary_count);
 
 		XMLElement * pPointElement = pBoundaryElement->FirstChildElement("Point");
-		boundarys_[i].spline_x_.resize(point_num);
-		boundarys_[i].spline_y_.resize(point_num);
-		boundarys_[i].line_r_.resize(point_num);
+		boundary.spline_x_.resize(point_num);
+		boundary.spline_y_.resize(point_num);
+		boundary.line_r_.resize(point_num);
 		for (int j = 0; j < point_num; j++) {
-			eResult = pPointElement->QueryDoubleAttribute("x", &boundarys_[i].spline_x_[j]);
-			eResult = pPointElement->QueryDoubleAttribute("y", &boundarys_[i].spline_y_[j]);
-			eResult = pPointElement->QueryDoubleAttribute("r", &boundarys_[i].line_r_[j]);
-			boundarys_[i].line_r_[j] = DEFUALT_BOUNDARY_W;
+			eResult = pPointElement->QueryDoubleAttribute("x", &boundary.spline_x_[j]);
+			eResult = pPointElement->QueryDoubleAttribute("y", &boundary.spline_y_[j]);
+			eResult = pPointElement->QueryDoubleAttribute("r", &boundary.line_r_[j]);
+			boundary.line_r_[j] = DEFUALT_BOUNDARY_W;
 			pPointElement = pPointElement->NextSiblingElement("Point");
 		}
 
-		boundarys_[i].info.occlusions_top_bottom_.resize(boundary_count);
+		boundary.info.occlusions_top_bottom_.resize(boundary_count);
 		XMLElement * pOccElement = pBoundaryElement->FirstChildElement("Occlusion");   // 
 		for (int k = 0; k < boundary_count; k++) {
 			float top_y, bottom_y;
@@ -194,7 +207,7 @@ bool RoadLaneManager::ReadFile(const char *szpath)
 			eResult = pOccElement->QueryFloatAttribute("top", &top_y);
 			eResult = pOccElement->QueryFloatAttribute("bottom", &bottom_y);
 
-			boundarys_[i].info.occlusions_top_bottom_[k] = std::make_pair(top_y, bottom_y);
+			boundary.info.occlusions_top_bottom_[k] = std::make_pair(top_y, bottom_y);
 			pOccElement = pOccElement->NextSiblingElement("Occlusion");
 		}
 
@@ -204,11 +217,11 @@ bool RoadLaneManager::ReadFile(const char *szpath)
 		{
 		case BoundaryInfo::CATEGORY3::LEFT:
 		case BoundaryInfo::CATEGORY3::RIGHT:
-			boundarys_[i].info.SetType3(position, boundary_id);
+			types_in_range &= boundary.info.SetFileType3(position, boundary_id);
 			break;
 		default:
-			sum_x += boundarys_[i].spline_x_[0];
-			sum_x += boundarys_[i].spline_x_[point_num - 1];
+			sum_x += boundary.spline_x_[0];
+			sum_x += boundary.spline_x_[point_num - 1];
 
 			average_x = sum_x / 2;
 
@@ -217,12 +230,240 @@ bool RoadLaneManager::ReadFile(const char *szpath)
 			else 
 				position = BoundaryInfo::CATEGORY3::RIGHT;
 
-			boundarys_[i].info.SetType3(position, boundary_unknown_id);
+			boundary.info.SetType3(position, boundary_unknown_id);
 			break;
 		}
-		boundarys_[i].GenerateModels();
+		boundary.GenerateModels();
 		pBoundaryElement = pBoundaryElement->NextSiblingElement("Boundary");
 	}
+	if (!types_in_range)
+		printf("Ÿ   ʰ,  - \"%s\".\n", szpath);
+	return true;
+}
+
+// Count attribute of a list, capped by the elements the unparsed bytes can
+// still hold (each takes at least the self closing tag), so a corrupt count
+// cannot make reserve throw bad_alloc.
+static size_t ReserveCount(const LaneXmlPullParser &parser, int count, size_t min_element_size)
+{
+	if (count <= 0)
+		return 0;
+	return std::min((size_t)count, parser.remaining() / min_element_size);
+}
+
+// Point / Occlusion children of a Spline or Boundary element.
+// Reads at most point_num points and occ_num occlusions like ReadFile does.
+static bool ReadStreamCurve(LaneXmlPullParser &parser, int point_num, int occ_num,
+	vector<double> &x, vector<double> &y, vector<double> &r, vector<std::pair<float, float>> &occlusions)
+{
+	x.clear(); y.clear(); r.clear();
+	occlusions.clear();
+	size_t point_reserve = ReserveCount(parser, point_num, sizeof("<Point/>") - 1);
+	x.reserve(point_reserve); y.reserve(point_reserve); r.reserve(point_reserve);
+	occlusions.reserve(ReserveCount(parser, occ_num, sizeof("<Occlusion/>") - 1));
+
+	for (;;) {
+		LaneXmlPullParser::Token token = parser.Next();
+		if (token == LaneXmlPullParser::TOKEN_END)
+			return true;
+		if (token != LaneXmlPullParser::TOKEN_START)
+			return false;
+
+		if (parser.IsElement("Point") && (int)x.size() < point_num) {
+			double px = 0, py = 0, pr = 0;
+			parser.QueryDoubleAttribute("x", &px);
+			parser.QueryDoubleAttribute("y", &py);
+			parser.QueryDoubleAttribute("r", &pr);
+			x.push_back(px); y.push_back(py); r.push_back(pr);
+		}
+		else if (parser.IsElement("Occlusion") && (int)occlusions.size() < occ_num) {
+			float top_y = 0, bottom_y = 0;
+			parser.QueryFloatAttribute("top", &top_y);
+			parser.QueryFloatAttribute("bottom", &bottom_y);
+			occlusions.push_back(std::make_pair(top_y, bottom_y));
+		}
+		if (!parser.SkipElement())
+			return false;
+	}
+}
+
+bool RoadLaneManager::ReadFileStream(const char *szpath)
+{
+	// the file buffer is reused across calls on the same thread
+	static thread_local vector<char> buffer;
+
+	if (!ReadLaneFileToBuffer(szpath, buffer)) {
+		printf(" ε   - \"%s\".\n", szpath);
+		return false;
+	}
+	return ReadBufferStream(&buffer[0], buffer.size() - 1, szpath);
+}
+
+bool RoadLaneManager::ReadBufferStream(const char *data, size_t size, const char *szpath)
+{
+	// polygon scratch is reused across calls on the same thread
+	static thread_local vector<PPOINTF> points;
+
+	LaneXmlPullParser parser(data, data + size);
+	LaneXmlPullParser::Token token = parser.Next();
+	if (token != LaneXmlPullParser::TOKEN_START) {
+		printf(" ε   - \"%s\".\n", szpath);
+		return false;
+	}
+	parser.QueryIntAttribute("imageWidth", &image_width_);
+	parser.QueryIntAttribute("imageHeight", &image_height_);
+
+	lines_.clear();
+	polygons_.clear();
+	boundarys_.clear();
+	index_dirty_ = true;
+	bool types_in_range = true;
+
+	for (;;) {
+		token = parser.Next();
+		if (token == LaneXmlPullParser::TOKEN_END)
+			break;
+		if (token != LaneXmlPullParser::TOKEN_START)
+			return false;
+
+		if (parser.IsElement("VP")) {
+			parser.QueryBoolAttribute("hasVP", &has_vp_);
+			parser.QueryDoubleAttribute("y_ratio", &vp_y_ratio_);
+			parser.QueryDoubleAttribute("x_ratio", &vp_x_ratio_);
+			if (!parser.SkipElement())
+				return false;
+		}
+		else if (parser.IsElement("Splines")) {
+			int spline_num = 0;
+			parser.QueryIntAttribute("splineNum", &spline_num);
+			lines_.reserve(ReserveCount(parser, spline_num, sizeof("<Spline/>") - 1));
+			while ((token = parser.Next()) == LaneXmlPullParser::TOKEN_START) {
+				if (!parser.IsElement("Spline") || (int)lines_.size() >= spline_num) {
+					if (!parser.SkipElement())
+						return false;
+					continue;
+				}
+				LaneLine &line = lines_.emplace_back();
+				int point_num = 0, occ_num = 0;
+				int type[6] = { 0 };
+				parser.QueryIntAttribute("type1", &type[0]);
+				parser.QueryIntAttribute("type2", &type[1]);
+				parser.QueryIntAttribute("type3", &type[2]);
+				parser.QueryIntAttribute("type4", &type[3]);
+				parser.QueryIntAttribute("type5", &type[4]);
+				parser.QueryIntAttribute("type6", &type[5]);
+				types_in_range &= line.info.SetFileTypes(type);
+				parser.QueryIntAttribute("pointNum", &point_num);
+				parser.QueryIntAttribute("occNum", &occ_num);
+				if (!ReadStreamCurve(parser, point_num, occ_num,
+					line.spline_x_, line.spline_y_, line.line_r_, line.info.occlusions_top_bottom_))
+					return false;
+				line.GenerateModels();
+			}
+			if (token != LaneXmlPullParser::TOKEN_END)
+				return false;
+		}
+		else if (parser.IsElement("Polygons")) {
+			int polygon_num = 0;
+			parser.QueryIntAttribute("polygonNum", &polygon_num);
+			polygons_.reserve(ReserveCount(parser, polygon_num, sizeof("<Polygon/>") - 1));
+			while ((token = parser.Next()) == LaneXmlPullParser::TOKEN_START) {
+				if (!parser.IsElement("Polygon") || (int)polygons_.size() >= polygon_num) {
+					if (!parser.SkipElement())
+						return false;
+					continue;
+				}
+				int point_num = 0, road_marker_type = 0;
+				parser.QueryIntAttribute("pointNum", &point_num);
+				parser.QueryIntAttribute("type", &road_marker_type);
+				points.clear();
+				while ((token = parser.Next()) == LaneXmlPullParser::TOKEN_START) {
+					if (parser.IsElement("Point") && (int)points.size() < point_num) {
+						PPOINTF point;
+						point.x = 0; point.y = 0;
+						parser.QueryFloatAttribute("x", &point.x);
+						parser.QueryFloatAttribute("y", &point.y);
+						points.push_back(point);
+					}
+					if (!parser.SkipElement())
+						return false;
+				}
+				if (token != LaneXmlPullParser::TOKEN_END)
+					return false;
+
+				RoadMarkingPolygon &polygon = polygons_.emplace_back();
+				switch (road_marker_type)
+				{
+				case 1:
+					polygon.SetRoadMarkType(RoadMarkerInfo::ROAD_MARKER_TYPE_STOP_LINE);
+					break;
+				case 2:
+					polygon.SetRoadMarkType(RoadMarkerInfo::ROAD_MARKER_TYPE_CROSSWALK);
+					break;
+				case 3:
+					polygon.SetRoadMarkType(RoadMarkerInfo::ROAD_MARKER_TYPE_ARROW);
+					break;
+				case 4:
+					polygon.SetRoadMarkType(RoadMarkerInfo::ROAD_MARKER_TYPE_SPEED_BUMP);
+					break;
+				default:
+					polygon.SetRoadMarkType(RoadMarkerInfo::ROAD_MARKER_TYPE_HARD_NEGATIVE);
+					break;
+				}
+				polygon.SetPoints(points);
+			}
+			if (token != LaneXmlPullParser::TOKEN_END)
+				return false;
+		}
+		else if (parser.IsElement("Boundarys")) {
+			int boundary_num = 0;
+			parser.QueryIntAttribute("boundaryNum", &boundary_num);
+			boundarys_.reserve(ReserveCount(parser, boundary_num, sizeof("<Boundary/>") - 1));
+			while ((token = parser.Next()) == LaneXmlPullParser::TOKEN_START) {
+				if (!parser.IsElement("Boundary") || (int)boundarys_.size() >= boundary_num) {
+					if (!parser.SkipElement())
+						return false;
+					continue;
+				}
+				BoundaryLine &boundary = boundarys_.emplace_back();
+				int point_num = 0, occ_num = 0, type3 = 0, boundary_type = 0;
+				parser.QueryIntAttribute("type3", &type3);
+				parser.QueryIntAttribute("boundary", &boundary_type);
+				types_in_range &= boundary.info.SetFileBoundaryType(boundary_type);
+				parser.QueryIntAttribute("pointNum", &point_num);
+				parser.QueryIntAttribute("occNum", &occ_num);
+				if (!ReadStreamCurve(parser, point_num, occ_num,
+					boundary.spline_x_, boundary.spline_y_, boundary.line_r_, boundary.info.occlusions_top_bottom_))
+					return false;
+				std::fill(boundary.line_r_.begin(), boundary.line_r_.end(), (double)DEFUALT_BOUNDARY_W);
+
+				// same side inference as ReadFile when the side is missing
+				BoundaryInfo::CATEGORY3 position = static_cast<BoundaryInfo::CATEGORY3>(type3 % (1 << 8));
+				if (position == BoundaryInfo::CATEGORY3::LEFT || position == BoundaryInfo::CATEGORY3::RIGHT) {
+					types_in_range &= boundary.info.SetFileType3(position, type3 >> 8);
+				}
+				else {
+					int boundary_unknown_id = 8;
+					double average_x = 0;
+					if (!boundary.spline_x_.empty())
+						average_x = (boundary.spline_x_.front() + boundary.spline_x_.back()) / 2;
+					if (average_x < image_width_ / 2)
+						position = BoundaryInfo::CATEGORY3::LEFT;
+					else
+						position = BoundaryInfo::CATEGORY3::RIGHT;
+					boundary.info.SetType3(position, boundary_unknown_id);
+				}
+				boundary.GenerateModels();
+			}
+			if (token != LaneXmlPullParser::TOKEN_END)
+				return false;
+		}
+		else if (!parser.SkipElement()) {
+			return false;
+		}
+	}
+	if (!types_in_range)
+		printf("Ÿ   ʰ,  - \"%s\".\n", szpath);
 	return true;
 }
 
@@ -337,6 +578,101 @@ bool RoadLaneManager::WriteFile(const char *szpath)
 	}
 	return true;
 }
+
+bool RoadLaneManager::WriteFileStream(const char *szpath)
+{
+	// reused across calls on the same thread, so batch rewrites do not reallocate
+	static thread_local LaneXmlWriter writer;
+	writer.Clear();
+
+	writer.OpenElement("RoadLane");
+	writer.PushAttribute("toolVersion", str_tool_version_.c_str());
+	writer.PushAttribute("imageWidth", image_width_);
+	writer.PushAttribute("imageHeight", image_height_);
+
+	writer.OpenElement("VP");
+	writer.PushAttribute("hasVP", has_vp_);
+	writer.PushAttribute("y_ratio", vp_y_ratio_);
+	writer.PushAttribute("x_ratio", vp_x_ratio_);
+	writer.CloseElement();
+
+	writer.OpenElement("Splines");
+	writer.PushAttribute("splineNum", (int)lines_.size());
+	for (int i = 0; i < lines_.size(); i++) {
+		const LaneLine &line = lines_[i];
+		writer.OpenElement("Spline");
+		writer.PushAttribute("type1", line.info.type1);
+		writer.PushAttribute("type2", line.info.type2);
+		writer.PushAttribute("type3", line.info.type3);
+		writer.PushAttribute("type4", line.info.type4);
+		writer.PushAttribute("type5", line.info.type5);
+		writer.PushAttribute("type6", line.info.type6);
+		writer.PushAttribute("pointNum", (int)line.spline_x_.size());
+		writer.PushAttribute("occNum", (int)line.info.occlusions_top_bottom_.size());
+		for (int j = 0; j < line.spline_x_.size(); j++) {
+			writer.OpenElement("Point");
+			writer.PushAttribute("x", line.spline_x_[j]);
+			writer.PushAttribute("y", line.spline_y_[j]);
+			writer.PushAttribute("r", line.line_r_[j]);
+			writer.CloseElement();
+		}
+		for (int k = 0; k < line.info.occlusions_top_bottom_.size(); k++) {
+			writer.OpenElement("Occlusion");
+			writer.PushAttribute("top", line.info.occlusions_top_bottom_[k].first);
+			writer.PushAttribute("bottom", line.info.occlusions_top_bottom_[k].second);
+			writer.CloseElement();
+		}
+		writer.CloseElement();
+	}
+	writer.CloseElement();
+
+	writer.OpenElement("Polygons");
+	writer.PushAttribute("polygonNum", (int)polygons_.size());
+	for (int i = 0; i < polygons_.size(); i++) {
+		const RoadMarkingPolygon &polygon = polygons_[i];
+		writer.OpenElement("Polygon");
+		writer.PushAttribute("pointNum", polygon.GetPolygonPointNum());
+		writer.PushAttribute("type", polygon.GetRoadMarkerInfo().GetType());
+		for (int j = 0; j < polygon.GetPolygonPointNum(); j++) {
+			PPOINTF point = polygon.GetPoint(j);
+			writer.OpenElement("Point");
+			writer.PushAttribute("x", point.x);
+			writer.PushAttribute("y", point.y);
+			writer.CloseElement();
+		}
+		writer.CloseElement();
+	}
+	writer.CloseElement();
+
+	writer.OpenElement("Boundarys");
+	writer.PushAttribute("boundaryNum", (int)boundarys_.size());
+	for (int i = 0; i < boundarys_.size(); i++) {
+		const BoundaryLine &boundary = boundarys_[i];
+		writer.OpenElement("Boundary");
+		writer.PushAttribute("type3", boundary.info.type3);
+		writer.PushAttribute("boundary", boundary.info.BoundaryType);
+		writer.PushAttribute("pointNum", (int)boundary.spline_x_.size());
+		writer.PushAttribute("occNum", (int)boundary.info.occlusions_top_bottom_.size());
+		for (int j = 0; j < boundary.spline_x_.size(); j++) {
+			writer.OpenElement("Point");
+			writer.PushAttribute("x", boundary.spline_x_[j]);
+			writer.PushAttribute("y", boundary.spline_y_[j]);
+			writer.PushAttribute("r", DEFUALT_BOUNDARY_W);
+			writer.CloseElement();
+		}
+		for (int k = 0; k < boundary.info.occlusions_top_bottom_.size(); k++) {
+			writer.OpenElement("Occlusion");
+			writer.PushAttribute("top", boundary.info.occlusions_top_bottom_[k].first);
+			writer.PushAttribute("bottom", boundary.info.occlusions_top_bottom_[k].second);
+			writer.CloseElement();
+		}
+		writer.CloseElement();
+	}
+	writer.CloseElement();
+
+	writer.CloseElement();
+	return writer.SaveFile(szpath);
+}
 void RoadLaneManager::Reset(int image_width, int image_height)
 {	
 	image_width_ = image_width;
@@ -346,52 +682,110 @@ void RoadLaneManager::Reset(int image_width, int image_height)
 	boundarys_.clear();
 	vp_y_ratio_ = DEFUALT_VP_Y;
 	has_vp_ = false;
+	index_dirty_ = true;
 }
 void RoadLaneManager::AddLine(const LaneLine &line)
 {
 	lines_.push_back(line);
+	index_dirty_ = true;
+}
+void RoadLaneManager::AddLine(LaneLine &&line)
+{
+	lines_.push_back(std::move(line));
+	index_dirty_ = true;
+}
+LaneLine &RoadLaneManager::EmplaceLine()
+{
+	index_dirty_ = true;
+	return lines_.emplace_back();
 }
 void RoadLaneManager::ResetLine(const LaneLine &line, int idx)
 {
 	if(idx >= 0 && idx < lines_.size())
-		lines_[idx] = line;
+		lines_.set(idx, line);
+	index_dirty_ = true;
+}
+void RoadLaneManager::ResetLine(LaneLine &&line, int idx)
+{
+	if(idx >= 0 && idx < lines_.size())
+		lines_.set(idx, std::move(line));
+	index_dirty_ = true;
 }
 void RoadLaneManager::RemoveLine(int idx)
 {
 	if(idx >= 0 && idx < lines_.size()){
-		lines_.erase(lines_.begin() + idx);
+		lines_.erase(idx);
 	}
+	index_dirty_ = true;
 }
 void RoadLaneManager::AddBoundary(const BoundaryLine &line)
 {
 	boundarys_.push_back(line);
+	index_dirty_ = true;
+}
+void RoadLaneManager::AddBoundary(BoundaryLine &&line)
+{
+	boundarys_.push_back(std::move(line));
+	index_dirty_ = true;
+}
+BoundaryLine &RoadLaneManager::EmplaceBoundary()
+{
+	index_dirty_ = true;
+	return boundarys_.emplace_back();
 }
 void RoadLaneManager::ResetBoundary(const BoundaryLine &line, int idx)
 {
 	if (idx >= 0 && idx < boundarys_.size())
-		boundarys_[idx] = line;
+		boundarys_.set(idx, line);
+	index_dirty_ = true;
+}
+void RoadLaneManager::ResetBoundary(BoundaryLine &&line, int idx)
+{
+	if (idx >= 0 && idx < boundarys_.size())
+		boundarys_.set(idx, std::move(line));
+	index_dirty_ = true;
 }
 void RoadLaneManager::RemoveBoundary(int idx)
 {
 	if (idx >= 0 && idx < boundarys_.size()) {
-		boundarys_.erase(boundarys_.begin() + idx);
+		boundarys_.erase(idx);
 	}
+	index_dirty_ = true;
 }
 
 void RoadLaneManager::AddPolygon(const RoadMarkingPolygon &polygon)
 {
 	polygons_.push_back(polygon);
+	index_dirty_ = true;
+}
+void RoadLaneManager::AddPolygon(RoadMarkingPolygon &&polygon)
+{
+	polygons_.push_back(std::move(polygon));
+	index_dirty_ = true;
+}
+RoadMarkingPolygon &RoadLaneManager::EmplacePolygon()
+{
+	index_dirty_ = true;
+	return polygons_.emplace_back();
 }
 void RoadLaneManager::ResetPoygon(const RoadMarkingPolygon &polygon, int idx)
 {
 	if (idx >= 0 && idx < polygons_.size())
-		polygons_[idx] = polygon;
+		polygons_.set(idx, polygon);
+	index_dirty_ = true;
+}
+void RoadLaneManager::ResetPoygon(RoadMarkingPolygon &&polygon, int idx)
+{
+	if (idx >= 0 && idx < polygons_.size())
+		polygons_.set(idx, std::move(polygon));
+	index_dirty_ = true;
 }
 void RoadLaneManager::RemovePoygon(int idx)
 {
 	if (idx >= 0 && idx < polygons_.size()) {
-		polygons_.erase(polygons_.begin() + idx);
+		polygons_.erase(idx);
 	}
+	index_dirty_ = true;
 }
 
 void RoadLaneManager::SetVPYRatio(double vp_y_ratio)
@@ -405,12 +799,55 @@ void RoadLaneManager::SetVPXRatio(double vp_x_ratio)
 	vp_x_ratio_ = vp_x_ratio;
 }
 
-bool SortLane(LaneLine &p1, LaneLine &p2){
+bool SortLane(const LaneLine &p1, const LaneLine &p2){
 	return (p1.bottom_y_ - p1.top_y_) < (p2.bottom_y_ - p2.top_y_);
 }
 
 void RoadLaneManager::SortingLength(){
-	std::sort(lines_.begin(), lines_.end(), SortLane);
+	lines_.sort(SortLane);
+	index_dirty_ = true;
+}
+
+void RoadLaneManager::UpdateIndex()
+{
+	bool edited = !edited_lines_.empty() || !edited_boundarys_.empty() || !edited_polygons_.empty();
+	if (!index_dirty_ && !edited && spatial_index_) return;
+	// built aside and swapped in; copies holding the old index keep it
+	std::shared_ptr<LaneSpatialIndex> index = std::make_shared<LaneSpatialIndex>();
+	if (index_dirty_ || !spatial_index_)
+		index->Build(*this);
+	else
+		index->Update(*spatial_index_, *this, edited_lines_, edited_boundarys_, edited_polygons_);
+	spatial_index_ = index;
+	index_dirty_ = false;
+	edited_lines_.clear();
+	edited_boundarys_.clear();
+	edited_polygons_.clear();
+}
+
+int RoadLaneManager::FindLineAt(PPOINTF image_pt)
+{
+	UpdateIndex();
+	return spatial_index_->FindLine(*this, image_pt);
+}
+
+int RoadLaneManager::FindBoundaryAt(PPOINTF image_pt)
+{
+	UpdateIndex();
+	return spatial_index_->FindBoundary(*this, image_pt);
+}
+
+int RoadLaneManager::FindRoadMarkingAt(PPOINTF image_pt)
+{
+	UpdateIndex();
+	return spatial_index_->FindRoadMarking(*this, image_pt);
+}
+
+void RoadLaneManager::FindInRect(float left, float top, float right, float bottom,
+	vector<int> &lines, vector<int> &boundarys, vector<int> &polygons)
+{
+	UpdateIndex();
+	spatial_index_->FindInRect(left, top, right, bottom, lines, boundarys, polygons);
 }
 
 void RoadLaneManager::SetImageSize(int width, int height)
@@ -1,7 +1,18 @@
 #ifndef _ROAD_LANE_V3_H_
 #define _ROAD_LANE_V3_H_
 #include "regressor.h"
+#include "LaneSpline.h"
+#include "LaneSpatialIndex.h"
+#include "LanePolygonEdgeTable.h"
+#include "LaneCowVector.h"
+#include "LaneOcclusion.h"
 #include <vector>
+#include <memory>
+#ifndef _MSC_VER
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#endif
 //#include "tinyxml2.h"      //// ߰ ////
 
 using namespace std;
@@ -9,10 +20,56 @@ using namespace std;
 
 //version 3.0
 
+#ifndef _MSC_VER
+// Array forms of the MSVC CRT sprintf_s / strcat_s used by the type strings,
+// for building the headless library (LaneMaskRasterizer.h) elsewhere.
+template <size_t N>
+inline int sprintf_s(char (&buffer)[N], const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	int len = vsnprintf(buffer, N, format, args);
+	va_end(args);
+	return len;
+}
+
+template <size_t N>
+inline int strcat_s(char (&buffer)[N], const char *source)
+{
+	size_t len = strlen(buffer);
+	snprintf(buffer + len, N - len, "%s", source);
+	return 0;
+}
+#endif
+
+// Label text of a type value; fallback for values outside the table.
+template <int N>
+inline const char *LaneInfoLabel(const char *(&table)[N], int type, const char *fallback = "")
+{
+	return (type >= 0 && type < N) ? table[type] : fallback;
+}
+
+// Value read from a file for a signed bit-field of the given width. Out of
+// range values are clamped and flagged, so they stay outside every type
+// instead of wrapping onto a valid one (257 in an 8 bit field reads back as
+// SOLID, 200 as -56).
+inline int LaneTypeFieldValue(int value, int bits, bool &clamped)
+{
+	int max_value = (1 << (bits - 1)) - 1, min_value = -max_value - 1;
+	if (value < min_value || value > max_value) {
+		clamped = true;
+		return value < min_value ? min_value : max_value;
+	}
+	return value;
+}
+
+// The type fields are bit-fields: every value the tool writes fits and they
+// are still read and assigned as plain ints (type3 keeps side + (id << 8)).
+// Values from files go through the SetFile* functions, which clamp them.
+// GetInfoText formats into one buffer per thread instead of one per object;
+// the text is valid until the next GetInfoText call on the same thread.
 class LaneInfo
 {
-private:
-	char string_buffer[256];
 public:
 	
 	typedef enum{
@@ -35,16 +92,18 @@ public:
 	}CATEGORY6;
 	//////////////////////// ߰ ////////////////////////
 
-	int type1 = 0; // Solid, Dashed, Bot_dot
-	int type2 = 0; // Single, Double line	
-	int type3 = 0; // Left, Right, Uncertain
-	int type4 = 0; // Branch, Merged, Unable, Opposite_side
-	int type5 = 0; // WHITE, YELLOW, ORANGE, BLUE, ETC 
-	int type6 = 0; // BICYCLE 
+	int type1 : 8; // Solid, Dashed, Bot_dot
+	int type2 : 8; // Single, Double line	
+	int type3 : 16; // Left, Right, Uncertain
+	int type4 : 8; // Branch, Merged, Unable, Opposite_side
+	int type5 : 8; // WHITE, YELLOW, ORANGE, BLUE, ETC 
+	int type6 : 8; // BICYCLE 
 	//////////////////////// ߰ ////////////////////////
 
 	std::vector<std::pair<float, float>> occlusions_top_bottom_;
 
+	LaneInfo() { Reset(); }
+
 	void Reset(){
 		type1 = 0;// Solid, Dashed, Bot_dot
 		type2 = 0; //Single, Double line	
@@ -56,14 +115,14 @@ public:
 		occlusions_top_bottom_.clear();
 	}
 
-	bool isEmpty() { return type1 == 0 && type2 == 0 && type3 == 0; }
-	int GetType1() { return type1; }
-	int GetType2() { return type2; }
-	int GetType3() { return char(type3); }
-	int GetType3_ID() { return type3>>8; }
-	int GetType4() { return type4; }
-	int GetType5() { return char(type5); }
-	int GetType6() { return char(type6); }
+	bool isEmpty() const { return type1 == 0 && type2 == 0 && type3 == 0; }
+	int GetType1() const { return type1; }
+	int GetType2() const { return type2; }
+	int GetType3() const { return char(type3); }
+	int GetType3_ID() const { return type3>>8; }
+	int GetType4() const { return type4; }
+	int GetType5() const { return char(type5); }
+	int GetType6() const { return char(type6); }
 	//////////////////////// ߰ ////////////////////////
 
 	void SetType1(CATEGORY1 type) { type1 = type; }
@@ -73,49 +132,36 @@ public:
 	void SetType5(CATEGORY5 type) { type5 = type; }
 	void SetType6(CATEGORY6 type) { type6 = type; }
 	//////////////////////// ߰ ////////////////////////
+	// type1..type6 of a file; false when one was clamped to its field
+	bool SetFileTypes(const int (&type)[6]) {
+		bool clamped = false;
+		type1 = LaneTypeFieldValue(type[0], 8, clamped);
+		type2 = LaneTypeFieldValue(type[1], 8, clamped);
+		type3 = LaneTypeFieldValue(type[2], 16, clamped);
+		type4 = LaneTypeFieldValue(type[3], 8, clamped);
+		type5 = LaneTypeFieldValue(type[4], 8, clamped);
+		type6 = LaneTypeFieldValue(type[5], 8, clamped);
+		return !clamped;
+	}
+
+	const char *GetInfoText() const {
+		static const char *type1_text[] = { "", "_", "_", "Ĺ_" };
+		static const char *type2_text[] = { "", "_", "_", "_" };
+		static const char *type4_text[] = { "", "_", "_", "_", "_" };
+		static const char *type5_text[] = { "_NoColor", "_", "_", "_", "_Ÿ" };
+		static const char *type6_text[] = { "", "_" };
+		static thread_local char string_buffer[256];
 
-	const char *GetInfoText() {
 		if (isEmpty()) {
 			sprintf_s(string_buffer, "NONE");
 			return string_buffer;
 		}
 
-		int type1 = GetType1();
-		switch (type1)
-		{
-		case SOLID:
-			sprintf_s(string_buffer, "_");
-			break;
-		case DASHED:
-			sprintf_s(string_buffer, "_");
-			break;
-		case CATS_EYE:
-			sprintf_s(string_buffer, "Ĺ_");
-			break;
-		default:
-			sprintf_s(string_buffer, "");
-			break;
-		}
-		int type2 = GetType2();
-		switch (type2)
-		{
-		case SINGLE:
-			strcat_s(string_buffer, "_");
-			break;
-		case DOUBLE:
-			strcat_s(string_buffer, "_");
-			break;
-		case ACCESSORIE:
-			strcat_s(string_buffer, "_");
-			break;
-		default:
-			strcat_s(string_buffer, "");
-			break;
-		}
+		sprintf_s(string_buffer, "%s", LaneInfoLabel(type1_text, GetType1()));
+		strcat_s(string_buffer, LaneInfoLabel(type2_text, GetType2()));
 
 		char tmp[256];
-		int type3 = GetType3();
-		switch (type3)
+		switch (GetType3())
 		{
 		case C3_NONE:
 			strcat_s(string_buffer, "");
@@ -135,58 +181,10 @@ public:
 			break;
 		}
 
-		switch (GetType4())
-		{
-		case C4_NONE:
-			strcat_s(string_buffer, "");
-			break;
-		case MERGED:
-			strcat_s(string_buffer, "_");
-			break;
-		case BRANCH:
-			strcat_s(string_buffer, "_");
-			break;
-		case UNABLE:
-			strcat_s(string_buffer, "_");
-			break;
-		case OPPOSITE_SIDE:
-			strcat_s(string_buffer, "_");
-			break;
-		}
+		strcat_s(string_buffer, LaneInfoLabel(type4_text, GetType4()));
 		//////////////////////// ߰ ////////////////////////
-		int type5 = GetType5();
-		switch (type5)
-		{
-		case C5_NONE:
-			strcat_s(string_buffer, "_NoColor");
-			break;
-		case WHITE:
-			strcat_s(string_buffer, "_");
-			break;
-		case YELLOW:
-			strcat_s(string_buffer, "_");
-			break;
-		case BLUE:
-			strcat_s(string_buffer, "_");
-			break;
-		case ETC:
-			strcat_s(string_buffer, "_Ÿ");
-			break;
-		default:
-			break;
-		}
-
-		int type6 = GetType6();
-		switch (type6)
-		{
-		case C6_NONE:
-			break;
-		case BICYCLE:
-			strcat_s(string_buffer, "_");
-			break;
-		default:
-			break;
-		}
+		strcat_s(string_buffer, LaneInfoLabel(type5_text, GetType5()));
+		strcat_s(string_buffer, LaneInfoLabel(type6_text, GetType6()));
 		//////////////////////////////////////////////////////
 
 		return string_buffer;
@@ -195,8 +193,6 @@ public:
 
 class BoundaryInfo
 {
-private:
-	char string_buffer[256];
 public:
 
 	typedef enum {
@@ -207,11 +203,13 @@ public:
 		PLASTIC_WALL, DRUM, BEACONS, CONE, ROAD_EDGE, INNER_PARKINGSPACE, UNEXEPLAINABLE, BOUNDARY_STRUCTURE_ETCS, BOUNDARY_ETCS
 	}BOUNDARY;
 
-	int type3 = 0; // Left, Right, Uncertain
-	int BoundaryType = 0; // WALLS, STATIONARY_VEHICLES, GUARDRAIL, CURBS, LANE_SEPARATOR, BEACONS, ROAD_EDGE, BOUNDARY_ETCS
-	int Situation = 0;
+	int type3 : 16; // Left, Right, Uncertain
+	int BoundaryType : 8; // WALLS, STATIONARY_VEHICLES, GUARDRAIL, CURBS, LANE_SEPARATOR, BEACONS, ROAD_EDGE, BOUNDARY_ETCS
+	int Situation : 8;
 	std::vector<std::pair<float, float>> occlusions_top_bottom_;
 
+	BoundaryInfo() { Reset(); }
+
 	void Reset() {
 		type3 = 0; //Left, Right, Uncertain
 		BoundaryType = 0;
@@ -219,25 +217,46 @@ public:
 		occlusions_top_bottom_.clear();
 	}
 
-	bool isEmpty() { return type3 == 0 && BoundaryType == 0; }
-	int GetType3() { return char(type3); }
-	int GetType3_ID() { return type3 >> 8; }
-	int GetBoundaryType() { return BoundaryType; }
+	bool isEmpty() const { return type3 == 0 && BoundaryType == 0; }
+	int GetType3() const { return char(type3); }
+	int GetType3_ID() const { return type3 >> 8; }
+	int GetBoundaryType() const { return BoundaryType; }
 
 	void SetType3(CATEGORY3 type, int id = 0) { type3 = char(type) + (id << 8); }
 	void SetBoundaryType(BOUNDARY type) { BoundaryType = type; }
+	// values of a file; false when one was clamped to its field (the id to
+	// the 8 bits above the side)
+	bool SetFileType3(CATEGORY3 type, int id) {
+		bool clamped = false;
+		SetType3(type, LaneTypeFieldValue(id, 8, clamped));
+		return !clamped;
+	}
+	bool SetFileBoundaryType(int type) {
+		bool clamped = false;
+		BoundaryType = LaneTypeFieldValue(type, 8, clamped);
+		return !clamped;
+	}
+	bool SetFileTypes(int type3_value, int boundary_type, int situation) {
+		bool clamped = false;
+		type3 = LaneTypeFieldValue(type3_value, 16, clamped);
+		BoundaryType = LaneTypeFieldValue(boundary_type, 8, clamped);
+		Situation = LaneTypeFieldValue(situation, 8, clamped);
+		return !clamped;
+	}
+
+	const char *GetInfoText() const {
+		static const char *boundary_text[] = { "", "_", "_", "_巹", "_и", "_", "_ӽúи",
+			"_öƽ_", "_巳", "_", "_", "_ڸ", "_ǳ", "_Ұ", "_", "_Ÿ" };
+		static thread_local char string_buffer[256];
 
-	const char *GetInfoText() {
 		if (isEmpty()) {
 			sprintf_s(string_buffer, "NONE");
 			return string_buffer;
 		}
-		int BoundaryType = GetBoundaryType();
 
-		char tmp[256];
-		int type3 = GetType3();
+		string_buffer[0] = 0;
 		int type3_id = GetType3_ID() + 1;
-		switch (type3)
+		switch (GetType3())
 		{
 		case C3_NONE:
 			strcat_s(string_buffer, "");
@@ -247,83 +266,26 @@ public:
 				sprintf_s(string_buffer, "_");
 				break;
 			}
-			sprintf_s(string_buffer, "%d", GetType3_ID() + 1);
+			sprintf_s(string_buffer, "%d", type3_id);
 			break;
 		case RIGHT:
 			if (type3_id >= 5) {
 				sprintf_s(string_buffer, "_");
 				break;
 			}
-			sprintf_s(string_buffer, "%d", GetType3_ID() + 1);
+			sprintf_s(string_buffer, "%d", type3_id);
 			break;
-		/*case UNCERTAIN:
-			sprintf_s(string_buffer, "");
-			break;*/
 		default:
 			break;
 		}
 
-		switch (BoundaryType) {
-		case BOUNDARY_NONE:
-			strcat_s(string_buffer, "");
-			break;
-		case WALLS:
-			strcat_s(string_buffer, "_");
-			break;
-		case STATIONARY_VEHICLES:
-			strcat_s(string_buffer, "_");
-			break;
-		case GUARDRAIL:
-			strcat_s(string_buffer, "_巹");
-			break;
-		case STATIC_LANE_SEPARATOR:
-			strcat_s(string_buffer, "_и");
-			break;
-		case CURBS:
-			strcat_s(string_buffer, "_");
-			break;
-		case LANE_SEPARATOR:
-			strcat_s(string_buffer, "_ӽúи");
-			break;
-		case PLASTIC_WALL:
-			strcat_s(string_buffer, "_öƽ_");
-			break;
-		case DRUM:
-			strcat_s(string_buffer, "_巳");
-			break;
-		case BEACONS:
-			strcat_s(string_buffer, "_");
-			break;
-		case CONE:
-			strcat_s(string_buffer, "_");
-			break;
-		case ROAD_EDGE:
-			strcat_s(string_buffer, "_ڸ");
-			break;
-		case INNER_PARKINGSPACE:
-			strcat_s(string_buffer, "_ǳ");
-			break;
-		case UNEXEPLAINABLE:
-			strcat_s(string_buffer, "_Ұ");
-			break;
-		case BOUNDARY_STRUCTURE_ETCS:
-			strcat_s(string_buffer, "_");
-			break;
-		case BOUNDARY_ETCS:
-			strcat_s(string_buffer, "_Ÿ");
-			break;
-		default:
-			strcat_s(string_buffer, "_Ÿ");
-			break;
-		}
+		strcat_s(string_buffer, LaneInfoLabel(boundary_text, GetBoundaryType(), "_Ÿ"));
 		return string_buffer;
 	};
 };
 
 class RoadMarkerInfo
 {
-private:
-	char string_buffer[256];
 public:
 
 	typedef enum {
@@ -342,29 +304,10 @@ public:
 	RoadMakerType GetType()const {
 		return type;
 	}
-	const char *GetInfoText() {
-		RoadMakerType type = GetType();
-		switch (type)
-		{
-		case ROAD_MARKER_TYPE_HARD_NEGATIVE:
-			sprintf_s(string_buffer, "");
-			break;
-		case ROAD_MARKER_TYPE_STOP_LINE:
-			sprintf_s(string_buffer, "");
-			break;
-		case ROAD_MARKER_TYPE_CROSSWALK:
-			sprintf_s(string_buffer, "Ⱦܺ");
-			break;
-		case ROAD_MARKER_TYPE_ARROW:
-			sprintf_s(string_buffer, "");
-			break;
-		case ROAD_MARKER_TYPE_SPEED_BUMP:
-			sprintf_s(string_buffer, "");
-			break;
-		default:
-			sprintf_s(string_buffer, "");
-			break;
-		}
+	const char *GetInfoText() const {
+		static const char *type_text[] = { "", "", "Ⱦܺ", "", "" };
+		static thread_local char string_buffer[256];
+		sprintf_s(string_buffer, "%s", LaneInfoLabel(type_text, GetType()));
 		return string_buffer;
 	};
 };
@@ -375,6 +318,11 @@ public:
 		road_maker_type_.Reset();
 	}
 	~RoadMarkingPolygon() {}
+	// declared so the destructor above does not suppress moves
+	RoadMarkingPolygon(const RoadMarkingPolygon &) = default;
+	RoadMarkingPolygon(RoadMarkingPolygon &&) = default;
+	RoadMarkingPolygon &operator=(const RoadMarkingPolygon &) = default;
+	RoadMarkingPolygon &operator=(RoadMarkingPolygon &&) = default;
 
 	int GetPolygonPointNum() const { return polygon_.size(); }
 	PPOINTF GetPoint(int idx) const { return polygon_[idx]; }
@@ -386,7 +334,9 @@ public:
 		return polygon_; 
 	}
 	vector<PPOINTF> GetPoints() const { return polygon_; }
-	bool PtInPolygon(PPOINTF point) {
+	// read only view of the points, no copy
+	const vector<PPOINTF> &points() const { return polygon_; }
+	bool PtInPolygon(PPOINTF point) const {
 		int i, j, nvert = polygon_.size();
 		bool c = false;
 
@@ -398,21 +348,24 @@ public:
 		}
 		return c;
 	}
-	bool FindPointIndexPtInPolygonPoint(PPOINTF point) {
-		int i, j, nvert = polygon_.size();
-		bool c = false;
-
-		for (i = 0, j = nvert - 1; i < nvert; j = i++) {
-			if (((polygon_[i].y >= point.y) != (polygon_[j].y >= point.y)) &&
-				(point.x <= (polygon_[j].x - polygon_[i].x) * (point.y - polygon_[i].y) / (polygon_[j].y - polygon_[i].y) + polygon_[i].x)
-				)
-				c = !c;
-		}
-		return c;
+	bool FindPointIndexPtInPolygonPoint(PPOINTF point) const {
+		return PtInPolygon(point);
+	}
+	// batch form of PtInPolygon; inside[i] = PtInPolygon(points[i])
+	void PtInPolygon(const PPOINTF *points, int count, unsigned char *inside) const {
+		EdgeTable().ClassifyPoints(points, count, inside);
 	}
+	// build once and reuse for row / grid classification of the same polygon
+	LanePolygonEdgeTable EdgeTable() const { return LanePolygonEdgeTable(polygon_); }
 	bool SetPoints(const vector<PPOINTF> &points) {
 		if (points.size() < 3) return false;
 		polygon_ = points;
+		return true;
+	}
+	bool SetPoints(vector<PPOINTF> &&points) {
+		if (points.size() < 3) return false;
+		polygon_ = std::move(points);
+		return true;
 	}
 protected:
 	RoadMarkerInfo road_maker_type_;
@@ -451,6 +404,152 @@ private:
 
 };
 
+// Control points of a working line kept sorted by y between edits, so moving,
+// adding or erasing one point refits the models without sorting again.
+// Points with equal y keep their index order and only the first one becomes
+// a knot. LaneLine / BoundaryLine::GenerateModels use one per thread as sort
+// scratch.
+class LaneKnotSet
+{
+public:
+	void Clear() { knots_.clear(); }
+	int size() const { return knots_.size(); }
+
+	void Build(const vector<double> &x, const vector<double> &y, const vector<double> &r) {
+		knots_.resize(x.size());
+		for (int i = 0; i < x.size(); i++) {
+			knots_[i].point = PPOINT3F(x[i], y[i], r[i]);
+			knots_[i].src = i;
+		}
+		std::sort(knots_.begin(), knots_.end(), Less);
+	}
+	// src is the index of the point in the line arrays; later points shift up
+	void Insert(int src, const PPOINT3F &point) {
+		for (int i = 0; i < knots_.size(); i++) {
+			if (knots_[i].src >= src) knots_[i].src++;
+		}
+		Knot knot;
+		knot.point = point;
+		knot.src = src;
+		knots_.insert(std::upper_bound(knots_.begin(), knots_.end(), knot, Less), knot);
+	}
+	void Erase(int src) {
+		int pos = Find(src);
+		if (pos < 0) return;
+		knots_.erase(knots_.begin() + pos);
+		for (int i = 0; i < knots_.size(); i++) {
+			if (knots_[i].src > src) knots_[i].src--;
+		}
+	}
+	void Move(int src, const PPOINT3F &point) {
+		int pos = Find(src);
+		if (pos < 0) return;
+		Knot knot = knots_[pos];
+		knot.point = point;
+		knots_.erase(knots_.begin() + pos);
+		knots_.insert(std::upper_bound(knots_.begin(), knots_.end(), knot, Less), knot);
+	}
+
+	// fits x(y) cubic and r(y) linear; false with less than 3 distinct y
+	bool Fit(LaneSpline &xy_model, LaneSpline &ry_model, double &top_y, double &bottom_y) {
+		x_.clear(); y_.clear(); r_.clear();
+		for (int i = 0; i < knots_.size(); i++) {
+			if (i && knots_[i].point.y == knots_[i - 1].point.y) continue;
+			x_.push_back(knots_[i].point.x);
+			y_.push_back(knots_[i].point.y);
+			r_.push_back(knots_[i].point.r);
+		}
+		if (y_.size() < 3) {
+			top_y = 0; bottom_y = 0;
+			return false;
+		}
+		top_y = y_.front();
+		bottom_y = y_.back();
+		xy_model.set_points(y_, x_);
+		ry_model.set_points(y_, r_, false);
+		return true;
+	}
+
+private:
+	struct Knot {
+		PPOINT3F point;
+		int src;
+	};
+	static bool Less(const Knot &a, const Knot &b) {
+		return a.point.y < b.point.y || (a.point.y == b.point.y && a.src < b.src);
+	}
+	int Find(int src) const {
+		for (int i = 0; i < knots_.size(); i++) {
+			if (knots_[i].src == src) return i;
+		}
+		return -1;
+	}
+
+	vector<Knot> knots_;
+	vector<double> x_, y_, r_;   // fit input, reused between edits
+};
+
+// A curve sampled once per image row: center x, half width r and occlusion
+// flag for every row from top_y_ (floored, clamped to 0) to the last image row.
+// Rows past bottom_y_ are the extrapolated extension drawn for ego lanes.
+// Built lazily by RowRaster() and shared read-only by the drawing and mask code.
+struct LaneRowRaster {
+	int top_y;
+	int height;
+	vector<double> x, r;
+	vector<char> occluded;
+	vector<std::pair<float, float>> occlusions;   // occlusions the flags were built from
+
+	int size() const { return x.size(); }
+	double row_x(int y) const { return x[y - top_y]; }
+	double row_r(int y) const { return r[y - top_y]; }
+	bool row_occluded(int y) const { return occluded[y - top_y] != 0; }
+};
+
+// Cache slot of data derived from a line (RowRaster, Occlusions). Lines are
+// shared between RoadLaneManager snapshots, so the value is loaded and
+// replaced atomically and a copy takes the current one.
+template <typename T>
+class LaneSharedCache {
+public:
+	LaneSharedCache() {}
+	LaneSharedCache(const LaneSharedCache &other) : value_(other.load()) {}
+	LaneSharedCache &operator=(const LaneSharedCache &other) { store(other.load()); return *this; }
+
+	std::shared_ptr<const T> load() const { return std::atomic_load(&value_); }
+	void store(const std::shared_ptr<const T> &value) const { std::atomic_store(&value_, value); }
+	void reset() { store(nullptr); }
+private:
+	mutable std::shared_ptr<const T> value_;
+};
+typedef LaneSharedCache<LaneRowRaster> LaneRowRasterCache;
+typedef LaneSharedCache<LaneOcclusionSet> LaneOcclusionCache;
+
+template <typename LINE>
+std::shared_ptr<const LaneRowRaster> BuildLaneRowRaster(const LINE &line, int height)
+{
+	std::shared_ptr<LaneRowRaster> raster = std::make_shared<LaneRowRaster>();
+	raster->top_y = std::max((int)floor(line.top_y_), 0);
+	raster->height = height;
+	std::shared_ptr<const LaneOcclusionSet> occlusions = line.Occlusions();
+	raster->occlusions = occlusions->source();
+	int count = std::max(height - raster->top_y, 0);
+	raster->x.resize(count);
+	raster->r.resize(count);
+	raster->occluded.assign(count, 0);
+	if (count) {
+		line.EvaluateRows(raster->top_y, height - 1, 1, &raster->x[0], &raster->r[0]);
+	}
+	// same test as the per row loops: top <= y <= bottom; intervals are
+	// disjoint, so every row is written at most once
+	for (int k = 0; k < occlusions->size(); k++) {
+		int first = std::max((int)ceil((*occlusions)[k].first), raster->top_y);
+		int last = std::min((int)floor((*occlusions)[k].second), height - 1);
+		for (int y = first; y <= last; y++) raster->occluded[y - raster->top_y] = 1;
+	}
+	return raster;
+}
+
 class LaneLine
 {
 public:
@@ -458,12 +557,16 @@ public:
 		top_y_ = 0; bottom_y_ = 0;
 	}
 	~LaneLine(){}
+	LaneLine(const LaneLine &) = default;
+	LaneLine(LaneLine &&) = default;
+	LaneLine &operator=(const LaneLine &) = default;
+	LaneLine &operator=(LaneLine &&) = default;
 	vector<double> spline_x_, spline_y_;
 	vector<double> line_r_;
 
 	double top_y_, bottom_y_;
-	svld::tk::spline spline_xy_model_;
-	svld::tk::spline spline_ry_model_;
+	LaneSpline spline_xy_model_;
+	LaneSpline spline_ry_model_;
 
 	LaneInfo info;
 	
@@ -471,35 +574,47 @@ public:
 		return (a.y < b.y);
 	}
 	bool GenerateModels(){
-		std::vector<PPOINT3F> xyz;
-		if(spline_x_.size() < 3){
-			top_y_ = 0; bottom_y_ = 0;
-			return false;
-		}
-		for(int i = 0; i < spline_x_.size(); ++i) xyz.push_back(PPOINT3F(spline_x_[i], spline_y_[i], line_r_[i]));
-		sort(xyz.begin(), xyz.end(), comp);
-		for(int i = xyz.size() - 1; i--;){ if(xyz[i].y == xyz[i + 1].y){ xyz.erase(xyz.begin() + i + 1); } }
-		if(xyz.size() < 3){
-			top_y_ = 0; bottom_y_ = 0;
-			return false;
-		}
-		top_y_ = xyz[0].y;
-		bottom_y_ = xyz[xyz.size() - 1].y;
-
-		std::vector<double> x, y, r;
-		for(int i = 0; i < xyz.size(); i++){
-			x.push_back(xyz[i].x); y.push_back(xyz[i].y);  r.push_back(xyz[i].r);
+		row_raster_.reset();
+		// sorted and deduplicated in per thread scratch, so loading
+		// many files does not allocate per line
+		static thread_local LaneKnotSet knots;
+		knots.Build(spline_x_, spline_y_, line_r_);
+		return knots.Fit(spline_xy_model_, spline_ry_model_, top_y_, bottom_y_);
+	}
+	PPOINT3F EstimatePoint(double y) const {
+		double x, r;
+		EvaluateSplinePair(spline_xy_model_, spline_ry_model_, y, 1, 1, &x, &r);
+		return PPOINT3F(x, y, r);
+	}
+	// x and r of rows y0, y0 + step, ... <= y1; returns the number of rows written
+	int EvaluateRows(double y0, double y1, double step, double *x_out, double *r_out) const {
+		int count = LaneSplineRowCount(y0, y1, step);
+		EvaluateSplinePair(spline_xy_model_, spline_ry_model_, y0, step, count, x_out, r_out);
+		return count;
+	}
+	// rows of this line for an image of the given height; rebuilt after
+	// GenerateModels or when the occlusions changed
+	std::shared_ptr<const LaneRowRaster> RowRaster(int height) const {
+		std::shared_ptr<const LaneRowRaster> raster = row_raster_.load();
+		if (!raster || raster->height != height || raster->occlusions != info.occlusions_top_bottom_) {
+			raster = BuildLaneRowRaster(*this, height);
+			row_raster_.store(raster);
 		}
-		spline_xy_model_.set_points(y, x);
-		spline_ry_model_.set_points(y, r, false);
-		//line_r_model_.LeastSquareFit(&spline_y_[0], &line_r_[0], spline_y_.size());
-		return true;
+		return raster;
 	}
-	PPOINT3F EstimatePoint(double y){
-		return PPOINT3F(spline_xy_model_(y), y, spline_ry_model_(y));
+	// occlusions sorted and merged; rebuilt when info.occlusions_top_bottom_ changed.
+	// Hold the set while querying many rows.
+	std::shared_ptr<const LaneOcclusionSet> Occlusions() const {
+		std::shared_ptr<const LaneOcclusionSet> occlusions = occlusion_set_.load();
+		if (!occlusions || occlusions->source() != info.occlusions_top_bottom_) {
+			occlusions = std::make_shared<LaneOcclusionSet>(info.occlusions_top_bottom_);
+			occlusion_set_.store(occlusions);
+		}
+		return occlusions;
 	}
 protected:
-	
+	LaneRowRasterCache row_raster_;
+	LaneOcclusionCache occlusion_set_;
 };
 
 class WorkingLaneLine : public LaneLine
@@ -526,6 +641,7 @@ public:
 		spline_x_[idx] = pt3.x;
 		spline_y_[idx] = pt3.y;
 		line_r_[idx] = pt3.r;
+		if (knots_.size() == element_size()) knots_.Move(idx, ixyr(idx));
 		GenerateModels();
 	}
 	PPOINT3F vxyr(int idx) const {
@@ -561,6 +677,7 @@ public:
 		spline_x_.erase(spline_x_.begin() + idx);
 		spline_y_.erase(spline_y_.begin() + idx);
 		line_r_.erase(line_r_.begin() + idx);
+		if (knots_.size() == element_size() + 1) knots_.Erase(idx);
 		GenerateModels();
 	}
 
@@ -569,15 +686,15 @@ public:
 		spline_y_.clear();
 		line_r_.clear();
 		info.Reset();
+		knots_.Clear();
 		GenerateModels();
 	}
 
+	// refits from the sorted knots; they are rebuilt only when out of step with the arrays
 	bool GenerateModels(){
-		if(LaneLine::GenerateModels()){
-			initialized_ = true;
-		} else {
-			initialized_ = false;
-		}
+		row_raster_.reset();
+		if(knots_.size() != element_size()) knots_.Build(spline_x_, spline_y_, line_r_);
+		initialized_ = knots_.Fit(spline_xy_model_, spline_ry_model_, top_y_, bottom_y_);
 		return initialized_;
 	}
 
@@ -585,12 +702,14 @@ public:
 		spline_x_.push_back(point3.x);
 		spline_y_.push_back(point3.y);
 		line_r_.push_back(point3.r);
+		if (knots_.size() == element_size() - 1) knots_.Insert(element_size() - 1, ixyr(element_size() - 1));
 	}
 
 protected:
 
 private:
 	bool initialized_ = false;
+	LaneKnotSet knots_;
 };
 
 class BoundaryLine
@@ -600,12 +719,16 @@ public:
 		top_y_ = 0; bottom_y_ = 0;
 	}
 	~BoundaryLine() {}
+	BoundaryLine(const BoundaryLine &) = default;
+	BoundaryLine(BoundaryLine &&) = default;
+	BoundaryLine &operator=(const BoundaryLine &) = default;
+	BoundaryLine &operator=(BoundaryLine &&) = default;
 	vector<double> spline_x_, spline_y_;
 	vector<double> line_r_;
 
 	double top_y_, bottom_y_;
-	svld::tk::spline spline_xy_model_;
-	svld::tk::spline spline_ry_model_;
+	LaneSpline spline_xy_model_;
+	LaneSpline spline_ry_model_;
 
 	BoundaryInfo info;
 
@@ -613,35 +736,42 @@ public:
 		return (a.y < b.y);
 	}
 	bool GenerateModels() {
-		std::vector<PPOINT3F> xyz;
-		if (spline_x_.size() < 3) {
-			top_y_ = 0; bottom_y_ = 0;
-			return false;
-		}
-		for (int i = 0; i < spline_x_.size(); ++i) xyz.push_back(PPOINT3F(spline_x_[i], spline_y_[i], line_r_[i]));
-		sort(xyz.begin(), xyz.end(), comp);
-		for (int i = xyz.size() - 1; i--;) { if (xyz[i].y == xyz[i + 1].y) { xyz.erase(xyz.begin() + i + 1); } }
-		if (xyz.size() < 3) {
-			top_y_ = 0; bottom_y_ = 0;
-			return false;
-		}
-		top_y_ = xyz[0].y;
-		bottom_y_ = xyz[xyz.size() - 1].y;
-
-		std::vector<double> x, y, r;
-		for (int i = 0; i < xyz.size(); i++) {
-			x.push_back(xyz[i].x); y.push_back(xyz[i].y);  r.push_back(xyz[i].r);
+		row_raster_.reset();
+		static thread_local LaneKnotSet knots;
+		knots.Build(spline_x_, spline_y_, line_r_);
+		return knots.Fit(spline_xy_model_, spline_ry_model_, top_y_, bottom_y_);
+	}
+	PPOINT3F EstimatePoint(double y) const {
+		double x, r;
+		EvaluateSplinePair(spline_xy_model_, spline_ry_model_, y, 1, 1, &x, &r);
+		return PPOINT3F(x, y, r);
+	}
+	int EvaluateRows(double y0, double y1, double step, double *x_out, double *r_out) const {
+		int count = LaneSplineRowCount(y0, y1, step);
+		EvaluateSplinePair(spline_xy_model_, spline_ry_model_, y0, step, count, x_out, r_out);
+		return count;
+	}
+	std::shared_ptr<const LaneRowRaster> RowRaster(int height) const {
+		std::shared_ptr<const LaneRowRaster> raster = row_raster_.load();
+		if (!raster || raster->height != height || raster->occlusions != info.occlusions_top_bottom_) {
+			raster = BuildLaneRowRaster(*this, height);
+			row_raster_.store(raster);
 		}
-		spline_xy_model_.set_points(y, x);
-		spline_ry_model_.set_points(y, r, false);
-		//line_r_model_.LeastSquareFit(&spline_y_[0], &line_r_[0], spline_y_.size());
-		return true;
+		return raster;
 	}
-	PPOINT3F EstimatePoint(double y) {
-		return PPOINT3F(spline_xy_model_(y), y, spline_ry_model_(y));
+	// occlusions sorted and merged; rebuilt when info.occlusions_top_bottom_ changed.
+	// Hold the set while querying many rows.
+	std::shared_ptr<const LaneOcclusionSet> Occlusions() const {
+		std::shared_ptr<const LaneOcclusionSet> occlusions = occlusion_set_.load();
+		if (!occlusions || occlusions->source() != info.occlusions_top_bottom_) {
+			occlusions = std::make_shared<LaneOcclusionSet>(info.occlusions_top_bottom_);
+			occlusion_set_.store(occlusions);
+		}
+		return occlusions;
 	}
 protected:
-
+	LaneRowRasterCache row_raster_;
+	LaneOcclusionCache occlusion_set_;
 };
 
 class WorkingBoundaryLine : public BoundaryLine
@@ -668,6 +798,7 @@ public:
 		spline_x_[idx] = pt3.x;
 		spline_y_[idx] = pt3.y;
 		line_r_[idx] = pt3.r;
+		if (knots_.size() == element_size()) knots_.Move(idx, ixyr(idx));
 		GenerateModels();
 	}
 	PPOINT3F vxyr(int idx) const {
@@ -703,6 +834,7 @@ public:
 		spline_x_.erase(spline_x_.begin() + idx);
 		spline_y_.erase(spline_y_.begin() + idx);
 		line_r_.erase(line_r_.begin() + idx);
+		if (knots_.size() == element_size() + 1) knots_.Erase(idx);
 		GenerateModels();
 	}
 
@@ -711,16 +843,14 @@ public:
 		spline_y_.clear();
 		line_r_.clear();
 		info.Reset();
+		knots_.Clear();
 		GenerateModels();
 	}
 
 	bool GenerateModels() {
-		if (BoundaryLine::GenerateModels()) {
-			initialized_ = true;
-		}
-		else {
-			initialized_ = false;
-		}
+		row_raster_.reset();
+		if (knots_.size() != element_size()) knots_.Build(spline_x_, spline_y_, line_r_);
+		initialized_ = knots_.Fit(spline_xy_model_, spline_ry_model_, top_y_, bottom_y_);
 		return initialized_;
 	}
 
@@ -728,12 +858,14 @@ public:
 		spline_x_.push_back(point3.x);
 		spline_y_.push_back(point3.y);
 		line_r_.push_back(point3.r);
+		if (knots_.size() == element_size() - 1) knots_.Insert(element_size() - 1, ixyr(element_size() - 1));
 	}
 
 protected:
 
 private:
 	bool initialized_ = false;
+	LaneKnotSet knots_;
 };
 
 struct CurrentPoint{
@@ -751,84 +883,170 @@ public:
 	volatile bool IsZF() { return ((float)image_height_ / image_width_ > 0.7); }
 
 	bool ReadFile(const char *szpath);
+	// same schema as ReadFile without building a DOM; used by the bulk loaders
+	bool ReadFileStream(const char *szpath);
+	// ReadFileStream on a file already in memory; data[size] must be NUL,
+	// szpath only names the file in messages
+	bool ReadBufferStream(const char *data, size_t size, const char *szpath = "");
 	bool WriteFile(const char *szpath);
+	// same output schema as WriteFile, emitted straight into a buffer
+	bool WriteFileStream(const char *szpath);
 	void Reset(int image_width, int image_height);
 
 	void AddLine(const LaneLine &line);
+	void AddLine(LaneLine &&line);
 	void ResetLine(const LaneLine &line, int idx);
+	void ResetLine(LaneLine &&line, int idx);
 	void RemoveLine(int idx);
 	void AddPolygon(const RoadMarkingPolygon &polygon);
+	void AddPolygon(RoadMarkingPolygon &&polygon);
 	void ResetPoygon(const RoadMarkingPolygon &polygon, int idx);
+	void ResetPoygon(RoadMarkingPolygon &&polygon, int idx);
 	void RemovePoygon(int idx);
 	void AddBoundary(const BoundaryLine &line);
+	void AddBoundary(BoundaryLine &&line);
 	void ResetBoundary(const BoundaryLine &line, int idx);
+	void ResetBoundary(BoundaryLine &&line, int idx);
 	void RemoveBoundary(int idx);
+	// append an empty element and return it to be filled in place.
+	// The reference is valid until the element is reset or removed.
+	LaneLine &EmplaceLine();
+	RoadMarkingPolygon &EmplacePolygon();
+	BoundaryLine &EmplaceBoundary();
+	void ReserveLine(int size) { lines_.reserve(size); }
+	void ReservePolygon(int size) { polygons_.reserve(size); }
+	void ReserveBoundary(int size) { boundarys_.reserve(size); }
 	void SetVPYRatio(double vp_y_ratio);
 	void SetVPXRatio(double vp_x_ratio);
 	void SetImageSize(int width, int height);
 	void SetToolVersion(string str_version);
-
-	int GetSizeLaneLine() { return lines_.size(); }
-	int GetSizeRoadMarking() { return polygons_.size(); }
-	int GetSizeBoundary() { return boundarys_.size(); }
-
-	int GetImageW() { return image_width_; }
-	int GetImageH() { return image_height_; }
-
+	const string &tool_version() const { return str_tool_version_; }
+
+	int GetSizeLaneLine() const { return lines_.size(); }
+	int GetSizeRoadMarking() const { return polygons_.size(); }
+	int GetSizeBoundary() const { return boundarys_.size(); }
+
+	int GetImageW() const { return image_width_; }
+	int GetImageH() const { return image_height_; }
+
+	// read only views of the whole containers, no copy
+	const LaneCowVector<LaneLine> &lines() const { return lines_; }
+	const LaneCowVector<RoadMarkingPolygon> &roadmarkings() const { return polygons_; }
+	const LaneCowVector<BoundaryLine> &boundarys() const { return boundarys_; }
+
+	// Copies of a RoadLaneManager share their objects (copy on write), so a
+	// copy is O(1) whatever the size of the frame. The non-const *_ptr
+	// accessors give write access: they clone the object first when a copy
+	// still shares it and mark the object stale in the spatial index. Read
+	// through the const overloads or line() / roadmarking() / boundary() when
+	// nothing is changed.
 	LaneLine *line_ptr(int idx) {
+		if(idx >= 0 && idx < lines_.size()) {
+			MarkEdited(edited_lines_, idx);
+			return &lines_.mutable_at(idx);
+		}
+		else return NULL;
+	}
+	const LaneLine *line_ptr(int idx) const {
 		if(idx >= 0 && idx < lines_.size())
 			return &lines_[idx];
 		else return NULL;
 	}
 
-	LaneLine line(int idx) {
+	const LaneLine &line(int idx) const {
+		static const LaneLine empty;
 		if(idx >= 0 && idx < lines_.size())
 			return lines_[idx];
-		else return LaneLine();
+		else return empty;
 	}
 
 	RoadMarkingPolygon *roadmarking_ptr(int idx) {
+		if (idx >= 0 && idx < polygons_.size()) {
+			MarkEdited(edited_polygons_, idx);
+			return &polygons_.mutable_at(idx);
+		}
+		else return NULL;
+	}
+	const RoadMarkingPolygon *roadmarking_ptr(int idx) const {
 		if (idx >= 0 && idx < polygons_.size())
 			return &polygons_[idx];
 		else return NULL;
 	}
 
-	RoadMarkingPolygon roadmarking(int idx) {
+	const RoadMarkingPolygon &roadmarking(int idx) const {
+		static const RoadMarkingPolygon empty;
 		if (idx >= 0 && idx < polygons_.size())
 			return polygons_[idx];
-		else return RoadMarkingPolygon();
+		else return empty;
 	}
 
 	BoundaryLine *boundary_ptr(int idx) {
+		if (idx >= 0 && idx < boundarys_.size()) {
+			MarkEdited(edited_boundarys_, idx);
+			return &boundarys_.mutable_at(idx);
+		}
+		else return NULL;
+	}
+	const BoundaryLine *boundary_ptr(int idx) const {
 		if (idx >= 0 && idx < boundarys_.size())
 			return &boundarys_[idx];
 		else return NULL;
 	}
 
-	BoundaryLine boundary(int idx) {
+	const BoundaryLine &boundary(int idx) const {
+		static const BoundaryLine empty;
 		if (idx >= 0 && idx < boundarys_.size())
 			return boundarys_[idx];
-		else return BoundaryLine();
+		else return empty;
 	}
 
 	void SortingLength();
 
-	double vp_x_ratio() { return vp_x_ratio_; }
-	double vp_y_ratio() { return vp_y_ratio_; }
-	bool has_vp() { return has_vp_; }
+	// hit tests through a spatial index, rebuilt lazily after the mutators;
+	// after the non-const *_ptr accessors above only the objects they
+	// returned are measured again (LaneSpatialIndex::Update). A pointer taken
+	// before a Find* call and written through after it must be taken again,
+	// or InvalidateIndex called, since the Find* call rebuilt the index from
+	// the old points.
+	int FindLineAt(PPOINTF image_pt);
+	int FindBoundaryAt(PPOINTF image_pt);
+	int FindRoadMarkingAt(PPOINTF image_pt);
+	void FindInRect(float left, float top, float right, float bottom,
+		vector<int> &lines, vector<int> &boundarys, vector<int> &polygons);
+	void InvalidateIndex() { index_dirty_ = true; }
+
+	double vp_x_ratio() const { return vp_x_ratio_; }
+	double vp_y_ratio() const { return vp_y_ratio_; }
+	bool has_vp() const { return has_vp_; }
 	void set_has_vp(bool vp) { has_vp_ = vp; }
 
 	//tinyxml2::XMLDocument xmlDoc;
 private:
-	vector<RoadMarkingPolygon> polygons_;
-	vector<LaneLine> lines_;	
-	vector<BoundaryLine> boundarys_;
+	LaneCowVector<RoadMarkingPolygon> polygons_;
+	LaneCowVector<LaneLine> lines_;	
+	LaneCowVector<BoundaryLine> boundarys_;
 	double vp_y_ratio_;
 	double vp_x_ratio_;
 	bool has_vp_;
 	int image_width_;
 	int image_height_;
 	string str_tool_version_;
+	// immutable once built, shared by copies until one of them edits
+	std::shared_ptr<const LaneSpatialIndex> spatial_index_;
+	bool index_dirty_;   // rebuild all
+	// objects handed out by the *_ptr accessors since the index was built
+	vector<int> edited_lines_, edited_boundarys_, edited_polygons_;
+
+	void MarkEdited(vector<int> &edited, int idx) {
+		if (!edited.empty() && edited.back() == idx)
+			return;
+		// many objects edited between two hit tests: measure them all
+		if (edited.size() >= 64)
+			index_dirty_ = true;
+		else
+			edited.push_back(idx);
+	}
+	void UpdateIndex();
 protected:
 
 };
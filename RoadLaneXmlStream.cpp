@@ -0,0 +1,490 @@
+#include "RoadLaneXmlStream.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+static const double kExactPow10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Splits a decimal literal into an integer mantissa and a power of ten.
+// Returns false when the literal has more digits than fit in the mantissa
+// or is not a plain decimal number; callers then fall back to strtod.
+static bool SplitDecimal(const char *s, const char *e, bool *negative, uint64_t *mantissa, int *exp10, int *digits)
+{
+	*negative = false;
+	*mantissa = 0;
+	*exp10 = 0;
+	*digits = 0;
+	while (s < e && (*s == ' ' || *s == '\t')) s++;
+	if (s < e && (*s == '-' || *s == '+')) {
+		*negative = (*s == '-');
+		s++;
+	}
+	bool has_digit = false;
+	for (; s < e && *s >= '0' && *s <= '9'; s++) {
+		has_digit = true;
+		if (*mantissa == 0 && *s == '0') continue;
+		if (*digits >= 19) return false;
+		*mantissa = *mantissa * 10 + (*s - '0');
+		(*digits)++;
+	}
+	if (s < e && *s == '.') {
+		for (s++; s < e && *s >= '0' && *s <= '9'; s++) {
+			has_digit = true;
+			(*exp10)--;
+			if (*mantissa == 0 && *s == '0') continue;
+			if (*digits >= 19) return false;
+			*mantissa = *mantissa * 10 + (*s - '0');
+			(*digits)++;
+		}
+	}
+	if (!has_digit) return false;
+	if (s < e && (*s == 'e' || *s == 'E')) {
+		s++;
+		bool exp_negative = false;
+		if (s < e && (*s == '-' || *s == '+')) {
+			exp_negative = (*s == '-');
+			s++;
+		}
+		int exp = 0;
+		if (s == e || *s < '0' || *s > '9') return false;
+		for (; s < e && *s >= '0' && *s <= '9'; s++) {
+			if (exp < 10000) exp = exp * 10 + (*s - '0');
+		}
+		*exp10 += exp_negative ? -exp : exp;
+	}
+	while (s < e && (*s == ' ' || *s == '\t')) s++;
+	return s == e;
+}
+
+bool ParseLaneDouble(const char *s, const char *e, double *value)
+{
+	bool negative;
+	uint64_t mantissa;
+	int exp10, digits;
+	// exact when both the mantissa and the power of ten are exact doubles
+	if (SplitDecimal(s, e, &negative, &mantissa, &exp10, &digits) &&
+		mantissa <= ((uint64_t)1 << 53) && exp10 >= -22 && exp10 <= 22) {
+		double v = (double)mantissa;
+		v = exp10 < 0 ? v / kExactPow10[-exp10] : v * kExactPow10[exp10];
+		*value = negative ? -v : v;
+		return true;
+	}
+	char *endp;
+	double v = strtod(s, &endp);
+	if (endp == s) return false;
+	*value = v;
+	return true;
+}
+
+bool ParseLaneFloat(const char *s, const char *e, float *value)
+{
+	bool negative;
+	uint64_t mantissa;
+	int exp10, digits;
+	if (SplitDecimal(s, e, &negative, &mantissa, &exp10, &digits) &&
+		mantissa <= ((uint64_t)1 << 24) && exp10 >= -10 && exp10 <= 10) {
+		float v = (float)mantissa;
+		v = exp10 < 0 ? v / (float)kExactPow10[-exp10] : v * (float)kExactPow10[exp10];
+		*value = negative ? -v : v;
+		return true;
+	}
+	char *endp;
+	float v = strtof(s, &endp);
+	if (endp == s) return false;
+	*value = v;
+	return true;
+}
+
+bool ParseLaneInt(const char *s, const char *e, int *value)
+{
+	while (s < e && (*s == ' ' || *s == '\t')) s++;
+	bool negative = false;
+	if (s < e && (*s == '-' || *s == '+')) {
+		negative = (*s == '-');
+		s++;
+	}
+	if (s == e || *s < '0' || *s > '9') return false;
+	int64_t v = 0;
+	for (; s < e && *s >= '0' && *s <= '9'; s++) {
+		v = v * 10 + (*s - '0');
+		if (v > ((int64_t)1 << 32)) return false;
+	}
+	*value = (int)(negative ? -v : v);
+	return true;
+}
+
+bool ParseLaneBool(const char *s, const char *e, bool *value)
+{
+	int ivalue;
+	if (ParseLaneInt(s, e, &ivalue)) {
+		*value = ivalue != 0;
+		return true;
+	}
+	size_t len = e - s;
+	if (len == 4 && strncmp(s, "true", 4) == 0) {
+		*value = true;
+		return true;
+	}
+	if (len == 5 && strncmp(s, "false", 5) == 0) {
+		*value = false;
+		return true;
+	}
+	return false;
+}
+
+bool ReadLaneFileToBuffer(const char *szpath, std::vector<char> &buffer)
+{
+	FILE *fp = fopen(szpath, "rb");
+	if (fp == NULL) return false;
+	fseek(fp, 0, SEEK_END);
+	long size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	if (size < 0) {
+		fclose(fp);
+		return false;
+	}
+	buffer.resize(size + 1);
+	size_t read = size ? fread(&buffer[0], 1, size, fp) : 0;
+	fclose(fp);
+	buffer[read] = '\0';
+	buffer.resize(read + 1);
+	return read == (size_t)size;
+}
+
+LaneXmlPullParser::LaneXmlPullParser(const char *begin, const char *end)
+{
+	cur_ = begin;
+	end_ = end;
+	name_ = NULL;
+	name_len_ = 0;
+	attribute_num_ = 0;
+	depth_ = 0;
+	pending_end_ = false;
+}
+
+static inline bool IsXmlSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static inline bool IsNameChar(char c)
+{
+	return !IsXmlSpace(c) && c != '/' && c != '>' && c != '=' && c != '\0';
+}
+
+static const char *SkipPast(const char *cur, const char *end, const char *token)
+{
+	size_t len = strlen(token);
+	for (; cur + len <= end; cur++) {
+		if (memcmp(cur, token, len) == 0) return cur + len;
+	}
+	return NULL;
+}
+
+// Parses the tag starting right after '<'. Fills name and attributes.
+bool LaneXmlPullParser::ParseTag()
+{
+	const char *p = cur_;
+	name_ = p;
+	while (p < end_ && IsNameChar(*p)) p++;
+	name_len_ = p - name_;
+	if (name_len_ == 0) return false;
+
+	attribute_num_ = 0;
+	for (;;) {
+		while (p < end_ && IsXmlSpace(*p)) p++;
+		if (p >= end_) return false;
+		if (*p == '>') {
+			pending_end_ = false;
+			cur_ = p + 1;
+			return true;
+		}
+		if (*p == '/') {
+			if (p + 1 >= end_ || p[1] != '>') return false;
+			pending_end_ = true;
+			cur_ = p + 2;
+			return true;
+		}
+		Attribute attr;
+		attr.name = p;
+		while (p < end_ && IsNameChar(*p)) p++;
+		attr.name_len = p - attr.name;
+		while (p < end_ && IsXmlSpace(*p)) p++;
+		if (attr.name_len == 0 || p >= end_ || *p != '=') return false;
+		p++;
+		while (p < end_ && IsXmlSpace(*p)) p++;
+		if (p >= end_ || (*p != '"' && *p != '\'')) return false;
+		char quote = *p++;
+		attr.value = p;
+		while (p < end_ && *p != quote) p++;
+		if (p >= end_) return false;
+		attr.value_end = p++;
+		if (attribute_num_ < MAX_ATTRIBUTES)
+			attributes_[attribute_num_++] = attr;
+	}
+}
+
+LaneXmlPullParser::Token LaneXmlPullParser::Next()
+{
+	if (pending_end_) {
+		pending_end_ = false;
+		depth_--;
+		return TOKEN_END;
+	}
+	for (;;) {
+		while (cur_ < end_ && *cur_ != '<') cur_++;
+		if (cur_ >= end_ || *cur_ == '\0') return TOKEN_EOF;
+		const char *p = cur_ + 1;
+		if (p < end_ && (*p == '?' || *p == '!')) {
+			const char *next;
+			if (end_ - p >= 3 && memcmp(p, "!--", 3) == 0) next = SkipPast(p, end_, "-->");
+			else if (end_ - p >= 8 && memcmp(p, "![CDATA[", 8) == 0) next = SkipPast(p, end_, "]]>");
+			else next = SkipPast(p, end_, ">");
+			if (next == NULL) return TOKEN_ERROR;
+			cur_ = next;
+			continue;
+		}
+		if (p < end_ && *p == '/') {
+			const char *close = SkipPast(p, end_, ">");
+			if (close == NULL) return TOKEN_ERROR;
+			name_ = p + 1;
+			name_len_ = 0;
+			while (name_ + name_len_ < close - 1 && IsNameChar(name_[name_len_])) name_len_++;
+			attribute_num_ = 0;
+			cur_ = close;
+			depth_--;
+			return TOKEN_END;
+		}
+		cur_ = p;
+		if (!ParseTag()) return TOKEN_ERROR;
+		depth_++;
+		return TOKEN_START;
+	}
+}
+
+bool LaneXmlPullParser::IsElement(const char *name) const
+{
+	return strlen(name) == name_len_ && memcmp(name, name_, name_len_) == 0;
+}
+
+bool LaneXmlPullParser::SkipElement()
+{
+	int depth = depth_;
+	while (depth_ >= depth) {
+		Token token = Next();
+		if (token == TOKEN_EOF || token == TOKEN_ERROR) return false;
+	}
+	return true;
+}
+
+const LaneXmlPullParser::Attribute *LaneXmlPullParser::FindAttribute(const char *name) const
+{
+	size_t len = strlen(name);
+	for (int i = 0; i < attribute_num_; i++) {
+		if (attributes_[i].name_len == len && memcmp(attributes_[i].name, name, len) == 0)
+			return &attributes_[i];
+	}
+	return NULL;
+}
+
+bool LaneXmlPullParser::QueryIntAttribute(const char *name, int *value) const
+{
+	const Attribute *attr = FindAttribute(name);
+	return attr && ParseLaneInt(attr->value, attr->value_end, value);
+}
+
+bool LaneXmlPullParser::QueryDoubleAttribute(const char *name, double *value) const
+{
+	const Attribute *attr = FindAttribute(name);
+	return attr && ParseLaneDouble(attr->value, attr->value_end, value);
+}
+
+bool LaneXmlPullParser::QueryFloatAttribute(const char *name, float *value) const
+{
+	const Attribute *attr = FindAttribute(name);
+	return attr && ParseLaneFloat(attr->value, attr->value_end, value);
+}
+
+bool LaneXmlPullParser::QueryBoolAttribute(const char *name, bool *value) const
+{
+	const Attribute *attr = FindAttribute(name);
+	return attr && ParseLaneBool(attr->value, attr->value_end, value);
+}
+
+bool LaneXmlPullParser::QueryStringAttribute(const char *name, std::string *value) const
+{
+	static const struct { const char *text; int len; char c; } entities[] = {
+		{ "&amp;", 5, '&' }, { "&lt;", 4, '<' }, { "&gt;", 4, '>' }, { "&quot;", 6, '"' }, { "&apos;", 6, '\'' }
+	};
+	const Attribute *attr = FindAttribute(name);
+	if (attr == NULL) return false;
+	value->clear();
+	for (const char *p = attr->value; p < attr->value_end;) {
+		int k = 0;
+		if (*p == '&') {
+			for (; k < 5; k++) {
+				if (attr->value_end - p >= entities[k].len && memcmp(p, entities[k].text, entities[k].len) == 0) break;
+			}
+		}
+		if (*p == '&' && k < 5) {
+			value->push_back(entities[k].c);
+			p += entities[k].len;
+		}
+		else {
+			value->push_back(*p++);
+		}
+	}
+	return true;
+}
+
+int FormatLaneDouble(char *buf, double value)
+{
+	// %.17g always round trips; try shorter precisions first
+	static const char *formats[] = { "%.15g", "%.16g", "%.17g" };
+	int len = 0;
+	for (int i = 0; i < 3; i++) {
+		len = snprintf(buf, 32, formats[i], value);
+		double back;
+		if (ParseLaneDouble(buf, buf + len, &back) && back == value) break;
+	}
+	return len;
+}
+
+int FormatLaneFloat(char *buf, float value)
+{
+	static const char *formats[] = { "%.6g", "%.7g", "%.8g", "%.9g" };
+	int len = 0;
+	for (int i = 0; i < 4; i++) {
+		len = snprintf(buf, 32, formats[i], value);
+		float back;
+		if (ParseLaneFloat(buf, buf + len, &back) && back == value) break;
+	}
+	return len;
+}
+
+int FormatLaneInt(char *buf, int value)
+{
+	char tmp[16];
+	int len = 0, out = 0;
+	unsigned int u = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+	do {
+		tmp[len++] = (char)('0' + u % 10);
+		u /= 10;
+	} while (u);
+	if (value < 0) buf[out++] = '-';
+	while (len) buf[out++] = tmp[--len];
+	buf[out] = '\0';
+	return out;
+}
+
+LaneXmlWriter::LaneXmlWriter()
+{
+	element_just_opened_ = false;
+}
+
+void LaneXmlWriter::Clear()
+{
+	buffer_.clear();
+	stack_.clear();
+	element_just_opened_ = false;
+}
+
+void LaneXmlWriter::Append(const char *str)
+{
+	Append(str, strlen(str));
+}
+
+void LaneXmlWriter::Indent(int depth)
+{
+	for (int i = 0; i < depth; i++) Append("    ", 4);
+}
+
+void LaneXmlWriter::OpenElement(const char *name)
+{
+	if (element_just_opened_) Append(">\n", 2);
+	Indent(stack_.size());
+	Append("<", 1);
+	Append(name);
+	stack_.push_back(name);
+	element_just_opened_ = true;
+}
+
+void LaneXmlWriter::PushRawAttribute(const char *name, const char *value, int len)
+{
+	Append(" ", 1);
+	Append(name);
+	Append("=\"", 2);
+	Append(value, len);
+	Append("\"", 1);
+}
+
+void LaneXmlWriter::PushAttribute(const char *name, const char *value)
+{
+	Append(" ", 1);
+	Append(name);
+	Append("=\"", 2);
+	for (const char *p = value; *p; p++) {
+		switch (*p) {
+		case '&': Append("&amp;", 5); break;
+		case '<': Append("&lt;", 4); break;
+		case '>': Append("&gt;", 4); break;
+		case '"': Append("&quot;", 6); break;
+		default: buffer_.push_back(*p); break;
+		}
+	}
+	Append("\"", 1);
+}
+
+void LaneXmlWriter::PushAttribute(const char *name, int value)
+{
+	char buf[32];
+	PushRawAttribute(name, buf, FormatLaneInt(buf, value));
+}
+
+void LaneXmlWriter::PushAttribute(const char *name, bool value)
+{
+	if (value) PushRawAttribute(name, "true", 4);
+	else PushRawAttribute(name, "false", 5);
+}
+
+void LaneXmlWriter::PushAttribute(const char *name, float value)
+{
+	char buf[32];
+	PushRawAttribute(name, buf, FormatLaneFloat(buf, value));
+}
+
+void LaneXmlWriter::PushAttribute(const char *name, double value)
+{
+	char buf[32];
+	PushRawAttribute(name, buf, FormatLaneDouble(buf, value));
+}
+
+void LaneXmlWriter::CloseElement()
+{
+	const char *name = stack_.back();
+	stack_.pop_back();
+	if (element_just_opened_) {
+		Append("/>\n", 3);
+	}
+	else {
+		Indent(stack_.size());
+		Append("</", 2);
+		Append(name);
+		Append(">\n", 2);
+	}
+	element_just_opened_ = false;
+}
+
+bool LaneXmlWriter::SaveFile(const char *szpath) const
+{
+	FILE *fp = fopen(szpath, "wb");
+	if (fp == NULL) return false;
+	size_t written = buffer_.empty() ? 0 : fwrite(&buffer_[0], 1, buffer_.size(), fp);
+	bool ok = (written == buffer_.size());
+	if (fclose(fp) != 0) ok = false;
+	return ok;
+}
@@ -0,0 +1,108 @@
+#ifndef _ROAD_LANE_XML_STREAM_H_
+#define _ROAD_LANE_XML_STREAM_H_
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+// Allocation free helpers for the RoadLane xml schema. The DOM path
+// (tinyxml2) stays the reference implementation; these are used by the
+// bulk paths that read or write whole datasets.
+
+// Number parsers for attribute values. [s, e) must not include the quotes.
+// Values with few significant digits are converted exactly without strtod.
+bool ParseLaneDouble(const char *s, const char *e, double *value);
+bool ParseLaneFloat(const char *s, const char *e, float *value);
+bool ParseLaneInt(const char *s, const char *e, int *value);
+bool ParseLaneBool(const char *s, const char *e, bool *value);
+
+// Reads a whole file into buffer (NUL terminated) with a single read.
+bool ReadLaneFileToBuffer(const char *szpath, std::vector<char> &buffer);
+
+// Shortest decimal text that parses back to the same value. buf needs 32 bytes.
+// Returns the text length.
+int FormatLaneDouble(char *buf, double value);
+int FormatLaneFloat(char *buf, float value);
+int FormatLaneInt(char *buf, int value);
+
+// Minimal pull parser: walks start/end tags of a NUL terminated buffer in
+// document order. Text, comments, declarations and doctypes are skipped.
+// A self closing element produces TOKEN_START followed by TOKEN_END.
+class LaneXmlPullParser
+{
+public:
+	enum Token {
+		TOKEN_START, TOKEN_END, TOKEN_EOF, TOKEN_ERROR
+	};
+	enum { MAX_ATTRIBUTES = 16 };
+
+	LaneXmlPullParser(const char *begin, const char *end);
+
+	Token Next();
+	int depth() const { return depth_; }
+	// bytes not parsed yet
+	size_t remaining() const { return end_ - cur_; }
+	bool IsElement(const char *name) const;
+
+	bool QueryIntAttribute(const char *name, int *value) const;
+	bool QueryDoubleAttribute(const char *name, double *value) const;
+	bool QueryFloatAttribute(const char *name, float *value) const;
+	bool QueryBoolAttribute(const char *name, bool *value) const;
+	// value with the entities of LaneXmlWriter decoded
+	bool QueryStringAttribute(const char *name, std::string *value) const;
+
+	// consumes the rest of the element returned by the last TOKEN_START,
+	// including its end tag
+	bool SkipElement();
+
+private:
+	struct Attribute {
+		const char *name;
+		size_t name_len;
+		const char *value;
+		const char *value_end;
+	};
+	const Attribute *FindAttribute(const char *name) const;
+	bool ParseTag();
+
+	const char *cur_, *end_;
+	const char *name_;
+	size_t name_len_;
+	Attribute attributes_[MAX_ATTRIBUTES];
+	int attribute_num_;
+	int depth_;
+	bool pending_end_;
+};
+
+// Direct to buffer writer producing the same layout as tinyxml2::XMLPrinter
+// (4 space indent, empty elements closed with "/>"). The buffer is kept
+// between documents so a writer reused for a batch stops allocating.
+class LaneXmlWriter
+{
+public:
+	LaneXmlWriter();
+
+	void Clear();
+	void OpenElement(const char *name);
+	void PushAttribute(const char *name, const char *value);
+	void PushAttribute(const char *name, int value);
+	void PushAttribute(const char *name, bool value);
+	void PushAttribute(const char *name, float value);
+	void PushAttribute(const char *name, double value);
+	void CloseElement();
+
+	const char *data() const { return buffer_.empty() ? "" : &buffer_[0]; }
+	size_t size() const { return buffer_.size(); }
+	// writes the buffer with a single fwrite
+	bool SaveFile(const char *szpath) const;
+
+private:
+	void Append(const char *str, size_t len) { buffer_.insert(buffer_.end(), str, str + len); }
+	void Append(const char *str);
+	void Indent(int depth);
+	void PushRawAttribute(const char *name, const char *value, int len);
+
+	std::vector<char> buffer_;
+	std::vector<const char *> stack_;
+	bool element_just_opened_;
+};
+#endif
@@ -1,7 +1,11 @@
 #include "stdafx.h"
 #include "PointingToolView.h"
 #include "regressor.h"
+#include "LaneMaskRasterizer.h"
+#include "LaneMaskExport.h"
+#include "RoadLaneJournal.h"
 #include <io.h>
+#include <map>
 #include <stack>
 
 bool comp(PPOINTF &a, PPOINTF &b) {
@@ -12,31 +16,16 @@ bool OcclusionStartYConstraint(LaneLine &line, float y, std::pair<float, float>
 	//1. 
 	if (line.top_y_ > y) { return false; }
 	if (line.bottom_y_ < y) { return false; }
-	for (int i = 0; i < line.info.occlusions_top_bottom_.size(); i++) {
-		if (line.info.occlusions_top_bottom_[i].first <= y &&
-			line.info.occlusions_top_bottom_[i].second >= y) {
-			return false;
-		}
-	}
+	std::shared_ptr<const LaneOcclusionSet> occlusions = line.Occlusions();
+	if (occlusions->IsOccluded(y)) { return false; }
 
+	// free range between the end of the occlusion above and the start of the one below
 	float top_y = line.top_y_;
 	float bottom_y = line.bottom_y_;
 
-	float min_dist_top = 100000.;
-	float min_dist_bottom = 100000.;
-
-	for (int i = 0; i < line.info.occlusions_top_bottom_.size(); i++) {
-		if (line.info.occlusions_top_bottom_[i].first - y > 0 &&
-			min_dist_top > line.info.occlusions_top_bottom_[i].first - y) {
-			min_dist_top = line.info.occlusions_top_bottom_[i].first - y;
-			bottom_y = line.info.occlusions_top_bottom_[i].first;
-		}
-		if (y - line.info.occlusions_top_bottom_[i].first > 0 &&
-			min_dist_bottom > y - line.info.occlusions_top_bottom_[i].first) {
-			min_dist_bottom = y - line.info.occlusions_top_bottom_[i].first;
-			top_y = line.info.occlusions_top_bottom_[i].first;
-		}
-	}
+	int idx = occlusions->UpperBound(y);
+	if (idx > 0) top_y = (*occlusions)[idx - 1].second;
+	if (idx < occlusions->size()) bottom_y = (*occlusions)[idx].first;
 
 	constTopBottom = make_pair(top_y, bottom_y);
 
@@ -45,6 +34,80 @@ bool OcclusionStartYConstraint(LaneLine &line, float y, std::pair<float, float>
 
 
 
+// For the paint and hover paths: DrawSpline, MousePointOnSplineOcclusion and
+// OCCControlRegion only read the line but take LaneLine &, so hand them the
+// line of the const accessor; line_ptr would clone a line a copy shares.
+static LaneLine &ReadOnlyLine(const RoadLaneManager &road, int idx)
+{
+	return const_cast<LaneLine &>(road.line(idx));
+}
+
+// Undo / redo history of m_RoadLane (Ctrl+Z / Ctrl+Y), one per view, kept
+// here next to the edits that record it. Undo restores the whole manager, so
+// every edit of m_RoadLane records the state after it.
+struct SplineJournalEntry {
+	SplineJournalEntry() : hwnd(NULL) {}
+	HWND hwnd;                       // window of the view the history belongs to
+	RoadLaneJournal journal;
+};
+
+static RoadLaneJournal &SplineJournal(const CPointingToolView *view)
+{
+	static std::map<const CPointingToolView *, SplineJournalEntry> journals;
+	// histories of destroyed views are dropped; a view created at the address
+	// of a destroyed one has another window, so it starts with no history
+	for (auto it = journals.begin(); it != journals.end();) {
+		if (it->first != view && !::IsWindow(it->second.hwnd))
+			it = journals.erase(it);
+		else
+			++it;
+	}
+	SplineJournalEntry &entry = journals[view];
+	if (entry.hwnd != view->GetSafeHwnd()) {
+		entry.hwnd = view->GetSafeHwnd();
+		entry.journal.Clear();
+	}
+	return entry.journal;
+}
+
+// types and occlusions CSplineManagerDlg edits
+static bool SameLaneInfo(const LaneInfo &a, const LaneInfo &b)
+{
+	return a.type1 == b.type1 && a.type2 == b.type2 && a.type3 == b.type3 && a.type4 == b.type4 &&
+		a.type5 == b.type5 && a.type6 == b.type6 && a.occlusions_top_bottom_ == b.occlusions_top_bottom_;
+}
+
+template <typename LINE>
+static bool SameCurvePoints(const LINE &a, const LINE &b)
+{
+	return a.spline_x_ == b.spline_x_ && a.spline_y_ == b.spline_y_ && a.line_r_ == b.line_r_;
+}
+
+// everything the tool edits, to find edits of m_RoadLane that were not recorded
+static bool SameRoadLane(const RoadLaneManager &a, const RoadLaneManager &b)
+{
+	if (a.has_vp() != b.has_vp() || a.vp_x_ratio() != b.vp_x_ratio() || a.vp_y_ratio() != b.vp_y_ratio() ||
+		a.GetSizeLaneLine() != b.GetSizeLaneLine() || a.GetSizeBoundary() != b.GetSizeBoundary() ||
+		a.GetSizeRoadMarking() != b.GetSizeRoadMarking()) return false;
+	for (int i = 0; i < a.GetSizeLaneLine(); i++) {
+		if (!SameLaneInfo(a.line(i).info, b.line(i).info) || !SameCurvePoints(a.line(i), b.line(i))) return false;
+	}
+	for (int i = 0; i < a.GetSizeBoundary(); i++) {
+		const BoundaryInfo &x = a.boundary(i).info, &y = b.boundary(i).info;
+		if (x.type3 != y.type3 || x.BoundaryType != y.BoundaryType || x.Situation != y.Situation ||
+			x.occlusions_top_bottom_ != y.occlusions_top_bottom_ || !SameCurvePoints(a.boundary(i), b.boundary(i))) return false;
+	}
+	for (int i = 0; i < a.GetSizeRoadMarking(); i++) {
+		if (a.roadmarking(i).GetRoadMarkerInfo().type != b.roadmarking(i).GetRoadMarkerInfo().type) return false;
+		const vector<PPOINTF> &p = a.roadmarking(i).points(), &q = b.roadmarking(i).points();
+		if (p.size() != q.size()) return false;
+		for (size_t k = 0; k < p.size(); k++) {
+			if (p[k].x != q[k].x || p[k].y != q[k].y) return false;
+		}
+	}
+	return true;
+}
+
 bool OCCControlRegion(LaneLine &line, PPOINTF img_point, int &idx, int &top0_bottom1) {
 	for (int i = 0; i < line.info.occlusions_top_bottom_.size(); i++) {
 		PPOINT3F point = line.EstimatePoint(line.info.occlusions_top_bottom_[i].first);
@@ -102,16 +165,16 @@ void CPointingToolView::MouseMoveSpline(const CPoint &point)
 
 		if (m_bCheckOcclusion) {
 			if (m_nSplineMouseOver != -1)
-				m_nOccMouseOver = MousePointOnSplineOcclusion(*m_RoadLane.line_ptr(m_nSplineMouseOver), point);
+				m_nOccMouseOver = MousePointOnSplineOcclusion(ReadOnlyLine(m_RoadLane, m_nSplineMouseOver), point);
 			int top0_bottom1;
 			int idx;
 			if (m_bLDownOcclusion) {
 				if (occConstTopBottom.first < ipt.y && occConstTopBottom.second > ipt.y) {
-					occEnd = m_RoadLane.line_ptr(m_nSplineMouseOver)->EstimatePoint(ipt.y);
+					occEnd = m_RoadLane.line(m_nSplineMouseOver).EstimatePoint(ipt.y);
 				}
 			}
 			else if (m_nSplineMouseOver != -1 &&
-				OCCControlRegion(*m_RoadLane.line_ptr(m_nSplineMouseOver), ipt, idx, top0_bottom1)) {
+				OCCControlRegion(ReadOnlyLine(m_RoadLane, m_nSplineMouseOver), ipt, idx, top0_bottom1)) {
 				m_bOccControlPoint = true;
 			}
 		}
@@ -145,10 +208,10 @@ void CPointingToolView::LButtonDownSpline(const CPoint &point)
 				int idx;
 				int top0_bottom1;
 				if (OCCControlRegion(*m_RoadLane.line_ptr(m_nSplineMouseOver), ipt, idx, top0_bottom1)) {
-					PPOINT3F pt1 = m_RoadLane.line_ptr(m_nSplineMouseOver)->EstimatePoint(
-						m_RoadLane.line_ptr(m_nSplineMouseOver)->info.occlusions_top_bottom_[idx].first);
-					PPOINT3F pt2 = m_RoadLane.line_ptr(m_nSplineMouseOver)->EstimatePoint(
-						m_RoadLane.line_ptr(m_nSplineMouseOver)->info.occlusions_top_bottom_[idx].second);
+					PPOINT3F pt1 = m_RoadLane.line(m_nSplineMouseOver).EstimatePoint(
+						m_RoadLane.line(m_nSplineMouseOver).info.occlusions_top_bottom_[idx].first);
+					PPOINT3F pt2 = m_RoadLane.line(m_nSplineMouseOver).EstimatePoint(
+						m_RoadLane.line(m_nSplineMouseOver).info.occlusions_top_bottom_[idx].second);
 
 					if (top0_bottom1 == 0) {
 						occEnd = pt1;
@@ -166,7 +229,7 @@ void CPointingToolView::LButtonDownSpline(const CPoint &point)
 			}
 			else if (OcclusionStartYConstraint(*line, ipt.y, occConstTopBottom)) {
 				m_bLDownOcclusion = true;
-				occStart = occEnd = m_RoadLane.line_ptr(m_nSplineMouseOver)->EstimatePoint(ipt.y);
+				occStart = occEnd = m_RoadLane.line(m_nSplineMouseOver).EstimatePoint(ipt.y);
 				occEnd = occStart;
 			}
 		}
@@ -178,7 +241,7 @@ void CPointingToolView::LButtonDownSpline(const CPoint &point)
 		if (sel_spline != -1) {
 			m_nSelSpline = sel_spline;
 			m_WorkingSplineLine.Reset();
-			LaneLine &line = *m_RoadLane.line_ptr(m_nSelSpline);
+			const LaneLine &line = m_RoadLane.line(m_nSelSpline);
 			for (int i = 0; i < line.spline_x_.size(); i++) {
 				PPOINT3F ipoint3(line.spline_x_[i], line.spline_y_[i], line.line_r_[i]);
 				m_WorkingSplineLine.AddPoint3(ipoint3);
@@ -212,15 +275,30 @@ void CPointingToolView::LButtonDownSpline(const CPoint &point)
 }
 
 void CPointingToolView::LButtonUpSpline(const CPoint &point) {
-	m_bLDownVP = false;
+	if (m_bLDownVP) {
+		m_bLDownVP = false;
+		const RoadLaneManager &recorded = SplineJournal(this).current();
+		if (m_RoadLane.has_vp() != recorded.has_vp() || m_RoadLane.vp_x_ratio() != recorded.vp_x_ratio() ||
+			m_RoadLane.vp_y_ratio() != recorded.vp_y_ratio())
+			SplineJournal(this).Record(m_RoadLane, "vanishing point");
+	}
 	if (m_bLDownOcclusion) {
 		PPOINTF ipt = mapv2i(PPOINTF(point.x, point.y));
 		LaneLine &line = *m_RoadLane.line_ptr(m_nSplineMouseOver);
 		if (occConstTopBottom.first < ipt.y && occConstTopBottom.second > ipt.y) {
-			occEnd = m_RoadLane.line_ptr(m_nSplineMouseOver)->EstimatePoint(ipt.y);
+			occEnd = m_RoadLane.line(m_nSplineMouseOver).EstimatePoint(ipt.y);
 		}
-		if (abs(occStart.y - occEnd.y) > 1)
+		const RoadLaneManager &recorded = SplineJournal(this).current();
+		if (abs(occStart.y - occEnd.y) > 1) {
 			line.info.occlusions_top_bottom_.push_back(std::make_pair(std::min(occStart.y, occEnd.y), std::max(occStart.y, occEnd.y)));
+			SplineJournal(this).Record(m_RoadLane, "occlusion");
+		}
+		else if (m_nSplineMouseOver < recorded.GetSizeLaneLine() &&
+			line.info.occlusions_top_bottom_ != recorded.line(m_nSplineMouseOver).info.occlusions_top_bottom_) {
+			// an occlusion grabbed on button down (and erased there) let go
+			// with no height
+			SplineJournal(this).Record(m_RoadLane, "remove occlusion");
+		}
 
 		m_bLDownOcclusion = false;
 		//DrawSplines(point);
@@ -278,6 +356,8 @@ void CPointingToolView::RButtonUpSpline(const CPoint &point)
 					GetClientRect(rect);
 					dlg.left_oriented = rect.Width() * 0.5 < point.x ? false : true;
 					dlg.DoModal();
+					if (!SameLaneInfo(dlg.m_spline->info, SplineJournal(this).current().line(sel_id).info))
+						SplineJournal(this).Record(m_RoadLane, "lane types");
 
 					if (dlg.m_spline->info.GetType2() == LaneInfo::SINGLE
 						&& dlg.m_spline->info.GetType3() != LaneInfo::UNCERTAIN
@@ -285,10 +365,11 @@ void CPointingToolView::RButtonUpSpline(const CPoint &point)
 						for (int i = 0; i < m_RoadLane.GetSizeLaneLine(); i++) {
 							if (i == sel_id)
 								continue;
-							if (m_RoadLane.line(i).info.GetType3() == dlg.m_spline->info.GetType3()
-								&& m_RoadLane.line(i).info.GetType3_ID() == dlg.m_spline->info.GetType3_ID()
-								&& m_RoadLane.line(i).info.GetType2() == dlg.m_spline->info.GetType2()
-								&& m_RoadLane.line(i).info.GetType4() == dlg.m_spline->info.GetType4()) {
+							const LaneInfo &other = m_RoadLane.line(i).info;
+							if (other.GetType3() == dlg.m_spline->info.GetType3()
+								&& other.GetType3_ID() == dlg.m_spline->info.GetType3_ID()
+								&& other.GetType2() == dlg.m_spline->info.GetType2()
+								&& other.GetType4() == dlg.m_spline->info.GetType4()) {
 								//AfxMessageBox(_T("Ÿ 3 ߺǾϴ."));
 							}
 						}
@@ -416,6 +497,23 @@ bool CPointingToolView::KeyDownSpline(UINT nChar, UINT nRepCnt, UINT nFlags) {
 	///////////////////////////////////////////////////////////////
 
 
+	if ((nChar == 90 || nChar == 89) && GetKeyState(VK_CONTROL) < 0) { // Ctrl+Z ǵ, Ctrl+Y ٽ 
+		RoadLaneJournal &journal = SplineJournal(this);
+		// an edit that was not recorded becomes an entry of its own, so Undo
+		// reverts it instead of dropping it
+		if (!SameRoadLane(m_RoadLane, journal.current()))
+			journal.Record(m_RoadLane, "edit");
+		if (nChar == 90 ? journal.Undo(m_RoadLane) : journal.Redo(m_RoadLane)) {
+			m_nSelSpline = -1;
+			m_nSelSplinePoint = -1;
+			m_nSplineMouseOver = -1;
+			m_nOccMouseOver = -1;
+			m_bControlSplinePoint = false;
+			m_WorkingSplineLine.Reset();
+		}
+		return true;
+	}
+
 	if (nChar == 88) {//x		
 		if (m_bControlSplinePoint == false && m_nSelSplinePoint >= 0 &&
 			m_nSelSplinePoint < m_WorkingSplineLine.element_size() &&
@@ -577,6 +675,8 @@ bool CPointingToolView::KeyDownSpline(UINT nChar, UINT nRepCnt, UINT nFlags) {
 				GetClientRect(rect);
 				dlg.left_oriented = rect.Width() * 0.5 < point.x ? false : true;
 				dlg.DoModal();
+				if (!SameLaneInfo(dlg.m_spline->info, SplineJournal(this).current().line(sel_id).info))
+					SplineJournal(this).Record(m_RoadLane, "lane types");
 
 				if (dlg.m_spline->info.GetType2() == LaneInfo::SINGLE
 					&& dlg.m_spline->info.GetType3() != LaneInfo::UNCERTAIN
@@ -584,10 +684,11 @@ bool CPointingToolView::KeyDownSpline(UINT nChar, UINT nRepCnt, UINT nFlags) {
 					for (int i = 0; i < m_RoadLane.GetSizeLaneLine(); i++) {
 						if (i == sel_id)
 							continue;
-						if (m_RoadLane.line(i).info.GetType3() == dlg.m_spline->info.GetType3()
-							&& m_RoadLane.line(i).info.GetType3_ID() == dlg.m_spline->info.GetType3_ID()
-							&& m_RoadLane.line(i).info.GetType2() == dlg.m_spline->info.GetType2()
-							&& m_RoadLane.line(i).info.GetType4() == dlg.m_spline->info.GetType4()) {
+						const LaneInfo &other = m_RoadLane.line(i).info;
+						if (other.GetType3() == dlg.m_spline->info.GetType3()
+							&& other.GetType3_ID() == dlg.m_spline->info.GetType3_ID()
+							&& other.GetType2() == dlg.m_spline->info.GetType2()
+							&& other.GetType4() == dlg.m_spline->info.GetType4()) {
 							AfxMessageBox(_T("Ÿ 3 ߺǾϴ."));
 						}
 					}
@@ -613,6 +714,7 @@ bool CPointingToolView::KeyDownSpline(UINT nChar, UINT nRepCnt, UINT nFlags) {
 				m_RoadLane.line_ptr(m_nSplineMouseOver)->info.occlusions_top_bottom_.erase(
 					m_RoadLane.line_ptr(m_nSplineMouseOver)->info.occlusions_top_bottom_.begin() + m_nOccMouseOver);
 				m_nOccMouseOver = -1;
+				SplineJournal(this).Record(m_RoadLane, "remove occlusion");
 			}
 		}
 		else if (m_nSelSplinePoint > -1 && m_WorkingSplineLine.element_size() > m_nSelSplinePoint) {
@@ -638,6 +740,7 @@ bool CPointingToolView::KeyDownSpline(UINT nChar, UINT nRepCnt, UINT nFlags) {
 		}
 		else if (m_nSplineMouseOver != -1) {
 			m_RoadLane.RemoveLine(m_nSplineMouseOver);
+			SplineJournal(this).Record(m_RoadLane, "remove lane");
 			m_nSplineMouseOver = -1;
 			m_nSelSpline = -1;
 			m_nSelSplinePoint = -1;
@@ -715,13 +818,14 @@ bool CPointingToolView::KeyDownSpline(UINT nChar, UINT nRepCnt, UINT nFlags) {
 			LaneLine line = m_WorkingSplineLine;
 			if (m_nSelSpline != -1) {
 				RefineOCCRegion(line);
-				m_RoadLane.ResetLine(line, m_nSelSpline);
+				m_RoadLane.ResetLine(std::move(line), m_nSelSpline);
 				m_nSelSpline = -1;
 			}
 			else {
-				m_RoadLane.AddLine(line);
+				m_RoadLane.AddLine(std::move(line));
 			}
 			m_WorkingSplineLine.Reset();
+			SplineJournal(this).Record(m_RoadLane, "lane");
 		}
 
 		m_bControlSplinePoint = false;
@@ -745,13 +849,14 @@ bool CPointingToolView::KeyDownSpline(UINT nChar, UINT nRepCnt, UINT nFlags) {
 			LaneLine line = m_WorkingSplineLine;
 			if (m_nSelSpline != -1) {
 				RefineOCCRegion(line);
-				m_RoadLane.ResetLine(line, m_nSelSpline);
+				m_RoadLane.ResetLine(std::move(line), m_nSelSpline);
 				m_nSelSpline = -1;
 			}
 			else {
-				m_RoadLane.AddLine(line);
+				m_RoadLane.AddLine(std::move(line));
 			}
 			m_WorkingSplineLine.Reset();
+			SplineJournal(this).Record(m_RoadLane, "lane");
 		}
 
 		m_bControlSplinePoint = false;
@@ -825,6 +930,7 @@ bool CPointingToolView::KeyDownSpline(UINT nChar, UINT nRepCnt, UINT nFlags) {
 				m_RoadLane.line_ptr(m_nSplineMouseOver)->info.occlusions_top_bottom_.erase(
 					m_RoadLane.line_ptr(m_nSplineMouseOver)->info.occlusions_top_bottom_.begin() + m_nOccMouseOver);
 				m_nOccMouseOver = -1;
+				SplineJournal(this).Record(m_RoadLane, "remove occlusion");
 			}
 		}
 		else if (m_nSelSplinePoint > -1 && m_WorkingSplineLine.element_size() > m_nSelSplinePoint) {
@@ -850,6 +956,7 @@ bool CPointingToolView::KeyDownSpline(UINT nChar, UINT nRepCnt, UINT nFlags) {
 		}
 		else if (m_nSplineMouseOver != -1) {
 			m_RoadLane.RemoveLine(m_nSplineMouseOver);
+			SplineJournal(this).Record(m_RoadLane, "remove lane");
 			m_nSplineMouseOver = -1;
 			m_nSelSpline = -1;
 			m_nSelSplinePoint = -1;
@@ -1001,27 +1108,18 @@ void CPointingToolView::DrawSpline(
 
 	double top_vy_ = mapi2v_y(line.top_y_);
 	double bottom_vy_ = mapi2v_y(line.bottom_y_);
-	std::vector<std::pair<float, float>> &occ = line.info.occlusions_top_bottom_;
+	std::shared_ptr<const LaneOcclusionSet> occlusions = line.Occlusions();
+	LaneOcclusionSet::Cursor occ(*occlusions);
 
 	for (int y = top_vy_; y <= bottom_vy_; y++) {
-		double ix = line.spline_xy_model_(mapv2i_y(y));
+		double iy = mapv2i_y(y);
+		double ix = line.spline_xy_model_(iy);
 		pts.push_back(PPOINTF(mapi2v_x(ix), y));
-		occlusion.push_back(false);
+		occlusion.push_back(occ.IsOccluded(iy));
 	}
 
 	if (pts.size() == 0) return;
 
-	for (int i = 0; i < occ.size(); i++) {
-		int occ_top_vy_ = std::lroundl(mapi2v_y(occ[i].first));
-		int occ_bottom_vy_ = std::lroundl(mapi2v_y(occ[i].second));
-
-		for (int y = occ_top_vy_; y <= occ_bottom_vy_; y++) {
-			int idx = y - top_vy_;
-			if (idx > 0 && idx < occlusion.size())
-				occlusion[idx] = true;
-		}
-	}
-
 	//int I_R = std::lroundl(g_view_scale * m_pImage->GetHeight() / 2);
 	//int center_x = std::lroundl(mapi2v_x(m_pImage->GetWidth()*0.5));
 	//int center_y = std::lroundl(mapi2v_y(m_pImage->GetHeight()*0.5));
@@ -1142,13 +1240,13 @@ void CPointingToolView::DrawSplines(const CPoint &point) {
 
 		}
 		else if (m_nSelSpline != i) {
-			DrawSpline(G, *m_RoadLane.line_ptr(i), pen_spline, pen_spline_r, pen_spline_r_expect, pen_marker, pen_occ, SolidBrush(Color(255, 0, 0)));
+			DrawSpline(G, ReadOnlyLine(m_RoadLane, i), pen_spline, pen_spline_r, pen_spline_r_expect, pen_marker, pen_occ, SolidBrush(Color(255, 0, 0)));
 		}
 	}
 	// 콺 ÷ 
 	for (int i = 0; i < m_RoadLane.GetSizeLaneLine(); i++) {
 		if (m_nSelSpline == -1 && m_WorkingSplineLine.element_size() == 0 && m_nSplineMouseOver == i) {
-			DrawSpline(G, *m_RoadLane.line_ptr(i), pen_spline_highlight, pen_spline_r, clr_spline_r_expect_highlight, pen_marker, pen_occ, SolidBrush(Color(0, 0, 255)));
+			DrawSpline(G, ReadOnlyLine(m_RoadLane, i), pen_spline_highlight, pen_spline_r, clr_spline_r_expect_highlight, pen_marker, pen_occ, SolidBrush(Color(0, 0, 255)));
 		}
 	}
 
@@ -1223,12 +1321,12 @@ void CPointingToolView::DrawSplines(Graphics &G, const CPoint &point)
 
 		}
 		else if (m_nSelSpline != i) {
-			DrawSpline(G, *m_RoadLane.line_ptr(i), pen_spline, pen_spline_r, pen_spline_r_expect, pen_marker, pen_occ, SolidBrush(Color(255, 0, 0)));
+			DrawSpline(G, ReadOnlyLine(m_RoadLane, i), pen_spline, pen_spline_r, pen_spline_r_expect, pen_marker, pen_occ, SolidBrush(Color(255, 0, 0)));
 		}
 	}
 	for (int i = 0; i < m_RoadLane.GetSizeLaneLine(); i++) {
 		if (m_nSelSpline == -1 && m_WorkingSplineLine.element_size() == 0 && m_nSplineMouseOver == i) {
-			DrawSpline(G, *m_RoadLane.line_ptr(i), pen_spline_highlight, pen_spline_r, clr_spline_r_expect_highlight, pen_marker, pen_occ, SolidBrush(Color(0, 0, 255)));
+			DrawSpline(G, ReadOnlyLine(m_RoadLane, i), pen_spline_highlight, pen_spline_r, clr_spline_r_expect_highlight, pen_marker, pen_occ, SolidBrush(Color(0, 0, 255)));
 		}
 	}
 
@@ -1309,15 +1407,7 @@ int CPointingToolView::MousePointOnSpline(const CPoint &point)
 	if (m_WorkingSplineLine.element_size()) return -1;
 	PPOINTF view_pt(point.x, point.y);
 	PPOINTF image_pt = mapv2i(view_pt);
-	for (int i = 0; i < m_RoadLane.GetSizeLaneLine(); i++) {
-		LaneLine &line = *m_RoadLane.line_ptr(i);
-		if (line.top_y_ > image_pt.y || line.bottom_y_ < image_pt.y) continue;
-		PPOINT3F point3 = line.EstimatePoint(image_pt.y);
-		if (fabs(point3.x - image_pt.x) < (point3.r + 1)) {
-			return i;
-		}
-	}
-	return -1;
+	return m_RoadLane.FindLineAt(image_pt);
 }
 
 int CPointingToolView::MousePointOnSplinePoint(const CPoint &point)
@@ -1389,6 +1479,8 @@ void CPointingToolView::LoadDataSpline()
 		WideCharToMultiByte(CP_ACP, 0, full_lane_path, 1024, ctemp, 1024, NULL, NULL);
 		m_RoadLane.ReadFile(ctemp);
 		m_BackupRoadLane = m_RoadLane;
+		SplineJournal(this).Clear();
+		SplineJournal(this).Record(m_RoadLane, "load");
 	}
 }
 void CPointingToolView::SaveDataSpline()
@@ -1444,23 +1536,17 @@ void CPointingToolView::DrawSplineToMask(RoadLaneManager &lane, Graphics &G, int
 	}
 
 	for (int i = 0; i < lane.GetSizeLaneLine(); i++) {
-		LaneLine &line = *lane.line_ptr(i);
+		const LaneLine &line = lane.line(i);
 		vector<PointF> pts;
 		std::vector<PPOINTF> xy;
 		std::vector<PPOINTF> wy;
 		std::vector<bool> occlusions;
+		std::shared_ptr<const LaneRowRaster> raster = line.RowRaster(height);
 		for (int y = line.top_y_; y <= line.bottom_y_; y++) {
-			bool occlusion = false;
-			for (int k = 0; k < line.info.occlusions_top_bottom_.size(); k++) {
-				if (y >= line.info.occlusions_top_bottom_[k].first &&
-					y <= line.info.occlusions_top_bottom_[k].second) {
-					occlusion = true;
-					break;
-				}
-			}
-			occlusions.push_back(occlusion);
-			double ix = line.spline_xy_model_(y);
-			pts.push_back(PPOINTF(ix, y));
+			// rows off the mask are not drawn
+			if (y < raster->top_y || y >= height) continue;
+			occlusions.push_back(raster->row_occluded(y));
+			pts.push_back(PPOINTF(raster->row_x(y), y));
 		}
 
 		Color clr_spline = MakeColor(color_value);
@@ -1469,7 +1555,7 @@ void CPointingToolView::DrawSplineToMask(RoadLaneManager &lane, Graphics &G, int
 		Pen pen_spline_occ(clr_occlusion, 1);
 		color_value += COLOR_ID_STEP;
 		for (int i = 0; i < pts.size(); i++) {
-			double r = line.spline_ry_model_(pts[i].Y);
+			double r = raster->row_r((int)pts[i].Y);
 			double lx = pts[i].X - r;
 			double rx = pts[i].X + r;
 			if (occlusions[i]) {
@@ -1480,7 +1566,7 @@ void CPointingToolView::DrawSplineToMask(RoadLaneManager &lane, Graphics &G, int
 			}
 
 			if (i > 0 && pts[i].Y - pts[i - 1].Y < 3) {
-				double r_prev = line.spline_ry_model_(pts[i - 1].Y);
+				double r_prev = raster->row_r((int)pts[i - 1].Y);
 				double prev_lx = pts[i - 1].X - r_prev;
 				double prev_rx = pts[i - 1].X + r_prev;
 				double overlap_ratio = (std::min(prev_rx, rx) - std::max(prev_lx, lx)) /
@@ -1548,67 +1634,128 @@ void CPointingToolView::SaveSplineMaskImage()
 void CPointingToolView::SaveSplineMaskImageAll()
 {
 	TCHAR full_img_path[1024];
-	TCHAR full_mask_path[1024];
 	TCHAR full_lane_path[1024];
-
+	TCHAR full_mask_path[1024];
+	TCHAR full_xml_path[1024];
+	TCHAR full_manifest_path[1024];
+	TCHAR full_folder_path[1024];
+	char ctemp[1024];
+
+	// a TypeData xml per frame, as SaveSplineMaskImage writes it. The types
+	// of all frames in one manifest (lane_type_manifest.hpp) instead, when
+	// the MaskExport\TypeManifest profile setting is on.
+	bool type_manifest = AfxGetApp()->GetProfileInt(_T("MaskExport"), _T("TypeManifest"), 0) != 0;
+	if (!type_manifest) {
+		_stprintf(full_folder_path, _T("%s\\TypeData"), g_pToolView->m_strMaskFolder.GetBuffer());
+		CreateDirectory(full_folder_path, NULL);
+	}
+	_stprintf(full_folder_path, _T("%s\\LaneData"), g_pToolView->m_strMaskFolder.GetBuffer());
+	CreateDirectory(full_folder_path, NULL);
+
+	// png masks, as SaveSplineMaskImage writes them. Run length labels
+	// (lane_label_rle.hpp), which the UDB data layer reads without a png
+	// decode, only when the MaskExport\RunLength profile setting is on.
+	LaneMaskExportOptions options;
+	if (AfxGetApp()->GetProfileInt(_T("MaskExport"), _T("RunLength"), 0))
+		options.format = LANE_MASK_RLE;
+	// every frame is exported again, so masks follow label edits. Frames
+	// whose mask is newer than their lane xml are skipped only to continue
+	// an interrupted export, with the MaskExport\Resume profile setting on.
+	options.resume = AfxGetApp()->GetProfileInt(_T("MaskExport"), _T("Resume"), 0) != 0;
+	const TCHAR *mask_ext = options.format == LANE_MASK_RLE ? _T(".lrle") : _T(".png");
+
+	// mask size comes from the image header, else the image size stored in
+	// the lane xml; the image itself is never decoded. Frames without an
+	// image or a lane xml are skipped, as they always were.
+	vector<LaneMaskExportItem> items;
 	for (int i = 0; i < g_FileList.size(); i++) {
 		CString fname = g_FileList[i].first;
-		//CString mask_fname = fname;
-		CString lane_fname;
+		CString lane_fname = fname.Left(fname.ReverseFind('.')) + _T(".xml");
+		CString mask_fname = fname.Left(fname.ReverseFind('.')) + mask_ext;
 		_stprintf(full_img_path, _T("%s/%s"), g_pToolView->m_strImageFolder.GetBuffer(), fname.GetBuffer());
-		lane_fname = fname.Left(fname.ReverseFind('.')) + _T(".xml");
 		_stprintf(full_lane_path, _T("%s/%s"), g_pToolView->m_strMaskFolder.GetBuffer(), lane_fname.GetBuffer());
-		/*mask_fname = mask_fname.Left(mask_fname.ReverseFind('.')) + _T(".png");
-		_stprintf(full_mask_path, _T("%s/%s"), g_pToolView->m_strMaskFolder.GetBuffer(), mask_fname.GetBuffer());		*/
-
-		Bitmap *pImage = LoadImgFromFile(full_img_path);
-
-		if (pImage) {
-			char ctemp[1024];
-			WideCharToMultiByte(CP_ACP, 0, full_lane_path, 1024, ctemp, 1024, NULL, NULL);
-			RoadLaneManager road_lane;
-
-			int w = pImage->GetWidth(), h = pImage->GetHeight();
-			Bitmap mask_bmp(w, h, PixelFormat24bppRGB);
-			Graphics G(&mask_bmp);
-			G.Clear(Color(0, 0, 0));
-			if (road_lane.ReadFile(ctemp)) {
-				road_lane.SortingLength();
-				DrawRoadMarkingToMask(road_lane, mask_bmp);
-				DrawVPToMask(road_lane, mask_bmp);
-				// make type.xml path
-				char cfull_xml_path[256];
-				TCHAR full_xml_path[256];
-				TCHAR full_xml_folder_path[256];
-				CString xml_fname = fname;
-				xml_fname = xml_fname.Left(xml_fname.ReverseFind('.')) + _T(".xml");
-				_stprintf(full_xml_folder_path, _T("%s\\TypeData"), g_pToolView->m_strMaskFolder.GetBuffer());
-				CreateDirectory(full_xml_folder_path, NULL);
-				_stprintf(full_xml_path, _T("%s\\TypeData\\%s"), g_pToolView->m_strMaskFolder.GetBuffer(), xml_fname.GetBuffer());
-				WideCharToMultiByte(CP_ACP, 0, full_xml_path, 256, cfull_xml_path, 256, NULL, NULL);
-				// draw lane boundary mask
-				DrawLaneBoundaryToMask(road_lane, mask_bmp, cfull_xml_path);
-				// save mask
-				CString mask_fname = fname;
-				mask_fname = mask_fname.Left(mask_fname.ReverseFind('.')) + _T(".png");
-				TCHAR full_mask_path[256];
-				TCHAR full_original_path[256];
-				TCHAR full_folder_path[256];
-				_stprintf(full_folder_path, _T("%s\\LaneData"), g_pToolView->m_strMaskFolder.GetBuffer());
-				_stprintf(full_mask_path, _T("%s\\LaneData\\%s"), g_pToolView->m_strMaskFolder.GetBuffer(), mask_fname.GetBuffer());
-				_stprintf(full_original_path, _T("%s\\LaneData\\%s"), g_pToolView->m_strMaskFolder.GetBuffer(), fname.GetBuffer());
-				CreateDirectory(full_folder_path, NULL);
-				CLSID clsid;
-				GetEncCLSID(L"image/png", &clsid);
-				mask_bmp.Save(full_mask_path, &clsid, NULL);
-				//GetEncCLSID(L"image/jpg", &clsid);
-				//pImage->Save(full_original_path, &clsid, NULL);
-
+		_stprintf(full_mask_path, _T("%s\\LaneData\\%s"), g_pToolView->m_strMaskFolder.GetBuffer(), mask_fname.GetBuffer());
+		if (_taccess(full_img_path, 0) != 0 || _taccess(full_lane_path, 0) != 0)
+			continue;
+		LaneMaskExportItem item;
+		WideCharToMultiByte(CP_ACP, 0, full_lane_path, 1024, ctemp, 1024, NULL, NULL);
+		item.xml_path = ctemp;
+		WideCharToMultiByte(CP_ACP, 0, full_mask_path, 1024, ctemp, 1024, NULL, NULL);
+		item.mask_path = ctemp;
+		if (!type_manifest) {
+			_stprintf(full_xml_path, _T("%s\\TypeData\\%s"), g_pToolView->m_strMaskFolder.GetBuffer(), lane_fname.GetBuffer());
+			WideCharToMultiByte(CP_ACP, 0, full_xml_path, 1024, ctemp, 1024, NULL, NULL);
+			item.type_path = ctemp;
+		}
+		CString frame_name = fname.Left(fname.ReverseFind('.'));
+		WideCharToMultiByte(CP_ACP, 0, frame_name.GetBuffer(), -1, ctemp, 1024, NULL, NULL);
+		item.type_key = ctemp;
+		WideCharToMultiByte(CP_ACP, 0, full_img_path, 1024, ctemp, 1024, NULL, NULL);
+		item.image_path = ctemp;
+		items.push_back(item);
+	}
+
+	// The layers GDI+ draws in SaveSplineMaskImage (road markings, boundary
+	// segments) and the png encoder run on the worker threads, each through
+	// its own Bitmap over the worker's pixels; GDI+ objects are not shared
+	// between threads.
+	struct MaskExport {
+		CPointingToolView *view;
+		CLSID png_clsid;
+
+		static bool DrawRoadMarking(const RoadLaneManager &road, LaneMaskBuffer &mask, void *user) {
+			Bitmap mask_bmp(mask.width, mask.height, mask.stride, PixelFormat24bppRGB, mask.data);
+			if (mask_bmp.GetLastStatus() != Ok) return false;
+			RoadLaneManager road_lane = road;
+			((MaskExport *)user)->view->DrawRoadMarkingToMask(road_lane, mask_bmp);
+			return mask_bmp.GetLastStatus() == Ok;
+		}
+		static bool DrawBoundarySeg(const BoundaryLine &boundary, int id, float width, LaneMaskBuffer &mask, void *user) {
+			Bitmap mask_bmp(mask.width, mask.height, mask.stride, PixelFormat24bppRGB, mask.data);
+			if (mask_bmp.GetLastStatus() != Ok) return false;
+			BoundaryLine line = boundary;
+			((MaskExport *)user)->view->DrawBoundarySegToMask(line, id, mask_bmp, width);
+			return mask_bmp.GetLastStatus() == Ok;
+		}
+		static bool EncodePng(const LaneMaskBuffer &mask, vector<unsigned char> &png, void *user) {
+			Bitmap mask_bmp(mask.width, mask.height, mask.stride, PixelFormat24bppRGB, mask.data);
+			IStream *stream = NULL;
+			if (mask_bmp.GetLastStatus() != Ok || CreateStreamOnHGlobal(NULL, TRUE, &stream) != S_OK) return false;
+			bool ok = mask_bmp.Save(stream, &((MaskExport *)user)->png_clsid, NULL) == Ok;
+			HGLOBAL memory = NULL;
+			if (ok && GetHGlobalFromStream(stream, &memory) == S_OK) {
+				STATSTG stat;
+				ok = stream->Stat(&stat, STATFLAG_NONAME) == S_OK;
+				const unsigned char *bytes = ok ? (const unsigned char *)GlobalLock(memory) : NULL;
+				if (bytes) {
+					png.assign(bytes, bytes + (size_t)stat.cbSize.QuadPart);
+					GlobalUnlock(memory);
+				}
+				ok = bytes != NULL;
 			}
-			::delete pImage;
-			pImage = NULL;
-		}
-	}
+			else {
+				ok = false;
+			}
+			stream->Release();
+			return ok;
+		}
+	};
+	MaskExport mask_export;
+	mask_export.view = this;
+	GetEncCLSID(L"image/png", &mask_export.png_clsid);
+	if (type_manifest) {
+		_stprintf(full_manifest_path, _T("%s\\TypeData.ltm"), g_pToolView->m_strMaskFolder.GetBuffer());
+		WideCharToMultiByte(CP_ACP, 0, full_manifest_path, 1024, ctemp, 1024, NULL, NULL);
+		options.type_manifest_path = ctemp;
+	}
+	options.draw_road_marking = MaskExport::DrawRoadMarking;
+	options.draw_boundary = MaskExport::DrawBoundarySeg;
+	options.encode_png = MaskExport::EncodePng;
+	options.user = &mask_export;
+
+	LaneMaskExportStats stats;
+	ExportLaneMasks(items, options, stats);
+	stats.Print();
 }
 
 //Lane Mask Format
@@ -1618,15 +1765,23 @@ void CPointingToolView::SaveSplineMaskImageAll()
 //B: Color(2bit) + VP(0,64,128)(x,?,O)
 
 
-void CPointingToolView::DrawRoadMarkingToMask(RoadLaneManager &road, Bitmap &mask)
+// LockBits view of a 24 bpp mask for the LaneMaskRasterizer functions;
+// GDI+ keeps the pixels in B, G, R order like LaneMaskBuffer
+static LaneMaskBuffer LockLaneMask(Bitmap &mask, Gdiplus::BitmapData &data)
 {
-	int w = mask.GetWidth(), h = mask.GetHeight();
-	Rect rect(0, 0, w, h);
+	Rect rect(0, 0, mask.GetWidth(), mask.GetHeight());
+	mask.LockBits(&rect, Gdiplus::ImageLockModeRead | Gdiplus::ImageLockModeWrite, PixelFormat24bppRGB, &data);
+	return LaneMaskBuffer((BYTE *)data.Scan0, data.Width, data.Height, data.Stride);
+}
 
+// GDI+ FillPolygon stays the reference for road markings until
+// LaneMaskDrawRoadMarking has a golden comparison against it
+void CPointingToolView::DrawRoadMarkingToMask(RoadLaneManager &road, Bitmap &mask)
+{
 	Graphics G(&mask);
 	SolidBrush br(Color(0, 128, 0));
 	for (int i = 0; i < road.GetSizeRoadMarking(); i++) {
-		const RoadMarkingPolygon &polygons = *road.roadmarking_ptr(i);
+		const RoadMarkingPolygon &polygons = road.roadmarking(i);
 		if (polygons.GetPolygonPointNum())
 		{
 			std::vector<Gdiplus::PointF> points(polygons.GetPolygonPointNum());
@@ -1642,485 +1797,35 @@ void CPointingToolView::DrawRoadMarkingToMask(RoadLaneManager &road, Bitmap &mas
 
 void CPointingToolView::DrawVPToMask(RoadLaneManager &road, Bitmap &mask)
 {
-	Rect rt_vp;
-	int b;
-	int w = mask.GetWidth(), h = mask.GetHeight();
-	if (!road.has_vp()) {
-		b = 64;
-		rt_vp = Rect(0, 0, w, h);
-	}
-	else
-	{
-		b = 128;
-		int rt_width = w / 5;
-		int rt_height = h / 8;
-		if (road.IsZF())
-		{
-			rt_width = w / 8;
-			rt_height = h / 24;
-		}
-
-		int vpx = (int)std::round(road.vp_x_ratio() * w);
-		int vpy = (int)std::round(road.vp_y_ratio() * h);
-
-		rt_vp = Rect(vpx - rt_width / 2, vpy - rt_height / 2, rt_width, rt_height);
-	}
-
-	Rect rect(0, 0, w, h);
-
 	Gdiplus::BitmapData bmData_o;
-	mask.LockBits(&rect, Gdiplus::ImageLockModeWrite, PixelFormat24bppRGB, &bmData_o);
-	for (int y = max(0, rt_vp.Y); y < rt_vp.Y + rt_vp.Height && y < h; y++)
-	{
-		for (int x = max(0, rt_vp.X); x < rt_vp.X + rt_vp.Width && x < w; x++)
-		{
-			BYTE *pbyte = (BYTE *)bmData_o.Scan0;
-			pbyte[y*bmData_o.Stride + x * 3] = b;
-		}
-	}
+	LaneMaskBuffer buffer = LockLaneMask(mask, bmData_o);
+	LaneMaskDrawVP(road, buffer);
 	mask.UnlockBits(&bmData_o);
 }
 
-bool compareLaneType(LaneLine l0, LaneLine l1)
-{
-	LaneInfo info0 = l0.info;
-	LaneInfo info1 = l1.info;
-
-	if (info0.GetType3() == info1.GetType3() && info0.GetType4() == info1.GetType4() && info0.GetType3_ID() == info1.GetType3_ID())
-	{
-		if (info0.GetType2() == LaneInfo::DOUBLE)
-			return true;
-		return false;
-	}
-
-	if (info0.GetType3() == LaneInfo::UNCERTAIN)
-	{
-		return true;
-	}
-	else if (info1.GetType3() == LaneInfo::UNCERTAIN)
-	{
-		return false;
-	}
-
-	if (info0.GetType4() == LaneInfo::OPPOSITE_SIDE)
-	{
-		return true;
-	}
-	else if (info1.GetType4() == LaneInfo::OPPOSITE_SIDE)
-	{
-		return false;
-	}
-
-	if (info0.GetType4() == LaneInfo::BRANCH || info0.GetType4() == LaneInfo::MERGED)
-	{
-		return true;
-	}
-	else if (info1.GetType4() == LaneInfo::BRANCH || info1.GetType4() == LaneInfo::MERGED)
-	{
-		return false;
-	}
-
-	return true;
-}
-
 int CPointingToolView::DrawLaneToMask(RoadLaneManager &road, Bitmap &mask)
 {
-	static int max_id = 0;
-	int sl_count = 0;
-	int dl_count = 0;
-	vector<LaneLine> lines;
-	static int img_id = 0;
-	img_id++;
-	for (int i = 0; i < road.GetSizeLaneLine(); i++)
-	{
-
-		LaneInfo info = road.line_ptr(i)->info;
-		if (LaneInfo::SOLID <= info.GetType1() && info.GetType1() <= LaneInfo::CATS_EYE && LaneInfo::SINGLE <= info.GetType2() && info.GetType2() <= LaneInfo::ACCESSORIE && LaneInfo::LEFT <= info.GetType3() && info.GetType3() <= LaneInfo::UNCERTAIN && LaneInfo::C4_NONE <= info.GetType4() && info.GetType4() <= LaneInfo::OPPOSITE_SIDE)
-		{
-			if (info.GetType4() != LaneInfo::UNABLE)
-			{
-				lines.push_back(*(road.line_ptr(i)));
-			}
-		}
-	}
-
-	for (int i = 0; i < lines.size(); i++)
-	{
-		int select_idx = i;
-		for (int j = i + 1; j < lines.size(); j++)
-		{
-			if (compareLaneType(lines[j], lines[select_idx]))
-				select_idx = j;
-		}
-		LaneLine temp = lines[i];
-		lines[i] = lines[select_idx];
-		lines[select_idx] = temp;
-	}
-
-	for (int i = 0; i < lines.size(); i++)
-	{
-		int id = -1;
-
-		LaneInfo info = lines[i].info;
-		if (info.GetType2() == LaneInfo::SINGLE)
-			id = 1 + 2 * sl_count++;
-		else
-			id = 2 * (1 + dl_count++);
-
-		DrawLineToMask(lines[i], id, mask);
-	}
+	Gdiplus::BitmapData bmData_o;
+	LaneMaskBuffer buffer = LockLaneMask(mask, bmData_o);
+	LaneMaskDrawLanes(road, buffer);
+	mask.UnlockBits(&bmData_o);
 	return 1;
 }
 
 void CPointingToolView::DrawLineAsRoadMarkerToMask(LaneLine &line, Bitmap &mask) {
-	int w = mask.GetWidth(), h = mask.GetHeight();
-	Rect rect(0, 0, w, h);
-
 	Gdiplus::BitmapData bmData_o;
-	mask.LockBits(&rect, Gdiplus::ImageLockModeWrite, PixelFormat24bppRGB, &bmData_o);
-	vector<PointF> pts;
-
-	int top_y = std::max((int)std::round(line.top_y_), 0);
-	int bottom_y = std::min((int)std::round(line.bottom_y_), h - 1);
-
-	for (int y = top_y; y <= bottom_y; y++) {
-		double ix = line.spline_xy_model_(y);
-		pts.push_back(PPOINTF(ix, y));
-	}
-	int y = top_y;
-	BYTE *pbyte = (BYTE *)bmData_o.Scan0 + y * bmData_o.Stride;
-	int prev_lx, prev_rx;
-	for (int i = 0; i < pts.size(); i++) {
-		double r = line.spline_ry_model_(pts[i].Y);
-		int lx = std::round(pts[i].X - r);
-		int rx = std::round(pts[i].X + r);
-		for (int j = lx; j <= rx; j++) {
-			if (j < 0 || j > w - 1) continue;
-			if (pbyte[j * 3 + 1] < 128)
-				pbyte[j * 3 + 1] += 128;
-		}
-		if (i) {
-			double overlap_ratio = (std::min(prev_lx, rx) - std::max(prev_lx, lx)) /
-				(double)(std::max(prev_rx, rx) - std::min(prev_lx, lx));
-			if (overlap_ratio <= 0) {
-				if (prev_lx > rx) {
-					for (int j = prev_lx; j <= rx; j++) {
-						if (j < 0 || j > w - 1) continue;
-						if (pbyte[j * 3 + 1] < 128)
-							pbyte[j * 3 + 1] += 128;
-					}
-				}
-				else {
-					for (int j = prev_lx; j <= rx; j++) {
-						if (j < 0 || j > w - 1) continue;
-						if (pbyte[j * 3 + 1] < 128)
-							pbyte[j * 3 + 1] += 128;
-					}
-				}
-			}
-		}
-		prev_lx = lx;
-		prev_rx = rx;
-		pbyte += bmData_o.Stride;
-	}
+	LaneMaskBuffer buffer = LockLaneMask(mask, bmData_o);
+	LaneMaskDrawLineAsRoadMarker(line, buffer);
 	mask.UnlockBits(&bmData_o);
 }
+
 void CPointingToolView::DrawLineToMask(LaneLine &line, int id, Bitmap &mask)
 {
-	int w = mask.GetWidth(), h = mask.GetHeight();
-	Rect rect(0, 0, w, h);
-
 	Gdiplus::BitmapData bmData_o;
-	mask.LockBits(&rect, Gdiplus::ImageLockModeWrite, PixelFormat24bppRGB, &bmData_o);
-	vector<PointF> pts;
-	std::vector<PPOINTF> xy;
-	std::vector<PPOINTF> wy;
-	std::vector<bool> occlusions;
-
-	int typePos = 0;
-	int typeShape = 0;
-	LaneInfo info = line.info;
-
-	if (info.GetType4() == LaneInfo::OPPOSITE_SIDE && info.GetType3() == LaneInfo::LEFT)
-		typePos = 0;
-	else if (info.GetType4() == LaneInfo::BRANCH)
-		typePos = 1;
-	else if (info.GetType4() == LaneInfo::C4_NONE && info.GetType3() == LaneInfo::LEFT && info.GetType3_ID() == 3)
-		typePos = 2;
-	else if (info.GetType4() == LaneInfo::C4_NONE && info.GetType3() == LaneInfo::LEFT && info.GetType3_ID() == 2)
-		typePos = 3;
-	else if (info.GetType4() == LaneInfo::C4_NONE && info.GetType3() == LaneInfo::LEFT && info.GetType3_ID() == 1)
-		typePos = 4;
-	else if (info.GetType4() == LaneInfo::C4_NONE && info.GetType3() == LaneInfo::LEFT && info.GetType3_ID() == 0)
-		typePos = 5;
-	else if (info.GetType4() == LaneInfo::C4_NONE && info.GetType3() == LaneInfo::RIGHT && info.GetType3_ID() == 0)
-		typePos = 6;
-	else if (info.GetType4() == LaneInfo::C4_NONE && info.GetType3() == LaneInfo::RIGHT && info.GetType3_ID() == 1)
-		typePos = 7;
-	else if (info.GetType4() == LaneInfo::C4_NONE && info.GetType3() == LaneInfo::RIGHT && info.GetType3_ID() == 2)
-		typePos = 8;
-	else if (info.GetType4() == LaneInfo::C4_NONE && info.GetType3() == LaneInfo::RIGHT && info.GetType3_ID() == 3)
-		typePos = 9;
-	else if (info.GetType4() == LaneInfo::MERGED)
-		typePos = 10;
-	else if (info.GetType4() == LaneInfo::OPPOSITE_SIDE && info.GetType3() == LaneInfo::RIGHT)
-		typePos = 11;
-	else  //uncertain
-		typePos = 12;
-
-	typeShape = info.GetType1() - 1;
-
-	int green = (typeShape << 5) + typePos;
-
-	int blue = info.GetType5() - 1;
-
-
-	int top_y = std::max((int)std::round(line.top_y_), 0);
-	int bottom_y = std::min((int)std::round(line.bottom_y_), h - 1);
-
-	bool b_ext = (4 <= typePos && typePos <= 7);
-	for (int y = top_y; y <= (b_ext ? (h - 1) : bottom_y); y++) {
-		bool occlusion = false;
-		for (int k = 0; k < line.info.occlusions_top_bottom_.size(); k++) {
-			if (y >= line.info.occlusions_top_bottom_[k].first &&
-				y <= line.info.occlusions_top_bottom_[k].second) {
-				occlusion = true;
-				break;
-			}
-		}
-		occlusions.push_back(occlusion);
-		double ix = line.spline_xy_model_(y);
-		pts.push_back(PPOINTF(ix, y));
-	}
-	int y = top_y;
-	BYTE *pbyte = (BYTE *)bmData_o.Scan0 + y * bmData_o.Stride;
-	int prev_lx, prev_rx;
-	for (int i = 0; i < pts.size(); i++) {
-		double r = line.spline_ry_model_(pts[i].Y);
-		int lx = std::round(pts[i].X - r);
-		int rx = std::round(pts[i].X + r);
-		for (int j = lx; j <= rx; j++) {
-			if (j < 0 || j > w - 1) continue;
-			int id_ = id;
-			if (occlusions[i])
-				id_ += 128;
-			if (pts[i].Y > bottom_y)
-				id_ += 64;
-			pbyte[j * 3 + 2] = id_;
-
-			if (128 <= pbyte[j * 3 + 1])
-				pbyte[j * 3 + 1] = green + 128;
-			else
-				pbyte[j * 3 + 1] = green;
-
-			if (128 <= pbyte[j * 3])
-				pbyte[j * 3] = blue + 128;
-			else if (64 <= pbyte[j * 3])
-				pbyte[j * 3] = blue + 64;
-			else
-				pbyte[j * 3] = blue;
-		}
-		if (i) {
-			double r_prev = line.spline_ry_model_(pts[i - 1].Y);
-			double overlap_ratio = (std::min(prev_lx, rx) - std::max(prev_lx, lx)) /
-				(double)(std::max(prev_rx, rx) - std::min(prev_lx, lx));
-			if (overlap_ratio <= 0) {
-				if (prev_lx > rx) {
-					for (int j = prev_lx; j <= rx; j++) {
-						if (j < 0 || j > w - 1) continue;
-						int id_ = id;
-						if (occlusions[i])
-							id_ += 128;
-						if (pts[i].Y > bottom_y)
-							id_ += 64;
-						pbyte[j * 3 + 2] = id_;
-
-						if (128 <= pbyte[j * 3 + 1])
-							pbyte[j * 3 + 1] = green + 128;
-						else
-							pbyte[j * 3 + 1] = green;
-
-						if (128 <= pbyte[j * 3])
-							pbyte[j * 3] = blue + 128;
-						else if (64 <= pbyte[j * 3])
-							pbyte[j * 3] = blue + 64;
-						else
-							pbyte[j * 3] = blue;
-					}
-				}
-				else {
-					for (int j = prev_lx; j <= rx; j++) {
-						if (j < 0 || j > w - 1) continue;
-						int id_ = id;
-						if (occlusions[i])
-							id_ += 128;
-						if (pts[i].Y > bottom_y)
-							id_ += 64;
-						pbyte[j * 3 + 2] = id_;
-
-						if (128 <= pbyte[j * 3 + 1])
-							pbyte[j * 3 + 1] = green + 128;
-						else
-							pbyte[j * 3 + 1] = green;
-
-						if (128 <= pbyte[j * 3])
-							pbyte[j * 3] = blue + 128;
-						else if (64 <= pbyte[j * 3])
-							pbyte[j * 3] = blue + 64;
-						else
-							pbyte[j * 3] = blue;
-					}
-				}
-			}
-		}
-		prev_lx = lx;
-		prev_rx = rx;
-		pbyte += bmData_o.Stride;
-	}
+	LaneMaskBuffer buffer = LockLaneMask(mask, bmData_o);
+	LaneMaskDrawLine(line, id, buffer);
 	mask.UnlockBits(&bmData_o);
 }
-LineTypes GetLineTypes(LaneInfo info, int id) {
-	int typePos = 0;
-	int typeShape = 0;
-	int typeSD = 0;
-	int typeColor = 0;
-	int typeBicycle = 0;
-
-	if (info.GetType4() == LaneInfo::OPPOSITE_SIDE && info.GetType3() == LaneInfo::LEFT)
-		typePos = 0;
-	else if (info.GetType4() == LaneInfo::BRANCH)
-		typePos = 1;
-	else if (info.GetType4() == LaneInfo::C4_NONE && info.GetType3() == LaneInfo::LEFT && info.GetType3_ID() == 3)
-		typePos = 2;
-	else if (info.GetType4() == LaneInfo::C4_NONE && info.GetType3() == LaneInfo::LEFT && info.GetType3_ID() == 2)
-		typePos = 3;
-	else if (info.GetType4() == LaneInfo::C4_NONE && info.GetType3() == LaneInfo::LEFT && info.GetType3_ID() == 1)
-		typePos = 4;
-	else if (info.GetType4() == LaneInfo::C4_NONE && info.GetType3() == LaneInfo::LEFT && info.GetType3_ID() == 0)
-		typePos = 5;
-	else if (info.GetType4() == LaneInfo::C4_NONE && info.GetType3() == LaneInfo::RIGHT && info.GetType3_ID() == 0)
-		typePos = 6;
-	else if (info.GetType4() == LaneInfo::C4_NONE && info.GetType3() == LaneInfo::RIGHT && info.GetType3_ID() == 1)
-		typePos = 7;
-	else if (info.GetType4() == LaneInfo::C4_NONE && info.GetType3() == LaneInfo::RIGHT && info.GetType3_ID() == 2)
-		typePos = 8;
-	else if (info.GetType4() == LaneInfo::C4_NONE && info.GetType3() == LaneInfo::RIGHT && info.GetType3_ID() == 3)
-		typePos = 9;
-	else if (info.GetType4() == LaneInfo::MERGED)
-		typePos = 10;
-	else if (info.GetType4() == LaneInfo::OPPOSITE_SIDE && info.GetType3() == LaneInfo::RIGHT)
-		typePos = 11;
-	else  //uncertain
-		typePos = 12;
-
-	typeShape = info.GetType1() - 1;
-	typeSD = info.GetType2() - 1;
-	typeColor = info.GetType5() - 1;
-	typeBicycle = info.GetType6() - 1;
-
-	LineTypes line_type;
-	line_type.id = id;
-	line_type.typeShape = typeShape;
-	line_type.typeSD = typeSD;
-	line_type.typePos = typePos;
-	line_type.typeColor = typeColor;
-	line_type.typeBicycle = typeBicycle;
-
-	return line_type;
-}
-
-BoundaryTypes GetBoundaryTypes(BoundaryInfo info, int id, int max_level) {
-	int boundary_typePos = 0;
-	int boundary_typeShape = 0;
-
-	// set boundary typePos
-	if (max_level == 0) {
-		if (info.GetType3() == BoundaryInfo::LEFT && info.GetType3_ID() == 0)
-			boundary_typePos = 0;
-		else if (info.GetType3() == BoundaryInfo::RIGHT && info.GetType3_ID() == 0)
-			boundary_typePos = 1;
-		else
-			boundary_typePos = 2;
-	}
-	else if (max_level == 1) {
-		if (info.GetType3() == BoundaryInfo::LEFT && info.GetType3_ID() == 1)
-			boundary_typePos = 0;
-		else if (info.GetType3() == BoundaryInfo::LEFT && info.GetType3_ID() == 0)
-			boundary_typePos = 1;
-		else if (info.GetType3() == BoundaryInfo::RIGHT && info.GetType3_ID() == 0)
-			boundary_typePos = 2;
-		else if (info.GetType3() == BoundaryInfo::RIGHT && info.GetType3_ID() == 1)
-			boundary_typePos = 3;
-		else
-			boundary_typePos = 4;
-	}
-	else if (max_level == 2) {
-		if (info.GetType3() == BoundaryInfo::LEFT && info.GetType3_ID() == 2)
-			boundary_typePos = 0;
-		else if (info.GetType3() == BoundaryInfo::LEFT && info.GetType3_ID() == 1)
-			boundary_typePos = 1;
-		else if (info.GetType3() == BoundaryInfo::LEFT && info.GetType3_ID() == 0)
-			boundary_typePos = 2;
-		else if (info.GetType3() == BoundaryInfo::RIGHT && info.GetType3_ID() == 0)
-			boundary_typePos = 3;
-		else if (info.GetType3() == BoundaryInfo::RIGHT && info.GetType3_ID() == 1)
-			boundary_typePos = 4;
-		else if (info.GetType3() == BoundaryInfo::RIGHT && info.GetType3_ID() == 2)
-			boundary_typePos = 5;
-		else
-			boundary_typePos = 6;
-	}
-	else {
-		if (info.GetType3() == BoundaryInfo::LEFT && info.GetType3_ID() > 2)
-			boundary_typePos = 0;
-		else if (info.GetType3() == BoundaryInfo::LEFT && info.GetType3_ID() == 2)
-			boundary_typePos = 1;
-		else if (info.GetType3() == BoundaryInfo::LEFT && info.GetType3_ID() == 1)
-			boundary_typePos = 2;
-		else if (info.GetType3() == BoundaryInfo::LEFT && info.GetType3_ID() == 0)
-			boundary_typePos = 3;
-		else if (info.GetType3() == BoundaryInfo::RIGHT && info.GetType3_ID() == 0)
-			boundary_typePos = 4;
-		else if (info.GetType3() == BoundaryInfo::RIGHT && info.GetType3_ID() == 1)
-			boundary_typePos = 5;
-		else if (info.GetType3() == BoundaryInfo::RIGHT && info.GetType3_ID() == 2)
-			boundary_typePos = 6;
-		else if (info.GetType3() == BoundaryInfo::RIGHT && info.GetType3_ID() > 2)
-			boundary_typePos = 7;
-		else
-			boundary_typePos = 8;
-	}
-
-	//WALLS, STATIONARY_VEHICLES, GUARDRAIL, STATIC_LANE_SEPARATOR, CURBS, LANE_SEPARATOR, PLASTIC_WALL, DRUM, BEACONS, CONE, ROAD_EDGE, INNER_PARKINGSPACE, UNEXEPLAINABLE, BOUNDARY_STRUCTURE_ETCS, BOUNDARY_ETCS
-
-	// set boundary typeShape
-	if (info.GetBoundaryType() == BoundaryInfo::WALLS)
-		boundary_typeShape = 0;
-	else if (info.GetBoundaryType() == BoundaryInfo::STATIONARY_VEHICLES)
-		boundary_typeShape = 1;
-	else if (info.GetBoundaryType() == BoundaryInfo::GUARDRAIL)
-		boundary_typeShape = 2;
-	else if (info.GetBoundaryType() == BoundaryInfo::CURBS)
-		boundary_typeShape = 3;
-	else if (info.GetBoundaryType() == BoundaryInfo::STATIC_LANE_SEPARATOR ||
-		info.GetBoundaryType() == BoundaryInfo::LANE_SEPARATOR)
-		boundary_typeShape = 4;
-	else if (info.GetBoundaryType() == BoundaryInfo::PLASTIC_WALL ||
-		info.GetBoundaryType() == BoundaryInfo::DRUM ||
-		info.GetBoundaryType() == BoundaryInfo::BEACONS ||
-		info.GetBoundaryType() == BoundaryInfo::CONE)
-		boundary_typeShape = 5;
-	else if (info.GetBoundaryType() == BoundaryInfo::ROAD_EDGE)
-		boundary_typeShape = 6;
-	else
-		boundary_typeShape = 7;
-
-	BoundaryTypes boundary_type;
-	boundary_type.id = id;
-	boundary_type.typeShape = boundary_typeShape;
-	boundary_type.typePos = boundary_typePos;
-	return boundary_type;
-}
 
 bool WriteTypeFile(const char *szpath, vector<LineTypes> &line_types, vector<BoundaryTypes> &boundary_types, int width, int height)
 {
@@ -2177,185 +1882,30 @@ int CPointingToolView::DrawLaneBoundaryToMask(RoadLaneManager &road, Bitmap &mas
 	// B : VP
 	*/
 
-	// lane
-	vector<LaneLine> lines;
-	vector<LaneLine> acc_lines;
-	vector<LineTypes> line_types;
-	for (int i = 0; i < road.GetSizeLaneLine(); i++) {
-		LaneInfo info = road.line_ptr(i)->info;
-		if (LaneInfo::SOLID <= info.GetType1() && info.GetType1() <= LaneInfo::CATS_EYE
-			&& LaneInfo::SINGLE <= info.GetType2() && info.GetType2() <= LaneInfo::ACCESSORIE
-			&& LaneInfo::LEFT <= info.GetType3() && info.GetType3() <= LaneInfo::UNCERTAIN
-			&& LaneInfo::C4_NONE <= info.GetType4() && info.GetType4() <= LaneInfo::OPPOSITE_SIDE
-			&& LaneInfo::WHITE <= info.GetType5() && info.GetType5() <= LaneInfo::ETC)
-		{
-			if (info.GetType4() != LaneInfo::UNABLE)
-			{
-				if (!use_acc && info.GetType2() == LaneInfo::ACCESSORIE)
-					acc_lines.push_back(*(road.line_ptr(i)));
-				else
-					lines.push_back(*(road.line_ptr(i)));
-			}
-		}
-	}
-
-	// boundary
-	float boundary_width_ratio = 128.0;
-	float boundary_width = road.GetImageW() / (float)boundary_width_ratio;
-	int boundary_max_level = 1;
-
-	vector<BoundaryLine> boundaries;
-	vector<BoundaryTypes> boundary_types;
-
-	// get left_id, right_id
-	int left_id = INT_MAX, right_id = INT_MAX;
-	for (int i = 0; i < road.GetSizeBoundary(); i++) {
-		BoundaryInfo boundary_info = road.boundary_ptr(i)->info;
-		if ((BoundaryInfo::WALLS <= boundary_info.GetBoundaryType() && boundary_info.GetBoundaryType() <= BoundaryInfo::ROAD_EDGE) ||
-			(BoundaryInfo::BOUNDARY_STRUCTURE_ETCS <= boundary_info.GetBoundaryType() && boundary_info.GetBoundaryType() <= BoundaryInfo::BOUNDARY_ETCS)) {
-			int type3_id = boundary_info.GetType3_ID();
-			if (type3_id >= 0 && type3_id <= boundary_max_level) {
-				if (boundary_info.GetType3() == BoundaryInfo::LEFT && type3_id < left_id) {
-					left_id = type3_id;
-				}
-				else if (boundary_info.GetType3() == BoundaryInfo::RIGHT && type3_id < right_id) {
-					right_id = type3_id;
-				}
-			}
-		}
-	}
-	// add to boundaries vector
-	for (int i = 0; i < road.GetSizeBoundary(); i++) {
-		BoundaryInfo boundary_info = road.boundary_ptr(i)->info;
-		if ((BoundaryInfo::WALLS <= boundary_info.GetBoundaryType() && boundary_info.GetBoundaryType() <= BoundaryInfo::ROAD_EDGE) ||
-			(BoundaryInfo::BOUNDARY_STRUCTURE_ETCS <= boundary_info.GetBoundaryType() && boundary_info.GetBoundaryType() <= BoundaryInfo::BOUNDARY_ETCS)) {
-			if ((boundary_info.GetType3() == BoundaryInfo::LEFT && boundary_info.GetType3_ID() == left_id) || (boundary_info.GetType3() == BoundaryInfo::RIGHT && boundary_info.GetType3_ID() == right_id))
-				boundaries.push_back(*(road.boundary_ptr(i)));
-		}
-		else {
-			printf("this image has boundary type problem\n");
-			//return -1;
-		}
-	}
-
-
-	if (!use_acc) {
-		// acc lines as road marker
-		for (int i = 0; i < acc_lines.size(); i++) {
-			DrawLineAsRoadMarkerToMask(acc_lines[i], mask);
-		}
-	}
-
-	// draw line seg mask in R channel
-	for (int i = 0; i < lines.size(); i++) {
-		int line_id = i + 1;
-		DrawLineSegToMask(lines[i], line_id, mask);
-		line_types.push_back(GetLineTypes(lines[i].info, line_id));
-	}
+	// lanes in R channel, acc lines as road marker
+	LaneMaskLayout layout;
+	Gdiplus::BitmapData bmData_o;
+	LaneMaskBuffer buffer = LockLaneMask(mask, bmData_o);
+	LaneMaskDrawLaneBoundary(road, buffer, layout, use_acc);
+	mask.UnlockBits(&bmData_o);
 
 	// draw boundary seg mask in G channel
-	int left_count = 0;
-	int right_count = 0;
-	for (int i = 0; i < boundaries.size(); i++) {
-		int boundary_id = -1;
-		if (boundaries[i].info.GetType3() == BoundaryInfo::LEFT) {
-			boundary_id = (2 * left_count++) + 1; // odd
-		}
-		else {
-			boundary_id = 2 * (1 + right_count++); // even
-		}
-		DrawBoundarySegToMask(boundaries[i], boundary_id, mask, boundary_width);
-		boundary_types.push_back(GetBoundaryTypes(boundaries[i].info, boundary_id, boundary_max_level));
+	for (int i = 0; i < layout.boundary_types.size(); i++) {
+		BoundaryLine boundary = road.boundary(layout.boundary_index[i]);
+		DrawBoundarySegToMask(boundary, layout.boundary_types[i].id, mask, layout.boundary_width);
 	}
 
 	// save line, boundary type info in xml file
 	int w = mask.GetWidth(), h = mask.GetHeight();
-	WriteTypeFile(xml_outpath, line_types, boundary_types, w, h);
+	WriteTypeFile(xml_outpath, layout.line_types, layout.boundary_types, w, h);
 
 	return 0;
 }
 
 int CPointingToolView::DrawLineSegToMask(LaneLine &line, int id, Bitmap &mask) {
-	int w = mask.GetWidth(), h = mask.GetHeight();
-	Rect rect(0, 0, w, h);
-
 	Gdiplus::BitmapData bmData_o;
-	mask.LockBits(&rect, Gdiplus::ImageLockModeWrite, PixelFormat24bppRGB, &bmData_o);
-	vector<PointF> pts;
-	std::vector<PPOINTF> xy;
-	std::vector<PPOINTF> wy;
-	std::vector<bool> occlusions;
-
-	int top_y = std::max((int)std::round(line.top_y_), 0);
-	int bottom_y = std::min((int)std::round(line.bottom_y_), h - 1);
-
-	bool b_ext = false;
-	if (line.info.GetType4() == LaneInfo::C4_NONE && line.info.GetType3() == LaneInfo::LEFT && (line.info.GetType3_ID() == 1 || line.info.GetType3_ID() == 0)
-		|| line.info.GetType4() == LaneInfo::C4_NONE && line.info.GetType3() == LaneInfo::RIGHT && (line.info.GetType3_ID() == 0 || line.info.GetType3_ID() == 1))
-		b_ext = true;
-	//bool b_ext = (4 <= typePos && typePos <= 7);
-	for (int y = top_y; y <= (b_ext ? (h - 1) : bottom_y); y++) {
-		bool occlusion = false;
-		for (int k = 0; k < line.info.occlusions_top_bottom_.size(); k++) {
-			if (y >= line.info.occlusions_top_bottom_[k].first &&
-				y <= line.info.occlusions_top_bottom_[k].second) {
-				occlusion = true;
-				break;
-			}
-		}
-		occlusions.push_back(occlusion);
-		double ix = line.spline_xy_model_(y);
-		pts.push_back(PPOINTF(ix, y));
-	}
-	int y = top_y;
-	BYTE *pbyte = (BYTE *)bmData_o.Scan0 + y * bmData_o.Stride;
-	int prev_lx, prev_rx;
-	for (int i = 0; i < pts.size(); i++) {
-		double r = line.spline_ry_model_(pts[i].Y);
-		int lx = std::round(pts[i].X - r);
-		int rx = std::round(pts[i].X + r);
-		for (int j = lx; j <= rx; j++) {
-			if (j < 0 || j > w - 1) continue;
-			int id_ = id;
-			if (occlusions[i])
-				id_ += 128;
-			if (pts[i].Y > bottom_y)
-				id_ += 64;
-			pbyte[j * 3 + 2] = id_;
-		}
-		if (i) {
-			double r_prev = line.spline_ry_model_(pts[i - 1].Y);
-			double overlap_ratio = (std::min(prev_lx, rx) - std::max(prev_lx, lx)) /
-				(double)(std::max(prev_rx, rx) - std::min(prev_lx, lx));
-			if (overlap_ratio <= 0) {
-				if (prev_lx > rx) {
-					for (int j = prev_lx; j <= rx; j++) {
-						if (j < 0 || j > w - 1) continue;
-						int id_ = id;
-						if (occlusions[i])
-							id_ += 128;
-						if (pts[i].Y > bottom_y)
-							id_ += 64;
-						pbyte[j * 3 + 2] = id_;
-					}
-				}
-				else {
-					for (int j = prev_lx; j <= rx; j++) {
-						if (j < 0 || j > w - 1) continue;
-						int id_ = id;
-						if (occlusions[i])
-							id_ += 128;
-						if (pts[i].Y > bottom_y)
-							id_ += 64;
-						pbyte[j * 3 + 2] = id_;
-					}
-				}
-			}
-		}
-		prev_lx = lx;
-		prev_rx = rx;
-		pbyte += bmData_o.Stride;
-	}
+	LaneMaskBuffer buffer = LockLaneMask(mask, bmData_o);
+	LaneMaskDrawLineSeg(line, id, buffer);
 	mask.UnlockBits(&bmData_o);
 	return 0;
 }
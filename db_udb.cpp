@@ -7,6 +7,7 @@
 #include <boost/foreach.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/filesystem.hpp>
+#include "lane_type_manifest.hpp"
 
 #define UDB_CACHE_VER "ucv1.1"
 
@@ -882,6 +883,29 @@ namespace caffe {
 							selected_entries.push_back(curline);
 					}
 
+					// type labels of the split from one manifest (lane_type_manifest.hpp)
+					// when there is one; frames missing from it fall back to their xml
+					std::unordered_map<std::string, LaneTypeManifestFrame> type_manifest;
+					std::string manifest_name;
+					int type_xml_fallbacks = 0;
+					if (use_lane_type_label_ || use_boundary_type_label_) {
+						manifest_name = "ImageSets/" + db_files_[taridx].second + ".ltm";
+						if (!tar_reader_ann->exists(manifest_name))
+							manifest_name = "TypeData.ltm";
+						if (tar_reader_ann->exists(manifest_name)) {
+							std::string manifest;
+							tar_reader_ann->read(manifest_name, manifest);
+							if (!DecodeLaneTypeManifest(manifest.data(), manifest.size(), type_manifest)) {
+								LOG(ERROR) << "tar parsing error: cannot read type manifest " << manifest_name;
+								exit(-1);
+							}
+							LOG(INFO) << "Type labels of " << type_manifest.size() << " frames from " << manifest_name;
+						}
+						else {
+							manifest_name.clear();
+						}
+					}
+
 					for (int i = 0; i < selected_entries.size(); i++) {
 						std::string dataname = selected_entries[i];
 						std::string annotation_path = "Annotations/" + dataname + ".xml";
@@ -889,6 +913,7 @@ namespace caffe {
 						std::string png_path = "JPEGImages/" + dataname + ".png";
 						std::string bmp_path = "JPEGImages/" + dataname + ".bmp";
 						std::string segmentation_path = "Segmentations/" + dataname + ".png";
+						std::string segmentation_rle_path = "Segmentations/" + dataname + ".lrle";
 						std::string ego_xy_path = "Ego_XY/" + dataname + ".xml";
 						UDBPoint* cur_data = new UDBPoint(tar_reader_img, tar_reader_ann, tar_reader_seg, dataname);
 
@@ -911,8 +936,28 @@ namespace caffe {
 						}
 
 						if (use_lane_type_label_ || use_boundary_type_label_) {
-							if (tar_reader_ann->exists(annotation_path)) {
+							auto type_it = type_manifest.find(dataname);
+							if (type_it != type_manifest.end()) {
+								const LaneTypeManifestFrame& type_frame = type_it->second;
+								if (tar_reader_ann->exists(annotation_path))
+									cur_data->ann_path_ = annotation_path;
+								cur_data->img_width_ = type_frame.width;
+								cur_data->img_height_ = type_frame.height;
+								if (use_lane_type_label_) {
+									cur_data->lane_type_label_.push_back(type_frame.lane_num());
+									for (int k = 0; k < type_frame.lanes.size(); k++)
+										cur_data->lane_type_label_.push_back(type_frame.lanes[k]);
+								}
+								if (use_boundary_type_label_) {
+									cur_data->boundary_type_label_.push_back(type_frame.boundary_num());
+									for (int k = 0; k < type_frame.boundaries.size(); k++)
+										cur_data->boundary_type_label_.push_back(type_frame.boundaries[k]);
+								}
+							}
+							else if (tar_reader_ann->exists(annotation_path)) {
 								cur_data->ann_path_ = annotation_path;
+								if (!manifest_name.empty() && type_xml_fallbacks++ < 10)
+									LOG(WARNING) << dataname << " is not in type manifest " << manifest_name << ", reading " << annotation_path;
 
 								ptree pt;
 
@@ -1519,7 +1564,10 @@ namespace caffe {
 						}
 
 						if (use_seg_) {
-							if (tar_reader_seg->exists(segmentation_path))
+							// run length labels (lane_label_rle.hpp) first
+							if (tar_reader_seg->exists(segmentation_rle_path))
+								cur_data->seg_path_ = segmentation_rle_path;
+							else if (tar_reader_seg->exists(segmentation_path))
 								cur_data->seg_path_ = segmentation_path;
 							else if (req_seg_) {
 								LOG(ERROR) << "tar parsing error: cannot find a file " << segmentation_path;
@@ -1539,6 +1587,9 @@ namespace caffe {
 							delete cur_data;
 						}
 					}
+					if (type_xml_fallbacks > 0)
+						LOG(WARNING) << type_xml_fallbacks << " frames of " << db_files_[taridx].second
+							<< " are not in type manifest " << manifest_name << ", their types were read from xml";
 
 					for (auto it = udb_points_map_.begin(); it != udb_points_map_.end(); it++) {
 						if (it->second->seq_len_ > 0) {
@@ -0,0 +1,179 @@
+#ifndef _LANE_LABEL_RLE_HPP_
+#define _LANE_LABEL_RLE_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+// Run length lane label format (.lrle), shared by the mask exporter of the
+// annotation tool and the UDB data layer.
+//
+// Lane masks are mostly one background color with thin labeled spans, so a
+// row is stored as its runs of equal color. Pixels outside every run are
+// label 0 (black); labels are the packed color RGB2INT(R, G, B).
+// Little endian:
+//   char     magic[4]              "LRLE"
+//   uint32   width, height         width <= 65536
+//   uint32   run_num
+//   uint32   row_begin[height + 1] first run of each row, row_begin[height] = run_num
+//   run      runs[run_num]         per row ascending and disjoint
+// with run = { uint16 x0, x1 (inclusive), uint32 label }.
+
+#define LANE_LABEL_RLE_HEADER_SIZE 16
+#define LANE_LABEL_RLE_RUN_SIZE 8
+
+struct LaneLabelRun {
+	int x0, x1;                      // inclusive
+	int label;
+};
+
+inline void PutLaneLabelRle32(std::vector<unsigned char> &out, uint32_t value)
+{
+	for (int k = 0; k < 4; k++) out.push_back((unsigned char)(value >> (8 * k)));
+}
+
+inline uint32_t GetLaneLabelRle32(const unsigned char *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Encodes an 8 bit, 3 channel image; r, g, b are the byte offsets of the
+// channels in a pixel (2, 1, 0 for BGR). stride is the row size in bytes.
+// False for sizes the format cannot hold.
+inline bool EncodeLaneLabelRle(const unsigned char *pixels, int width, int height, int stride,
+	int r, int g, int b, std::vector<unsigned char> &out)
+{
+	std::vector<unsigned char> runs;
+	out.clear();
+	if (width <= 0 || width > 65536 || height <= 0 || height > (1 << 24)) return false;
+	out.insert(out.end(), "LRLE", "LRLE" + 4);
+	PutLaneLabelRle32(out, width);
+	PutLaneLabelRle32(out, height);
+	PutLaneLabelRle32(out, 0);
+	uint32_t run_num = 0;
+	for (int y = 0; y < height; y++) {
+		PutLaneLabelRle32(out, run_num);
+		const unsigned char *row = pixels + (ptrdiff_t)y * stride;
+		for (int x = 0; x < width;) {
+			int label = (row[x * 3 + r] << 16) | (row[x * 3 + g] << 8) | row[x * 3 + b];
+			int x0 = x;
+			for (x++; x < width; x++) {
+				const unsigned char *px = row + x * 3;
+				if (((px[r] << 16) | (px[g] << 8) | px[b]) != label) break;
+			}
+			if (label == 0) continue;
+			runs.push_back((unsigned char)x0);
+			runs.push_back((unsigned char)(x0 >> 8));
+			runs.push_back((unsigned char)(x - 1));
+			runs.push_back((unsigned char)((x - 1) >> 8));
+			PutLaneLabelRle32(runs, label);
+			run_num++;
+		}
+	}
+	PutLaneLabelRle32(out, run_num);
+	for (int k = 0; k < 4; k++) out[12 + k] = (unsigned char)(run_num >> (8 * k));
+	out.insert(out.end(), runs.begin(), runs.end());
+	return true;
+}
+
+// Read only view of an encoded buffer; the buffer must outlive it.
+class LaneLabelRle
+{
+public:
+	LaneLabelRle() : data_(NULL), runs_(NULL), width_(0), height_(0), run_num_(0) {}
+
+	static bool IsRle(const void *data, size_t size) {
+		return size >= 4 && memcmp(data, "LRLE", 4) == 0;
+	}
+
+	// Checks the header, the row index and every run; false for anything
+	// else, including other image formats.
+	bool Parse(const void *data, size_t size) {
+		const unsigned char *p = (const unsigned char *)data;
+		data_ = runs_ = NULL;
+		width_ = height_ = run_num_ = 0;
+		if (size < LANE_LABEL_RLE_HEADER_SIZE || !IsRle(data, size)) return false;
+		uint32_t width = GetLaneLabelRle32(p + 4), height = GetLaneLabelRle32(p + 8);
+		uint32_t run_num = GetLaneLabelRle32(p + 12);
+		if (width == 0 || width > 65536 || height == 0 || height > (1u << 24) || run_num > (1u << 28)) return false;
+		size_t index_size = ((size_t)height + 1) * 4;
+		if (size != LANE_LABEL_RLE_HEADER_SIZE + index_size + (size_t)run_num * LANE_LABEL_RLE_RUN_SIZE) return false;
+		const unsigned char *index = p + LANE_LABEL_RLE_HEADER_SIZE;
+		const unsigned char *runs = index + index_size;
+		if (GetLaneLabelRle32(index) != 0 || GetLaneLabelRle32(index + height * 4) != run_num) return false;
+		for (uint32_t y = 0; y < height; y++) {
+			uint32_t begin = GetLaneLabelRle32(index + y * 4), end = GetLaneLabelRle32(index + y * 4 + 4);
+			if (begin > end || end > run_num) return false;
+			int prev_x1 = -1;
+			for (uint32_t i = begin; i < end; i++) {
+				const unsigned char *run = runs + (size_t)i * LANE_LABEL_RLE_RUN_SIZE;
+				int x0 = run[0] | (run[1] << 8), x1 = run[2] | (run[3] << 8);
+				if (x0 <= prev_x1 || x0 > x1 || x1 >= (int)width) return false;
+				prev_x1 = x1;
+			}
+		}
+		data_ = index;
+		runs_ = runs;
+		width_ = width;
+		height_ = height;
+		run_num_ = run_num;
+		return true;
+	}
+
+	int width() const { return width_; }
+	int height() const { return height_; }
+	int run_num() const { return run_num_; }
+	// runs [row_begin(y), row_end(y)) belong to row y
+	int row_begin(int y) const { return GetLaneLabelRle32(data_ + y * 4); }
+	int row_end(int y) const { return GetLaneLabelRle32(data_ + y * 4 + 4); }
+	LaneLabelRun run(int idx) const {
+		const unsigned char *p = runs_ + (size_t)idx * LANE_LABEL_RLE_RUN_SIZE;
+		LaneLabelRun run = { p[0] | (p[1] << 8), p[2] | (p[3] << 8), (int)GetLaneLabelRle32(p + 4) };
+		return run;
+	}
+
+	// Run of row y covering x, -1 for label 0. cursor is a run index kept
+	// by the caller between calls (any value to start): it ends on the first
+	// run of the row with x1 >= x, so scans that move a few pixels at a time,
+	// in either direction, are O(1); longer jumps binary search the row.
+	int Find(int y, int x, int &cursor) const {
+		int begin = row_begin(y), end = row_end(y);
+		int steps = 0;
+		if (cursor < begin || cursor > end) steps = 4;
+		for (; steps < 4 && cursor < end && run(cursor).x1 < x; steps++) cursor++;
+		for (; steps < 4 && cursor > begin && run(cursor - 1).x1 >= x; steps++) cursor--;
+		if (steps >= 4) {
+			int lo = begin, hi = end;
+			while (lo < hi) {
+				int mid = (lo + hi) / 2;
+				if (run(mid).x1 < x) lo = mid + 1;
+				else hi = mid;
+			}
+			cursor = lo;
+		}
+		return (cursor < end && run(cursor).x0 <= x) ? cursor : -1;
+	}
+
+	// 8 bit BGR pixels of the whole label image
+	void Expand(unsigned char *bgr, int stride) const {
+		for (int y = 0; y < height_; y++) {
+			unsigned char *row = bgr + (ptrdiff_t)y * stride;
+			memset(row, 0, width_ * 3);
+			for (int i = row_begin(y); i < row_end(y); i++) {
+				LaneLabelRun cur = run(i);
+				for (int x = cur.x0; x <= cur.x1; x++) {
+					row[x * 3 + 0] = (unsigned char)cur.label;
+					row[x * 3 + 1] = (unsigned char)(cur.label >> 8);
+					row[x * 3 + 2] = (unsigned char)(cur.label >> 16);
+				}
+			}
+		}
+	}
+
+private:
+	const unsigned char *data_;      // row index
+	const unsigned char *runs_;
+	int width_, height_, run_num_;
+};
+#endif
@@ -0,0 +1,115 @@
+#ifndef _LANE_TYPE_MANIFEST_HPP_
+#define _LANE_TYPE_MANIFEST_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Lane type manifest (.ltm): the LaneLine / BoundaryLine types of every frame
+// of a dataset in one file, in place of a TypeData xml per frame. Written by
+// the mask exporter of the annotation tool, read by UDB::Open.
+//
+// A header followed by frame records, so the exporter can append a record
+// per frame; a frame recorded twice takes its last record.
+// Little endian:
+//   char     magic[4]              "LTMF"
+//   uint32   version               1
+// record:
+//   uint32   size                  bytes of the record after this field
+//   uint32   key_size
+//   char     key[key_size]         frame name without extension
+//   int32    width, height         image size
+//   uint32   lane_num, boundary_num
+//   int32    lanes[lane_num][6]    id, typeShape, typeSD, typePos, typeColor, typeBicycle
+//   int32    boundaries[boundary_num][3]  id, typeShape, typePos
+
+#define LANE_TYPE_MANIFEST_HEADER_SIZE 8
+#define LANE_TYPE_MANIFEST_VERSION 1
+#define LANE_TYPE_MANIFEST_LANE_FIELDS 6
+#define LANE_TYPE_MANIFEST_BOUNDARY_FIELDS 3
+
+struct LaneTypeManifestFrame {
+	int width, height;
+	std::vector<int> lanes;          // LANE_TYPE_MANIFEST_LANE_FIELDS per lane
+	std::vector<int> boundaries;     // LANE_TYPE_MANIFEST_BOUNDARY_FIELDS per boundary
+
+	LaneTypeManifestFrame() : width(0), height(0) {}
+	int lane_num() const { return (int)lanes.size() / LANE_TYPE_MANIFEST_LANE_FIELDS; }
+	int boundary_num() const { return (int)boundaries.size() / LANE_TYPE_MANIFEST_BOUNDARY_FIELDS; }
+};
+
+inline void PutLaneTypeManifest32(std::vector<unsigned char> &out, uint32_t value)
+{
+	for (int k = 0; k < 4; k++) out.push_back((unsigned char)(value >> (8 * k)));
+}
+
+inline uint32_t GetLaneTypeManifest32(const unsigned char *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// the bytes a new manifest file starts with
+inline void EncodeLaneTypeManifestHeader(std::vector<unsigned char> &out)
+{
+	out.clear();
+	out.insert(out.end(), "LTMF", "LTMF" + 4);
+	PutLaneTypeManifest32(out, LANE_TYPE_MANIFEST_VERSION);
+}
+
+// one frame record, appended to out
+inline void EncodeLaneTypeManifestFrame(const std::string &key, const LaneTypeManifestFrame &frame,
+	std::vector<unsigned char> &out)
+{
+	size_t size = 4 + key.size() + 16 + (frame.lanes.size() + frame.boundaries.size()) * 4;
+	PutLaneTypeManifest32(out, (uint32_t)size);
+	PutLaneTypeManifest32(out, (uint32_t)key.size());
+	out.insert(out.end(), key.begin(), key.end());
+	PutLaneTypeManifest32(out, frame.width);
+	PutLaneTypeManifest32(out, frame.height);
+	PutLaneTypeManifest32(out, frame.lane_num());
+	PutLaneTypeManifest32(out, frame.boundary_num());
+	for (size_t i = 0; i < frame.lanes.size(); i++) PutLaneTypeManifest32(out, frame.lanes[i]);
+	for (size_t i = 0; i < frame.boundaries.size(); i++) PutLaneTypeManifest32(out, frame.boundaries[i]);
+}
+
+// Reads a whole manifest in one pass. False for another format, or for a
+// damaged or truncated record (e.g. an interrupted export); the frames
+// before it are kept.
+inline bool DecodeLaneTypeManifest(const void *data, size_t size,
+	std::unordered_map<std::string, LaneTypeManifestFrame> &frames)
+{
+	const unsigned char *p = (const unsigned char *)data;
+	if (size < LANE_TYPE_MANIFEST_HEADER_SIZE || memcmp(p, "LTMF", 4) != 0 ||
+		GetLaneTypeManifest32(p + 4) != LANE_TYPE_MANIFEST_VERSION) return false;
+	size_t pos = LANE_TYPE_MANIFEST_HEADER_SIZE;
+	while (pos < size) {
+		if (size - pos < 4) return false;
+		size_t record_size = GetLaneTypeManifest32(p + pos);
+		pos += 4;
+		if (record_size < 20 || record_size > size - pos) return false;
+		const unsigned char *record = p + pos;
+		size_t key_size = GetLaneTypeManifest32(record);
+		if (key_size > record_size - 20) return false;
+		const unsigned char *fields = record + 4 + key_size;
+		uint32_t lane_num = GetLaneTypeManifest32(fields + 8);
+		uint32_t boundary_num = GetLaneTypeManifest32(fields + 12);
+		size_t value_num = (record_size - 20 - key_size) / 4;
+		if (lane_num > value_num || boundary_num > value_num ||
+			(size_t)lane_num * LANE_TYPE_MANIFEST_LANE_FIELDS + (size_t)boundary_num * LANE_TYPE_MANIFEST_BOUNDARY_FIELDS != value_num ||
+			record_size != 20 + key_size + value_num * 4) return false;
+		LaneTypeManifestFrame &frame = frames[std::string((const char *)record + 4, key_size)];
+		frame.width = (int)GetLaneTypeManifest32(fields);
+		frame.height = (int)GetLaneTypeManifest32(fields + 4);
+		frame.lanes.resize((size_t)lane_num * LANE_TYPE_MANIFEST_LANE_FIELDS);
+		frame.boundaries.resize((size_t)boundary_num * LANE_TYPE_MANIFEST_BOUNDARY_FIELDS);
+		const unsigned char *value = fields + 16;
+		for (size_t i = 0; i < frame.lanes.size(); i++, value += 4) frame.lanes[i] = (int)GetLaneTypeManifest32(value);
+		for (size_t i = 0; i < frame.boundaries.size(); i++, value += 4) frame.boundaries[i] = (int)GetLaneTypeManifest32(value);
+		pos += record_size;
+	}
+	return true;
+}
+#endif
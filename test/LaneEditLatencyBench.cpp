@@ -0,0 +1,138 @@
+#include "stdafx.h"
+#include "RoadLaneManager.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+// Edit latency of WorkingLaneLine against point count: moving a point
+// (set_ixyr, what a drag does per mouse move), inserting one (AddPoint3 then
+// GenerateModels) and erasing one (erase_element), next to the full refit
+// every edit cost before the knots were kept sorted (copy to PPOINT3F, sort,
+// erase duplicates one by one, copy out, set_points).
+//
+//   LaneEditLatencyBench [<points>...]
+//     default 10 50 100 200 500 1000 2000 points; microseconds per edit.
+//
+// Exit code 0 when after every edit the models equal a LaneLine fitted from
+// scratch on the same points.
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+bool Comp(const PPOINT3F &a, const PPOINT3F &b)
+{
+	return a.y < b.y;
+}
+
+// GenerateModels as it was before LaneKnotSet
+bool OldFit(const LaneLine &line, LaneSpline &xy_model, LaneSpline &ry_model)
+{
+	std::vector<PPOINT3F> xyz;
+	if (line.spline_x_.size() < 3) return false;
+	for (int i = 0; i < line.spline_x_.size(); ++i) xyz.push_back(PPOINT3F(line.spline_x_[i], line.spline_y_[i], line.line_r_[i]));
+	std::sort(xyz.begin(), xyz.end(), Comp);
+	for (int i = xyz.size() - 1; i--;) { if (xyz[i].y == xyz[i + 1].y) { xyz.erase(xyz.begin() + i + 1); } }
+	if (xyz.size() < 3) return false;
+	std::vector<double> x, y, r;
+	for (int i = 0; i < xyz.size(); i++) {
+		x.push_back(xyz[i].x); y.push_back(xyz[i].y); r.push_back(xyz[i].r);
+	}
+	xy_model.set_points(y, x);
+	ry_model.set_points(y, r, false);
+	return true;
+}
+
+// distinct y, a long boundary from the top of a 1080 row image down
+PPOINT3F RandomPoint(std::mt19937 &rng, int n)
+{
+	std::uniform_real_distribution<double> u(0, 1);
+	double y = floor(u(rng) * n * 8) / 8 + 0.0625;
+	return PPOINT3F(900 + u(rng) * 100, y * 1080.0 / n, 1 + u(rng) * 5);
+}
+
+bool SameModels(WorkingLaneLine &working)
+{
+	LaneLine ref;
+	ref.spline_x_ = working.spline_x_;
+	ref.spline_y_ = working.spline_y_;
+	ref.line_r_ = working.line_r_;
+	bool ok = ref.GenerateModels();
+	if (ok != working.initialized()) return false;
+	if (!ok) return true;
+	if (ref.top_y_ != working.top_y_ || ref.bottom_y_ != working.bottom_y_) return false;
+	for (double y = ref.top_y_ - 5; y < ref.bottom_y_ + 5; y += 3.25) {
+		if (ref.spline_xy_model_(y) != working.reg_ix(y) || ref.spline_ry_model_(y) != working.reg_ir(y)) return false;
+	}
+	return true;
+}
+
+bool Run(int n)
+{
+	std::mt19937 rng(n);
+	WorkingLaneLine working;
+	for (int i = 0; i < n; i++) working.AddPoint3(RandomPoint(rng, n));
+	working.GenerateModels();
+
+	const int edit_num = std::max(50, 200000 / n);
+	double seconds[4] = { 0 };
+	int failed = 0;
+
+	LaneSpline xy_model, ry_model;
+	Clock::time_point start = Clock::now();
+	for (int e = 0; e < edit_num; e++) OldFit(working, xy_model, ry_model);
+	seconds[0] = std::chrono::duration<double>(Clock::now() - start).count();
+
+	for (int e = 0; e < edit_num; e++) {
+		PPOINT3F point = RandomPoint(rng, n);
+		int idx = rng() % working.element_size();
+		start = Clock::now();
+		working.set_ixyr(point, idx);
+		seconds[1] += std::chrono::duration<double>(Clock::now() - start).count();
+
+		point = RandomPoint(rng, n);
+		start = Clock::now();
+		working.AddPoint3(point);
+		working.GenerateModels();
+		seconds[2] += std::chrono::duration<double>(Clock::now() - start).count();
+
+		idx = rng() % working.element_size();
+		start = Clock::now();
+		working.erase_element(idx);
+		seconds[3] += std::chrono::duration<double>(Clock::now() - start).count();
+
+		// checking every edit would dominate the run on long lines
+		if (e % 16 == 0 && !SameModels(working)) failed++;
+	}
+	if (!SameModels(working)) failed++;
+
+	printf("%6d %12.2f %12.2f %12.2f %12.2f %8d\n", n, seconds[0] * 1e6 / edit_num, seconds[1] * 1e6 / edit_num,
+		seconds[2] * 1e6 / edit_num, seconds[3] * 1e6 / edit_num, failed);
+	return failed == 0;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	std::vector<int> counts;
+	for (int i = 1; i < argc; i++) counts.push_back(atoi(argv[i]));
+	if (counts.empty()) {
+		static const int defaults[] = { 10, 50, 100, 200, 500, 1000, 2000 };
+		counts.assign(defaults, defaults + sizeof(defaults) / sizeof(defaults[0]));
+	}
+	printf("%6s %12s %12s %12s %12s %8s\n", "points", "old refit", "move", "insert", "erase", "differ");
+	bool ok = true;
+	for (int i = 0; i < counts.size(); i++) {
+		if (counts[i] < 3) {
+			printf("usage: LaneEditLatencyBench [<points (3 or more)>...]\n");
+			return 2;
+		}
+		ok &= Run(counts[i]);
+	}
+	return ok ? 0 : 1;
+}
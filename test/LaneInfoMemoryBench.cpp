@@ -0,0 +1,117 @@
+#include "stdafx.h"
+#include "RoadLaneManager.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// Size of the packed LaneInfo / BoundaryInfo against the layout they had
+// before (an int per type and a 256 byte text buffer per object), and the
+// clamping of out of range types read from xml.
+//
+//   LaneInfoMemoryBench [<xml>...]
+//     sizeof of both layouts, then bytes per LaneLine / BoundaryLine over the
+//     given files: the object plus its point and occlusion vectors.
+//
+// Exit code 0 when the clamping checks pass.
+
+namespace {
+
+// the layouts before the types were packed
+struct OldLaneInfo {
+	int type1, type2, type3, type4, type5, type6;
+	std::vector<std::pair<float, float>> occlusions_top_bottom_;
+	char string_buffer[256];
+};
+
+struct OldBoundaryInfo {
+	int type3, BoundaryType, Situation;
+	std::vector<std::pair<float, float>> occlusions_top_bottom_;
+	char string_buffer[256];
+};
+
+template <typename LINE>
+size_t HeapBytes(const LINE &line)
+{
+	return (line.spline_x_.capacity() + line.spline_y_.capacity() + line.line_r_.capacity()) * sizeof(double) +
+		line.info.occlusions_top_bottom_.capacity() * sizeof(std::pair<float, float>);
+}
+
+bool Check(bool ok, const char *what)
+{
+	if (!ok) printf("FAILED %s\n", what);
+	return ok;
+}
+
+// out of range values must stay out of range instead of wrapping onto a type
+bool CheckClamping()
+{
+	static const char xml[] =
+		"<RoadLane imageWidth=\"1280\" imageHeight=\"720\">"
+		"<Splines splineNum=\"2\">"
+		"<Spline type1=\"257\" type2=\"-200\" type3=\"70000\" type4=\"259\" type5=\"1\" type6=\"300\" pointNum=\"0\" occNum=\"0\"/>"
+		"<Spline type1=\"1\" type2=\"2\" type3=\"513\" type4=\"0\" type5=\"2\" type6=\"1\" pointNum=\"0\" occNum=\"0\"/>"
+		"</Splines>"
+		"<Boundarys boundaryNum=\"2\">"
+		"<Boundary type3=\"65793\" boundary=\"261\" pointNum=\"0\" occNum=\"0\"/>"
+		"<Boundary type3=\"770\" boundary=\"5\" pointNum=\"0\" occNum=\"0\"/>"
+		"</Boundarys>"
+		"</RoadLane>";
+	RoadLaneManager road;
+	bool ok = Check(road.ReadBufferStream(xml, sizeof(xml) - 1, "clamp") && road.GetSizeLaneLine() == 2 &&
+		road.GetSizeBoundary() == 2, "read");
+	if (!ok) return false;
+	const LaneInfo &bad = road.line(0).info;
+	ok &= Check(bad.GetType1() == 127 && bad.GetType2() == -128 && bad.type3 == 32767 && bad.GetType4() == 127 &&
+		bad.GetType5() == 1 && bad.GetType6() == 127, "lane types clamped");
+	const LaneInfo &good = road.line(1).info;
+	ok &= Check(good.GetType1() == LaneInfo::SOLID && good.GetType2() == LaneInfo::DOUBLE &&
+		good.GetType3() == LaneInfo::LEFT && good.GetType3_ID() == 2 && good.GetType5() == LaneInfo::YELLOW &&
+		good.GetType6() == LaneInfo::BICYCLE, "lane types in range kept");
+	// side LEFT with id 257: the id is clamped to 127, not wrapped to 1
+	const BoundaryInfo &bad_boundary = road.boundary(0).info;
+	ok &= Check(bad_boundary.GetType3() == BoundaryInfo::LEFT && bad_boundary.GetType3_ID() == 127 &&
+		bad_boundary.GetBoundaryType() == 127, "boundary types clamped");
+	const BoundaryInfo &good_boundary = road.boundary(1).info;
+	ok &= Check(good_boundary.GetType3() == BoundaryInfo::RIGHT && good_boundary.GetType3_ID() == 3 &&
+		good_boundary.GetBoundaryType() == BoundaryInfo::CURBS, "boundary types in range kept");
+	return ok;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	bool ok = CheckClamping();
+
+	size_t lane_line = sizeof(LaneLine), boundary_line = sizeof(BoundaryLine);
+	size_t old_lane_line = lane_line - sizeof(LaneInfo) + sizeof(OldLaneInfo);
+	size_t old_boundary_line = boundary_line - sizeof(BoundaryInfo) + sizeof(OldBoundaryInfo);
+	printf("%-14s %8s %8s\n", "sizeof", "before", "after");
+	printf("%-14s %8zu %8zu\n", "LaneInfo", sizeof(OldLaneInfo), sizeof(LaneInfo));
+	printf("%-14s %8zu %8zu\n", "BoundaryInfo", sizeof(OldBoundaryInfo), sizeof(BoundaryInfo));
+	printf("%-14s %8zu %8zu\n", "LaneLine", old_lane_line, lane_line);
+	printf("%-14s %8zu %8zu\n", "BoundaryLine", old_boundary_line, boundary_line);
+
+	size_t lanes = 0, boundaries = 0, lane_heap = 0, boundary_heap = 0;
+	for (int i = 1; i < argc; i++) {
+		RoadLaneManager road;
+		if (!road.ReadFileStream(argv[i])) {
+			ok = false;
+			continue;
+		}
+		for (int k = 0; k < road.GetSizeLaneLine(); k++) lane_heap += HeapBytes(road.line(k));
+		for (int k = 0; k < road.GetSizeBoundary(); k++) boundary_heap += HeapBytes(road.boundary(k));
+		lanes += road.GetSizeLaneLine();
+		boundaries += road.GetSizeBoundary();
+	}
+	if (lanes) {
+		printf("%zu lanes, bytes per LaneLine: %.1f before, %.1f after\n", lanes,
+			old_lane_line + (double)lane_heap / lanes, lane_line + (double)lane_heap / lanes);
+	}
+	if (boundaries) {
+		printf("%zu boundaries, bytes per BoundaryLine: %.1f before, %.1f after\n", boundaries,
+			old_boundary_line + (double)boundary_heap / boundaries, boundary_line + (double)boundary_heap / boundaries);
+	}
+	return ok ? 0 : 1;
+}
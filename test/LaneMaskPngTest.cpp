@@ -0,0 +1,382 @@
+#include "LaneMaskExport.h"
+#include "lane_label_rle.hpp"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// Test of EncodeLaneMaskPng, the encoder ExportLaneMasks uses without a
+// png callback (the tool passes the GDI+ encoder instead).
+//
+//   LaneMaskPngTest [<dir>]
+//     synthetic masks (noise, flat, 1 pixel, rows longer than the 32K deflate
+//     window, strides padded to 4 bytes, RGB channel order), plus the masks
+//     of dir/NNN.lrle when given (test/data/lane_mask). Every png is decoded
+//     by the independent inflate below, which checks chunk crcs, IHDR, the
+//     zlib header and adler32, and compared with the source pixels.
+//
+// Exit code 0 when every png decodes to its mask.
+
+namespace {
+
+// RFC 1951 inflate of all block types, the reference for the encoder
+class Inflater
+{
+public:
+	Inflater(const unsigned char *data, size_t size) : data_(data), size_(size), pos_(0), bits_(0), count_(0), error_(false) {}
+
+	bool Run(std::vector<unsigned char> &out) {
+		int last;
+		do {
+			last = Bits(1);
+			int type = Bits(2);
+			if (type == 0) Stored(out);
+			else if (type == 1) Fixed(out);
+			else if (type == 2) Dynamic(out);
+			else error_ = true;
+		} while (!last && !error_);
+		return !error_;
+	}
+	// bytes consumed, the adler32 follows
+	size_t pos() const { return pos_; }
+
+private:
+	struct Huffman {
+		short count[16];
+		short symbol[288];
+	};
+
+	int Bits(int n) {
+		uint32_t value = bits_;
+		while (count_ < n) {
+			if (pos_ >= size_) {
+				error_ = true;
+				return 0;
+			}
+			value |= (uint32_t)data_[pos_++] << count_;
+			count_ += 8;
+		}
+		bits_ = value >> n;
+		count_ -= n;
+		return value & ((1u << n) - 1);
+	}
+	// canonical code from code lengths; false for an oversubscribed set
+	static bool Build(Huffman &h, const short *length, int n) {
+		memset(h.count, 0, sizeof(h.count));
+		for (int s = 0; s < n; s++) h.count[length[s]]++;
+		int left = 1;
+		for (int len = 1; len < 16; len++) {
+			left = left * 2 - h.count[len];
+			if (left < 0) return false;
+		}
+		short offs[16];
+		offs[1] = 0;
+		for (int len = 1; len < 15; len++) offs[len + 1] = offs[len] + h.count[len];
+		for (int s = 0; s < n; s++) if (length[s]) h.symbol[offs[length[s]]++] = s;
+		return true;
+	}
+	int Decode(const Huffman &h) {
+		int code = 0, first = 0, index = 0;
+		for (int len = 1; len < 16; len++) {
+			code |= Bits(1);
+			int count = h.count[len];
+			if (code - count < first) return h.symbol[index + (code - first)];
+			index += count;
+			first = (first + count) << 1;
+			code <<= 1;
+		}
+		error_ = true;
+		return 0;
+	}
+	void Stored(std::vector<unsigned char> &out) {
+		bits_ = 0;
+		count_ = 0;
+		if (size_ - pos_ < 4) {
+			error_ = true;
+			return;
+		}
+		int len = data_[pos_] | (data_[pos_ + 1] << 8);
+		int nlen = data_[pos_ + 2] | (data_[pos_ + 3] << 8);
+		pos_ += 4;
+		if (len != (~nlen & 0xffff) || size_ - pos_ < (size_t)len) {
+			error_ = true;
+			return;
+		}
+		out.insert(out.end(), data_ + pos_, data_ + pos_ + len);
+		pos_ += len;
+	}
+	void Codes(std::vector<unsigned char> &out, const Huffman &lencode, const Huffman &distcode) {
+		static const short base[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+		static const short extra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+		static const short dists[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+		static const short dext[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+		for (;;) {
+			int symbol = Decode(lencode);
+			if (error_) return;
+			if (symbol < 256) {
+				out.push_back((unsigned char)symbol);
+				continue;
+			}
+			if (symbol == 256) return;
+			symbol -= 257;
+			if (symbol >= 29) {
+				error_ = true;
+				return;
+			}
+			int len = base[symbol] + Bits(extra[symbol]);
+			int code = Decode(distcode);
+			if (error_ || code >= 30) {
+				error_ = true;
+				return;
+			}
+			size_t dist = dists[code] + Bits(dext[code]);
+			if (dist > out.size()) {
+				error_ = true;
+				return;
+			}
+			for (int k = 0; k < len; k++) out.push_back(out[out.size() - dist]);
+		}
+	}
+	void Fixed(std::vector<unsigned char> &out) {
+		short length[288 + 30];
+		int s = 0;
+		for (; s < 144; s++) length[s] = 8;
+		for (; s < 256; s++) length[s] = 9;
+		for (; s < 280; s++) length[s] = 7;
+		for (; s < 288; s++) length[s] = 8;
+		for (; s < 288 + 30; s++) length[s] = 5;
+		Huffman lencode, distcode;
+		Build(lencode, length, 288);
+		Build(distcode, length + 288, 30);
+		Codes(out, lencode, distcode);
+	}
+	void Dynamic(std::vector<unsigned char> &out) {
+		static const short order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+		int nlen = Bits(5) + 257, ndist = Bits(5) + 1, ncode = Bits(4) + 4;
+		if (nlen > 286 || ndist > 30) {
+			error_ = true;
+			return;
+		}
+		short length[320] = { 0 };
+		for (int i = 0; i < ncode; i++) length[order[i]] = Bits(3);
+		Huffman lencode, distcode;
+		if (!Build(lencode, length, 19)) {
+			error_ = true;
+			return;
+		}
+		for (int i = 0; i < nlen + ndist && !error_;) {
+			int symbol = Decode(lencode);
+			if (symbol < 16) {
+				length[i++] = symbol;
+				continue;
+			}
+			int value = 0, repeat;
+			if (symbol == 16) {
+				if (i == 0) {
+					error_ = true;
+					return;
+				}
+				value = length[i - 1];
+				repeat = 3 + Bits(2);
+			}
+			else if (symbol == 17) repeat = 3 + Bits(3);
+			else repeat = 11 + Bits(7);
+			if (i + repeat > nlen + ndist) {
+				error_ = true;
+				return;
+			}
+			while (repeat--) length[i++] = value;
+		}
+		if (error_ || !Build(lencode, length, nlen) || !Build(distcode, length + nlen, ndist)) {
+			error_ = true;
+			return;
+		}
+		Codes(out, lencode, distcode);
+	}
+
+	const unsigned char *data_;
+	size_t size_, pos_;
+	uint32_t bits_;
+	int count_;
+	bool error_;
+};
+
+uint32_t BigEndian(const unsigned char *p)
+{
+	return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+uint32_t Crc32(const unsigned char *data, size_t size)
+{
+	uint32_t crc = 0xffffffffu;
+	for (size_t i = 0; i < size; i++) {
+		crc ^= data[i];
+		for (int k = 0; k < 8; k++) crc = (crc & 1) ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+	}
+	return ~crc;
+}
+
+// RGB pixels of an 8 bit truecolor png, rows without padding
+bool DecodePng(const std::vector<unsigned char> &png, int &width, int &height, std::vector<unsigned char> &rgb)
+{
+	static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	if (png.size() < 8 || memcmp(&png[0], signature, 8) != 0) return false;
+	std::vector<unsigned char> idat;
+	bool ihdr = false, iend = false;
+	for (size_t pos = 8; pos < png.size() && !iend;) {
+		if (png.size() - pos < 12) return false;
+		uint32_t length = BigEndian(&png[pos]);
+		if (length > png.size() - pos - 12) return false;
+		const unsigned char *type = &png[pos + 4], *data = type + 4;
+		if (Crc32(type, length + 4) != BigEndian(data + length)) {
+			printf("bad crc of chunk %.4s\n", type);
+			return false;
+		}
+		if (memcmp(type, "IHDR", 4) == 0) {
+			if (length != 13 || data[8] != 8 || data[9] != 2 || data[10] || data[11] || data[12]) return false;
+			width = BigEndian(data);
+			height = BigEndian(data + 4);
+			ihdr = true;
+		}
+		else if (memcmp(type, "IDAT", 4) == 0) {
+			idat.insert(idat.end(), data, data + length);
+		}
+		else if (memcmp(type, "IEND", 4) == 0) {
+			iend = true;
+		}
+		pos += 12 + length;
+	}
+	if (!ihdr || !iend || idat.size() < 6 || (idat[0] & 0x0f) != 8 || ((idat[0] << 8) | idat[1]) % 31 != 0) return false;
+
+	std::vector<unsigned char> raw;
+	Inflater inflater(&idat[2], idat.size() - 2);
+	if (!inflater.Run(raw) || idat.size() - 2 - inflater.pos() != 4) return false;
+	uint32_t s1 = 1, s2 = 0;
+	for (size_t i = 0; i < raw.size(); i++) {
+		s1 = (s1 + raw[i]) % 65521;
+		s2 = (s2 + s1) % 65521;
+	}
+	if (((s2 << 16) | s1) != BigEndian(&idat[idat.size() - 4])) {
+		printf("bad adler32\n");
+		return false;
+	}
+
+	size_t row_bytes = (size_t)width * 3;
+	if (raw.size() != (row_bytes + 1) * height) return false;
+	rgb.assign(row_bytes * height, 0);
+	for (int y = 0; y < height; y++) {
+		const unsigned char *src = &raw[(row_bytes + 1) * y];
+		unsigned char *dst = &rgb[row_bytes * y];
+		const unsigned char *up = y ? dst - row_bytes : NULL;
+		int filter = *src++;
+		for (size_t x = 0; x < row_bytes; x++) {
+			int a = x >= 3 ? dst[x - 3] : 0, b = up ? up[x] : 0, c = up && x >= 3 ? up[x - 3] : 0;
+			int predict = 0;
+			if (filter == 1) predict = a;
+			else if (filter == 2) predict = b;
+			else if (filter == 3) predict = (a + b) / 2;
+			else if (filter == 4) {
+				int p = a + b - c, pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+				predict = pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+			}
+			else if (filter != 0) return false;
+			dst[x] = (unsigned char)(src[x] + predict);
+		}
+	}
+	return true;
+}
+
+// encodes the mask and checks the decoded png against it
+bool CheckMask(const char *name, const LaneMaskBuffer &mask)
+{
+	std::vector<unsigned char> png, rgb;
+	EncodeLaneMaskPng(mask, png);
+	int width = -1, height = -1;
+	if (!DecodePng(png, width, height, rgb)) {
+		printf("%s: png does not decode\n", name);
+		return false;
+	}
+	if (width != mask.width || height != mask.height) {
+		printf("%s: %dx%d png of a %dx%d mask\n", name, width, height, mask.width, mask.height);
+		return false;
+	}
+	int mismatch = 0;
+	for (int y = 0; y < height; y++) {
+		const unsigned char *src = mask.row(y), *dst = &rgb[(size_t)y * width * 3];
+		for (int x = 0; x < width; x++, src += 3, dst += 3) {
+			if (dst[0] != src[mask.r] || dst[1] != src[mask.g] || dst[2] != src[mask.b]) mismatch++;
+		}
+	}
+	if (mismatch) printf("%s: %d pixels differ\n", name, mismatch);
+	return mismatch == 0;
+}
+
+enum SyntheticKind { SYNTHETIC_NOISE, SYNTHETIC_FLAT, SYNTHETIC_LABELS };
+
+bool CheckSynthetic(int width, int height, SyntheticKind kind, bool rgb_order)
+{
+	char name[64];
+	static const char *kinds[] = { "noise", "flat", "labels" };
+	sprintf(name, "%s %dx%d%s", kinds[kind], width, height, rgb_order ? " rgb" : "");
+	int stride = (width * 3 + 3) & ~3;
+	std::vector<unsigned char> pixels((size_t)stride * height);
+	uint32_t seed = width * 7919u + height;
+	for (int y = 0; y < height; y++) {
+		unsigned char *row = &pixels[(size_t)stride * y];
+		for (int x = 0; x < stride; x++) {
+			seed = seed * 1103515245u + 12345u;
+			if (kind == SYNTHETIC_NOISE) row[x] = (unsigned char)(seed >> 16);
+			else if (kind == SYNTHETIC_FLAT) row[x] = 64;
+			else row[x] = (unsigned char)(x / 3 / 37 * 16 + y / 23);
+		}
+	}
+	LaneMaskBuffer mask(&pixels[0], width, height, stride);
+	if (rgb_order) mask.SetRGB();
+	return CheckMask(name, mask);
+}
+
+std::vector<unsigned char> ReadBytes(const std::string &path)
+{
+	std::vector<char> buffer;
+	if (!ReadLaneFileToBuffer(path.c_str(), buffer)) return std::vector<unsigned char>();
+	return std::vector<unsigned char>(buffer.begin(), buffer.end() - 1);
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	int checked = 0, failed = 0;
+	static const int sizes[][2] = { { 1, 1 }, { 1, 7 }, { 5, 1 }, { 13, 11 }, { 86, 4 }, { 641, 37 }, { 1242, 19 }, { 12000, 3 } };
+	for (int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		for (int kind = SYNTHETIC_NOISE; kind <= SYNTHETIC_LABELS; kind++) {
+			for (int rgb_order = 0; rgb_order < 2; rgb_order++) {
+				checked++;
+				if (!CheckSynthetic(sizes[i][0], sizes[i][1], (SyntheticKind)kind, rgb_order != 0)) failed++;
+			}
+		}
+	}
+
+	for (int frame = 0; argc > 1; frame++) {
+		char name[16];
+		sprintf(name, "%03d", frame);
+		std::vector<unsigned char> bytes = ReadBytes(std::string(argv[1]) + "/" + name + ".lrle");
+		if (bytes.empty()) break;
+		LaneLabelRle rle;
+		checked++;
+		if (!rle.Parse(&bytes[0], bytes.size())) {
+			printf("%s: cannot read the rle mask\n", name);
+			failed++;
+			continue;
+		}
+		int stride = (rle.width() * 3 + 3) & ~3;
+		std::vector<unsigned char> pixels((size_t)stride * rle.height());
+		rle.Expand(&pixels[0], stride);
+		LaneMaskBuffer mask(&pixels[0], rle.width(), rle.height(), stride);
+		if (!CheckMask(name, mask)) failed++;
+	}
+	printf("%d masks, %d failed\n", checked, failed);
+	return failed == 0 ? 0 : 1;
+}
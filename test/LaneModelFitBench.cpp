@@ -0,0 +1,243 @@
+#include "stdafx.h"
+#include "RoadLaneManager.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+// LaneLine / BoundaryLine::GenerateModels (per thread LaneKnotSet scratch)
+// against the fit they had before: copy to PPOINT3F, sort, erase duplicate
+// y one by one, copy into three vectors, set_points twice.
+//
+//   LaneModelFitBench [<xml | @list>...]
+//     first 20000 random lines and boundaries of 0-12 points, many with
+//     equal y: both fits must succeed or fail together and give the same
+//     top / bottom and models. Then nanoseconds and heap allocations per fit
+//     against point count. With xmls, the lines of the whole set are loaded
+//     with ReadFileStream and refitted both ways, next to the load time.
+//
+// The old fit ran std::sort, which leaves the order of points with equal y
+// unspecified; the reference here keeps the first of them in index order,
+// as GenerateModels does.
+//
+// Exit code 0 when every fit matches the reference.
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+size_t g_allocations = 0;
+
+}
+
+void *operator new(size_t size)
+{
+	g_allocations++;
+	if (void *p = malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+	free(p);
+}
+
+namespace {
+
+double Seconds(Clock::time_point start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+bool Comp(const PPOINT3F &a, const PPOINT3F &b)
+{
+	return a.y < b.y;
+}
+
+// GenerateModels as it was before LaneKnotSet
+template <typename LINE>
+bool OldFit(const LINE &line, LaneSpline &xy_model, LaneSpline &ry_model, double &top_y, double &bottom_y)
+{
+	std::vector<PPOINT3F> xyz;
+	top_y = 0;
+	bottom_y = 0;
+	if (line.spline_x_.size() < 3) return false;
+	for (int i = 0; i < line.spline_x_.size(); ++i) xyz.push_back(PPOINT3F(line.spline_x_[i], line.spline_y_[i], line.line_r_[i]));
+	std::stable_sort(xyz.begin(), xyz.end(), Comp);
+	for (int i = xyz.size() - 1; i--;) { if (xyz[i].y == xyz[i + 1].y) { xyz.erase(xyz.begin() + i + 1); } }
+	if (xyz.size() < 3) return false;
+	top_y = xyz[0].y;
+	bottom_y = xyz[xyz.size() - 1].y;
+	std::vector<double> x, y, r;
+	for (int i = 0; i < xyz.size(); i++) {
+		x.push_back(xyz[i].x); y.push_back(xyz[i].y); r.push_back(xyz[i].r);
+	}
+	xy_model.set_points(y, x);
+	ry_model.set_points(y, r, false);
+	return true;
+}
+
+template <typename LINE>
+void RandomPoints(std::mt19937 &rng, int n, LINE &line)
+{
+	// half the lines crowd their y into a few rows, so duplicates are common
+	int y_range = rng() % 2 ? 6 : 1000;
+	for (int i = 0; i < n; i++) {
+		line.spline_x_.push_back(rng() % 1000 + 0.3);
+		line.spline_y_.push_back(rng() % y_range + 0.25 * (rng() % 3));
+		line.line_r_.push_back(rng() % 9);
+	}
+}
+
+template <typename LINE>
+bool SameFit(LINE &line)
+{
+	LaneSpline xy_model, ry_model;
+	double top_y, bottom_y;
+	bool ok = OldFit(line, xy_model, ry_model, top_y, bottom_y);
+	if (line.GenerateModels() != ok || line.top_y_ != top_y || line.bottom_y_ != bottom_y) return false;
+	if (!ok) return true;
+	for (double y = top_y - 5; y < bottom_y + 5; y += 0.7) {
+		if (xy_model(y) != line.spline_xy_model_(y) || ry_model(y) != line.spline_ry_model_(y)) return false;
+	}
+	return true;
+}
+
+template <typename LINE>
+void Time(const char *kind, int n)
+{
+	const int line_num = std::max(200, 400000 / n);
+	std::mt19937 rng(n);
+	std::vector<LINE> lines(line_num);
+	for (int i = 0; i < line_num; i++) {
+		for (int j = 0; j < n; j++) {
+			lines[i].spline_x_.push_back(500 + rng() % 100);
+			lines[i].spline_y_.push_back(300 + (rng() % (n * 8)) * 700.0 / (n * 8));
+			lines[i].line_r_.push_back(1 + rng() % 5);
+		}
+	}
+	// warm the per thread scratch, as a loader thread has after its first file
+	for (int i = 0; i < line_num; i++) lines[i].GenerateModels();
+
+	// the old fit also wrote into the models of the line, reusing their storage
+	LaneSpline xy_model, ry_model;
+	double top_y, bottom_y;
+	OldFit(lines[0], xy_model, ry_model, top_y, bottom_y);
+	size_t allocations = g_allocations;
+	Clock::time_point start = Clock::now();
+	for (int i = 0; i < line_num; i++) OldFit(lines[i], xy_model, ry_model, top_y, bottom_y);
+	double old_seconds = Seconds(start);
+	size_t old_allocations = g_allocations - allocations;
+
+	allocations = g_allocations;
+	start = Clock::now();
+	for (int i = 0; i < line_num; i++) lines[i].GenerateModels();
+	double new_seconds = Seconds(start);
+	size_t new_allocations = g_allocations - allocations;
+
+	printf("%-9s %6d %10.0f %10.0f %6.1fx %10.1f %10.1f\n", kind, n, old_seconds * 1e9 / line_num, new_seconds * 1e9 / line_num,
+		new_seconds > 0 ? old_seconds / new_seconds : 0.0, (double)old_allocations / line_num, (double)new_allocations / line_num);
+}
+
+bool AddPaths(const char *arg, std::vector<std::string> &paths)
+{
+	if (arg[0] != '@') {
+		paths.push_back(arg);
+		return true;
+	}
+	FILE *fp = fopen(arg + 1, "r");
+	if (!fp) {
+		printf("cannot read - \"%s\".\n", arg + 1);
+		return false;
+	}
+	char line[4096];
+	while (fgets(line, sizeof(line), fp)) {
+		size_t len = strcspn(line, "\r\n");
+		line[len] = 0;
+		if (len) paths.push_back(line);
+	}
+	fclose(fp);
+	return true;
+}
+
+// the lines of a real set, refitted both ways, against loading the set
+void TimeSet(const std::vector<std::string> &paths)
+{
+	std::vector<RoadLaneManager> roads(paths.size());
+	Clock::time_point start = Clock::now();
+	for (size_t i = 0; i < paths.size(); i++) roads[i].ReadFileStream(paths[i].c_str());
+	double load_seconds = Seconds(start);
+
+	LaneSpline xy_model, ry_model;
+	double top_y, bottom_y;
+	double seconds[2];
+	int curve_num = 0;
+	for (int pass = 0; pass < 2; pass++) {
+		start = Clock::now();
+		for (size_t f = 0; f < roads.size(); f++) {
+			RoadLaneManager &road = roads[f];
+			for (int i = 0; i < road.GetSizeLaneLine(); i++) {
+				LaneLine *line = road.line_ptr(i);
+				if (pass == 0) {
+					OldFit(*line, xy_model, ry_model, top_y, bottom_y);
+					curve_num++;
+				}
+				else {
+					line->GenerateModels();
+				}
+			}
+			for (int i = 0; i < road.GetSizeBoundary(); i++) {
+				BoundaryLine *boundary = road.boundary_ptr(i);
+				if (pass == 0) {
+					OldFit(*boundary, xy_model, ry_model, top_y, bottom_y);
+					curve_num++;
+				}
+				else {
+					boundary->GenerateModels();
+				}
+			}
+		}
+		seconds[pass] = Seconds(start);
+	}
+	printf("%zu files, %d curves: ReadFileStream %.1f ms, old fits %.1f ms, GenerateModels %.1f ms\n",
+		paths.size(), curve_num, load_seconds * 1e3, seconds[0] * 1e3, seconds[1] * 1e3);
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; i++) {
+		if (!AddPaths(argv[i], paths)) return 2;
+	}
+
+	std::mt19937 rng(18);
+	int failed = 0;
+	for (int it = 0; it < 20000; it++) {
+		LaneLine line;
+		BoundaryLine boundary;
+		RandomPoints(rng, rng() % 13, line);
+		RandomPoints(rng, rng() % 13, boundary);
+		if (!SameFit(line) && failed++ < 20) printf("line %d: fit differs\n", it);
+		if (!SameFit(boundary) && failed++ < 20) printf("boundary %d: fit differs\n", it);
+	}
+	printf("40000 random curves, %d fits differ\n", failed);
+
+	printf("%-9s %6s %10s %10s %7s %10s %10s\n", "", "points", "old ns", "new ns", "", "old alloc", "new alloc");
+	static const int counts[] = { 5, 10, 20, 50, 200 };
+	for (int i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) Time<LaneLine>("line", counts[i]);
+	for (int i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) Time<BoundaryLine>("boundary", counts[i]);
+	if (!paths.empty()) TimeSet(paths);
+	return failed == 0 ? 0 : 1;
+}
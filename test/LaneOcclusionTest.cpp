@@ -0,0 +1,171 @@
+#include "stdafx.h"
+#include "RoadLaneManager.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+// The occlusion interval set (LaneOcclusion.h) against the per row scan of
+// occlusions_top_bottom_ it replaced.
+//
+//   LaneOcclusionTest [<occlusions>...]
+//     first 20000 random sets (overlapping, touching, reversed, fractional
+//     and duplicate intervals): IsOccluded, Cursor and VisibleSpans must
+//     agree with the scan at every quarter row, and LaneLine::Occlusions()
+//     must follow edits of info.occlusions_top_bottom_. Then nanoseconds per
+//     row over 1080 rows for each occlusion count (default 0 1 2 4 8 16 64
+//     256): the scan, IsOccluded, Cursor and VisibleSpans.
+//
+// Exit code 0 when every query matches the scan.
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+typedef std::pair<float, float> Interval;
+
+int g_failed = 0;
+
+bool ScanOccluded(const std::vector<Interval> &occlusions, double y)
+{
+	for (int i = 0; i < occlusions.size(); i++) {
+		if (occlusions[i].first <= y && y <= occlusions[i].second) return true;
+	}
+	return false;
+}
+
+void RandomOcclusions(std::mt19937 &rng, int count, int height, std::vector<Interval> &occlusions)
+{
+	occlusions.clear();
+	for (int i = 0; i < count; i++) {
+		float top = (float)(rng() % height) + (rng() % 4) * 0.25f;
+		// a few reversed, some zero length, mostly short
+		float bottom = top + (int)(rng() % (height / 8 + 2)) - 3 + (rng() % 2) * 0.5f;
+		occlusions.push_back(std::make_pair(top, bottom));
+		if (rng() % 10 == 0) occlusions.push_back(occlusions.back());
+	}
+}
+
+void CheckSet(const std::vector<Interval> &occlusions, int height, std::mt19937 &rng)
+{
+	LaneOcclusionSet set(occlusions);
+	LaneOcclusionSet::Cursor cursor(set);
+	for (double y = -2; y < height + 2; y += 0.25) {
+		bool occluded = ScanOccluded(occlusions, y);
+		if ((set.IsOccluded(y) != occluded || cursor.IsOccluded(y) != occluded) && g_failed++ < 20)
+			printf("%d occlusions: y %g is %s\n", (int)occlusions.size(), y, occluded ? "occluded" : "visible");
+	}
+	for (int i = 1; i < set.size(); i++) {
+		if (set[i - 1].second >= set[i].first && g_failed++ < 20) printf("intervals %d and %d not merged\n", i - 1, i);
+	}
+
+	int first_row = (int)(rng() % height) - 2, last_row = first_row + (int)(rng() % height);
+	std::vector<std::pair<int, int>> spans;
+	set.VisibleSpans(first_row, last_row, spans);
+	std::vector<int> visible(last_row - first_row + 1, 0);
+	for (int k = 0; k < spans.size(); k++) {
+		if (k && spans[k].first <= spans[k - 1].second + 1 && g_failed++ < 20) printf("spans %d and %d not disjoint\n", k - 1, k);
+		for (int row = spans[k].first; row <= spans[k].second; row++) {
+			if (row >= first_row && row <= last_row) visible[row - first_row]++;
+			else if (g_failed++ < 20) printf("span row %d outside [%d, %d]\n", row, first_row, last_row);
+		}
+	}
+	for (int row = first_row; row <= last_row; row++) {
+		if (visible[row - first_row] != (ScanOccluded(occlusions, row) ? 0 : 1) && g_failed++ < 20)
+			printf("%d occlusions: row %d in %d visible spans\n", (int)occlusions.size(), row, visible[row - first_row]);
+	}
+}
+
+// the cached set is rebuilt when the annotation changes, not only on
+// GenerateModels
+void CheckLineCache()
+{
+	LaneLine line;
+	for (int j = 0; j < 5; j++) {
+		line.spline_x_.push_back(500 + j * 10);
+		line.spline_y_.push_back(400 + j * 150);
+		line.line_r_.push_back(3);
+	}
+	line.GenerateModels();
+	if (line.Occlusions()->IsOccluded(600) && g_failed++ < 20) printf("line cache: occluded before any occlusion\n");
+	line.info.occlusions_top_bottom_.push_back(std::make_pair(550.f, 650.f));
+	if (!line.Occlusions()->IsOccluded(600) && g_failed++ < 20) printf("line cache: added occlusion missed\n");
+	line.info.occlusions_top_bottom_[0].second = 590.f;
+	if (line.Occlusions()->IsOccluded(600) && g_failed++ < 20) printf("line cache: edited occlusion missed\n");
+	line.info.occlusions_top_bottom_.clear();
+	if (!line.Occlusions()->empty() && g_failed++ < 20) printf("line cache: removed occlusion kept\n");
+}
+
+void Time(int count)
+{
+	const int height = 1080;
+	const int set_num = std::max(20, 4000 / (count + 1));
+	std::mt19937 rng(count);
+	std::vector<std::vector<Interval>> sets(set_num);
+	for (int s = 0; s < set_num; s++) RandomOcclusions(rng, count, height, sets[s]);
+
+	double seconds[4] = { 0 };
+	long long visible[4] = { 0 };
+	for (int s = 0; s < set_num; s++) {
+		const std::vector<Interval> &occlusions = sets[s];
+		Clock::time_point start = Clock::now();
+		for (int row = 0; row < height; row++) visible[0] += !ScanOccluded(occlusions, row);
+		seconds[0] += std::chrono::duration<double>(Clock::now() - start).count();
+
+		// building the set is part of the cost, as when a line was edited
+		start = Clock::now();
+		LaneOcclusionSet set(occlusions);
+		for (int row = 0; row < height; row++) visible[1] += !set.IsOccluded(row);
+		seconds[1] += std::chrono::duration<double>(Clock::now() - start).count();
+
+		start = Clock::now();
+		LaneOcclusionSet cursor_set(occlusions);
+		LaneOcclusionSet::Cursor cursor(cursor_set);
+		for (int row = 0; row < height; row++) visible[2] += !cursor.IsOccluded(row);
+		seconds[2] += std::chrono::duration<double>(Clock::now() - start).count();
+
+		start = Clock::now();
+		LaneOcclusionSet span_set(occlusions);
+		std::vector<std::pair<int, int>> spans;
+		span_set.VisibleSpans(0, height - 1, spans);
+		for (int k = 0; k < spans.size(); k++) visible[3] += spans[k].second - spans[k].first + 1;
+		seconds[3] += std::chrono::duration<double>(Clock::now() - start).count();
+	}
+	for (int k = 1; k < 4; k++) {
+		if (visible[k] != visible[0] && g_failed++ < 20) printf("%d occlusions: timed pass %d counts %lld visible rows, scan %lld\n", count, k, visible[k], visible[0]);
+	}
+	double rows = (double)set_num * height;
+	printf("%11d %10.2f %10.2f %10.2f %12.2f\n", count, seconds[0] * 1e9 / rows, seconds[1] * 1e9 / rows,
+		seconds[2] * 1e9 / rows, seconds[3] * 1e9 / rows);
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	std::vector<int> counts;
+	for (int i = 1; i < argc; i++) counts.push_back(atoi(argv[i]));
+	if (counts.empty()) {
+		static const int defaults[] = { 0, 1, 2, 4, 8, 16, 64, 256 };
+		counts.assign(defaults, defaults + sizeof(defaults) / sizeof(defaults[0]));
+	}
+	for (int i = 0; i < counts.size(); i++) {
+		if (counts[i] < 0) {
+			printf("usage: LaneOcclusionTest [<occlusions (0 or more)>...]\n");
+			return 2;
+		}
+	}
+
+	std::mt19937 rng(17);
+	std::vector<Interval> occlusions;
+	for (int it = 0; it < 20000; it++) {
+		RandomOcclusions(rng, rng() % 8, 160, occlusions);
+		CheckSet(occlusions, 160, rng);
+	}
+	CheckLineCache();
+	printf("random sets: %d queries differ from the scan\n", g_failed);
+
+	printf("%11s %10s %10s %10s %12s   ns per row\n", "occlusions", "scan", "IsOccluded", "Cursor", "VisibleSpans");
+	for (int i = 0; i < counts.size(); i++) Time(counts[i]);
+	return g_failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,272 @@
+#include "stdafx.h"
+#include "LaneQa.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+// Checks and throughput of the dataset QA scanner (LaneQa.h).
+//
+//   LaneQaTest <work dir> [<xml | @list>...]
+//     first a frame with one planted problem per check must report exactly
+//     those issues, and the same frame without them none. Then the xmls (or
+//     5000 generated frames written into work dir, a crossing planted every
+//     50th frame and a bad occlusion every 50th from the 25th) are scanned
+//     with ScanXml on one thread and on all cores, converted into a corpus
+//     (LaneCorpus.h) and scanned with ScanCorpus; all three must give the
+//     same issues. Microseconds per frame and the time a 500k frame dataset
+//     would take at that rate.
+//
+// Exit code 0 when the planted issues are found and the scans agree.
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double Seconds(Clock::time_point start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+int g_failed = 0;
+
+void Expect(bool ok, const char *what)
+{
+	if (!ok && g_failed++ < 20) printf("%s\n", what);
+}
+
+void StraightLine(LaneLine &line, double top_x, double bottom_x, double top_y, double bottom_y)
+{
+	for (int j = 0; j < 5; j++) {
+		line.spline_x_.push_back(top_x + (bottom_x - top_x) * j / 4);
+		line.spline_y_.push_back(top_y + (bottom_y - top_y) * j / 4);
+		line.line_r_.push_back(3);
+	}
+	line.GenerateModels();
+}
+
+void StraightBoundary(BoundaryLine &boundary, double x, BoundaryInfo::CATEGORY3 side)
+{
+	for (int j = 0; j < 4; j++) {
+		boundary.spline_x_.push_back(x);
+		boundary.spline_y_.push_back(500 + j * 100);
+		boundary.line_r_.push_back(5);
+	}
+	boundary.info.SetType3(side, 0);
+	boundary.GenerateModels();
+}
+
+void Triangle(RoadMarkingPolygon &polygon, int point_num)
+{
+	vector<PPOINTF> points;
+	for (int j = 0; j < point_num; j++) points.push_back(PPOINTF(900 + j * 40, 900 + (j % 2) * 60));
+	polygon.SetPoints(points);
+}
+
+// lanes 0 and 1 cross, lane 3 has two points, lane 2 an occlusion above its
+// top, boundary 0 sits right but is typed LEFT, polygon 1 has two points
+void PlantedFrame(RoadLaneManager &road, bool planted)
+{
+	road.Reset(1920, 1080);
+	StraightLine(road.EmplaceLine(), 500, planted ? 1200 : 550, 400, 1000);
+	StraightLine(road.EmplaceLine(), 1100, 600 + (planted ? 0 : 500), 400, 1000);
+	StraightLine(road.EmplaceLine(), 1500, 1600, 400, 1000);
+	road.line_ptr(2)->info.occlusions_top_bottom_.push_back(std::make_pair(planted ? 300.f : 450.f, 500.f));
+	if (planted) {
+		LaneLine &line = road.EmplaceLine();
+		line.spline_x_.push_back(1); line.spline_y_.push_back(5); line.line_r_.push_back(1);
+		line.spline_x_.push_back(2); line.spline_y_.push_back(6); line.line_r_.push_back(1);
+		line.GenerateModels();
+	}
+	StraightBoundary(road.EmplaceBoundary(), planted ? 1700 : 100, BoundaryInfo::CATEGORY3::LEFT);
+	StraightBoundary(road.EmplaceBoundary(), 1800, BoundaryInfo::CATEGORY3::RIGHT);
+	Triangle(road.EmplacePolygon(), 3);
+	if (planted) Triangle(road.EmplacePolygon(), 2);
+}
+
+void CheckPlanted()
+{
+	struct Expected { LaneQaCheck check; LaneQaObject kind; int object, other; };
+	static const Expected expected[] = {
+		{ LANE_QA_OCCLUSION_RANGE, LANE_QA_LINE, 2, -1 },
+		{ LANE_QA_MODEL_FAILED, LANE_QA_LINE, 3, -1 },
+		{ LANE_QA_LANES_CROSSING, LANE_QA_LINE, 0, 1 },
+		{ LANE_QA_BOUNDARY_SIDE, LANE_QA_BOUNDARY, 0, -1 },
+		{ LANE_QA_POLYGON_POINTS, LANE_QA_POLYGON, 1, -1 },
+	};
+	const int expected_num = sizeof(expected) / sizeof(expected[0]);
+	LaneQaScanner scanner;
+	for (int planted = 1; planted >= 0; planted--) {
+		RoadLaneManager road;
+		PlantedFrame(road, planted != 0);
+		vector<LaneQaIssue> issues;
+		scanner.CheckFrame(road, 7, issues);
+		if (!planted) {
+			for (int i = 0; i < issues.size(); i++) printf("clean frame: %s\n", LaneQaCheckName(issues[i].check));
+			Expect(issues.empty(), "issues on the clean frame");
+			continue;
+		}
+		Expect(issues.size() == expected_num, "planted frame: issue count");
+		for (int e = 0; e < expected_num; e++) {
+			bool found = false;
+			for (int i = 0; i < issues.size(); i++) {
+				const LaneQaIssue &issue = issues[i];
+				found |= issue.frame == 7 && issue.check == expected[e].check && issue.object_kind == expected[e].kind &&
+					issue.object == expected[e].object && issue.other == expected[e].other;
+			}
+			if (!found && g_failed++ < 20) printf("planted frame: %s not reported\n", LaneQaCheckName(expected[e].check));
+		}
+	}
+
+	// a missing file is reported, not skipped
+	vector<string> paths(1, "/nonexistent/lane.xml");
+	vector<LaneQaIssue> issues;
+	scanner.ScanXml(paths, issues);
+	Expect(issues.size() == 1 && issues[0].check == LANE_QA_UNREADABLE && issues[0].frame == 0, "missing file: unreadable");
+}
+
+// 4-7 lanes fanning out from the vanishing point, a boundary each side
+void GenerateFrames(const std::string &dir, int frame_num, std::vector<std::string> &paths)
+{
+	std::mt19937 rng(16);
+	std::uniform_real_distribution<double> u(0, 1);
+	for (int f = 0; f < frame_num; f++) {
+		RoadLaneManager road;
+		road.Reset(1920, 1080);
+		int n = 4 + rng() % 4;
+		for (int i = 0; i < n; i++) {
+			LaneLine &line = road.EmplaceLine();
+			int type[6] = { 1 + (int)(rng() % 3), (int)(rng() % 2), 1, 0, 1, 0 };
+			line.info.SetFileTypes(type);
+			double top = 350 + u(rng) * 100, bottom = 1000 + u(rng) * 80;
+			for (int j = 0; j < 6; j++) {
+				double y = top + j * (bottom - top) / 5;
+				double spread = 40 + (y - 300) * 0.5;
+				double x = 960 + (i - n / 2.0) * spread + u(rng) * 2;
+				// lane 1 ends half way past lane 2
+				if (f % 50 == 0 && i == 1) x += 1.5 * spread * j / 5;
+				line.spline_x_.push_back(x);
+				line.spline_y_.push_back(y);
+				line.line_r_.push_back(2 + j);
+			}
+			if (f % 50 == 25 && i == 0) line.info.occlusions_top_bottom_.push_back(std::make_pair((float)(top - 50), (float)(top + 50)));
+			line.GenerateModels();
+		}
+		StraightBoundary(road.EmplaceBoundary(), 60 + u(rng) * 100, BoundaryInfo::CATEGORY3::LEFT);
+		StraightBoundary(road.EmplaceBoundary(), 1760 + u(rng) * 100, BoundaryInfo::CATEGORY3::RIGHT);
+		if (rng() % 4 == 0) Triangle(road.EmplacePolygon(), 4);
+
+		char name[32];
+		sprintf(name, "/qa_%05d.xml", f);
+		paths.push_back(dir + name);
+		road.WriteFileStream(paths.back().c_str());
+	}
+}
+
+bool AddPaths(const char *arg, std::vector<std::string> &paths)
+{
+	if (arg[0] != '@') {
+		paths.push_back(arg);
+		return true;
+	}
+	FILE *fp = fopen(arg + 1, "r");
+	if (!fp) {
+		printf("cannot read - \"%s\".\n", arg + 1);
+		return false;
+	}
+	char line[4096];
+	while (fgets(line, sizeof(line), fp)) {
+		size_t len = strcspn(line, "\r\n");
+		line[len] = 0;
+		if (len) paths.push_back(line);
+	}
+	fclose(fp);
+	return true;
+}
+
+bool SameIssues(const vector<LaneQaIssue> &a, const vector<LaneQaIssue> &b)
+{
+	if (a.size() != b.size()) return false;
+	for (size_t i = 0; i < a.size(); i++) {
+		if (a[i].frame != b[i].frame || a[i].check != b[i].check || a[i].object_kind != b[i].object_kind ||
+			a[i].object != b[i].object || a[i].other != b[i].other || a[i].y != b[i].y) return false;
+	}
+	return true;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2) {
+		printf("usage: LaneQaTest <work dir> [<xml | @list>...]\n");
+		return 2;
+	}
+	std::string dir = argv[1];
+	std::vector<std::string> paths;
+	for (int i = 2; i < argc; i++) {
+		if (!AddPaths(argv[i], paths)) return 2;
+	}
+	const bool generated = paths.empty();
+	if (generated) GenerateFrames(dir, 5000, paths);
+	const int frame_num = paths.size();
+
+	CheckPlanted();
+
+	LaneQaOptions single_options;
+	single_options.num_threads = 1;
+	LaneQaScanner single(single_options), parallel;
+	vector<LaneQaIssue> issues[3];
+	double seconds[3];
+	Clock::time_point start = Clock::now();
+	single.ScanXml(paths, issues[0]);
+	seconds[0] = Seconds(start);
+	start = Clock::now();
+	parallel.ScanXml(paths, issues[1]);
+	seconds[1] = Seconds(start);
+
+	LaneCorpus corpus;
+	for (int f = 0; f < frame_num; f++) {
+		// unreadable frames stay in as empty ones, so frame indices line up
+		if (!corpus.AppendXml(paths[f].c_str(), paths[f].c_str())) corpus.Append(RoadLaneManager(), paths[f].c_str());
+	}
+	std::string corpus_path = dir + "/qa.corpus";
+	LaneCorpusView view;
+	if (!corpus.Save(corpus_path.c_str()) || !view.Open(corpus_path.c_str())) {
+		printf("cannot write the corpus - \"%s\".\n", corpus_path.c_str());
+		return 2;
+	}
+	start = Clock::now();
+	parallel.ScanCorpus(view, issues[2]);
+	seconds[2] = Seconds(start);
+
+	Expect(SameIssues(issues[0], issues[1]), "ScanXml on one thread and on all cores differ");
+	int counts[LANE_QA_CHECK_NUM] = { 0 };
+	for (int i = 0; i < issues[0].size(); i++) counts[issues[0][i].check]++;
+	if (generated) {
+		Expect(counts[LANE_QA_LANES_CROSSING] == (frame_num + 49) / 50, "generated frames: crossing count");
+		Expect(counts[LANE_QA_OCCLUSION_RANGE] == (frame_num + 24) / 50, "generated frames: occlusion count");
+		Expect(issues[0].size() == counts[LANE_QA_LANES_CROSSING] + counts[LANE_QA_OCCLUSION_RANGE], "generated frames: other issues");
+	}
+	// the corpus has no unreadable frames, and keeps float coordinates the
+	// way the xml does
+	vector<LaneQaIssue> readable;
+	for (int i = 0; i < issues[0].size(); i++) {
+		if (issues[0][i].check != LANE_QA_UNREADABLE) readable.push_back(issues[0][i]);
+	}
+	Expect(SameIssues(readable, issues[2]), "ScanXml and ScanCorpus differ");
+
+	printf("%d frames, %zu issues:", frame_num, issues[0].size());
+	for (int c = 0; c < LANE_QA_CHECK_NUM; c++) printf(" %s %d", LaneQaCheckName((LaneQaCheck)c), counts[c]);
+	printf("\n");
+	static const char *names[3] = { "ScanXml, one thread", "ScanXml, all cores", "ScanCorpus, all cores" };
+	for (int k = 0; k < 3; k++) {
+		printf("%-22s %8.1f us per frame, %6.1f s for 500k frames\n", names[k],
+			seconds[k] * 1e6 / frame_num, seconds[k] * 500000 / frame_num);
+	}
+	printf("%d checks failed\n", g_failed);
+	return g_failed == 0 ? 0 : 1;
+}
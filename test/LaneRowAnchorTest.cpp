@@ -0,0 +1,165 @@
+#include "stdafx.h"
+#include "LaneRowAnchor.h"
+#include "LaneTypeMap.h"
+#include <math.h>
+#include <stdio.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+// Row anchor targets (LaneRowAnchor.h) against a per point reference:
+// EstimatePoint at every anchor row, a scan of occlusions_top_bottom_ and the
+// LaneTypeMap.h labels, for the default spec (800 x 288, 72 rows, 8 lanes,
+// 4 boundaries).
+//
+//   LaneRowAnchorTest [<xml>...]
+//     the frames of the xmls, or 2000 generated frames of 3-10 lanes, a
+//     boundary and occlusions. Also times the batch on one thread and on
+//     all cores, and checks both give the same arrays.
+//
+// Exit code 0 when every value matches the reference.
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+void GenerateFrames(std::vector<RoadLaneManager> &frames)
+{
+	std::mt19937 rng(15);
+	std::uniform_real_distribution<double> u(0, 1);
+	frames.resize(2000);
+	for (int f = 0; f < frames.size(); f++) {
+		RoadLaneManager &road = frames[f];
+		road.Reset(1920, 1080);
+		int n = 3 + rng() % 8;
+		for (int i = 0; i < n; i++) {
+			LaneLine &line = road.EmplaceLine();
+			int type[6] = { 1 + (int)(rng() % 3), (int)(rng() % 3), (int)(rng() % 2 + 1) + (int)((rng() % 3) << 8), 0, 1 + (int)(rng() % 3), 0 };
+			line.info.SetFileTypes(type);
+			double top = 300 + u(rng) * 300;
+			for (int j = 0; j < 6; j++) {
+				line.spline_x_.push_back(200 + i * 200 + u(rng) * 50 + j * 20);
+				line.spline_y_.push_back(top + j * (1080 - top) / 5);
+				line.line_r_.push_back(2 + u(rng) * 4);
+			}
+			if (rng() % 2) line.info.occlusions_top_bottom_.push_back(std::make_pair((float)(top + 100), (float)(top + 200)));
+			line.GenerateModels();
+		}
+		BoundaryLine &boundary = road.EmplaceBoundary();
+		for (int j = 0; j < 4; j++) {
+			boundary.spline_x_.push_back(50 + j * 10);
+			boundary.spline_y_.push_back(500 + j * 150);
+			boundary.line_r_.push_back(5);
+		}
+		boundary.info.SetFileTypes(BoundaryInfo::LEFT, BoundaryInfo::CURBS, 0);
+		boundary.GenerateModels();
+	}
+}
+
+int g_failed = 0;
+
+void Expect(bool ok, int frame, int slot, const char *what)
+{
+	if (!ok && g_failed++ < 20) printf("frame %d slot %d: %s\n", frame, slot, what);
+}
+
+template <typename LINE>
+void CheckCurve(const LINE &line, const LaneRowAnchorSpec &spec, LaneRowAnchorBatch &batch,
+	double scale_x, double scale_y, int frame, int slot)
+{
+	for (int k = 0; k < spec.rows.size(); k++) {
+		double y = spec.rows[k] / scale_y;
+		float x = batch.x_ptr(frame, slot)[k], half_width = batch.half_width_ptr(frame, slot)[k];
+		unsigned char visible = batch.visible_ptr(frame, slot)[k];
+		if (y < line.top_y_ || y > line.bottom_y_) {
+			Expect(x == -1 && half_width == -1 && visible == 0, frame, slot, "row outside the curve");
+			continue;
+		}
+		PPOINT3F point = line.EstimatePoint(y);
+		Expect(fabs(x - point.x * scale_x) < 1e-3 && fabs(half_width - point.r * scale_x) < 1e-3, frame, slot, "x / half width");
+		bool occluded = false;
+		for (int j = 0; j < line.info.occlusions_top_bottom_.size(); j++) {
+			if (line.info.occlusions_top_bottom_[j].first <= y && y <= line.info.occlusions_top_bottom_[j].second) occluded = true;
+		}
+		double out_x = point.x * scale_x;
+		Expect(visible == (!occluded && out_x >= 0 && out_x < spec.out_width), frame, slot, "visibility");
+	}
+}
+
+void CheckFrame(const RoadLaneManager &road, const LaneRowAnchorSpec &spec, LaneRowAnchorBatch &batch, int frame)
+{
+	double scale_x = (double)spec.out_width / road.GetImageW();
+	double scale_y = (double)spec.out_height / road.GetImageH();
+	int slot = 0, dropped = 0;
+	for (int i = 0; i < road.GetSizeLaneLine(); i++) {
+		const LaneLine &line = road.line(i);
+		if (line.top_y_ >= line.bottom_y_) continue;
+		if (slot >= spec.max_lines) {
+			dropped++;
+			continue;
+		}
+		CheckCurve(line, spec, batch, scale_x, scale_y, frame, slot);
+		const int8_t *labels = batch.labels_ptr(frame, slot);
+		Expect(labels[LANE_ANCHOR_LABEL_KIND] == 0 && labels[LANE_ANCHOR_LABEL_POS] == LaneTypePos(line.info) &&
+			labels[LANE_ANCHOR_LABEL_SHAPE] == LaneTypeShape(line.info) && labels[LANE_ANCHOR_LABEL_SD] == LaneTypeSD(line.info) &&
+			labels[LANE_ANCHOR_LABEL_COLOR] == LaneTypeColor(line.info) && labels[LANE_ANCHOR_LABEL_BICYCLE] == LaneTypeBicycle(line.info),
+			frame, slot, "lane labels");
+		slot++;
+	}
+	int used = slot;
+	slot = spec.max_lines;
+	for (int i = 0; i < road.GetSizeBoundary(); i++) {
+		const BoundaryLine &line = road.boundary(i);
+		if (line.top_y_ >= line.bottom_y_) continue;
+		if (slot >= spec.slot_count()) {
+			dropped++;
+			continue;
+		}
+		CheckCurve(line, spec, batch, scale_x, scale_y, frame, slot);
+		const int8_t *labels = batch.labels_ptr(frame, slot);
+		Expect(labels[LANE_ANCHOR_LABEL_KIND] == 1 && labels[LANE_ANCHOR_LABEL_POS] == BoundaryTypePos(line.info, spec.boundary_max_level) &&
+			labels[LANE_ANCHOR_LABEL_SHAPE] == BoundaryTypeShape(line.info) && labels[LANE_ANCHOR_LABEL_SD] == -1,
+			frame, slot, "boundary labels");
+		slot++;
+	}
+	used += slot - spec.max_lines;
+	Expect(batch.object_count[frame] == used && batch.dropped_count[frame] == dropped, frame, -1, "object count");
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	std::vector<RoadLaneManager> frames;
+	if (argc > 1) {
+		frames.resize(argc - 1);
+		for (int i = 1; i < argc; i++) {
+			if (!frames[i - 1].ReadFileStream(argv[i])) return 2;
+		}
+	}
+	else {
+		GenerateFrames(frames);
+	}
+	vector<const RoadLaneManager *> pointers;
+	for (int f = 0; f < frames.size(); f++) pointers.push_back(&frames[f]);
+
+	LaneRowAnchorSpec spec;
+	LaneRowAnchorBatch single, parallel;
+	Clock::time_point start = Clock::now();
+	SampleRowAnchorsBatch(pointers, spec, single, 1);
+	double single_time = std::chrono::duration<double>(Clock::now() - start).count();
+	start = Clock::now();
+	SampleRowAnchorsBatch(pointers, spec, parallel);
+	double parallel_time = std::chrono::duration<double>(Clock::now() - start).count();
+
+	for (int f = 0; f < frames.size(); f++) {
+		if (frames[f].GetImageW() > 0 && frames[f].GetImageH() > 0) CheckFrame(frames[f], spec, single, f);
+	}
+	Expect(single.x == parallel.x && single.half_width == parallel.half_width && single.visible == parallel.visible &&
+		single.labels == parallel.labels && single.object_count == parallel.object_count, -1, -1, "threads differ");
+
+	printf("%zu frames, %d values differ\n", frames.size(), g_failed);
+	printf("%.2f us per frame on one thread, %.2f us on all cores\n",
+		single_time * 1e6 / frames.size(), parallel_time * 1e6 / frames.size());
+	return g_failed == 0 ? 0 : 1;
+}
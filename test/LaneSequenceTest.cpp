@@ -0,0 +1,225 @@
+#include "stdafx.h"
+#include "LaneSequence.h"
+#include "RoadLaneXmlStream.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+// Round trip and storage of the lane sequence codec (LaneSequence.h).
+//
+//   LaneSequenceTest <work dir> [<xml>...]
+//     the xmls, in sequence order, are the frames of one sequence. Without
+//     them a 600 frame sequence is generated into work dir first: points
+//     drifting by sub pixel steps, lanes appearing and disappearing, float
+//     coordinates as the tool stores them.
+//     Every frame goes ReadFile -> LaneSequenceWriter -> LaneSequenceReader
+//     -> WriteFile and must give the bytes WriteFile gives for ReadFile
+//     directly, decoded in order and in random order (keyframe seeks).
+//     With lossless off every value must be within 1 / (2 scale). Then the
+//     xml bytes against the sequence file, and the time to load all frames
+//     from the xmls and from the sequence file.
+//
+// Exit code 0 when every frame round trips.
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double Seconds(Clock::time_point start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+bool ReadBytes(const std::string &path, std::vector<char> &bytes)
+{
+	if (!ReadLaneFileToBuffer(path.c_str(), bytes)) return false;
+	bytes.pop_back();   // the NUL ReadLaneFileToBuffer appends
+	return true;
+}
+
+void GenerateSequence(const std::string &dir, int frame_num, std::vector<std::string> &paths)
+{
+	std::mt19937 rng(14);
+	std::uniform_real_distribution<float> u(-1, 1);
+	RoadLaneManager road;
+	road.Reset(1920, 1080);
+	road.SetToolVersion("3.1");
+	for (int k = 0; k < 8; k++) {
+		LaneLine &line = road.EmplaceLine();
+		int type[6] = { 1 + k % 3, k % 2, (k % 2) + ((k / 2) << 8), 0, k % 3, 0 };
+		line.info.SetFileTypes(type);
+		for (int j = 0; j < 12; j++) {
+			line.spline_x_.push_back((float)(300 + k * 150 + j * 3.7f + u(rng)));
+			line.spline_y_.push_back((float)(400 + j * 55.5f));
+			line.line_r_.push_back(j < 6 ? 3 : (float)(3 + j * 0.37f));
+		}
+		if (k == 2) line.info.occlusions_top_bottom_.push_back(std::make_pair(500.5f, 560.f));
+		line.GenerateModels();
+	}
+	for (int k = 0; k < 2; k++) {
+		BoundaryLine &boundary = road.EmplaceBoundary();
+		boundary.info.SetFileTypes(k, BoundaryInfo::CURBS, 0);
+		for (int j = 0; j < 6; j++) {
+			boundary.spline_x_.push_back(k ? 1700 - j * 20.25 : 100 + j * 20.25);
+			boundary.spline_y_.push_back(420 + j * 110);
+			boundary.line_r_.push_back(2);
+		}
+		boundary.GenerateModels();
+	}
+
+	for (int f = 0; f < frame_num; f++) {
+		for (int i = 0; i < road.GetSizeLaneLine(); i++) {
+			if (rng() % 3) continue;
+			LaneLine *line = road.line_ptr(i);
+			for (int j = 0; j < line->spline_x_.size(); j++) line->spline_x_[j] = (float)(line->spline_x_[j] + u(rng) * 0.5f);
+			line->GenerateModels();
+		}
+		if (f % 30 == 10) {
+			// an occlusion grows, or one appears on another lane
+			LaneLine *line = road.line_ptr(f / 30 % road.GetSizeLaneLine());
+			if (line->info.occlusions_top_bottom_.empty())
+				line->info.occlusions_top_bottom_.push_back(std::make_pair(610.f, 640.5f));
+			else
+				line->info.occlusions_top_bottom_.back().second += 7.25f;
+		}
+		if (f % 50 == 25 && road.GetSizeLaneLine() > 3) road.RemoveLine(1);
+		if (f % 50 == 40) {
+			LaneLine line = road.line(2);
+			for (int j = 0; j < line.spline_x_.size(); j++) line.spline_x_[j] += 40;
+			road.AddLine(std::move(line));
+		}
+		char name[32];
+		sprintf(name, "/%04d.xml", f);
+		paths.push_back(dir + name);
+		road.WriteFile(paths.back().c_str());
+	}
+}
+
+// every value of b within tolerance of a
+template <typename LINE>
+bool NearCurve(const LINE &a, const LINE &b, double tolerance)
+{
+	if (a.spline_x_.size() != b.spline_x_.size() ||
+		a.info.occlusions_top_bottom_.size() != b.info.occlusions_top_bottom_.size()) return false;
+	for (int j = 0; j < a.spline_x_.size(); j++) {
+		if (fabs(a.spline_x_[j] - b.spline_x_[j]) > tolerance || fabs(a.spline_y_[j] - b.spline_y_[j]) > tolerance ||
+			fabs(a.line_r_[j] - b.line_r_[j]) > tolerance) return false;
+	}
+	for (int j = 0; j < a.info.occlusions_top_bottom_.size(); j++) {
+		if (fabs(a.info.occlusions_top_bottom_[j].first - b.info.occlusions_top_bottom_[j].first) > tolerance ||
+			fabs(a.info.occlusions_top_bottom_[j].second - b.info.occlusions_top_bottom_[j].second) > tolerance) return false;
+	}
+	return true;
+}
+
+bool NearRoadLane(const RoadLaneManager &a, const RoadLaneManager &b, double tolerance)
+{
+	if (a.GetSizeLaneLine() != b.GetSizeLaneLine() || a.GetSizeBoundary() != b.GetSizeBoundary() ||
+		a.GetSizeRoadMarking() != b.GetSizeRoadMarking()) return false;
+	for (int i = 0; i < a.GetSizeLaneLine(); i++) {
+		if (!NearCurve(a.line(i), b.line(i), tolerance)) return false;
+	}
+	for (int i = 0; i < a.GetSizeBoundary(); i++) {
+		if (!NearCurve(a.boundary(i), b.boundary(i), tolerance)) return false;
+	}
+	for (int i = 0; i < a.GetSizeRoadMarking(); i++) {
+		const vector<PPOINTF> &p = a.roadmarking(i).points(), &q = b.roadmarking(i).points();
+		if (p.size() != q.size()) return false;
+		for (size_t k = 0; k < p.size(); k++) {
+			if (fabs(p[k].x - q[k].x) > tolerance || fabs(p[k].y - q[k].y) > tolerance) return false;
+		}
+	}
+	return true;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2) {
+		printf("usage: LaneSequenceTest <work dir> [<xml>...]\n");
+		return 2;
+	}
+	std::string dir = argv[1];
+	std::vector<std::string> paths(argv + 2, argv + argc);
+	if (paths.empty()) GenerateSequence(dir, 600, paths);
+	const int frame_num = paths.size();
+
+	// WriteFile of ReadFile, the reference bytes of every frame
+	std::vector<RoadLaneManager> roads(frame_num);
+	std::vector<std::vector<char>> expected(frame_num);
+	std::string out_xml = dir + "/sequence_frame.xml", out_seq = dir + "/sequence.lns";
+	size_t xml_bytes = 0;
+	for (int f = 0; f < frame_num; f++) {
+		std::vector<char> source;
+		if (!roads[f].ReadFile(paths[f].c_str()) || !ReadBytes(paths[f], source) ||
+			!roads[f].WriteFile(out_xml.c_str()) || !ReadBytes(out_xml, expected[f])) {
+			printf("cannot read - \"%s\".\n", paths[f].c_str());
+			return 2;
+		}
+		xml_bytes += source.size();
+	}
+
+	int failed = 0;
+	size_t sequence_bytes[2] = { 0 };
+	for (int lossless = 1; lossless >= 0; lossless--) {
+		LaneSequenceWriter writer(32, 1000, lossless != 0);
+		for (int f = 0; f < frame_num; f++) writer.Append(roads[f], paths[f].c_str());
+		std::vector<unsigned char> file;
+		writer.SaveBuffer(file);
+		sequence_bytes[lossless] = file.size();
+
+		LaneSequenceReader reader;
+		if (!reader.OpenBuffer(&file[0], file.size()) || reader.GetSizeFrame() != frame_num) {
+			printf("cannot open the sequence\n");
+			return 1;
+		}
+		std::mt19937 rng(frame_num);
+		for (int k = 0; k < frame_num * 2; k++) {
+			int f = k < frame_num ? k : rng() % frame_num;
+			RoadLaneManager road;
+			std::vector<char> bytes;
+			bool ok = reader.ToRoadLane(f, road) && strcmp(reader.frame_name(f), paths[f].c_str()) == 0;
+			if (ok && lossless) ok = road.WriteFile(out_xml.c_str()) && ReadBytes(out_xml, bytes) && bytes == expected[f];
+			if (ok && !lossless) ok = NearRoadLane(roads[f], road, 0.5 / 1000 + 1e-9);
+			if (!ok && failed++ < 20) printf("%s: frame %d does not round trip%s\n", paths[f].c_str(), f, lossless ? "" : " (lossy)");
+		}
+	}
+
+	// loading the sequence: every xml against the sequence file
+	LaneSequenceWriter writer;
+	for (int f = 0; f < frame_num; f++) writer.Append(roads[f], paths[f].c_str());
+	writer.Save(out_seq.c_str());
+	double seconds[3];
+	Clock::time_point start = Clock::now();
+	for (int f = 0; f < frame_num; f++) {
+		RoadLaneManager road;
+		road.ReadFile(paths[f].c_str());
+	}
+	seconds[0] = Seconds(start);
+	start = Clock::now();
+	for (int f = 0; f < frame_num; f++) {
+		RoadLaneManager road;
+		road.ReadFileStream(paths[f].c_str());
+	}
+	seconds[1] = Seconds(start);
+	start = Clock::now();
+	LaneSequenceReader reader;
+	reader.Open(out_seq.c_str());
+	for (int f = 0; f < frame_num; f++) {
+		RoadLaneManager road;
+		reader.ToRoadLane(f, road);
+	}
+	seconds[2] = Seconds(start);
+
+	printf("%d frames, %d do not round trip\n", frame_num, failed);
+	printf("xml %zu bytes, sequence %zu bytes lossless (%.1fx), %zu bytes lossy (%.1fx)\n", xml_bytes,
+		sequence_bytes[1], (double)xml_bytes / sequence_bytes[1], sequence_bytes[0], (double)xml_bytes / sequence_bytes[0]);
+	printf("load: ReadFile %.2f ms, ReadFileStream %.2f ms, sequence %.2f ms\n",
+		seconds[0] * 1e3, seconds[1] * 1e3, seconds[2] * 1e3);
+	return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,209 @@
+#include "stdafx.h"
+#include "RoadLaneManager.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+// Hit tests of RoadLaneManager through its spatial index against the linear
+// scans they replaced (MousePointOnSpline of the view and the same loop over
+// boundaries and road markings).
+//
+//   LaneSpatialIndexBench [<objects>...]
+//     for each count (default 1000 and 4000) a 1920 x 1080 frame with that
+//     many lanes, boundaries and road markings:
+//       - time per query of the linear scans and of FindLineAt /
+//         FindBoundaryAt / FindRoadMarkingAt, and the index build time;
+//       - edit latency: move a lane, a boundary or a road marking through
+//         its *_ptr accessor, then hit test, as the view does while
+//         dragging; the first Find* after the edit updates the index for
+//         the moved object. After each edit random points are checked too.
+//
+// Exit code 0 when every index answer equals the linear scan, including the
+// ones right after an edit.
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double Seconds(Clock::time_point start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+template <typename LINE>
+void FillCurve(LINE &line, std::mt19937 &rng)
+{
+	std::uniform_real_distribution<double> u(0, 1);
+	double x0 = u(rng) * 1900, y0 = u(rng) * 900;
+	int n = 3 + rng() % 5;
+	for (int k = 0; k < n; k++) {
+		line.spline_x_.push_back(x0 + u(rng) * 80 - 40);
+		line.spline_y_.push_back(y0 + k * (10 + u(rng) * 60));
+		line.line_r_.push_back(1 + u(rng) * 6);
+	}
+	line.GenerateModels();
+}
+
+void FillRoad(RoadLaneManager &road, int count, std::mt19937 &rng)
+{
+	std::uniform_real_distribution<double> u(0, 1);
+	road.Reset(1920, 1080);
+	for (int i = 0; i < count; i++) {
+		FillCurve(road.EmplaceLine(), rng);
+		FillCurve(road.EmplaceBoundary(), rng);
+		vector<PPOINTF> points;
+		double cx = u(rng) * 1900, cy = u(rng) * 1060;
+		int n = 3 + rng() % 4;
+		for (int k = 0; k < n; k++) points.push_back(PPOINTF(cx + u(rng) * 60, cy + u(rng) * 60));
+		road.EmplacePolygon().SetPoints(points);
+	}
+}
+
+template <typename LINE>
+void MoveCurve(LINE &line, double dx)
+{
+	for (int k = 0; k < line.spline_x_.size(); k++) line.spline_x_[k] += dx;
+	line.GenerateModels();
+}
+
+template <typename LINE>
+int LinearCurveAt(const LaneCowVector<LINE> &lines, PPOINTF pt)
+{
+	for (int i = 0; i < lines.size(); i++) {
+		const LINE &line = lines[i];
+		if (line.top_y_ > pt.y || line.bottom_y_ < pt.y) continue;
+		PPOINT3F point3 = line.EstimatePoint(pt.y);
+		if (fabs(point3.x - pt.x) < (point3.r + 1))
+			return i;
+	}
+	return -1;
+}
+
+int LinearRoadMarkingAt(const RoadLaneManager &road, PPOINTF pt)
+{
+	for (int i = 0; i < road.GetSizeRoadMarking(); i++) {
+		if (road.roadmarking(i).GetPolygonPointNum() && road.roadmarking(i).PtInPolygon(pt))
+			return i;
+	}
+	return -1;
+}
+
+bool Run(int count)
+{
+	std::mt19937 rng(count);
+	std::uniform_real_distribution<double> u(0, 1);
+	RoadLaneManager road;
+	FillRoad(road, count, rng);
+
+	const int query_num = count >= 4000 ? 20000 : 50000;
+	std::vector<PPOINTF> queries(query_num);
+	for (int q = 0; q < query_num; q++) queries[q] = PPOINTF(u(rng) * 2000 - 40, u(rng) * 1140 - 30);
+
+	std::vector<int> linear(query_num * 3), indexed(query_num * 3);
+	Clock::time_point start = Clock::now();
+	for (int q = 0; q < query_num; q++) {
+		linear[q * 3] = LinearCurveAt(road.lines(), queries[q]);
+		linear[q * 3 + 1] = LinearCurveAt(road.boundarys(), queries[q]);
+		linear[q * 3 + 2] = LinearRoadMarkingAt(road, queries[q]);
+	}
+	double linear_time = Seconds(start);
+
+	start = Clock::now();
+	road.FindLineAt(PPOINTF(-1, -1));
+	double build_time = Seconds(start);
+
+	start = Clock::now();
+	for (int q = 0; q < query_num; q++) {
+		indexed[q * 3] = road.FindLineAt(queries[q]);
+		indexed[q * 3 + 1] = road.FindBoundaryAt(queries[q]);
+		indexed[q * 3 + 2] = road.FindRoadMarkingAt(queries[q]);
+	}
+	double index_time = Seconds(start);
+
+	int failed = 0, hits = 0;
+	for (int k = 0; k < query_num * 3; k++) {
+		if (indexed[k] != linear[k]) failed++;
+		if (linear[k] >= 0) hits++;
+	}
+
+	// drag: every edit moves a lane, boundary or road marking onto the probe
+	// point, which the next hit test must see without an InvalidateIndex call
+	const int edit_num = 300;
+	double edit_time = 0;
+	for (int e = 0; e < edit_num; e++) {
+		double dx = u(rng) * 20 - 10;
+		int found, expected;
+		if (e % 3 == 0) {
+			int idx = rng() % road.GetSizeLaneLine();
+			start = Clock::now();
+			LaneLine &line = *road.line_ptr(idx);
+			MoveCurve(line, dx);
+			PPOINTF probe(line.EstimatePoint((line.top_y_ + line.bottom_y_) / 2).x, (line.top_y_ + line.bottom_y_) / 2);
+			found = road.FindLineAt(probe);
+			edit_time += Seconds(start);
+			expected = LinearCurveAt(road.lines(), probe);
+		}
+		else if (e % 3 == 1) {
+			int idx = rng() % road.GetSizeBoundary();
+			start = Clock::now();
+			BoundaryLine &boundary = *road.boundary_ptr(idx);
+			MoveCurve(boundary, dx);
+			PPOINTF probe(boundary.EstimatePoint((boundary.top_y_ + boundary.bottom_y_) / 2).x, (boundary.top_y_ + boundary.bottom_y_) / 2);
+			found = road.FindBoundaryAt(probe);
+			edit_time += Seconds(start);
+			expected = LinearCurveAt(road.boundarys(), probe);
+		}
+		else {
+			int idx = rng() % road.GetSizeRoadMarking();
+			start = Clock::now();
+			RoadMarkingPolygon &polygon = *road.roadmarking_ptr(idx);
+			vector<PPOINTF> points = polygon.points();
+			PPOINTF probe(0, 0);
+			for (int k = 0; k < points.size(); k++) {
+				points[k].x += (float)dx;
+				probe.x += points[k].x / points.size();
+				probe.y += points[k].y / points.size();
+			}
+			polygon.SetPoints(points);
+			found = road.FindRoadMarkingAt(probe);
+			edit_time += Seconds(start);
+			expected = LinearRoadMarkingAt(road, probe);
+		}
+		if (found != expected) failed++;
+		for (int q = 0; q < 8; q++) {
+			PPOINTF pt(u(rng) * 2000 - 40, u(rng) * 1140 - 30);
+			if (road.FindLineAt(pt) != LinearCurveAt(road.lines(), pt) || road.FindBoundaryAt(pt) != LinearCurveAt(road.boundarys(), pt) ||
+				road.FindRoadMarkingAt(pt) != LinearRoadMarkingAt(road, pt)) failed++;
+		}
+	}
+
+	printf("%5d objects each: linear %8.2f us, index %6.2f us per query (3 kinds), build %6.2f ms, "
+		"edit + query %6.2f ms, %d hits, %d differ\n",
+		count, linear_time * 1e6 / query_num, index_time * 1e6 / query_num, build_time * 1e3,
+		edit_time * 1e3 / edit_num, hits, failed);
+	return failed == 0;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	std::vector<int> counts;
+	for (int i = 1; i < argc; i++) counts.push_back(atoi(argv[i]));
+	if (counts.empty()) {
+		counts.push_back(1000);
+		counts.push_back(4000);
+	}
+	bool ok = true;
+	for (int i = 0; i < counts.size(); i++) {
+		if (counts[i] <= 0) {
+			printf("usage: LaneSpatialIndexBench [<objects>...]\n");
+			return 2;
+		}
+		ok &= Run(counts[i]);
+	}
+	return ok ? 0 : 1;
+}
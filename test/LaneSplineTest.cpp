@@ -0,0 +1,144 @@
+#include "stdafx.h"
+#include "regressor.h"
+#include "RoadLaneManager.h"
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// LaneSpline (LaneSpline.h), the model LaneLine / BoundaryLine keep, against
+// svld::tk::spline of regressor.h, the model they kept before.
+//
+//   LaneSplineTest
+//     50000 random knot sets of 3-40 knots (uneven gaps, sub pixel gaps,
+//     steep and flat runs), cubic and linear. Both splines are fitted on
+//     the same knots and compared at every knot, between knots and past
+//     both ends: operator(), EvaluateRows with positive and negative steps,
+//     and EvaluateSplinePair. Then LaneLine::EstimatePoint and EvaluateRows
+//     of lines fitted from shuffled points against a tk::spline pair fitted
+//     on the same points sorted.
+//
+// Exit code 0 when every value is within 1e-9 of tk::spline.
+
+namespace {
+
+const double kTolerance = 1e-9;
+
+int g_failed = 0;
+double g_max_error = 0;
+
+void Expect(double value, double reference, const char *what, int set)
+{
+	double error = fabs(value - reference);
+	if (error > g_max_error) g_max_error = error;
+	if (!(error <= kTolerance) && g_failed++ < 20)
+		printf("set %d: %s %.17g, tk::spline %.17g\n", set, what, value, reference);
+}
+
+// distinct ascending knots
+void RandomKnots(std::mt19937 &rng, int n, std::vector<double> &x, std::vector<double> &y)
+{
+	std::uniform_real_distribution<double> u(0, 1);
+	x.resize(n);
+	y.resize(n);
+	double pos = u(rng) * 500;
+	for (int i = 0; i < n; i++) {
+		int kind = rng() % 4;
+		pos += kind == 0 ? 0.01 + u(rng) * 0.5 : (kind == 1 ? 50 + u(rng) * 300 : 1 + u(rng) * 30);
+		x[i] = pos;
+		y[i] = rng() % 3 == 0 ? (i ? y[i - 1] : 800) : u(rng) * 1920;
+	}
+}
+
+void CheckSet(const std::vector<double> &x, const std::vector<double> &y, bool cubic, int set)
+{
+	svld::tk::spline reference;
+	LaneSpline spline;
+	reference.set_points(x, y, cubic);
+	spline.set_points(x, y, cubic);
+
+	int n = x.size();
+	double first = x[0] - 40, last = x[n - 1] + 40;
+	for (int i = 0; i < n; i++) Expect(spline(x[i]), reference(x[i]), "knot", set);
+	for (double v = first; v <= last; v += (last - first) / 997) Expect(spline(v), reference(v), "operator()", set);
+
+	const int count = 600;
+	double step = (last - first) / (count - 1);
+	std::vector<double> rows(count), pair0(count), pair1(count);
+	spline.EvaluateRows(first, step, count, &rows[0]);
+	for (int i = 0; i < count; i++) Expect(rows[i], reference(first + i * step), "EvaluateRows", set);
+	spline.EvaluateRows(last, -step, count, &rows[0]);
+	for (int i = 0; i < count; i++) Expect(rows[i], reference(last - i * step), "EvaluateRows, negative step", set);
+
+	// a second spline on the same knots, as r(y) next to x(y)
+	std::vector<double> r(n);
+	for (int i = 0; i < n; i++) r[i] = 1 + fmod(y[i], 7);
+	svld::tk::spline reference_r;
+	LaneSpline spline_r;
+	reference_r.set_points(x, r, false);
+	spline_r.set_points(x, r, false);
+	EvaluateSplinePair(spline, spline_r, first, step, count, &pair0[0], &pair1[0]);
+	for (int i = 0; i < count; i++) {
+		Expect(pair0[i], reference(first + i * step), "EvaluateSplinePair", set);
+		Expect(pair1[i], reference_r(first + i * step), "EvaluateSplinePair, second", set);
+	}
+}
+
+void CheckLine(std::mt19937 &rng, int set)
+{
+	std::vector<double> y, x;
+	RandomKnots(rng, 3 + rng() % 20, y, x);
+	std::vector<double> r(y.size());
+	for (int i = 0; i < r.size(); i++) r[i] = 1 + rng() % 9;
+	// GenerateModels fits the points as PPOINT3F, as it always did
+	for (int i = 0; i < y.size(); i++) {
+		y[i] = (float)y[i];
+		x[i] = (float)x[i];
+	}
+
+	svld::tk::spline reference_x, reference_r;
+	reference_x.set_points(y, x);
+	reference_r.set_points(y, r, false);
+
+	std::vector<int> order(y.size());
+	for (int i = 0; i < order.size(); i++) order[i] = i;
+	std::shuffle(order.begin(), order.end(), rng);
+	LaneLine line;
+	for (int i = 0; i < order.size(); i++) {
+		line.spline_x_.push_back(x[order[i]]);
+		line.spline_y_.push_back(y[order[i]]);
+		line.line_r_.push_back(r[order[i]]);
+	}
+	if (!line.GenerateModels()) {
+		if (g_failed++ < 20) printf("set %d: GenerateModels failed\n", set);
+		return;
+	}
+	for (double v = line.top_y_ - 10; v < line.bottom_y_ + 10; v += 0.37) {
+		PPOINT3F point = line.EstimatePoint(v);
+		// EstimatePoint returns float, as it always did
+		Expect(point.x, (float)reference_x(v), "EstimatePoint x", set);
+		Expect(point.r, (float)reference_r(v), "EstimatePoint r", set);
+	}
+	std::vector<double> xs(LaneSplineRowCount(line.top_y_, line.bottom_y_, 1)), rs(xs.size());
+	int rows = line.EvaluateRows(line.top_y_, line.bottom_y_, 1, &xs[0], &rs[0]);
+	for (int i = 0; i < rows; i++) {
+		Expect(xs[i], reference_x(line.top_y_ + i), "LaneLine::EvaluateRows x", set);
+		Expect(rs[i], reference_r(line.top_y_ + i), "LaneLine::EvaluateRows r", set);
+	}
+}
+
+}
+
+int main()
+{
+	std::mt19937 rng(5);
+	std::vector<double> x, y;
+	for (int set = 0; set < 50000; set++) {
+		RandomKnots(rng, 3 + rng() % 38, x, y);
+		CheckSet(x, y, set % 2 == 0, set);
+	}
+	for (int set = 0; set < 5000; set++) CheckLine(rng, set);
+	printf("%d values differ by more than %g, largest difference %g\n", g_failed, kTolerance, g_max_error);
+	return g_failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,185 @@
+#include "stdafx.h"
+#include "LaneTypeMap.h"
+#include <limits.h>
+#include <stdio.h>
+
+// Exhaustive test of the LaneTypeMap.h tables against the if / else chains
+// they replaced, copied below as they were in GetLineTypes and
+// GetBoundaryTypes of the view.
+//
+//   LaneTypeMapTest
+//     every type4 x type3 of a LaneInfo (8 x 16 bits, so every side and id),
+//     every type3 of a BoundaryInfo with max_level -300..300 and INT_MIN /
+//     INT_MAX, every BoundaryType, and every type1 / type2 / type5 / type6.
+//
+// Exit code 0 when every lookup equals its chain.
+
+namespace {
+
+int OldLaneTypePos(const LaneInfo &info)
+{
+	int typePos = 0;
+	if (info.GetType4() == LaneInfo::OPPOSITE_SIDE && info.GetType3() == LaneInfo::LEFT)
+		typePos = 0;
+	else if (info.GetType4() == LaneInfo::BRANCH)
+		typePos = 1;
+	else if (info.GetType4() == LaneInfo::C4_NONE && info.GetType3() == LaneInfo::LEFT && info.GetType3_ID() == 3)
+		typePos = 2;
+	else if (info.GetType4() == LaneInfo::C4_NONE && info.GetType3() == LaneInfo::LEFT && info.GetType3_ID() == 2)
+		typePos = 3;
+	else if (info.GetType4() == LaneInfo::C4_NONE && info.GetType3() == LaneInfo::LEFT && info.GetType3_ID() == 1)
+		typePos = 4;
+	else if (info.GetType4() == LaneInfo::C4_NONE && info.GetType3() == LaneInfo::LEFT && info.GetType3_ID() == 0)
+		typePos = 5;
+	else if (info.GetType4() == LaneInfo::C4_NONE && info.GetType3() == LaneInfo::RIGHT && info.GetType3_ID() == 0)
+		typePos = 6;
+	else if (info.GetType4() == LaneInfo::C4_NONE && info.GetType3() == LaneInfo::RIGHT && info.GetType3_ID() == 1)
+		typePos = 7;
+	else if (info.GetType4() == LaneInfo::C4_NONE && info.GetType3() == LaneInfo::RIGHT && info.GetType3_ID() == 2)
+		typePos = 8;
+	else if (info.GetType4() == LaneInfo::C4_NONE && info.GetType3() == LaneInfo::RIGHT && info.GetType3_ID() == 3)
+		typePos = 9;
+	else if (info.GetType4() == LaneInfo::MERGED)
+		typePos = 10;
+	else if (info.GetType4() == LaneInfo::OPPOSITE_SIDE && info.GetType3() == LaneInfo::RIGHT)
+		typePos = 11;
+	else  //uncertain
+		typePos = 12;
+	return typePos;
+}
+
+int OldBoundaryTypePos(const BoundaryInfo &info, int max_level)
+{
+	int boundary_typePos = 0;
+	if (max_level == 0) {
+		if (info.GetType3() == BoundaryInfo::LEFT && info.GetType3_ID() == 0)
+			boundary_typePos = 0;
+		else if (info.GetType3() == BoundaryInfo::RIGHT && info.GetType3_ID() == 0)
+			boundary_typePos = 1;
+		else
+			boundary_typePos = 2;
+	}
+	else if (max_level == 1) {
+		if (info.GetType3() == BoundaryInfo::LEFT && info.GetType3_ID() == 1)
+			boundary_typePos = 0;
+		else if (info.GetType3() == BoundaryInfo::LEFT && info.GetType3_ID() == 0)
+			boundary_typePos = 1;
+		else if (info.GetType3() == BoundaryInfo::RIGHT && info.GetType3_ID() == 0)
+			boundary_typePos = 2;
+		else if (info.GetType3() == BoundaryInfo::RIGHT && info.GetType3_ID() == 1)
+			boundary_typePos = 3;
+		else
+			boundary_typePos = 4;
+	}
+	else if (max_level == 2) {
+		if (info.GetType3() == BoundaryInfo::LEFT && info.GetType3_ID() == 2)
+			boundary_typePos = 0;
+		else if (info.GetType3() == BoundaryInfo::LEFT && info.GetType3_ID() == 1)
+			boundary_typePos = 1;
+		else if (info.GetType3() == BoundaryInfo::LEFT && info.GetType3_ID() == 0)
+			boundary_typePos = 2;
+		else if (info.GetType3() == BoundaryInfo::RIGHT && info.GetType3_ID() == 0)
+			boundary_typePos = 3;
+		else if (info.GetType3() == BoundaryInfo::RIGHT && info.GetType3_ID() == 1)
+			boundary_typePos = 4;
+		else if (info.GetType3() == BoundaryInfo::RIGHT && info.GetType3_ID() == 2)
+			boundary_typePos = 5;
+		else
+			boundary_typePos = 6;
+	}
+	else {
+		if (info.GetType3() == BoundaryInfo::LEFT && info.GetType3_ID() > 2)
+			boundary_typePos = 0;
+		else if (info.GetType3() == BoundaryInfo::LEFT && info.GetType3_ID() == 2)
+			boundary_typePos = 1;
+		else if (info.GetType3() == BoundaryInfo::LEFT && info.GetType3_ID() == 1)
+			boundary_typePos = 2;
+		else if (info.GetType3() == BoundaryInfo::LEFT && info.GetType3_ID() == 0)
+			boundary_typePos = 3;
+		else if (info.GetType3() == BoundaryInfo::RIGHT && info.GetType3_ID() == 0)
+			boundary_typePos = 4;
+		else if (info.GetType3() == BoundaryInfo::RIGHT && info.GetType3_ID() == 1)
+			boundary_typePos = 5;
+		else if (info.GetType3() == BoundaryInfo::RIGHT && info.GetType3_ID() == 2)
+			boundary_typePos = 6;
+		else if (info.GetType3() == BoundaryInfo::RIGHT && info.GetType3_ID() > 2)
+			boundary_typePos = 7;
+		else
+			boundary_typePos = 8;
+	}
+	return boundary_typePos;
+}
+
+int OldBoundaryTypeShape(const BoundaryInfo &info)
+{
+	int boundary_typeShape = 0;
+	if (info.GetBoundaryType() == BoundaryInfo::WALLS)
+		boundary_typeShape = 0;
+	else if (info.GetBoundaryType() == BoundaryInfo::STATIONARY_VEHICLES)
+		boundary_typeShape = 1;
+	else if (info.GetBoundaryType() == BoundaryInfo::GUARDRAIL)
+		boundary_typeShape = 2;
+	else if (info.GetBoundaryType() == BoundaryInfo::CURBS)
+		boundary_typeShape = 3;
+	else if (info.GetBoundaryType() == BoundaryInfo::STATIC_LANE_SEPARATOR ||
+		info.GetBoundaryType() == BoundaryInfo::LANE_SEPARATOR)
+		boundary_typeShape = 4;
+	else if (info.GetBoundaryType() == BoundaryInfo::PLASTIC_WALL ||
+		info.GetBoundaryType() == BoundaryInfo::DRUM ||
+		info.GetBoundaryType() == BoundaryInfo::BEACONS ||
+		info.GetBoundaryType() == BoundaryInfo::CONE)
+		boundary_typeShape = 5;
+	else if (info.GetBoundaryType() == BoundaryInfo::ROAD_EDGE)
+		boundary_typeShape = 6;
+	else
+		boundary_typeShape = 7;
+	return boundary_typeShape;
+}
+
+long long g_checked = 0, g_failed = 0;
+
+void Expect(int actual, int expected, const char *what, int a, int b)
+{
+	g_checked++;
+	if (actual != expected && g_failed++ < 20)
+		printf("%s (%d, %d): %d, chain %d\n", what, a, b, actual, expected);
+}
+
+}
+
+int main()
+{
+	LaneInfo lane;
+	for (int type4 = -128; type4 <= 127; type4++) {
+		lane.type4 = type4;
+		for (int type3 = -32768; type3 <= 32767; type3++) {
+			lane.type3 = type3;
+			Expect(LaneTypePos(lane), OldLaneTypePos(lane), "lane typePos of type4, type3", type4, type3);
+		}
+	}
+	for (int value = -128; value <= 127; value++) {
+		lane.type1 = lane.type2 = lane.type5 = lane.type6 = value;
+		Expect(LaneTypeShape(lane), lane.GetType1() - 1, "lane typeShape of type1", value, 0);
+		Expect(LaneTypeSD(lane), lane.GetType2() - 1, "lane typeSD of type2", value, 0);
+		Expect(LaneTypeColor(lane), lane.GetType5() - 1, "lane typeColor of type5", value, 0);
+		Expect(LaneTypeBicycle(lane), lane.GetType6() - 1, "lane typeBicycle of type6", value, 0);
+	}
+
+	BoundaryInfo boundary;
+	static const int extreme_levels[] = { INT_MIN, INT_MIN + 1, INT_MAX - 1, INT_MAX };
+	for (int level = -304; level <= 300; level++) {
+		int max_level = level >= -300 ? level : extreme_levels[level + 304];
+		for (int type3 = -32768; type3 <= 32767; type3++) {
+			boundary.type3 = type3;
+			Expect(BoundaryTypePos(boundary, max_level), OldBoundaryTypePos(boundary, max_level),
+				"boundary typePos of max_level, type3", max_level, type3);
+		}
+	}
+	for (int type = -128; type <= 127; type++) {
+		boundary.BoundaryType = type;
+		Expect(BoundaryTypeShape(boundary), OldBoundaryTypeShape(boundary), "boundary typeShape of BoundaryType", type, 0);
+	}
+
+	printf("%lld lookups, %lld differ from the chains\n", g_checked, g_failed);
+	return g_failed == 0 ? 0 : 1;
+}
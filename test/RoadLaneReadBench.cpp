@@ -0,0 +1,166 @@
+#include "stdafx.h"
+#include "RoadLaneManager.h"
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <new>
+#include <string>
+#include <vector>
+
+// ReadFileStream against the DOM ReadFile on a file set.
+//
+//   RoadLaneReadBench <xml | @list>...
+//     @list names a text file with one xml path per line, so a whole dataset
+//     (e.g. the lane xmls of a UDB split) can be given. Every file is read
+//     both ways and the two managers compared; then each path reads the
+//     whole set again and is timed, with the files in the OS cache by then.
+//     The tool version is not compared: ReadFile does not keep it.
+//     Files only one path accepts are listed but not counted as different,
+//     since ReadFile returns true on a missing element (the nonzero
+//     XML_ERROR_PARSING_ELEMENT it returns converts to true).
+//     First a frame whose splineNum / pointNum / occNum / polygonNum /
+//     boundaryNum are 2000000000 must read with ReadBufferStream, without
+//     reserving for those counts.
+//
+// Exit code 0 when the corrupt counts read and every file both paths read
+// gives the same manager.
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+template <typename LINE>
+bool SameCurve(const LINE &a, const LINE &b)
+{
+	return a.spline_x_ == b.spline_x_ && a.spline_y_ == b.spline_y_ && a.line_r_ == b.line_r_ &&
+		a.top_y_ == b.top_y_ && a.bottom_y_ == b.bottom_y_ &&
+		a.info.occlusions_top_bottom_ == b.info.occlusions_top_bottom_;
+}
+
+// what differs, NULL when nothing
+const char *Difference(const RoadLaneManager &a, const RoadLaneManager &b)
+{
+	if (a.GetImageW() != b.GetImageW() || a.GetImageH() != b.GetImageH()) return "image size";
+	if (a.has_vp() != b.has_vp() || a.vp_x_ratio() != b.vp_x_ratio() || a.vp_y_ratio() != b.vp_y_ratio()) return "vp";
+	if (a.GetSizeLaneLine() != b.GetSizeLaneLine()) return "spline count";
+	for (int i = 0; i < a.GetSizeLaneLine(); i++) {
+		const LaneInfo &x = a.line(i).info, &y = b.line(i).info;
+		if (x.type1 != y.type1 || x.type2 != y.type2 || x.type3 != y.type3 || x.type4 != y.type4 ||
+			x.type5 != y.type5 || x.type6 != y.type6) return "spline types";
+		if (!SameCurve(a.line(i), b.line(i))) return "spline points";
+	}
+	if (a.GetSizeRoadMarking() != b.GetSizeRoadMarking()) return "polygon count";
+	for (int i = 0; i < a.GetSizeRoadMarking(); i++) {
+		if (a.roadmarking(i).GetRoadMarkerInfo().type != b.roadmarking(i).GetRoadMarkerInfo().type) return "polygon type";
+		const vector<PPOINTF> &p = a.roadmarking(i).points(), &q = b.roadmarking(i).points();
+		if (p.size() != q.size()) return "polygon points";
+		for (size_t k = 0; k < p.size(); k++) {
+			if (p[k].x != q[k].x || p[k].y != q[k].y) return "polygon points";
+		}
+	}
+	if (a.GetSizeBoundary() != b.GetSizeBoundary()) return "boundary count";
+	for (int i = 0; i < a.GetSizeBoundary(); i++) {
+		const BoundaryInfo &x = a.boundary(i).info, &y = b.boundary(i).info;
+		if (x.type3 != y.type3 || x.BoundaryType != y.BoundaryType || x.Situation != y.Situation) return "boundary types";
+		if (!SameCurve(a.boundary(i), b.boundary(i))) return "boundary points";
+	}
+	return NULL;
+}
+
+// counts far past what the file holds read the elements that are there
+bool ReadsCorruptCounts()
+{
+	static const char xml[] =
+		"<RoadLane imageWidth=\"1920\" imageHeight=\"1080\">"
+		"<VP hasVP=\"true\" y_ratio=\"0.4\" x_ratio=\"0.5\"/>"
+		"<Splines splineNum=\"2000000000\">"
+		"<Spline type1=\"1\" type2=\"1\" type3=\"1\" type4=\"0\" type5=\"1\" type6=\"0\" pointNum=\"2000000000\" occNum=\"2000000000\">"
+		"<Point x=\"900\" y=\"500\" r=\"2\"/><Point x=\"850\" y=\"700\" r=\"3\"/><Point x=\"800\" y=\"900\" r=\"4\"/>"
+		"<Occlusion top=\"600\" bottom=\"650\"/></Spline></Splines>"
+		"<Polygons polygonNum=\"2000000000\"><Polygon pointNum=\"2000000000\" type=\"1\">"
+		"<Point x=\"10\" y=\"10\"/><Point x=\"60\" y=\"10\"/><Point x=\"60\" y=\"40\"/></Polygon></Polygons>"
+		"<Boundarys boundaryNum=\"2000000000\"><Boundary type3=\"1\" boundary=\"1\" pointNum=\"2000000000\" occNum=\"2000000000\">"
+		"<Point x=\"100\" y=\"500\"/><Point x=\"110\" y=\"700\"/><Point x=\"120\" y=\"900\"/></Boundary></Boundarys>"
+		"</RoadLane>";
+	RoadLaneManager road;
+	try {
+		if (!road.ReadBufferStream(xml, sizeof(xml) - 1, "corrupt counts")) return false;
+	}
+	catch (const std::bad_alloc &) {
+		return false;
+	}
+	return road.GetSizeLaneLine() == 1 && road.line(0).spline_x_.size() == 3 && road.line(0).info.occlusions_top_bottom_.size() == 1 &&
+		road.GetSizeRoadMarking() == 1 && road.roadmarking(0).points().size() == 3 &&
+		road.GetSizeBoundary() == 1 && road.boundary(0).spline_x_.size() == 3;
+}
+
+bool AddPaths(const char *arg, std::vector<std::string> &paths)
+{
+	if (arg[0] != '@') {
+		paths.push_back(arg);
+		return true;
+	}
+	FILE *fp = fopen(arg + 1, "r");
+	if (!fp) {
+		printf("cannot read - \"%s\".\n", arg + 1);
+		return false;
+	}
+	char line[4096];
+	while (fgets(line, sizeof(line), fp)) {
+		size_t len = strcspn(line, "\r\n");
+		line[len] = 0;
+		if (len) paths.push_back(line);
+	}
+	fclose(fp);
+	return true;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; i++) {
+		if (!AddPaths(argv[i], paths)) return 2;
+	}
+	if (paths.empty()) {
+		printf("usage: RoadLaneReadBench <xml | @list>...\n");
+		return 2;
+	}
+
+	bool corrupt_ok = ReadsCorruptCounts();
+	if (!corrupt_ok) printf("corrupt counts: ReadBufferStream failed\n");
+
+	int different = 0, one_sided = 0, unread = 0;
+	for (size_t i = 0; i < paths.size(); i++) {
+		RoadLaneManager dom, stream;
+		bool dom_ok = dom.ReadFile(paths[i].c_str());
+		bool stream_ok = stream.ReadFileStream(paths[i].c_str());
+		if (!dom_ok && !stream_ok) {
+			unread++;
+		}
+		else if (dom_ok != stream_ok) {
+			if (one_sided++ < 10) printf("%s: only %s reads it\n", paths[i].c_str(), dom_ok ? "ReadFile" : "ReadFileStream");
+		}
+		else if (const char *what = Difference(dom, stream)) {
+			if (different++ < 20) printf("%s: %s differ\n", paths[i].c_str(), what);
+		}
+	}
+
+	double seconds[2];
+	for (int pass = 0; pass < 2; pass++) {
+		Clock::time_point start = Clock::now();
+		for (size_t i = 0; i < paths.size(); i++) {
+			RoadLaneManager road;
+			if (pass == 0) road.ReadFile(paths[i].c_str());
+			else road.ReadFileStream(paths[i].c_str());
+		}
+		seconds[pass] = std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	printf("%zu files: %d differ, %d read by one path only, %d unreadable\n", paths.size(), different, one_sided, unread);
+	printf("ReadFile       %8.3f s, %8.1f us per file\n", seconds[0], seconds[0] * 1e6 / paths.size());
+	printf("ReadFileStream %8.3f s, %8.1f us per file, %.1fx\n", seconds[1], seconds[1] * 1e6 / paths.size(),
+		seconds[1] > 0 ? seconds[0] / seconds[1] : 0.0);
+	return corrupt_ok && different == 0 ? 0 : 1;
+}
@@ -11,6 +11,7 @@
 #include "caffe/util/im_transforms.hpp"
 #include "caffe/util/path_utils.hpp"
 #include <boost/filesystem.hpp>
+#include "lane_label_rle.hpp"
 
 #ifdef USE_CUDNN
 #define MAX_BATCH_FOR_SINGLE_THREAD 0
@@ -705,8 +706,7 @@ namespace caffe {
 		}
 		if (point->seg_path_.size()) {
 			boost::mutex::scoped_lock lock(tar_reader_mutex_);
-			point->tar_reader_seg_->read(point->seg_path_, seg
-				_data);
+			point->tar_reader_seg_->read(point->seg_path_, seg_data);
 		}
 
 		if (img_data.size()) {
@@ -725,9 +725,22 @@ namespace caffe {
 
 		if (seg_data.size()) {
 			cv::Mat buf(1, seg_data.size(), CV_8UC1, const_cast<char*>(seg_data.c_str()));
-			udb_datum->seg_ = cv::imdecode(buf, CV_LOAD_IMAGE_COLOR);
-			CHECK_EQ(udb_datum->img_.rows, udb_datum->seg_.rows) << "Image rows is different between: " << point->img_path_ << "<=>" << point->seg_path_;
-			CHECK_EQ(udb_datum->img_.cols, udb_datum->seg_.cols) << "Image cols is different between: " << point->img_path_ << "<=>" << point->seg_path_;
+			int seg_rows, seg_cols;
+			if (LaneLabelRle::IsRle(seg_data.data(), seg_data.size())) {
+				// kept encoded, see GetLaneLabelRle
+				LaneLabelRle rle;
+				CHECK(rle.Parse(seg_data.data(), seg_data.size())) << "Invalid run length label: " << point->seg_path_;
+				udb_datum->seg_ = buf.clone();
+				seg_rows = rle.height();
+				seg_cols = rle.width();
+			}
+			else {
+				udb_datum->seg_ = cv::imdecode(buf, CV_LOAD_IMAGE_COLOR);
+				seg_rows = udb_datum->seg_.rows;
+				seg_cols = udb_datum->seg_.cols;
+			}
+			CHECK_EQ(udb_datum->img_.rows, seg_rows) << "Image rows is different between: " << point->img_path_ << "<=>" << point->seg_path_;
+			CHECK_EQ(udb_datum->img_.cols, seg_cols) << "Image cols is different between: " << point->img_path_ << "<=>" << point->seg_path_;
 		}
 		else {
 			udb_datum->seg_.release();
@@ -1916,6 +1929,85 @@ namespace caffe {
 		}
 	}
 
+	// A seg_ of type CV_8UC1 holds the bytes of a run length label file
+	// (lane_label_rle.hpp) instead of BGR pixels.
+	static bool GetLaneLabelRle(const cv::Mat& seg, LaneLabelRle& rle) {
+		return seg.type() == CV_8UC1 && rle.Parse(seg.data, seg.total());
+	}
+
+	// seg_ as BGR pixels
+	static cv::Mat GetLaneLabelImage(const cv::Mat& seg) {
+		LaneLabelRle rle;
+		if (!GetLaneLabelRle(seg, rle)) {
+			return seg;
+		}
+		cv::Mat image(rle.height(), rle.width(), CV_8UC3);
+		rle.Expand(image.data, image.step);
+		return image;
+	}
+
+	// SetSegData on run length labels: same sampling, but the pixel is found
+	// by a cursor moving along the runs of its row and the color is mapped
+	// once per change of color instead of once per pixel.
+	template<typename Dtype, typename SegmentMap>
+	static void SetSegRleData(const LaneLabelRle& rle, const SegmentMap& segment_map, bool rgb2int, int map_scale, bool label_resize,
+		bool rnd_affine, Dtype* data, bool mirror, int width, int height, int resized_width, int resized_height, int crop_x, int crop_y,
+		Dtype im_scale_x, Dtype im_scale_y, const Dtype* affine_param) {
+		const Dtype& ai = affine_param[4];
+		const Dtype& bi = affine_param[5];
+		const Dtype& ci = affine_param[6];
+		const Dtype& di = affine_param[7];
+
+		int cached_color = -1;
+		int cached_label = 0;
+		for (int i = 0; i < resized_height; i++) {
+			int cursor = 0;
+			for (int j = 0; j < resized_width; j++) {
+				Dtype x = crop_x + j / im_scale_x;
+				Dtype y = crop_y + i / im_scale_y;
+
+				if (mirror) {
+					x = width - x - 1;
+				}
+
+				if (rnd_affine) {
+					Dtype _x = ai * x + bi * y;
+					Dtype _y = ci * x + di * y;
+					x = _x;
+					y = _y;
+				}
+				int label = 0;
+				if (x >= 0 && x <= width - 1 && y >= 0 && y <= height - 1) {
+					int x0 = (int)x;
+					int y0 = (int)y;
+					int run = rle.Find(y0, x0, cursor);
+					int segColor = run < 0 ? 0 : rle.run(run).label;
+					if (rgb2int) {
+						label = segColor;
+					}
+					else {
+						if (segColor != cached_color) {
+							auto it = segment_map.find(segColor);
+							CHECK(it != segment_map.end()) << "Unknown Color - R: " << (int)INT2R(segColor) << ", G: " << (int)INT2G(segColor) << ", B: " << (int)INT2B(segColor);
+							cached_color = segColor;
+							cached_label = it->second;
+						}
+						label = cached_label;  //seg
+					}
+				}
+				int data_c = (i % map_scale) * map_scale + (j % map_scale);
+				int data_y = i / map_scale;
+				int data_x = j / map_scale;
+				if (!label_resize) {
+					data[(data_c * (resized_height / map_scale) + data_y) * (resized_width / map_scale) + data_x] = label;
+				}
+				else if (data_c == 0) {
+					data[data_y * (resized_width / map_scale) + data_x] = label;
+				}
+			}
+		}
+	}
+
 	template<typename Dtype>
 	void UDBDataLayer<Dtype>::SetSegData(const unsigned char* src_data, Dtype* data, int seg_index,
 		bool mirror, int width, int height, int resized_width, int resized_height, int crop_x, int crop_y, Dtype im_scale_x, Dtype im_scale_y, const Dtype* affine_param) {
@@ -3328,13 +3420,21 @@ namespace caffe {
 			SetImgData(img.data, _data, mirror, color_aug, width, height, resized_width, resized_height, crop_x, crop_y, im_scale_x, im_scale_y, affine_param);
 
 			if (use_seg_) {
+				LaneLabelRle seg_rle;
+				bool seg_is_rle = GetLaneLabelRle(cur_data.seg_, seg_rle);
 				for (int i = 0; i < num_segments_; i++) {
-					SetSegData(cur_data.seg_.data, _seg[i], i, mirror, width, height, resized_width, resized_height, crop_x, crop_y, im_scale_x, im_scale_y, affine_param);
+					if (seg_is_rle) {
+						SetSegRleData(seg_rle, segment_map_[i], seg_output_rgb2int_, segment_map_scale_[i], segment_label_resize_[i], rnd_affine_,
+							_seg[i], mirror, width, height, resized_width, resized_height, crop_x, crop_y, im_scale_x, im_scale_y, affine_param);
+					}
+					else {
+						SetSegData(cur_data.seg_.data, _seg[i], i, mirror, width, height, resized_width, resized_height, crop_x, crop_y, im_scale_x, im_scale_y, affine_param);
+					}
 				}
 			}
 
 			if (use_edge_) {
-				MakeEdge(cur_data.seg_, _edge, mirror, width, height, resized_width, resized_height, crop_x, crop_y, im_scale_x, im_scale_y);
+				MakeEdge(GetLaneLabelImage(cur_data.seg_), _edge, mirror, width, height, resized_width, resized_height, crop_x, crop_y, im_scale_x, im_scale_y);
 			}
 
 			if (use_scene_lbl_) {
@@ -3589,7 +3689,7 @@ namespace caffe {
 				cv::Mat ori;
 				cv::Mat trn;
 				if (use_seg_) {
-					cv::Mat segmap_ori = cur_data.seg_.clone();
+					cv::Mat segmap_ori = GetLaneLabelImage(cur_data.seg_).clone();
 					int segmap_width = 0;
 					for (int i = 0; i < num_segments_; i++) {
 						segmap_width += segment_label_resize_[i] ? resized_width / segment_map_scale_[i] : resized_width;